@@ -139,6 +139,7 @@ static std::string runScript(const std::string &source_text)
   moduleMgr->registerIoStreamLib();
   //moduleMgr->registerIoLib(); // not needed in browser version
   moduleMgr->registerDateTimeLib();
+  moduleMgr->registerJsonLib();
 
   sq_newtable(vm);
   HSQOBJECT hBindings;
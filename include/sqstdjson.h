@@ -0,0 +1,15 @@
+/*  see copyright notice in squirrel.h */
+#ifndef _SQSTD_JSONLIB_H_
+#define _SQSTD_JSONLIB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SQUIRREL_API SQRESULT sqstd_register_jsonlib(HSQUIRRELVM v);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* _SQSTD_JSONLIB_H_ */
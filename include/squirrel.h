@@ -245,10 +245,27 @@ typedef struct tagSQFunctionInfo {
     SQInteger line;
 }SQFunctionInfo;
 
+typedef struct tagSQMemoryStats {
+    SQUnsignedInteger usedBytes;
+    SQUnsignedInteger peakBytes;
+    SQUnsignedInteger limitBytes; // 0 - unlimited
+}SQMemoryStats;
+
+typedef struct tagSQMemProfileSite {
+    const char *source; // "native" for objects created outside of script code
+    SQInteger line;
+    SQObjectType type;
+    SQUnsignedInteger liveBytes;
+    SQUnsignedInteger liveCount;
+    SQUnsignedInteger totalBytes;
+    SQUnsignedInteger totalCount;
+}SQMemProfileSite;
+
 #define BIT(n) (1ULL << (n))
 
 enum CompilationOptions : SQUnsignedInteger {
-  CO_CLOSURE_HOISTING_OPT = BIT(1)
+  CO_CLOSURE_HOISTING_OPT = BIT(1),
+  CO_CHAIN_FUSION_OPT = BIT(2)
 };
 
 #undef BIT
@@ -438,6 +455,7 @@ SQUIRREL_API SQRESULT sq_setfreevariable(HSQUIRRELVM v,SQInteger idx,SQUnsignedI
 SQUIRREL_API SQRESULT sq_next(HSQUIRRELVM v,SQInteger idx);
 SQUIRREL_API SQRESULT sq_getweakrefval(HSQUIRRELVM v,SQInteger idx);
 SQUIRREL_API SQRESULT sq_clear(HSQUIRRELVM v,SQInteger idx,SQBool freemem = SQTrue);
+SQUIRREL_API SQRESULT sq_compact(HSQUIRRELVM v,SQInteger idx,SQBool recursive);
 SQUIRREL_API SQRESULT sq_freeze(HSQUIRRELVM v, SQInteger idx);
 SQUIRREL_API SQRESULT sq_freeze_inplace(HSQUIRRELVM v, SQInteger idx);
 SQUIRREL_API SQRESULT sq_mark_pure_inplace(HSQUIRRELVM v, SQInteger idx);
@@ -521,6 +539,12 @@ SQUIRREL_API bool sq_canaccessfromthisthread(HSQUIRRELVM vm);
 typedef struct SQAllocContextT * SQAllocContext;
 SQUIRREL_API SQAllocContext sq_getallocctx(HSQUIRRELVM v);
 
+/*memory accounting*/
+SQUIRREL_API void sq_setmemorylimit(HSQUIRRELVM v, SQUnsignedInteger limit);
+SQUIRREL_API void sq_getmemorystats(HSQUIRRELVM v, SQMemoryStats *stats);
+SQUIRREL_API void sq_enablememprofiler(HSQUIRRELVM v, SQBool enable, SQUnsignedInteger sample_bytes);
+SQUIRREL_API SQInteger sq_getmemprofile(HSQUIRRELVM v, SQMemProfileSite *sites, SQInteger maxsites);
+
 /*mem allocation*/
 SQUIRREL_API void *sq_malloc(SQAllocContext ctx, SQUnsignedInteger size);
 SQUIRREL_API void *sq_realloc(SQAllocContext ctx, void* p,SQUnsignedInteger oldsize,SQUnsignedInteger newsize);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <squirrel.h>
+
+/*
+* Number <-> text conversions shared by the VM, the compiler and the standard library.
+* They use std::to_chars()/std::from_chars() when the C++ library has them for floats and
+* fall back to snprintf()/strtod() otherwise, either way the results are the same as the
+* printf()/strtod() ones scripts always got, without the locale and format string overhead.
+* Printing doesn't write a terminating zero and returns the number of chars written.
+*/
+
+// enough for sqnum_print_integer() and sqnum_print_float()
+#define SQNUM_BUF_SIZE 32
+
+// printf(_PRINT_INT_FMT)
+SQInteger sqnum_print_integer(char *buf, SQInteger i);
+// printf("%g"), how tostring() prints floats
+SQInteger sqnum_print_float(char *buf, SQFloat f);
+// printf("%.<precision><conv>") for conv 'f', 'e' or 'g', a negative precision is the default 6,
+// -1 if the result doesn't fit into size chars
+SQInteger sqnum_print_float_fmt(char *buf, SQInteger size, SQFloat f, char conv, int precision);
+// the shortest text sqnum_parse_float() reads back as exactly f, f has to be finite
+SQInteger sqnum_print_float_roundtrip(char *buf, SQFloat f);
+
+// strtod() over [begin,end): the longest prefix that is a number, false if there is none
+bool sqnum_parse_float(const char *begin, const char *end, SQFloat &res);
+// strtoll() with the given base over [begin,end)
+bool sqnum_parse_integer(const char *begin, const char *end, int base, SQInteger &res);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <squirrel.h>
+
+/*
+* Byte scanning kernels for the string type methods and the string library.
+* They look at 16 chars at a time with SSE2 where the target has it and use memchr() and
+* plain loops elsewhere, the results are the same either way. Zero bytes are ordinary
+* chars for all of them.
+*/
+
+// the first occurrence of needle in hay or NULL, needle_len has to be at least 1
+const char *sqstr_find(const char *hay, SQInteger hay_len, const char *needle, SQInteger needle_len);
+// the first char of [s,end) that is one of chars[0..nchars), end if there is none
+const char *sqstr_find_first_of(const char *s, const char *end, const char *chars, SQInteger nchars);
+// the first sq_isspace() char of [s,end), end if there is none
+const char *sqstr_find_space(const char *s, const char *end);
+// the first char of [s,end) that is not printable or is one of \ " ', end if there is none
+const char *sqstr_find_escape(const char *s, const char *end);
+// the first char of [s,end) that is a " a \ or below 0x20, end if there is none
+const char *sqstr_find_json_escape(const char *s, const char *end);
+// sq_tolower()/sq_toupper() of len chars, dst may be src
+void sqstr_tolower(char *dst, const char *src, SQInteger len);
+void sqstr_toupper(char *dst, const char *src, SQInteger len);
@@ -75,6 +75,8 @@ void PrintUsage()
         "  --parse-types             parse function types from file\n"
         "  --D:<diagnostic-name>     disable diagnostic by text id\n"
         "  -optCH                    enable Closure Hoisting Optimization\n"
+        "  -optCF                    enable fusion of array map/filter/reduce/each chains\n"
+        "  -memprofile [bytes]       print memory usage by allocation site after execution\n"
         "  -d                        generates debug infos\n"
         "  -v                        displays version\n"
         "  -h                        prints help\n");
@@ -104,6 +106,31 @@ static std::string read_file_ignoring_utf8bom(const char *filename)
     return result;
 }
 
+static void print_mem_profile(HSQUIRRELVM v)
+{
+    static const int maxSites = 20;
+    SQMemProfileSite sites[maxSites];
+    SQInteger total = sq_getmemprofile(v, sites, maxSites);
+    if (SQ_FAILED(total))
+        return;
+    SQInteger n = total < maxSites ? total : maxSites;
+
+    fprintf(stderr, "\nMemory by allocation site (%d of %d sites):\n", int(n), int(total));
+    fprintf(stderr, "%12s %10s %12s %10s  %-8s %s\n", "live bytes", "live objs", "total bytes", "total objs", "type", "site");
+    for (SQInteger i = 0; i < n; i++) {
+        const SQMemProfileSite &s = sites[i];
+        const char *type = s.type == OT_TABLE ? "table" : s.type == OT_ARRAY ? "array" : s.type == OT_STRING ? "string"
+            : s.type == OT_CLOSURE ? "function" : "instance";
+        fprintf(stderr, "%12llu %10llu %12llu %10llu  %-8s %s",
+            (unsigned long long)s.liveBytes, (unsigned long long)s.liveCount,
+            (unsigned long long)s.totalBytes, (unsigned long long)s.totalCount,
+            type, s.source);
+        if (s.line >= 0)
+            fprintf(stderr, ":%d", int(s.line));
+        fprintf(stderr, "\n");
+    }
+}
+
 static int fill_stack(HSQUIRRELVM v)
 {
   if (!check_stack_mode)
@@ -350,6 +377,7 @@ int getargs(HSQUIRRELVM v,int argc, char* argv[],SQInteger *retval)
     int compiles_only = 0;
     bool static_analysis = checkOption(argv, argc, "sa", optArg); // TODO: refact ugly loop below using this function
     bool parse_types = false;
+    bool mem_profile = false;
 
     if (static_analysis) {
       sq_enablesyntaxwarnings(true);
@@ -430,6 +458,16 @@ int getargs(HSQUIRRELVM v,int argc, char* argv[],SQInteger *retval)
             else if (strcmp("-optCH", arg) == 0) {
                 sq_setcompilationoption(v, CompilationOptions::CO_CLOSURE_HOISTING_OPT, true);
             }
+            else if (strcmp("-optCF", arg) == 0) {
+                sq_setcompilationoption(v, CompilationOptions::CO_CHAIN_FUSION_OPT, true);
+            }
+            else if (strcmp("-memprofile", arg) == 0) {
+                SQInteger sampleBytes = 0;
+                if ((index + 1) < argc && isdigit((unsigned char)argv[index + 1][0]))
+                    sampleBytes = atoi(argv[++index]);
+                mem_profile = true;
+                sq_enablememprofiler(v, SQTrue, sampleBytes);
+            }
             else if (strcmp("-v", arg) == 0 || strcmp("--version", arg) == 0) {
                 PrintVersionInfos();
                 return _DONE;
@@ -472,6 +510,7 @@ int getargs(HSQUIRRELVM v,int argc, char* argv[],SQInteger *retval)
 
         if (static_analysis) {
           sq_setcompilationoption(v, CompilationOptions::CO_CLOSURE_HOISTING_OPT, false);
+          sq_setcompilationoption(v, CompilationOptions::CO_CHAIN_FUSION_OPT, false);
         }
 
         if (diagFile)
@@ -537,6 +576,10 @@ int getargs(HSQUIRRELVM v,int argc, char* argv[],SQInteger *retval)
                   sq_checkglobalnames(v);
                 }
 
+                if (mem_profile) {
+                  print_mem_profile(v);
+                }
+
                 if (retCode != _DONE) {
                   fprintf(stderr, "Error [%s]\n", errMsg.c_str());
                 }
@@ -589,6 +632,7 @@ int sq_interpreter_main(int argc, char* argv[])
     module_mgr->registerIoStreamLib();
     module_mgr->registerIoLib();
     module_mgr->registerDateTimeLib();
+    module_mgr->registerJsonLib();
     module_mgr->registerDebugLib();
 
     sqstd_register_command_line_args(v, argc, argv);
@@ -7,6 +7,7 @@
 #include <sqstdio.h>
 #include <sqstdsystem.h>
 #include <sqstddatetime.h>
+#include <sqstdjson.h>
 #include <sqstdaux.h>
 
 #include <stdlib.h>
@@ -740,6 +741,8 @@ void SqModules::registerSystemLib() { registerStdLibNativeModule("system", sqstd
 
 void SqModules::registerDateTimeLib() { registerStdLibNativeModule("datetime", sqstd_register_datetimelib); }
 
+void SqModules::registerJsonLib() { registerStdLibNativeModule("json", sqstd_register_jsonlib); }
+
 void SqModules::registerDebugLib() { registerStdLibNativeModule("debug", sqstd_register_debuglib); }
 
 void SqModules::registerIoStreamLib()
@@ -110,6 +110,7 @@ public:
   void registerIoStreamLib();
   void registerIoLib();
   void registerDateTimeLib();
+  void registerJsonLib();
   void registerDebugLib();
   void registerModulesLib();
 
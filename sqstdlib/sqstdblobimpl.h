@@ -1,6 +1,8 @@
 /*  see copyright notice in squirrel.h */
 #pragma once
 
+#define SQSTD_BLOB_TYPE_TAG ((SQUnsignedInteger)(SQSTD_STREAM_TYPE_TAG | 0x00000002))
+
 struct SQBlob : public SQStream
 {
     SQBlob(SQAllocContext alloc_ctx, SQInteger size)
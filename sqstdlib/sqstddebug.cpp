@@ -86,6 +86,112 @@ static SQInteger debug_resurrectunreachable(HSQUIRRELVM v)
 }
 #endif
 
+static SQInteger debug_set_memory_limit(HSQUIRRELVM v)
+{
+    SQInteger limit = 0;
+    sq_getinteger(v, 2, &limit);
+    if (limit < 0)
+        return sq_throwerror(v, "memory limit must be non-negative");
+    SQMemoryStats stats;
+    sq_getmemorystats(v, &stats);
+    sq_setmemorylimit(v, SQUnsignedInteger(limit));
+    sq_pushinteger(v, SQInteger(stats.limitBytes));
+    return 1;
+}
+
+static SQInteger debug_get_memory_stats(HSQUIRRELVM v)
+{
+    SQMemoryStats stats;
+    sq_getmemorystats(v, &stats);
+    sq_newtable(v);
+    sq_pushstring(v, "used", -1);
+    sq_pushinteger(v, SQInteger(stats.usedBytes));
+    sq_newslot(v, -3, SQFalse);
+    sq_pushstring(v, "peak", -1);
+    sq_pushinteger(v, SQInteger(stats.peakBytes));
+    sq_newslot(v, -3, SQFalse);
+    sq_pushstring(v, "limit", -1);
+    sq_pushinteger(v, SQInteger(stats.limitBytes));
+    sq_newslot(v, -3, SQFalse);
+    return 1;
+}
+
+static SQInteger debug_mem_profiler_start(HSQUIRRELVM v)
+{
+    SQInteger sampleBytes = 0;
+    if (sq_gettop(v) > 1)
+        sq_getinteger(v, 2, &sampleBytes);
+    if (sampleBytes < 0)
+        return sq_throwerror(v, "sample size must be non-negative");
+    sq_enablememprofiler(v, SQTrue, SQUnsignedInteger(sampleBytes));
+    return 0;
+}
+
+static SQInteger debug_mem_profiler_stop(HSQUIRRELVM v)
+{
+    sq_enablememprofiler(v, SQFalse, 0);
+    return 0;
+}
+
+static const char *mem_profile_type_name(SQObjectType type)
+{
+    switch (type) {
+        case OT_TABLE: return "table";
+        case OT_ARRAY: return "array";
+        case OT_STRING: return "string";
+        case OT_CLOSURE: return "function";
+        case OT_INSTANCE: return "instance";
+        default: return "unknown";
+    }
+}
+
+static SQInteger debug_mem_profiler_report(HSQUIRRELVM v)
+{
+    SQInteger maxSites = -1;
+    if (sq_gettop(v) > 1)
+        sq_getinteger(v, 2, &maxSites);
+
+    SQInteger n = sq_getmemprofile(v, NULL, 0);
+    if (SQ_FAILED(n))
+        return SQ_ERROR;
+    if (maxSites >= 0 && maxSites < n)
+        n = maxSites;
+
+    SQAllocContext ctx = sq_getallocctx(v);
+    SQMemProfileSite *sites = (SQMemProfileSite *)sq_malloc(ctx, n * sizeof(SQMemProfileSite));
+    sq_getmemprofile(v, sites, n);
+
+    sq_newarray(v, 0);
+    for (SQInteger i = 0; i < n; i++) {
+        const SQMemProfileSite &site = sites[i];
+        sq_newtable(v);
+        sq_pushstring(v, "source", -1);
+        sq_pushstring(v, site.source, -1);
+        sq_newslot(v, -3, SQFalse);
+        sq_pushstring(v, "line", -1);
+        sq_pushinteger(v, site.line);
+        sq_newslot(v, -3, SQFalse);
+        sq_pushstring(v, "type", -1);
+        sq_pushstring(v, mem_profile_type_name(site.type), -1);
+        sq_newslot(v, -3, SQFalse);
+        sq_pushstring(v, "live_bytes", -1);
+        sq_pushinteger(v, SQInteger(site.liveBytes));
+        sq_newslot(v, -3, SQFalse);
+        sq_pushstring(v, "live_count", -1);
+        sq_pushinteger(v, SQInteger(site.liveCount));
+        sq_newslot(v, -3, SQFalse);
+        sq_pushstring(v, "total_bytes", -1);
+        sq_pushinteger(v, SQInteger(site.totalBytes));
+        sq_newslot(v, -3, SQFalse);
+        sq_pushstring(v, "total_count", -1);
+        sq_pushinteger(v, SQInteger(site.totalCount));
+        sq_newslot(v, -3, SQFalse);
+        sq_arrayappend(v, -2);
+    }
+    sq_free(ctx, sites, n * sizeof(SQMemProfileSite));
+    return 1;
+}
+
 static SQInteger debug_getbuildinfo(HSQUIRRELVM v)
 {
   sq_newtable(v);
@@ -461,6 +567,11 @@ static const SQRegFunctionFromStr debuglib_funcs[] = {
     { debug_collectgarbage, "collectgarbage(): int", "Runs the garbage collector and returns the number of reclaimed objects" },
     { debug_resurrectunreachable, "resurrectunreachable(): array|null", "Resurrects unreachable objects for inspection" },
 #endif
+    { debug_set_memory_limit, "set_memory_limit(limit_bytes: int): int", "Sets the VM memory limit in bytes (0 - unlimited) and returns the previous value" },
+    { debug_get_memory_stats, "get_memory_stats(): table", "Returns a table with used, peak and limit memory counters of the VM in bytes" },
+    { debug_mem_profiler_start, "mem_profiler_start([sample_bytes: int])", "Starts tracking live objects by allocation site; with sample_bytes > 0 only about one allocation per sample_bytes bytes is recorded" },
+    { debug_mem_profiler_stop, "mem_profiler_stop()", "Stops the memory profiler and drops collected data" },
+    { debug_mem_profiler_report, "mem_profiler_report([max_sites: int]): array", "Returns allocation sites sorted by live bytes as an array of tables (source, line, type, live_bytes, live_count, total_bytes, total_count)" },
     { debug_getbuildinfo, "getbuildinfo(): table", "Returns a table describing the Quirrel build (version, sizes, GC status)" },
     { NULL, NULL, NULL }
 };
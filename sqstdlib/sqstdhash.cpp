@@ -44,16 +44,19 @@ static SQInteger math_recursive_hash_impl(HSQUIRRELVM vm, HSQOBJECT &obj, SQUnsi
     case OT_STRING: {
       SQString *str = _string(obj);
       out_hash = (prev_hash ^ str->_len) * SQ_M_HASH_MULTIPLIER;
-      out_hash = (out_hash ^ str->_hash) * SQ_M_HASH_MULTIPLIER;
+      out_hash = (out_hash ^ str->Hash()) * SQ_M_HASH_MULTIPLIER;
       break;
     }
     case OT_ARRAY: {
       SQArray *arr = _array(obj);
       SQUnsignedInteger h = prev_hash;
       SQInteger arrSize = arr->Size();
+      SQObjectPtr item;
       for (SQInteger i = 0; i < arrSize; ++i) {
         SQUnsignedInteger resultHash = 0;
-        if (SQ_FAILED(math_recursive_hash_impl(vm, arr->_values[i], h, resultHash, depth - 1)))
+        if (arr->IsPacked())
+          arr->Get(i, item);
+        if (SQ_FAILED(math_recursive_hash_impl(vm, arr->IsPacked() ? item : arr->_values[i], h, resultHash, depth - 1)))
           return SQ_ERROR;
         h = resultHash;
       }
@@ -0,0 +1,778 @@
+/* see copyright notice in squirrel.h */
+#include <squirrel/sqpcheader.h>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <squirrel.h>
+#include <sqstdio.h>
+#include <sqstdblob.h>
+#include <sqstdjson.h>
+#include <squirrel/sqvm.h>
+#include <squirrel/sqstate.h>
+#include <squirrel/sqtable.h>
+#include <squirrel/sqarray.h>
+#include <squirrel/sqstring.h>
+#include <sqstrscan.h>
+#include <sqnumconv.h>
+#include <algorithm>
+
+// nesting limit for both directions, stringify() recurses and reference cycles end here
+#define JSON_MAX_DEPTH 1000
+// object keys repeat a lot in arrays of records, the last few are remembered by their text
+#define JSON_KEY_CACHE_SIZE 64
+#define JSON_KEY_CACHE_MAX_LEN 64
+// stringify() into a stream hands the text over in chunks of about this size
+#define JSON_STREAM_CHUNK (64 * 1024)
+
+
+static inline bool json_isdigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline int json_hexdigit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/*
+* The parser doesn't recurse, the values of the containers that are still open wait on a stack of
+* their own and a container is only built when it is closed, with the exact number of slots
+* it needs. Strings without escapes are taken from the source text as is.
+*/
+struct JsonParser {
+    struct Frame {
+        SQInteger base; // the first of the container's values, tables have key, value pairs
+        bool table;
+    };
+
+    SQSharedState *ss;
+    const char *begin, *p, *end;
+    bool frozen;
+    const char *error;
+    const char *errorpos;
+    sqvector<SQObjectPtr> values;
+    sqvector<Frame> frames;
+    sqvector<char> chars; // strings with escapes are put together here
+    SQObjectPtr keycache[JSON_KEY_CACHE_SIZE];
+
+    JsonParser(SQSharedState *ss_, const char *text, SQInteger len, bool frozen_)
+        : ss(ss_), begin(text), p(text), end(text + len), frozen(frozen_), error(NULL), errorpos(NULL),
+          values(ss_->_alloc_ctx), frames(ss_->_alloc_ctx), chars(ss_->_alloc_ctx)
+    {}
+
+    bool fail(const char *msg, const char *pos)
+    {
+        error = msg;
+        errorpos = pos;
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+            p++;
+    }
+
+    SQObjectPtr &finish(SQObjectPtr &o)
+    {
+        if (frozen)
+            o._flags |= SQOBJ_FLAG_IMMUTABLE;
+        return o;
+    }
+
+    void makeKey(const char *s, SQInteger len, SQObjectPtr &res)
+    {
+        if (len > JSON_KEY_CACHE_MAX_LEN) {
+            res = SQString::Create(ss, s, len);
+            return;
+        }
+        unsigned h = unsigned(len) * 31u;
+        if (len) {
+            h += (unsigned char)s[0] * 7u + (unsigned char)s[len - 1] + (unsigned char)s[len >> 1] * 3u;
+        }
+        SQObjectPtr &cached = keycache[h % JSON_KEY_CACHE_SIZE];
+        if (sq_type(cached) == OT_STRING && _string(cached)->_len == len && memcmp(_stringval(cached), s, len) == 0) {
+            res = cached;
+            return;
+        }
+        res = SQString::Create(ss, s, len);
+        cached = res;
+    }
+
+    bool parseEscape(const char *&q)
+    {
+        // q is past the backslash
+        if (q == end)
+            return fail("unterminated string", q);
+        char c = *q++;
+        switch (c) {
+            case '"': chars.push_back('"'); return true;
+            case '\\': chars.push_back('\\'); return true;
+            case '/': chars.push_back('/'); return true;
+            case 'b': chars.push_back('\b'); return true;
+            case 'f': chars.push_back('\f'); return true;
+            case 'n': chars.push_back('\n'); return true;
+            case 'r': chars.push_back('\r'); return true;
+            case 't': chars.push_back('\t'); return true;
+            case 'u': break;
+            default: return fail("invalid escape sequence", q - 2);
+        }
+        unsigned cp;
+        if (!parseHex4(q, cp))
+            return false;
+        // a surrogate pair makes one code point, a lone surrogate is encoded as it is
+        if (cp >= 0xD800 && cp < 0xDC00 && end - q >= 6 && q[0] == '\\' && q[1] == 'u') {
+            const char *lo = q + 2;
+            unsigned cp2;
+            if (!parseHex4(lo, cp2))
+                return false;
+            if (cp2 >= 0xDC00 && cp2 < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (cp2 - 0xDC00);
+                q = lo;
+            }
+        }
+        if (cp < 0x80)
+            chars.push_back(char(cp));
+        else if (cp < 0x800) {
+            chars.push_back(char(0xC0 | (cp >> 6)));
+            chars.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000) {
+            chars.push_back(char(0xE0 | (cp >> 12)));
+            chars.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            chars.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        else {
+            chars.push_back(char(0xF0 | (cp >> 18)));
+            chars.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+            chars.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            chars.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        return true;
+    }
+
+    bool parseHex4(const char *&q, unsigned &cp)
+    {
+        if (end - q < 4)
+            return fail("invalid unicode escape", q - 2);
+        cp = 0;
+        for (int i = 0; i < 4; i++) {
+            int d = json_hexdigit(q[i]);
+            if (d < 0)
+                return fail("invalid unicode escape", q - 2);
+            cp = (cp << 4) | unsigned(d);
+        }
+        q += 4;
+        return true;
+    }
+
+    // p is at the opening quote
+    bool parseString(bool key, SQObjectPtr &res)
+    {
+        const char *s = p + 1;
+        const char *q = sqstr_find_json_escape(s, end);
+        if (q < end && *q == '"') {
+            if (key)
+                makeKey(s, q - s, res);
+            else
+                res = SQString::Create(ss, s, q - s);
+            p = q + 1;
+            return true;
+        }
+
+        chars.resize(0);
+        for (;;) {
+            if (q == end)
+                return fail("unterminated string", p);
+            if (q > s) {
+                SQInteger n = chars.size();
+                chars.resize(n + (q - s));
+                memcpy(&chars[n], s, q - s);
+            }
+            if (*q == '"')
+                break;
+            if (*q != '\\')
+                return fail("control character in string", q);
+            q++;
+            if (!parseEscape(q))
+                return false;
+            s = q;
+            q = sqstr_find_json_escape(s, end);
+        }
+        SQInteger len = chars.size();
+        const char *text = len ? &chars[0] : "";
+        if (key)
+            makeKey(text, len, res);
+        else
+            res = SQString::Create(ss, text, len);
+        p = q + 1;
+        return true;
+    }
+
+    bool parseNumber(SQObjectPtr &res)
+    {
+        const char *s = p;
+        bool neg = false;
+        if (*p == '-') {
+            neg = true;
+            p++;
+        }
+        if (p == end || !json_isdigit(*p))
+            return fail("invalid number", s);
+
+        const SQUnsignedInteger limit = SQUnsignedInteger(~SQUnsignedInteger(0) >> 1) + (neg ? 1 : 0);
+        SQUnsignedInteger u = 0;
+        bool overflow = false;
+        if (*p == '0')
+            p++;
+        else {
+            for (; p < end && json_isdigit(*p); p++) {
+                unsigned d = unsigned(*p - '0');
+                if (u > (limit - d) / 10)
+                    overflow = true;
+                else
+                    u = u * 10 + d;
+            }
+        }
+
+        bool isfloat = overflow;
+        if (p < end && *p == '.') {
+            p++;
+            if (p == end || !json_isdigit(*p))
+                return fail("invalid number", s);
+            while (p < end && json_isdigit(*p))
+                p++;
+            isfloat = true;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            if (p < end && (*p == '+' || *p == '-'))
+                p++;
+            if (p == end || !json_isdigit(*p))
+                return fail("invalid number", s);
+            while (p < end && json_isdigit(*p))
+                p++;
+            isfloat = true;
+        }
+
+        if (!isfloat) {
+            res = neg ? SQInteger(SQUnsignedInteger(0) - u) : SQInteger(u);
+            return true;
+        }
+        // integers too large for SQInteger become floats too, strtod() needs the text terminated
+        SQInteger len = p - s;
+        char buf[64];
+        char *text = buf;
+        if (len >= SQInteger(sizeof(buf))) {
+            chars.resize(len + 1);
+            text = &chars[0];
+        }
+        memcpy(text, s, len);
+        text[len] = 0;
+        SQFloat f;
+        if (!sqnum_parse_float(text, text + len, f))
+            return fail("invalid number", s);
+        res = f;
+        return true;
+    }
+
+    bool parseLiteral(const char *word, SQInteger len, const SQObjectPtr &val, SQObjectPtr &res)
+    {
+        if (end - p < len || memcmp(p, word, len) != 0)
+            return fail("unexpected character", p);
+        p += len;
+        res = val;
+        return true;
+    }
+
+    bool parseScalar(SQObjectPtr &res)
+    {
+        switch (*p) {
+            case '"': return parseString(false, res);
+            case 't': return parseLiteral("true", 4, SQObjectPtr(true), res);
+            case 'f': return parseLiteral("false", 5, SQObjectPtr(false), res);
+            case 'n': return parseLiteral("null", 4, SQObjectPtr(), res);
+            default:
+                if (*p == '-' || json_isdigit(*p))
+                    return parseNumber(res);
+                return fail("unexpected character", p);
+        }
+    }
+
+    // "key": of the next table slot
+    bool parseKey()
+    {
+        skipSpace();
+        if (p == end)
+            return fail("unexpected end of input", p);
+        if (*p != '"')
+            return fail("expected a string key", p);
+        values.push_back(SQObjectPtr());
+        if (!parseString(true, values.top()))
+            return false;
+        skipSpace();
+        if (p == end)
+            return fail("unexpected end of input", p);
+        if (*p != ':')
+            return fail("expected ':'", p);
+        p++;
+        return true;
+    }
+
+    void closeContainer()
+    {
+        Frame f = frames.top();
+        frames.pop_back();
+        SQInteger n = values.size() - f.base;
+        SQObjectPtr *items = n ? &values[f.base] : NULL;
+        SQObjectPtr res;
+        if (f.table) {
+            SQTable *t = SQTable::CreateLiteral(ss, n / 2);
+            res = t;
+            for (SQInteger i = 0; i < n; i += 2)
+                t->NewSlot(items[i], items[i + 1]);
+        }
+        else {
+            SQArray *a = SQArray::Create(ss, 0);
+            res = a;
+            a->Reserve(n);
+            for (SQInteger i = 0; i < n; i++)
+                a->Append(items[i]);
+        }
+        values.resize(f.base);
+        values.push_back(finish(res));
+    }
+
+    bool parse(SQObjectPtr &result)
+    {
+        for (;;) {
+            // a value is expected here
+            skipSpace();
+            if (p == end)
+                return fail("unexpected end of input", p);
+            char c = *p;
+            if (c == '{' || c == '[') {
+                if (frames.size() >= JSON_MAX_DEPTH)
+                    return fail("nesting is too deep", p);
+                p++;
+                Frame f = { SQInteger(values.size()), c == '{' };
+                frames.push_back(f);
+                skipSpace();
+                if (p < end && *p == (c == '{' ? '}' : ']')) {
+                    p++;
+                    closeContainer();
+                }
+                else {
+                    if (c == '{' && !parseKey())
+                        return false;
+                    continue;
+                }
+            }
+            else {
+                values.push_back(SQObjectPtr());
+                if (!parseScalar(values.top()))
+                    return false;
+            }
+
+            // after a value: a separator, the end of a container or the end of the text
+            for (;;) {
+                skipSpace();
+                if (frames.empty()) {
+                    if (p != end)
+                        return fail("unexpected character after the value", p);
+                    result = values.top();
+                    return true;
+                }
+                if (p == end)
+                    return fail("unexpected end of input", p);
+                bool table = frames.top().table;
+                if (*p == ',') {
+                    p++;
+                    if (table && !parseKey())
+                        return false;
+                    break;
+                }
+                if (*p == (table ? '}' : ']')) {
+                    p++;
+                    closeContainer();
+                    continue;
+                }
+                return fail(table ? "expected ',' or '}'" : "expected ',' or ']'", p);
+            }
+        }
+    }
+
+    SQRESULT raiseError(HSQUIRRELVM v)
+    {
+        SQInteger line = 1;
+        const char *linestart = begin;
+        for (const char *s = begin; s < errorpos; s++)
+            if (*s == '\n') {
+                line++;
+                linestart = s + 1;
+            }
+        char buf[128];
+        scsprintf(buf, sizeof(buf), "JSON parse error at line %d, column %d: %s",
+            int(line), int(errorpos - linestart + 1), error);
+        return sq_throwerror(v, buf);
+    }
+};
+
+
+static bool json_option(HSQUIRRELVM v, SQInteger idx, const char *name)
+{
+    if (sq_gettop(v) < idx || sq_gettype(v, idx) != OT_TABLE)
+        return false;
+    sq_pushstring(v, name, -1);
+    if (SQ_FAILED(sq_rawget(v, idx)))
+        return false;
+    return true;
+}
+
+static SQInteger _json_parse(HSQUIRRELVM v)
+{
+    const char *text;
+    SQInteger len;
+    if (sq_gettype(v, 2) == OT_STRING)
+        sq_getstringandsize(v, 2, &text, &len);
+    else {
+        SQUserPointer data;
+        if (SQ_FAILED(sqstd_getblob(v, 2, &data)))
+            return sq_throwerror(v, "parse() expects a string or a blob");
+        text = (const char *)data;
+        len = sqstd_getblobsize(v, 2);
+    }
+
+    bool frozen = false;
+    if (json_option(v, 3, "frozen")) {
+        SQBool b;
+        sq_tobool(v, -1, &b);
+        frozen = b != SQFalse;
+        sq_pop(v, 1);
+    }
+
+    JsonParser parser(_ss(v), text, len, frozen);
+    SQObjectPtr res;
+    if (!parser.parse(res))
+        return parser.raiseError(v);
+    v->Push(res);
+    return 1;
+}
+
+
+/*
+* stringify() text goes to a buffer of its own, either becoming the result string or
+* being written to the stream whenever a chunk is full.
+*/
+struct JsonWriter {
+    HSQUIRRELVM v;
+    SQAllocContext allocctx;
+    SQStream *stream;
+    bool pretty;
+    bool sortKeys;
+    char *buf;
+    SQInteger len, cap;
+    char error[128];
+
+    JsonWriter(HSQUIRRELVM v_, SQStream *stream_, bool pretty_, bool sort_keys)
+        : v(v_), allocctx(_ss(v_)->_alloc_ctx), stream(stream_), pretty(pretty_), sortKeys(sort_keys),
+          buf(NULL), len(0), cap(0)
+    {
+        error[0] = 0;
+    }
+
+    ~JsonWriter()
+    {
+        if (buf)
+            sq_free(allocctx, buf, cap);
+    }
+
+    bool fail(const char *msg)
+    {
+        scsprintf(error, sizeof(error), "%s", msg);
+        return false;
+    }
+
+    bool flush()
+    {
+        if (len && stream->Write(buf, len) != len)
+            return fail("failed to write to the stream");
+        len = 0;
+        return true;
+    }
+
+    char *reserve(SQInteger n)
+    {
+        if (len + n > cap) {
+            SQInteger newcap = (len + n) * 2;
+            if (newcap < 256)
+                newcap = 256;
+            buf = (char *)sq_realloc(allocctx, buf, cap, newcap);
+            cap = newcap;
+        }
+        return buf + len;
+    }
+
+    bool put(const char *s, SQInteger n)
+    {
+        memcpy(reserve(n), s, n);
+        len += n;
+        return true;
+    }
+
+    void putc(char c)
+    {
+        *reserve(1) = c;
+        len++;
+    }
+
+    void newline(int depth)
+    {
+        char *d = reserve(1 + depth * 2);
+        *d++ = '\n';
+        memset(d, ' ', depth * 2);
+        len += 1 + depth * 2;
+    }
+
+    void putString(const char *s, SQInteger n)
+    {
+        static const char hex[] = "0123456789abcdef";
+        const char *e = s + n;
+        putc('"');
+        while (s < e) {
+            const char *q = sqstr_find_json_escape(s, e);
+            put(s, q - s);
+            if (q == e)
+                break;
+            char c = *q, *d = reserve(6);
+            d[0] = '\\';
+            switch (c) {
+                case '"': d[1] = '"'; len += 2; break;
+                case '\\': d[1] = '\\'; len += 2; break;
+                case '\b': d[1] = 'b'; len += 2; break;
+                case '\f': d[1] = 'f'; len += 2; break;
+                case '\n': d[1] = 'n'; len += 2; break;
+                case '\r': d[1] = 'r'; len += 2; break;
+                case '\t': d[1] = 't'; len += 2; break;
+                default:
+                    d[1] = 'u'; d[2] = '0'; d[3] = '0';
+                    d[4] = hex[(unsigned char)c >> 4]; d[5] = hex[c & 15];
+                    len += 6;
+                    break;
+            }
+            s = q + 1;
+        }
+        putc('"');
+    }
+
+    bool putFloat(SQFloat f, bool quoted)
+    {
+        if (!std::isfinite(double(f)))
+            return fail("cannot represent inf or nan in JSON");
+        char num[SQNUM_BUF_SIZE + 2];
+        SQInteger n = sqnum_print_float_roundtrip(num, f);
+        // keep it a float for the reader, to_chars() prints 1.0 as 1
+        if (!memchr(num, '.', n) && !memchr(num, 'e', n)) {
+            num[n++] = '.';
+            num[n++] = '0';
+        }
+        if (quoted)
+            putc('"');
+        put(num, n);
+        if (quoted)
+            putc('"');
+        return true;
+    }
+
+    bool putInteger(SQInteger i, bool quoted)
+    {
+        char num[SQNUM_BUF_SIZE];
+        SQInteger n = sqnum_print_integer(num, i);
+        if (quoted)
+            putc('"');
+        put(num, n);
+        if (quoted)
+            putc('"');
+        return true;
+    }
+
+    bool putKey(const SQObjectPtr &key)
+    {
+        switch (sq_type(key)) {
+            case OT_STRING: putString(_stringval(key), _string(key)->_len); return true;
+            case OT_INTEGER: return putInteger(_integer(key), true);
+            case OT_FLOAT: return putFloat(_float(key), true);
+            default:
+                scsprintf(error, sizeof(error), "cannot use a key of type '%s' in JSON", GetTypeName(key));
+                return false;
+        }
+    }
+
+    bool writeArray(SQArray *a, int depth)
+    {
+        SQInteger n = a->Size();
+        putc('[');
+        SQObjectPtr item;
+        for (SQInteger i = 0; i < n; i++) {
+            if (i)
+                putc(',');
+            if (pretty)
+                newline(depth + 1);
+            a->Get(i, item);
+            if (!write(item, depth + 1))
+                return false;
+        }
+        if (pretty && n)
+            newline(depth);
+        putc(']');
+        return true;
+    }
+
+    struct Slot {
+        SQObjectPtr key;
+        SQObjectPtr val;
+        SQObjectPtr text; // the key as a string, to sort by
+    };
+
+    static bool slotLess(const Slot &a, const Slot &b)
+    {
+        SQString *x = _string(a.text), *y = _string(b.text);
+        SQInteger n = x->_len < y->_len ? x->_len : y->_len;
+        int c = memcmp(x->_val, y->_val, n);
+        return c ? c < 0 : x->_len < y->_len;
+    }
+
+    bool writeTable(SQTable *t, int depth)
+    {
+        putc('{');
+        SQObjectPtr pos, key, val;
+        SQInteger idx, count = 0;
+        if (!sortKeys) {
+            while ((idx = t->Next(false, pos, key, val)) != -1) {
+                pos = idx;
+                if (count++)
+                    putc(',');
+                if (pretty)
+                    newline(depth + 1);
+                if (!putKey(key))
+                    return false;
+                put(": ", pretty ? 2 : 1);
+                if (!write(val, depth + 1))
+                    return false;
+            }
+        }
+        else {
+            sqvector<Slot> slots(allocctx);
+            slots.reserve(t->CountUsed());
+            while ((idx = t->Next(false, pos, key, val)) != -1) {
+                pos = idx;
+                slots.push_back(Slot());
+                Slot &s = slots.top();
+                s.key = key;
+                s.val = val;
+                if (sq_type(key) == OT_STRING)
+                    s.text = key;
+                else {
+                    SQInteger mark = len;
+                    if (!putKey(key))
+                        return false;
+                    s.text = SQString::Create(_ss(v), buf + mark + 1, len - mark - 2);
+                    len = mark;
+                }
+            }
+            if (slots.size())
+                std::sort(&slots[0], &slots[0] + slots.size(), slotLess);
+            for (count = 0; count < SQInteger(slots.size()); count++) {
+                if (count)
+                    putc(',');
+                if (pretty)
+                    newline(depth + 1);
+                putString(_stringval(slots[count].text), _string(slots[count].text)->_len);
+                put(": ", pretty ? 2 : 1);
+                if (!write(slots[count].val, depth + 1))
+                    return false;
+            }
+        }
+        if (pretty && count)
+            newline(depth);
+        putc('}');
+        return true;
+    }
+
+    bool write(const SQObjectPtr &o, int depth)
+    {
+        if (stream && len >= JSON_STREAM_CHUNK && !flush())
+            return false;
+        switch (sq_type(o)) {
+            case OT_NULL: return put("null", 4);
+            case OT_BOOL: return _integer(o) ? put("true", 4) : put("false", 5);
+            case OT_INTEGER: return putInteger(_integer(o), false);
+            case OT_FLOAT: return putFloat(_float(o), false);
+            case OT_STRING: putString(_stringval(o), _string(o)->_len); return true;
+            case OT_ARRAY:
+            case OT_TABLE:
+                if (depth >= JSON_MAX_DEPTH)
+                    return fail("nesting is too deep or has a reference cycle");
+                return sq_type(o) == OT_ARRAY ? writeArray(_array(o), depth) : writeTable(_table(o), depth);
+            default:
+                scsprintf(error, sizeof(error), "cannot convert a value of type '%s' to JSON", GetTypeName(o));
+                return false;
+        }
+    }
+};
+
+static SQInteger _json_stringify(HSQUIRRELVM v)
+{
+    bool pretty = false, sort_keys = false;
+    SQStream *stream = NULL;
+    SQBool b;
+    if (json_option(v, 3, "pretty")) {
+        sq_tobool(v, -1, &b);
+        pretty = b != SQFalse;
+        sq_pop(v, 1);
+    }
+    if (json_option(v, 3, "sort_keys")) {
+        sq_tobool(v, -1, &b);
+        sort_keys = b != SQFalse;
+        sq_pop(v, 1);
+    }
+    if (json_option(v, 3, "stream")) {
+        if (SQ_FAILED(sq_getinstanceup(v, -1, (SQUserPointer*)&stream, (SQUserPointer)((SQUnsignedInteger)SQSTD_STREAM_TYPE_TAG))) || !stream)
+            return sq_throwerror(v, "the 'stream' option has to be a stream");
+        if (!stream->IsValid())
+            return sq_throwerror(v, "the stream is invalid");
+        sq_pop(v, 1);
+    }
+
+    JsonWriter w(v, stream, pretty, sort_keys);
+    if (!w.write(stack_get(v, 2), 0) || (stream && !w.flush()))
+        return sq_throwerror(v, w.error);
+    if (stream)
+        return 0;
+    v->Push(SQObjectPtr(SQString::Create(_ss(v), w.buf ? w.buf : "", w.len)));
+    return 1;
+}
+
+
+static const SQRegFunctionFromStr jsonlib_funcs[] = {
+    { _json_parse,     "parse(text: string|instance, [options: table|null]): any",
+        "Parses JSON text given as a string or a blob; options: frozen" },
+    { _json_stringify, "stringify(value, [options: table|null]): string|null",
+        "Converts a value to JSON text; options: pretty, sort_keys, stream (the text is written there and null returned)" },
+    { NULL, NULL, NULL }
+};
+
+
+SQRESULT sqstd_register_jsonlib(HSQUIRRELVM v)
+{
+    SQInteger i = 0;
+    while (jsonlib_funcs[i].f) {
+        sq_new_closure_slot_from_decl_string(v, jsonlib_funcs[i].f, 0, jsonlib_funcs[i].declstring, jsonlib_funcs[i].docstring);
+        i++;
+    }
+    return SQ_OK;
+}
@@ -1,6 +1,8 @@
 /* see copyright notice in squirrel.h */
 #include <squirrel.h>
 #include <string.h>
+#include <stdlib.h>
+#include <limits.h>
 #include <ctype.h>
 #include <setjmp.h>
 #include <sqstdstring.h>
@@ -48,6 +50,9 @@ static const char *g_nnames[] =
 #define SQREX_SYMBOL_ESCAPE_CHAR ('\\')
 
 
+// the most chars of a literal pattern prefix the search looks for with memchr()
+#define SQREX_MAX_PREFIX 16
+
 typedef int SQRexNodeType;
 
 typedef struct tagSQRexNode{
@@ -57,6 +62,8 @@ typedef struct tagSQRexNode{
     SQInteger next;
 }SQRexNode;
 
+struct SQRexDFA;
+
 struct SQRex{
     SQAllocContext _alloc_ctx;
     const char *_eol;
@@ -72,6 +79,13 @@ struct SQRex{
     SQInteger _currsubexp;
     void *_jmpbuf;
     const char **_error;
+    // search start filters, see sqstd_rex_analyze()
+    SQBool _anchored;
+    char _prefix[SQREX_MAX_PREFIX];
+    SQInteger _prefixlen;
+    SQBool _usefirst;
+    unsigned char _firstchars[32];
+    SQRexDFA *_dfa;
 };
 
 static SQInteger sqstd_rex_list(SQRex *exp);
@@ -584,6 +598,510 @@ static const char *sqstd_rex_matchnode(SQRex* exp,SQRexNode *node,const char *st
     return NULL;
 }
 
+/*
+* Linear time search filter.
+*
+* The matcher above doesn't backtrack into quantifiers and alternatives, so it can miss
+* matches a textbook regexp engine finds, but everything it does match is a match of the
+* pattern read as a regular expression. Searching used to run it at every start position,
+* which is quadratic and gets very slow on patterns like (a*)*b over long runs of 'a'.
+*
+* Here the pattern is turned into a Thompson NFA of that regular expression, with the
+* anchors, \b and \m widened to what they can match at most, and read backwards by a DFA
+* built lazily from it. One pass over the text right to left finds every position some
+* match of the pattern could start at, the matcher then only runs at those, so the search
+* results and captures stay the same. The DFA states are cached in the SQRex and reused
+* by later searches. The same NFA, read forwards, gives the set of chars a match can start
+* with, searches skip to those with a table lookup or memchr() right away.
+*/
+
+// patterns building a bigger NFA search without the DFA
+#define SQREX_NFA_MAX_STATES 4096
+// larger {n,m} counts are widened to {n,} / {SQREX_NFA_MAX_REPEAT,} in the NFA
+#define SQREX_NFA_MAX_REPEAT 8
+// cached DFA transitions, the cache is flushed when it is full
+#define SQREX_DFA_MAX_TRANSITIONS (1 << 16)
+#define SQREX_DFA_MAX_POOL (1 << 18)
+// a scan flushing the cache more times gives up and leaves the filtering to the matcher
+#define SQREX_DFA_MAX_FLUSHES 8
+// failed match attempts before a search runs the DFA over the rest of the text
+#define SQREX_DFA_SEARCH_ATTEMPTS 4
+
+enum { RXN_MATCH, RXN_CHAR, RXN_SPLIT };
+
+struct SQRexNState {
+    int type;
+    int out, out1;
+    unsigned char bits[32]; // RXN_CHAR: the chars it takes
+};
+
+struct SQRexDFA {
+    SQAllocContext alloc_ctx;
+    // the NFA, state 0 is the match state
+    SQRexNState *nstates;
+    SQInteger nnstates;
+    SQInteger nallocated;
+    SQInteger start;
+    SQBool overflow;
+    // chars no NFA state tells apart share a class
+    unsigned char byteclass[256];
+    unsigned char classbyte[256];
+    SQInteger nclasses;
+    // cached DFA states, allocated by the first scan
+    SQInteger maxstates;
+    SQInteger ndstates;
+    SQInteger startstate;
+    int *next; // maxstates*nclasses transitions, -1 if not known yet
+    unsigned char *accepting;
+    SQInteger *setbegin; // the NFA states of DFA state s are pool[setbegin[s]..setbegin[s+1])
+    int *pool;
+    SQInteger poolsize;
+    SQInteger poolallocated;
+    int *hash;
+    SQInteger hashsize;
+    SQInteger nflushes;
+    // epsilon closure scratch, nnstates each
+    int *mark;
+    int gen;
+    int *stack;
+    int *work;
+};
+
+#define RXN_HASBIT(bits,c) ((bits)[(c) >> 3] & (1 << ((c) & 7)))
+
+static SQInteger sqstd_rexn_new(SQRexDFA *d, int type, SQInteger out, SQInteger out1)
+{
+    if(d->nnstates >= SQREX_NFA_MAX_STATES) {
+        d->overflow = SQTrue;
+        return 0;
+    }
+    if(d->nnstates == d->nallocated) {
+        SQInteger oldsize = d->nallocated;
+        d->nallocated = oldsize ? oldsize * 2 : 32;
+        d->nstates = (SQRexNState *)sq_realloc(d->alloc_ctx, d->nstates, oldsize * sizeof(SQRexNState), d->nallocated * sizeof(SQRexNState));
+    }
+    SQRexNState &st = d->nstates[d->nnstates];
+    st.type = type;
+    st.out = (int)out;
+    st.out1 = (int)out1;
+    memset(st.bits, 0, sizeof(st.bits));
+    return d->nnstates++;
+}
+
+static SQInteger sqstd_rexn_char(SQRexDFA *d, SQInteger cont)
+{
+    return sqstd_rexn_new(d, RXN_CHAR, cont, -1);
+}
+
+static void sqstd_rexn_setbit(SQRexDFA *d, SQInteger st, int c)
+{
+    d->nstates[st].bits[c >> 3] |= (unsigned char)(1 << (c & 7));
+}
+
+static SQInteger sqstd_rexn_list(SQRex *exp, SQRexDFA *d, SQInteger n, SQInteger cont, SQBool rev);
+
+// the NFA for a node followed by cont, rev builds the NFA of the reversed strings
+static SQInteger sqstd_rexn_node(SQRex *exp, SQRexDFA *d, SQInteger n, SQInteger cont, SQBool rev)
+{
+    SQRexNode *node = &exp->_nodes[n];
+    switch(node->type) {
+    case OP_GREEDY: {
+        SQInteger p0 = (node->right >> 16) & 0x0000FFFF, p1 = node->right & 0x0000FFFF;
+        SQBool unbounded = p1 == 0xFFFF ? SQTrue : SQFalse;
+        if(p0 > SQREX_NFA_MAX_REPEAT) {
+            p0 = SQREX_NFA_MAX_REPEAT;
+            unbounded = SQTrue;
+        }
+        if(!unbounded && p1 > SQREX_NFA_MAX_REPEAT)
+            unbounded = SQTrue;
+        SQInteger s = cont;
+        if(unbounded) {
+            SQInteger loop = sqstd_rexn_new(d, RXN_SPLIT, 0, cont);
+            SQInteger body = sqstd_rexn_node(exp, d, node->left, loop, rev);
+            if(!d->overflow)
+                d->nstates[loop].out = (int)body;
+            s = loop;
+        }
+        else {
+            for(SQInteger k = p0; k < p1 && !d->overflow; k++)
+                s = sqstd_rexn_new(d, RXN_SPLIT, sqstd_rexn_node(exp, d, node->left, s, rev), cont);
+        }
+        for(SQInteger k = 0; k < p0 && !d->overflow; k++)
+            s = sqstd_rexn_node(exp, d, node->left, s, rev);
+        return s;
+    }
+    case OP_OR: {
+        SQInteger l = sqstd_rexn_list(exp, d, node->left, cont, rev);
+        SQInteger r = sqstd_rexn_list(exp, d, node->right, cont, rev);
+        return sqstd_rexn_new(d, RXN_SPLIT, l, r);
+    }
+    case OP_EXPR:
+    case OP_NOCAPEXPR:
+        return sqstd_rexn_list(exp, d, node->left, cont, rev);
+    case OP_BOL:
+    case OP_EOL:
+    case OP_WB:
+        return cont;
+    case OP_MB: {
+        // at most: the open char, anything, the close char
+        SQInteger last = sqstd_rexn_char(d, cont);
+        SQInteger loop = sqstd_rexn_new(d, RXN_SPLIT, 0, last);
+        SQInteger any = sqstd_rexn_char(d, loop);
+        SQInteger first = sqstd_rexn_char(d, loop);
+        if(d->overflow)
+            return 0;
+        d->nstates[loop].out = (int)any;
+        memset(d->nstates[any].bits, 0xFF, sizeof(d->nstates[any].bits));
+        sqstd_rexn_setbit(d, rev ? first : last, (unsigned char)node->right);
+        sqstd_rexn_setbit(d, rev ? last : first, (unsigned char)node->left);
+        return first;
+    }
+    default: {
+        SQInteger st = sqstd_rexn_char(d, cont);
+        if(d->overflow)
+            return 0;
+        for(int c = 0; c < 256; c++) {
+            SQBool m;
+            switch(node->type) {
+            case OP_DOT: m = SQTrue; break;
+            case OP_CLASS: m = sqstd_rex_matchclass(exp, &exp->_nodes[node->left], (char)c); break;
+            case OP_NCLASS: m = !sqstd_rex_matchclass(exp, &exp->_nodes[node->left], (char)c); break;
+            case OP_CCLASS: m = sqstd_rex_matchcclass(node->left, (char)c); break;
+            default: m = (char)c == node->type ? SQTrue : SQFalse; break;
+            }
+            if(m)
+                sqstd_rexn_setbit(d, st, c);
+        }
+        return st;
+    }
+    }
+}
+
+static SQInteger sqstd_rexn_list(SQRex *exp, SQRexDFA *d, SQInteger n, SQInteger cont, SQBool rev)
+{
+    if(rev) {
+        for(; n != -1 && !d->overflow; n = exp->_nodes[n].next)
+            cont = sqstd_rexn_node(exp, d, n, cont, rev);
+        return cont;
+    }
+    if(n == -1)
+        return cont;
+    return sqstd_rexn_node(exp, d, n, sqstd_rexn_list(exp, d, exp->_nodes[n].next, cont, rev), rev);
+}
+
+static SQBool sqstd_rexn_build(SQRex *exp, SQRexDFA *d, SQBool rev)
+{
+    d->nnstates = 0;
+    d->overflow = SQFalse;
+    sqstd_rexn_new(d, RXN_MATCH, -1, -1);
+    d->start = sqstd_rexn_node(exp, d, exp->_first, 0, rev);
+    return d->overflow ? SQFalse : SQTrue;
+}
+
+static void sqstd_rexd_free(SQRexDFA *d)
+{
+    SQAllocContext ctx = d->alloc_ctx;
+    if(d->nstates) sq_free(ctx, d->nstates, d->nallocated * sizeof(SQRexNState));
+    if(d->next) {
+        sq_free(ctx, d->next, d->maxstates * d->nclasses * sizeof(int));
+        sq_free(ctx, d->accepting, d->maxstates * sizeof(unsigned char));
+        sq_free(ctx, d->setbegin, (d->maxstates + 1) * sizeof(SQInteger));
+        sq_free(ctx, d->hash, d->hashsize * sizeof(int));
+        sq_free(ctx, d->mark, d->nnstates * sizeof(int));
+        sq_free(ctx, d->stack, d->nnstates * 2 * sizeof(int));
+        sq_free(ctx, d->work, d->nnstates * sizeof(int));
+    }
+    if(d->pool) sq_free(ctx, d->pool, d->poolallocated * sizeof(int));
+    sq_free(ctx, d, sizeof(SQRexDFA));
+}
+
+// adds the epsilon closure of NFA state id to the work list
+static void sqstd_rexd_closure(SQRexDFA *d, int id, SQInteger &n)
+{
+    SQInteger sp = 0;
+    d->stack[sp++] = id;
+    while(sp) {
+        int s = d->stack[--sp];
+        if(d->mark[s] == d->gen)
+            continue;
+        d->mark[s] = d->gen;
+        const SQRexNState &st = d->nstates[s];
+        if(st.type == RXN_SPLIT) {
+            d->stack[sp++] = st.out1;
+            d->stack[sp++] = st.out;
+        }
+        else
+            d->work[n++] = s;
+    }
+}
+
+static void sqstd_rexd_newgen(SQRexDFA *d)
+{
+    if(++d->gen == INT_MAX) {
+        memset(d->mark, 0, d->nnstates * sizeof(int));
+        d->gen = 1;
+    }
+}
+
+static int sqstd_rexd_cmpint(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static SQUnsignedInteger sqstd_rexd_hashset(const int *set, SQInteger n)
+{
+    SQUnsignedInteger h = 2166136261u;
+    for(SQInteger i = 0; i < n; i++)
+        h = (h ^ (SQUnsignedInteger)set[i]) * 16777619u;
+    return h;
+}
+
+static void sqstd_rexd_flush(SQRexDFA *d)
+{
+    d->ndstates = 0;
+    d->poolsize = 0;
+    d->setbegin[0] = 0;
+    d->startstate = -1;
+    d->nflushes++;
+    for(SQInteger i = 0; i < d->hashsize; i++)
+        d->hash[i] = -1;
+}
+
+// the DFA state for the sorted NFA states in work[0..n), -1 if it doesn't fit even into an empty cache
+static int sqstd_rexd_state(SQRexDFA *d, SQInteger n)
+{
+    SQUnsignedInteger h = sqstd_rexd_hashset(d->work, n);
+    SQInteger mask = d->hashsize - 1;
+    for(SQInteger i = h & mask; d->hash[i] != -1; i = (i + 1) & mask) {
+        int s = d->hash[i];
+        SQInteger b = d->setbegin[s];
+        if(d->setbegin[s + 1] - b == n && memcmp(&d->pool[b], d->work, n * sizeof(int)) == 0)
+            return s;
+    }
+    if(d->ndstates == d->maxstates || d->poolsize + n > SQREX_DFA_MAX_POOL) {
+        if(d->ndstates == 0)
+            return -1;
+        sqstd_rexd_flush(d);
+        return sqstd_rexd_state(d, n);
+    }
+    if(d->poolsize + n > d->poolallocated) {
+        SQInteger oldsize = d->poolallocated;
+        while(d->poolsize + n > d->poolallocated)
+            d->poolallocated *= 2;
+        d->pool = (int *)sq_realloc(d->alloc_ctx, d->pool, oldsize * sizeof(int), d->poolallocated * sizeof(int));
+    }
+    int s = (int)d->ndstates++;
+    memcpy(&d->pool[d->poolsize], d->work, n * sizeof(int));
+    d->poolsize += n;
+    d->setbegin[s + 1] = d->poolsize;
+    d->accepting[s] = (n > 0 && d->work[0] == RXN_MATCH) ? 1 : 0;
+    for(SQInteger c = 0; c < d->nclasses; c++)
+        d->next[s * d->nclasses + c] = -1;
+    SQInteger i = h & mask;
+    while(d->hash[i] != -1)
+        i = (i + 1) & mask;
+    d->hash[i] = s;
+    return s;
+}
+
+// the NFA start state is also reached from every state, matches can start anywhere
+static int sqstd_rexd_step(SQRexDFA *d, int s, int cls)
+{
+    SQInteger n = 0;
+    unsigned char c = d->classbyte[cls];
+    sqstd_rexd_newgen(d);
+    for(SQInteger i = d->setbegin[s], e = d->setbegin[s + 1]; i < e; i++) {
+        const SQRexNState &st = d->nstates[d->pool[i]];
+        if(st.type == RXN_CHAR && RXN_HASBIT(st.bits, c))
+            sqstd_rexd_closure(d, st.out, n);
+    }
+    sqstd_rexd_closure(d, (int)d->start, n);
+    qsort(d->work, n, sizeof(int), sqstd_rexd_cmpint);
+    SQInteger nflushes = d->nflushes;
+    int t = sqstd_rexd_state(d, n);
+    // a flush has dropped s, there is no transition to remember
+    if(t >= 0 && nflushes == d->nflushes)
+        d->next[s * d->nclasses + cls] = t;
+    return t;
+}
+
+static void sqstd_rexd_alloc(SQRexDFA *d)
+{
+    SQAllocContext ctx = d->alloc_ctx;
+    d->maxstates = SQREX_DFA_MAX_TRANSITIONS / d->nclasses;
+    if(d->maxstates > 1024)
+        d->maxstates = 1024;
+    d->hashsize = 1;
+    while(d->hashsize < d->maxstates * 2)
+        d->hashsize *= 2;
+    d->next = (int *)sq_malloc(ctx, d->maxstates * d->nclasses * sizeof(int));
+    d->accepting = (unsigned char *)sq_malloc(ctx, d->maxstates * sizeof(unsigned char));
+    d->setbegin = (SQInteger *)sq_malloc(ctx, (d->maxstates + 1) * sizeof(SQInteger));
+    d->hash = (int *)sq_malloc(ctx, d->hashsize * sizeof(int));
+    d->poolallocated = 256;
+    d->pool = (int *)sq_malloc(ctx, d->poolallocated * sizeof(int));
+    d->mark = (int *)sq_malloc(ctx, d->nnstates * sizeof(int));
+    memset(d->mark, 0, d->nnstates * sizeof(int));
+    d->gen = 0;
+    // a state is pushed once per incoming edge at most
+    d->stack = (int *)sq_malloc(ctx, d->nnstates * 2 * sizeof(int));
+    d->work = (int *)sq_malloc(ctx, d->nnstates * sizeof(int));
+    sqstd_rexd_flush(d);
+    d->nflushes = 0;
+}
+
+// sets the bits of the positions in [begin,end) a match could start at, false if the DFA gave up
+static SQBool sqstd_rexd_scan(SQRexDFA *d, const char *begin, const char *end, unsigned char *bits)
+{
+    if(!d->next)
+        sqstd_rexd_alloc(d);
+    SQInteger nflushes = d->nflushes;
+    int s = (int)d->startstate;
+    if(s < 0) {
+        SQInteger n = 0;
+        sqstd_rexd_newgen(d);
+        sqstd_rexd_closure(d, (int)d->start, n);
+        qsort(d->work, n, sizeof(int), sqstd_rexd_cmpint);
+        s = sqstd_rexd_state(d, n);
+        if(s < 0)
+            return SQFalse;
+        d->startstate = s;
+    }
+    memset(bits, 0, ((end - begin) + 7) / 8);
+    const int *next = d->next;
+    SQInteger nclasses = d->nclasses;
+    for(const char *p = end; p > begin; ) {
+        --p;
+        int cls = d->byteclass[(unsigned char)*p];
+        int t = next[s * nclasses + cls];
+        if(t < 0) {
+            t = sqstd_rexd_step(d, s, cls);
+            if(t < 0 || d->nflushes - nflushes > SQREX_DFA_MAX_FLUSHES)
+                return SQFalse;
+        }
+        s = t;
+        if(d->accepting[s]) {
+            SQInteger i = p - begin;
+            bits[i >> 3] |= (unsigned char)(1 << (i & 7));
+        }
+    }
+    return SQTrue;
+}
+
+static void sqstd_rexd_classes(SQRexDFA *d)
+{
+    short newclass[256][2];
+    memset(d->byteclass, 0, sizeof(d->byteclass));
+    d->nclasses = 1;
+    for(SQInteger i = 0; i < d->nnstates; i++) {
+        const SQRexNState &st = d->nstates[i];
+        if(st.type != RXN_CHAR)
+            continue;
+        memset(newclass, 0xFF, sizeof(newclass));
+        SQInteger n = 0;
+        for(int c = 0; c < 256; c++) {
+            short &nc = newclass[d->byteclass[c]][RXN_HASBIT(st.bits, c) ? 1 : 0];
+            if(nc < 0)
+                nc = (short)n++;
+            d->byteclass[c] = (unsigned char)nc;
+        }
+        d->nclasses = n;
+    }
+    for(int c = 255; c >= 0; c--)
+        d->classbyte[d->byteclass[c]] = (unsigned char)c;
+}
+
+// fills in the search start filters after the pattern is parsed
+static void sqstd_rex_analyze(SQRex *exp)
+{
+    SQInteger head = exp->_nodes[exp->_first].left;
+    exp->_anchored = (head != -1 && exp->_nodes[head].type == OP_BOL) ? SQTrue : SQFalse;
+    exp->_prefixlen = 0;
+    for(SQInteger n = head; n != -1 && exp->_nodes[n].type <= SQ_MAX_CHAR && exp->_prefixlen < SQREX_MAX_PREFIX; n = exp->_nodes[n].next)
+        exp->_prefix[exp->_prefixlen++] = (char)exp->_nodes[n].type;
+    exp->_usefirst = SQFalse;
+
+    SQRexDFA *d = (SQRexDFA *)sq_malloc(exp->_alloc_ctx, sizeof(SQRexDFA));
+    memset(d, 0, sizeof(SQRexDFA));
+    d->alloc_ctx = exp->_alloc_ctx;
+    d->startstate = -1;
+    if(!sqstd_rexn_build(exp, d, SQFalse)) {
+        sqstd_rexd_free(d);
+        return;
+    }
+
+    // the chars a match can start with, unless an empty match is possible
+    SQInteger nfirst = 0;
+    d->mark = (int *)sq_malloc(exp->_alloc_ctx, d->nnstates * sizeof(int));
+    d->stack = (int *)sq_malloc(exp->_alloc_ctx, d->nnstates * 2 * sizeof(int));
+    d->work = (int *)sq_malloc(exp->_alloc_ctx, d->nnstates * sizeof(int));
+    memset(d->mark, 0, d->nnstates * sizeof(int));
+    d->gen = 1;
+    sqstd_rexd_closure(d, (int)d->start, nfirst);
+    memset(exp->_firstchars, 0, sizeof(exp->_firstchars));
+    SQBool nullable = SQFalse;
+    for(SQInteger i = 0; i < nfirst; i++) {
+        const SQRexNState &st = d->nstates[d->work[i]];
+        if(st.type == RXN_MATCH)
+            nullable = SQTrue;
+        for(int k = 0; k < 32; k++)
+            exp->_firstchars[k] |= st.bits[k];
+    }
+    SQInteger nbits = 0;
+    for(int c = 0; c < 256; c++)
+        if(RXN_HASBIT(exp->_firstchars, c))
+            nbits++;
+    exp->_usefirst = (!nullable && nbits < 256) ? SQTrue : SQFalse;
+    sq_free(exp->_alloc_ctx, d->mark, d->nnstates * sizeof(int));
+    sq_free(exp->_alloc_ctx, d->stack, d->nnstates * 2 * sizeof(int));
+    sq_free(exp->_alloc_ctx, d->work, d->nnstates * sizeof(int));
+    d->mark = d->stack = d->work = NULL;
+
+    // an anchored pattern is only tried at the beginning, a nullable one can start anywhere
+    if(exp->_anchored || nullable || !sqstd_rexn_build(exp, d, SQTrue)) {
+        sqstd_rexd_free(d);
+        return;
+    }
+    sqstd_rexd_classes(d);
+    exp->_dfa = d;
+}
+
+// the first position in [p,last) a match could start at or NULL, cand has a bit for each position from candbase on
+static const char *sqstd_rex_nextstart(SQRex *exp, const char *p, const char *last, const char *text_end,
+                                       const unsigned char *cand, const char *candbase)
+{
+    if(cand) {
+        for(; p < last; p++) {
+            SQInteger i = p - candbase;
+            if(!cand[i >> 3]) {
+                p += 7 - (i & 7);
+                continue;
+            }
+            if(cand[i >> 3] & (1 << (i & 7)))
+                return p;
+        }
+        return NULL;
+    }
+    if(exp->_prefixlen > 0) {
+        while(p < last) {
+            p = (const char *)memchr(p, exp->_prefix[0], last - p);
+            if(!p || text_end - p < exp->_prefixlen)
+                return NULL;
+            if(memcmp(p, exp->_prefix, exp->_prefixlen) == 0)
+                return p;
+            p++;
+        }
+        return NULL;
+    }
+    if(exp->_usefirst) {
+        for(; p < last; p++)
+            if(RXN_HASBIT(exp->_firstchars, (unsigned char)*p))
+                return p;
+        return NULL;
+    }
+    return p < last ? p : NULL;
+}
+
 /* public api */
 SQRex *sqstd_rex_compile(SQAllocContext alloc_ctx, const char *pattern,const char **error)
 {
@@ -598,6 +1116,7 @@ SQRex *sqstd_rex_compile(SQAllocContext alloc_ctx, const char *pattern,const cha
     exp->_depth = 0;
     exp->_matches = 0;
     exp->_nsubexpr = 0;
+    exp->_dfa = NULL;
     exp->_first = sqstd_rex_newnode(exp,OP_EXPR);
     exp->_error = error;
     exp->_jmpbuf = sq_malloc(alloc_ctx, sizeof(jmp_buf));
@@ -625,6 +1144,7 @@ SQRex *sqstd_rex_compile(SQAllocContext alloc_ctx, const char *pattern,const cha
 #endif
         exp->_matches = (SQRexMatch *) sq_malloc(alloc_ctx, exp->_nsubexpr * sizeof(SQRexMatch));
         memset(exp->_matches,0,exp->_nsubexpr * sizeof(SQRexMatch));
+        sqstd_rex_analyze(exp);
     }
     else{
         sqstd_rex_free(exp);
@@ -639,6 +1159,7 @@ void sqstd_rex_free(SQRex *exp)
         if(exp->_nodes) sq_free(exp->_alloc_ctx, exp->_nodes,exp->_nallocated * sizeof(SQRexNode));
         if(exp->_jmpbuf) sq_free(exp->_alloc_ctx, exp->_jmpbuf,sizeof(jmp_buf));
         if(exp->_matches) sq_free(exp->_alloc_ctx, exp->_matches,exp->_nsubexpr * sizeof(SQRexMatch));
+        if(exp->_dfa) sqstd_rexd_free(exp->_dfa);
         sq_free(exp->_alloc_ctx, exp, sizeof(SQRex));
     }
 }
@@ -662,9 +1183,17 @@ SQBool sqstd_rex_searchrange(SQRex* exp,const char* text_begin,const char* text_
     if(text_begin >= text_end) return SQFalse;
     exp->_bol = text_begin;
     exp->_eol = text_end;
-    do {
+    // the last position a match can start at plus one
+    const char *last = exp->_anchored ? text_begin + 1 : text_end;
+    const char *p = text_begin;
+    unsigned char *cand = NULL;
+    const char *candbase = NULL;
+    SQInteger candsize = 0, attempts = 0;
+    while((p = sqstd_rex_nextstart(exp, p, last, text_end, cand, candbase)) != NULL) {
+        // groups a failed attempt matched aren't captures of this one
+        memset(exp->_matches, 0, exp->_nsubexpr * sizeof(SQRexMatch));
         node = exp->_first;
-        cur = text_begin;
+        cur = p;
         while(node != -1) {
             exp->_currsubexp = 0;
             cur = sqstd_rex_matchnode(exp,&exp->_nodes[node],cur,NULL);
@@ -672,15 +1201,26 @@ SQBool sqstd_rex_searchrange(SQRex* exp,const char* text_begin,const char* text_
                 break;
             node = exp->_nodes[node].next;
         }
-        text_begin++;
-    } while(cur == NULL && text_begin != text_end);
+        if(cur)
+            break;
+        p++;
+        if(++attempts == SQREX_DFA_SEARCH_ATTEMPTS && exp->_dfa && p < last) {
+            candsize = ((text_end - p) + 7) / 8;
+            cand = (unsigned char *)sq_malloc(exp->_alloc_ctx, candsize);
+            candbase = p;
+            if(!sqstd_rexd_scan(exp->_dfa, p, text_end, cand)) {
+                sq_free(exp->_alloc_ctx, cand, candsize);
+                cand = NULL;
+            }
+        }
+    }
+    if(cand)
+        sq_free(exp->_alloc_ctx, cand, candsize);
 
-    if(cur == NULL)
+    if(p == NULL)
         return SQFalse;
 
-    --text_begin;
-
-    if(out_begin) *out_begin = text_begin;
+    if(out_begin) *out_begin = p;
     if(out_end) *out_end = cur;
     return SQTrue;
 }
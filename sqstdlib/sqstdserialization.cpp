@@ -1,6 +1,7 @@
 /* see copyright notice in squirrel.h */
 #include <squirrel/sqpcheader.h>
 #include <stdint.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +20,8 @@
 #include "sqstdblobimpl.h"
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
+#include <new>
 
 #define STDLIB std
 
@@ -34,10 +37,28 @@ struct SQStreamSerializer {
         TP_ARRAY = 5 << 4,
         TP_TABLE = 6 << 4,
         TP_INSTANCE = 7 << 4,
+        TP_STRING_REF = 8 << 4, // v2
+        TP_PACKED = 9 << 4, // v2
     };
 
+    // what a TP_PACKED array holds
+    enum PackedKind {
+        PK_INTEGER = 0,
+        PK_INTEGER_DELTA = 1,
+        PK_FLOAT32 = 2,
+        PK_FLOAT64 = 3,
+    };
+
+    /*
+    * Version 1 (START_MARKER) is still read. Version 2 (START_MARKER_V2) is a varint of the payload
+    * size, the payload and END_MARKER. In the payload counts, lengths and indices below 15 go into
+    * the low bits of the type byte, larger ones are varints, integers are zigzag varints, strings seen
+    * before are TP_STRING_REF indices into the strings in the order they appeared and arrays of only
+    * integers or only floats are TP_PACKED runs of bare numbers.
+    */
     enum {
         START_MARKER = 0xEA,
+        START_MARKER_V2 = 0xEB,
         END_MARKER = 0xFA,
         MAX_DEPTH = 200,
     };
@@ -50,7 +71,7 @@ struct SQStreamSerializer {
     HSQUIRRELVM vm;
     SQStream *stream;
     const char *errorString;
-    STDLIB::unordered_map<char *, uint32_t> stringTable; // string -> index mapping
+    STDLIB::unordered_map<SQString *, uint32_t> stringTable; // string -> index mapping
     STDLIB::vector<SQObjectPtr> stringList; // to keep track of strings
     STDLIB::unordered_map<SQClass *, ClassDesc> classTable;
     STDLIB::vector<SQObjectPtr> classList; // to keep track of classes
@@ -60,9 +81,72 @@ struct SQStreamSerializer {
     uint32_t stringCounter;
     uint32_t classCounter;
     uint32_t depth;
+    uint8_t *out; // v2 output
+    SQInteger outLen, outCap;
+    const uint8_t *in, *inEnd, *inStart; // v2 payload being read
+    SQInteger inLen;
+    SQBlob *inBlob; // the payload is in its buffer at inBlobStart
+    SQInteger inBlobStart;
+    uint8_t *inCopy; // or it was read from the stream into this one
+    SQInteger inCopySize;
+    SQInteger inCopyLen; // how much of the payload is in inCopy so far
+
+    /*
+    * readobject() and lazytables decode v2 values recursively, objectreader.step() decodes them
+    * with a Frame for each container being filled, so it can stop after any item and go on later.
+    * Either way the containers and pending keys are kept in roots since script code in constructors
+    * and __setstate() may run the garbage collector.
+    */
+    enum FrameKind { FR_ARRAY, FR_TABLE, FR_PACKED, FR_INSTANCE };
+
+    struct Frame {
+        uint8_t kind;
+        uint8_t packedKind;
+        bool haveKey;
+        uint64_t left; // items still to come
+        uint64_t prev; // last number of a PK_INTEGER_DELTA run
+        SQObjectPtr obj; // the container or the instance
+        SQObjectPtr key; // the table key waiting for its value, __setstate for an instance
+    };
+
+    enum {
+        ROOT_CLASSES,
+        ROOT_STREAM,
+        ROOT_CLASS_LIST,
+        ROOT_RESULT,
+        ROOT_FRAMES, // obj and key of each frame, then the containers filled with wholeValues set
+    };
+
+    STDLIB::vector<Frame> frames;
+    bool wholeValues; // readValue() reads containers entirely instead of opening frames
+    SQInteger nested; // containers being filled that way
+    SQInteger nestedBase; // the ones below it belong to a decoding this one interrupted
+    SQInteger decodeStop; // where the current step ends, from inStart as rebaseInput() may move the input
+    unsigned instanceFrames; // instance states being decoded
+    bool decodingDone;
+    SQObjectPtr roots; // an array kept on the VM stack or in the objectreader instance
+    bool lazyTables; // tables outside of instance states become lazytables
+    bool indexed; // the payload was scanned, strings and classes are looked up in the spans
+
+    struct Span { uint32_t pos, len; };
+    struct ContainerSpan { uint32_t pos, end; };
+    struct ScanFrame { uint32_t index; uint64_t left; };
+    STDLIB::vector<Span> stringSpans;
+    STDLIB::vector<Span> classSpans;
+    STDLIB::vector<ContainerSpan> containerEnds; // sorted by pos
+    STDLIB::vector<ScanFrame> scanFrames;
 
     SQStreamSerializer() : vm(nullptr), stream(nullptr), errorString(nullptr), stringCounter(0), depth(0),
-        classCounter(0) {}
+        classCounter(0), out(nullptr), outLen(0), outCap(0), in(nullptr), inEnd(nullptr), inStart(nullptr),
+        inLen(0), inBlob(nullptr), inBlobStart(0), inCopy(nullptr), inCopySize(0), inCopyLen(0), wholeValues(false), nested(0), nestedBase(0), decodeStop(0),
+        instanceFrames(0), decodingDone(false), lazyTables(false), indexed(false) {}
+
+    ~SQStreamSerializer() {
+        if (out)
+            sq_free(_ss(vm)->_alloc_ctx, out, outCap);
+        if (inCopy)
+            sq_free(_ss(vm)->_alloc_ctx, inCopy, inCopySize);
+    }
 
     int getCountOfParams(SQObjectPtr obj) {
         if (sq_isclosure(obj))
@@ -103,151 +187,191 @@ struct SQStreamSerializer {
             classTable[cls] = { -1, className };
         }
 
+#if SQ_TABLE_SHAPES
+        for (uint32_t i = 0; tbl->_shape && i < tbl->_shape->_nkeys; ++i) {
+            if (sq_isclass(tbl->_slots[i]))
+                classTable[_class(tbl->_slots[i])] = { -1, tbl->_shape->_keys[i]->_val };
+        }
+#endif
+
         getstateProcName = SQString::Create(_ss(vm), "__getstate");
         setstateProcName = SQString::Create(_ss(vm), "__setstate");
         return true;
     }
 
+    // v2 output is put together in memory and handed to the stream with a single Write()
+    uint8_t *outReserve(SQInteger n) {
+        if (outLen + n > outCap) {
+            SQInteger newCap = (outLen + n) * 2;
+            if (newCap < 256)
+                newCap = 256;
+            out = (uint8_t *)sq_realloc(_ss(vm)->_alloc_ctx, out, outCap, newCap);
+            outCap = newCap;
+        }
+        return out + outLen;
+    }
+
+    void putByte(uint8_t b) {
+        *outReserve(1) = b;
+        outLen++;
+    }
+
+    void putBytes(const void *p, SQInteger n) {
+        memcpy(outReserve(n), p, n);
+        outLen += n;
+    }
+
+    void putVarint(uint64_t u) {
+        uint8_t *p = outReserve(10), *start = p;
+        while (u >= 0x80) {
+            *p++ = uint8_t(u) | 0x80;
+            u >>= 7;
+        }
+        *p++ = uint8_t(u);
+        outLen += p - start;
+    }
+
+    // counts below 15 go into the low bits of the type byte, 15 means a varint of count - 15 follows
+    void putTagged(uint8_t type, uint64_t n) {
+        if (n < 15)
+            putByte(uint8_t(type | n));
+        else {
+            putByte(type | 0x0F);
+            putVarint(n - 15);
+        }
+    }
+
+    static uint64_t zigzag(int64_t i) { return (uint64_t(i) << 1) ^ uint64_t(i >> 63); }
+    static int64_t unzigzag(uint64_t u) { return int64_t(u >> 1) ^ -int64_t(u & 1); }
+
+    static SQInteger varintSize(uint64_t u) {
+        SQInteger n = 1;
+        for (; u >= 0x80; u >>= 7)
+            n++;
+        return n;
+    }
+
+    void putFloat(SQFloat fv) {
+        uint8_t v = TP_FLOAT;
+        if (fv == SQFloat(-1.0))
+            putByte(v | 0);
+        else if (fv == SQFloat(-0.5))
+            putByte(v | 1);
+        else if (fv == SQFloat(0.0) && !signbit(fv))
+            putByte(v | 2);
+        else if (fv == SQFloat(0.5))
+            putByte(v | 3);
+        else if (fv == SQFloat(1.0))
+            putByte(v | 4);
+        else if (fv == SQFloat(2.0))
+            putByte(v | 5);
+        else {
+        #ifdef SQUSEDOUBLE
+            putByte(v | 7); // 8-byte float
+            double dfv = static_cast<double>(fv);
+            putBytes(&dfv, sizeof(double));
+        #else
+            putByte(v | 6); // 4-byte float
+            float ffv = static_cast<float>(fv);
+            putBytes(&ffv, sizeof(float));
+        #endif
+        }
+    }
+
+    void putString(SQString *str) {
+        if (str->_len == 0) {
+            putByte(TP_STRING); // empty strings don't go to the table
+            return;
+        }
+        auto it = stringTable.find(str);
+        if (it != stringTable.end()) {
+            putTagged(TP_STRING_REF, it->second);
+            return;
+        }
+        putTagged(TP_STRING, uint64_t(str->_len));
+        putBytes(str->_val, str->_len);
+        stringTable[str] = stringCounter++;
+        // strings from __getstate() may be freed before the end, another one could then take the address
+        stringList.push_back(SQObjectPtr(str));
+    }
+
+    // arrays of only integers or only floats are written as a count and the bare numbers,
+    // integers as varints of either the values or the differences to the previous one, whatever is shorter
+    bool putPackedArray(SQArray *arr) {
+        SQInteger size = arr->Size();
+        SQObjectType type;
+#if SQ_PACKED_ARRAYS
+        if (arr->IsPacked())
+            type = arr->_packedtype;
+        else
+#endif
+        {
+            type = sq_type(arr->_values[0]);
+            if (type != OT_INTEGER && type != OT_FLOAT)
+                return false;
+            for (SQInteger i = 1; i < size; ++i)
+                if (sq_type(arr->_values[i]) != type)
+                    return false;
+        }
+
+        SQObjectPtr item;
+        if (type == OT_INTEGER) {
+            SQInteger plainSize = 0, deltaSize = 0;
+            uint64_t prev = 0;
+            for (SQInteger i = 0; i < size; ++i) {
+                arr->Get(i, item);
+                uint64_t u = uint64_t(int64_t(_integer(item)));
+                plainSize += varintSize(zigzag(int64_t(u)));
+                deltaSize += varintSize(zigzag(int64_t(u - prev)));
+                prev = u;
+            }
+            bool delta = deltaSize < plainSize;
+            putByte(TP_PACKED | (delta ? PK_INTEGER_DELTA : PK_INTEGER));
+            putVarint(uint64_t(size));
+            outReserve(delta ? deltaSize : plainSize);
+            prev = 0;
+            for (SQInteger i = 0; i < size; ++i) {
+                arr->Get(i, item);
+                uint64_t u = uint64_t(int64_t(_integer(item)));
+                putVarint(zigzag(int64_t(delta ? u - prev : u)));
+                prev = u;
+            }
+        }
+        else {
+            putByte(TP_PACKED | (sizeof(SQFloat) == sizeof(double) ? PK_FLOAT64 : PK_FLOAT32));
+            putVarint(uint64_t(size));
+            SQFloat *dst = (SQFloat *)outReserve(size * sizeof(SQFloat));
+            for (SQInteger i = 0; i < size; ++i) {
+                arr->Get(i, item);
+                SQFloat f = _float(item);
+                memcpy(dst + i, &f, sizeof(f));
+            }
+            outLen += size * sizeof(SQFloat);
+        }
+        return true;
+    }
+
     bool serializeObject(const SQObject &obj) {
         if (sq_isnull(obj)) {
-            uint8_t v = TP_NULL | 1;
-            stream->Write(&v, sizeof(v));
+            putByte(TP_NULL | 1);
         }
         else if (sq_isbool(obj)) {
-            uint8_t v = TP_BOOL | (_integer(obj) ? 1 : 0);
-            stream->Write(&v, sizeof(v));
+            putByte(TP_BOOL | (_integer(obj) ? 1 : 0));
         }
         else if (sq_isinteger(obj)) {
-            uint8_t v = TP_INTEGER;
             SQInteger iv = _integer(obj);
-            if (iv >= -1 && iv <= 2) {
-                v |= iv + 1; // map -1, 0, 1, 2 to 0, 1, 2, 3
-                stream->Write(&v, sizeof(v));
-            }
-            else if (iv >= INT8_MIN && iv <= INT8_MAX) {
-                v |= 4; // 4 for 1-byte integer
-                stream->Write(&v, sizeof(v));
-                int8_t iv8 = static_cast<int8_t>(iv);
-                stream->Write(&iv8, sizeof(int8_t));
-            }
-            else if (iv >= INT16_MIN && iv <= INT16_MAX) {
-                v |= 5; // 5 for 2-byte integer
-                stream->Write(&v, sizeof(v));
-                int16_t iv16 = static_cast<int16_t>(iv);
-                stream->Write(&iv16, sizeof(int16_t));
-            }
-            else if (iv >= INT32_MIN && iv <= INT32_MAX) {
-                v |= 6; // 6 for 4-byte integer
-                stream->Write(&v, sizeof(v));
-                int32_t iv32 = static_cast<int32_t>(iv);
-                stream->Write(&iv, sizeof(int32_t));
-            }
+            if (iv >= -1 && iv <= 13)
+                putByte(uint8_t(TP_INTEGER | (iv + 1))); // -1..13 as 0..14
             else {
-                v |= 7; // 7 for 8-byte integer
-                stream->Write(&v, sizeof(v));
-                int64_t iv64 = static_cast<int64_t>(iv);
-                stream->Write(&iv64, sizeof(int64_t));
+                putByte(TP_INTEGER | 0x0F);
+                putVarint(zigzag(int64_t(iv)));
             }
         }
         else if (sq_isfloat(obj)) {
-            uint8_t v = TP_FLOAT;
-            SQFloat fv = _float(obj);
-            if (fv == SQFloat(-1.0)) {
-                v |= 0; // -1.0
-                stream->Write(&v, sizeof(v));
-            }
-            else if (fv == SQFloat(-0.5)) {
-                v |= 1; // -0.5
-                stream->Write(&v, sizeof(v));
-            }
-            else if (fv == SQFloat(0.0)) {
-                v |= 2; // 0.0
-                stream->Write(&v, sizeof(v));
-            }
-            else if (fv == SQFloat(0.5)) {
-                v |= 3; // 0.5
-                stream->Write(&v, sizeof(v));
-            }
-            else if (fv == SQFloat(1.0)) {
-                v |= 4; // 1.0
-                stream->Write(&v, sizeof(v));
-            }
-            else if (fv == SQFloat(2.0)) {
-                v |= 5; // 2.0
-                stream->Write(&v, sizeof(v));
-            }
-            else {
-            #ifdef SQUSEDOUBLE
-                v |= 7; // 8-byte float
-                stream->Write(&v, sizeof(v));
-                double dfv = static_cast<double>(fv);
-                stream->Write(&dfv, sizeof(double));
-            #else
-                v |= 6; // 4-byte float
-                stream->Write(&v, sizeof(v));
-                float ffv = static_cast<float>(fv);
-                stream->Write(&ffv, sizeof(float));
-            #endif
-            }
+            putFloat(_float(obj));
         }
         else if (sq_isstring(obj)) {
-            uint8_t v = TP_STRING;
-            SQInteger len = _string(obj)->_len;
-            if (len == 0) {
-                v |= 0; // empty string
-                stream->Write(&v, sizeof(v));
-            }
-            else {
-                // check if the string is new or already in the table
-                char *str = _stringval(obj);
-                auto it = stringTable.find(str);
-                if (it == stringTable.end()) {
-                    if (len <= UINT8_MAX) {
-                        v |= 1; // 1-byte string
-                        stream->Write(&v, sizeof(v));
-                        uint8_t index = static_cast<uint8_t>(len);
-                        stream->Write(&index, sizeof(uint8_t));
-                        stream->Write(str, len * sizeof(char));
-                    }
-                    else if (len <= UINT16_MAX) {
-                        v |= 2; // 2-byte string
-                        stream->Write(&v, sizeof(v));
-                        uint16_t index = static_cast<uint16_t>(len);
-                        stream->Write(&index, sizeof(uint16_t));
-                        stream->Write(str, len * sizeof(char));
-                    }
-                    else {
-                        v |= 3; // 4-byte string
-                        stream->Write(&v, sizeof(v));
-                        uint32_t index = static_cast<uint32_t>(len);
-                        stream->Write(&index, sizeof(uint32_t));
-                        stream->Write(str, len * sizeof(char));
-                    }
-
-                    stringTable[str] = stringCounter++;
-                }
-                else {
-                    uint32_t index = it->second;
-                    if (index <= UINT8_MAX) {
-                        v |= 4; // 1-byte index
-                        stream->Write(&v, sizeof(v));
-                        uint8_t idx = static_cast<uint8_t>(index);
-                        stream->Write(&idx, sizeof(uint8_t));
-                    }
-                    else if (index <= UINT16_MAX) {
-                        v |= 5; // 2-byte index
-                        stream->Write(&v, sizeof(v));
-                        uint16_t idx = static_cast<uint16_t>(index);
-                        stream->Write(&idx, sizeof(uint16_t));
-                    }
-                    else {
-                        v |= 6; // 4-byte index
-                        stream->Write(&v, sizeof(v));
-                        uint32_t idx = static_cast<uint32_t>(index);
-                        stream->Write(&idx, sizeof(uint32_t));
-                    }
-                }
-            }
+            putString(_string(obj));
         }
         else if (sq_isarray(obj)) {
             depth++;
@@ -256,31 +380,19 @@ struct SQStreamSerializer {
                 return false;
             }
 
-            uint8_t v = TP_ARRAY;
             SQArray *arr = _array(obj);
             SQInteger size = arr->Size();
-
-            if (size == 0) {
-                v |= 0; // empty array
-                stream->Write(&v, sizeof(v));
-            }
-            else if (size <= UINT8_MAX) {
-                v |= 1; // 1-byte size
-                stream->Write(&v, sizeof(v));
-                uint8_t size8 = static_cast<uint8_t>(size);
-                stream->Write(&size8, sizeof(uint8_t));
-            }
-            else {
-                v |= 2; // 4-byte size
-                stream->Write(&v, sizeof(v));
-                uint32_t size32 = static_cast<uint32_t>(size);
-                stream->Write(&size32, sizeof(uint32_t));
+            if (size < 2 || !putPackedArray(arr)) {
+                putTagged(TP_ARRAY, uint64_t(size));
+                SQObjectPtr item;
+                for (SQInteger i = 0; i < size; ++i) {
+                    if (arr->IsPacked())
+                        arr->Get(i, item);
+                    if (!serializeObject(arr->IsPacked() ? item : arr->_values[i]))
+                        return false;
+                }
             }
 
-            for (SQInteger i = 0; i < size; ++i)
-                if (!serializeObject(arr->_values[i]))
-                    return false;
-
             depth--;
         }
         else if (sq_istable(obj)) {
@@ -290,26 +402,28 @@ struct SQStreamSerializer {
                 return false;
             }
 
-            uint8_t v = TP_TABLE;
             SQTable *tbl = _table(obj);
-            SQInteger size = tbl->CountUsed();
+            putTagged(TP_TABLE, uint64_t(tbl->CountUsed()));
 
-            if (size == 0) {
-                v |= 0; // empty table
-                stream->Write(&v, sizeof(v));
-            }
-            else if (size <= UINT8_MAX) {
-                v |= 1; // 1-byte size
-                stream->Write(&v, sizeof(v));
-                uint8_t size8 = static_cast<uint8_t>(size);
-                stream->Write(&size8, sizeof(uint8_t));
+#if SQ_TABLE_ARRAY_PART
+            for (uint32_t i = 0; i < tbl->_arraysize; ++i) {
+                if (sq_type(tbl->_array[i]) & OT_FREE_TABLE_SLOT)
+                    continue;
+                if (!serializeObject(SQObjectPtr(SQInteger(i))))
+                    return false;
+                if (!serializeObject(tbl->_array[i]))
+                    return false;
             }
-            else {
-                v |= 2; // 4-byte size
-                stream->Write(&v, sizeof(v));
-                uint32_t size32 = static_cast<uint32_t>(size);
-                stream->Write(&size32, sizeof(uint32_t));
+#endif
+#if SQ_TABLE_SHAPES
+            if (tbl->_shape) {
+                for (uint32_t i = 0; i < tbl->_shape->_nkeys; ++i) {
+                    putString(tbl->_shape->_keys[i]);
+                    if (!serializeObject(tbl->_slots[i]))
+                        return false;
+                }
             }
+#endif
 
             SQTable::_HashNode *node = tbl->_nodes;
             uint32_t count = tbl->_numofnodes_minus_one + 1;
@@ -357,33 +471,19 @@ struct SQStreamSerializer {
             ClassDesc &classDesc = it->second;
 
             if (classDesc.index == -1) {
-                // New class, write class name
-                int classNameLen = strlen(classDesc.className);
-                if (classNameLen > UINT8_MAX) {
-                    errorString = "Class name too long for serialization";
-                    return false;
-                }
-
-                uint8_t classNameLen8 = static_cast<uint8_t>(classNameLen);
-                uint8_t v = TP_INSTANCE | 0x0F; // 0x0F indicates a new class
-                stream->Write(&v, sizeof(v));
-                stream->Write(&classNameLen8, sizeof(classNameLen8));
-                stream->Write(classDesc.className, classNameLen * sizeof(char));
-
+                // new class, 0x0F and the class name
+                SQInteger classNameLen = strlen(classDesc.className);
+                putByte(TP_INSTANCE | 0x0F);
+                putVarint(uint64_t(classNameLen));
+                putBytes(classDesc.className, classNameLen);
                 classDesc.index = classCounter++;
-
-                if (classCounter >= 0x0EFF) {
-                    errorString = "Too many different classes for serialization";
-                    return false;
-                }
+            }
+            else if (classDesc.index < 14) {
+                putByte(uint8_t(TP_INSTANCE | classDesc.index));
             }
             else {
-                // existing class, write index
-                assert(classDesc.index >= 0 && classDesc.index < 0x0EFF);
-                uint8_t v = TP_INSTANCE | (0x0F & (classDesc.index >> 8));
-                uint8_t restOfIndex = static_cast<uint8_t>(classDesc.index & 0xFF);
-                stream->Write(&v, sizeof(v));
-                stream->Write(&restOfIndex, sizeof(restOfIndex));
+                putByte(TP_INSTANCE | 0x0E);
+                putVarint(uint64_t(classDesc.index - 14));
             }
 
             SQInteger referenceStackTop = sq_gettop(vm);
@@ -441,15 +541,23 @@ struct SQStreamSerializer {
         classList.clear();
         availableClasses = available_classes;
         depth = 0;
-
-        uint8_t startMarker = START_MARKER;
-        stream->Write(&startMarker, sizeof(startMarker));
+        outLen = 0;
 
         if (!serializeObject(obj))
             return sq_throwerror(vm, errorString ? errorString : "Serialization failed");
 
-        uint8_t endMarker = END_MARKER;
-        stream->Write(&endMarker, sizeof(endMarker));
+        // the payload size up front lets the reader take the whole payload at once
+        uint8_t header[11];
+        SQInteger headerLen = 1;
+        header[0] = START_MARKER_V2;
+        for (uint64_t u = uint64_t(outLen); ; u >>= 7) {
+            header[headerLen++] = uint8_t(u & 0x7F) | (u >= 0x80 ? 0x80 : 0);
+            if (u < 0x80)
+                break;
+        }
+        putByte(END_MARKER);
+        if (stream->Write(header, headerLen) != headerLen || stream->Write(out, outLen) != outLen)
+            return sq_throwerror(vm, "Failed to write serialized data to the stream");
         return SQ_OK;
     }
 
@@ -723,32 +831,9 @@ struct SQStreamSerializer {
                     char *className = sq_getscratchpad(vm, classNameLen * sizeof(char));
                     if (stream->Read(className, classNameLen * sizeof(char)) != classNameLen * sizeof(char))
                         return unexpectedEndOfData();
-
-                    SQString *classNameStr = SQString::Create(_ss(vm), className, classNameLen);
-
-                    if (!sq_istable(availableClasses)) {
-                        errorString = "Instance found during deserialization, but available classes not set or not a table";
-                        return false;
-                    }
-
-                    SQTable *tbl = _table(availableClasses);
-                    SQObjectPtr classObj;
-                    if (!tbl->Get(SQObjectPtr(classNameStr), classObj)) {
-                        errorString = "Class not found in available classes during deserialization";
+                    if (!addClass(className, classNameLen))
                         return false;
-                    }
-
-                    assert(sq_isclass(classObj)); // must be already checked in fillAvailableClassNamesOnDemand()
-
-                    classList.push_back(classObj);
                     index = classList.size() - 1;
-
-                    // check number of arguments required by the class constructor (must accept 1 argument - the instance itself)
-                    SQObjectPtr constructor;
-                    if (_class(classObj)->GetConstructor(constructor)) {
-                      if (!isClassConstructorValid(constructor))
-                        return false;
-                    }
                 }
                 else {
                     uint8_t restOfIndex = 0;
@@ -762,127 +847,1525 @@ struct SQStreamSerializer {
                 }
 
                 SQObjectPtr classObj = classList[index];
+                return createInstance(classObj);
+            }
 
-                SQObjectPtr setStateClosure;
-                if (_class(classObj)->Get(setstateProcName, setStateClosure)) {
-                    if (!sq_isclosure(setStateClosure) && !sq_isnativeclosure(setStateClosure)) {
-                        errorString = "Class method __setstate must be a closure";
-                        return false;
-                    }
-                }
-                else {
-                    errorString = "Class must have __setstate method for deserialization";
-                    return false;
-                }
-
-                // create instance
-
-                SQInteger stackbase = sq_gettop(vm);
+            default:
+                errorString = "Unsupported object type during deserialization";
+                return false;
+        }
+    }
 
-                sq_pushobject(vm, classObj);
-                sq_pushnull(vm); // environment
-                if (SQ_FAILED(sq_call(vm, 1, SQTrue, SQTrue))) {
-                    errorString = "Failed to instantiate class during deserialization";
-                    sq_settop(vm, stackbase);
-                    return false;
-                }
+    // instances refer to classes of availableClasses by name
+    bool findClass(const char *className, uint32_t classNameLen, SQObjectPtr &classObj)
+    {
+        SQString *classNameStr = SQString::Create(_ss(vm), className, classNameLen);
 
-                sq_remove(vm, -2); // remove class from stack, instance stays on stack
+        if (!sq_istable(availableClasses)) {
+            errorString = "Instance found during deserialization, but available classes not set or not a table";
+            return false;
+        }
 
-                sq_pushobject(vm, setStateClosure);
-                sq_push(vm, -2); // instance
+        SQTable *tbl = _table(availableClasses);
+        if (!tbl->Get(SQObjectPtr(classNameStr), classObj) || !sq_isclass(classObj)) {
+            errorString = "Class not found in available classes during deserialization";
+            return false;
+        }
 
-                if (!deserializeObject()) {
-                    sq_pop(vm, 2);
-                    return false;
-                }
+        if (sq_isarray(roots) && sq_isarray(rootsArray()->_values[ROOT_CLASS_LIST]))
+            _array(rootsArray()->_values[ROOT_CLASS_LIST])->Append(classObj);
 
-                int countOfSetStateParams = getCountOfParams(setStateClosure);
-                if (countOfSetStateParams > 2)
-                    sq_pushobject(vm, availableClasses);
+        // check number of arguments required by the class constructor (must accept 1 argument - the instance itself)
+        SQObjectPtr constructor;
+        if (_class(classObj)->GetConstructor(constructor)) {
+          if (!isClassConstructorValid(constructor))
+            return false;
+        }
+        return true;
+    }
 
-                SQInteger top = sq_gettop(vm);
-                SQRESULT res = sq_call(vm, countOfSetStateParams > 2 ? 3 : 2, SQTrue, SQTrue);
-                if (SQ_FAILED(res)) {
-                    errorString = "Failed to call __setstate method";
-                    sq_settop(vm, stackbase); // restore stack
-                    return false;
-                }
+    // the class an instance refers to by name, appended to classList
+    bool addClass(const char *className, uint32_t classNameLen)
+    {
+        SQObjectPtr classObj;
+        if (!findClass(className, classNameLen, classObj))
+            return false;
+        classList.push_back(classObj);
+        return true;
+    }
 
-                sq_settop(vm, stackbase + 1); // instance is left on the stack
-                return true;
+    // checks __setstate and calls the constructor, the state and the __setstate() call come after that
+    bool constructInstance(const SQObjectPtr &classObj, SQObjectPtr &setState, SQObjectPtr &inst)
+    {
+        if (_class(classObj)->Get(setstateProcName, setState)) {
+            if (!sq_isclosure(setState) && !sq_isnativeclosure(setState)) {
+                errorString = "Class method __setstate must be a closure";
+                return false;
             }
+        }
+        else {
+            errorString = "Class must have __setstate method for deserialization";
+            return false;
+        }
 
-            default:
-                errorString = "Unsupported object type during deserialization";
-                return false;
+        SQInteger stackbase = sq_gettop(vm);
+        sq_pushobject(vm, classObj);
+        sq_pushnull(vm); // environment
+        if (SQ_FAILED(sq_call(vm, 1, SQTrue, SQTrue))) {
+            if (!errorString)
+                errorString = "Failed to instantiate class during deserialization";
+            sq_settop(vm, stackbase);
+            return false;
         }
+        inst = vm->Top();
+        sq_settop(vm, stackbase);
+        return true;
     }
 
-    bool isClassConstructorValid(SQObjectPtr &constructor)
+    bool callSetState(const SQObjectPtr &inst, const SQObjectPtr &setState, const SQObjectPtr &state)
     {
-      if (sq_isclosure(constructor))
-      {
-        SQFunctionProto *func = _closure(constructor)->_function;
-        SQInteger paramssize = func->_nparameters;
-        SQInteger ndef = func->_ndefaultparams;
-        SQInteger nargs = 1;
-        if (func->_varparams)
-          paramssize--;
-
-        if (paramssize != nargs && !(ndef && nargs < paramssize && (paramssize - nargs) <= ndef))
-        {
-          errorString = "Class constructor must accept call with all default arguments during deserialization";
-          return false;
+        SQInteger stackbase = sq_gettop(vm);
+        sq_pushobject(vm, setState);
+        sq_pushobject(vm, inst);
+        sq_pushobject(vm, state);
+        int countOfSetStateParams = getCountOfParams(setState);
+        if (countOfSetStateParams > 2)
+            sq_pushobject(vm, availableClasses);
+
+        SQRESULT res = sq_call(vm, countOfSetStateParams > 2 ? 3 : 2, SQFalse, SQTrue);
+        sq_settop(vm, stackbase);
+        if (SQ_FAILED(res)) {
+            if (!errorString)
+                errorString = "Failed to call __setstate method";
+            return false;
         }
         return true;
-      }
-      else if (sq_isnativeclosure(constructor))
-      {
-        SQNativeClosure *nativeClosure = _nativeclosure(constructor);
-        if (nativeClosure->_nparamscheck > 1)
-        {
-          errorString = "Class constructor must accept call with all default arguments during deserialization";
-          return false;
+    }
+
+    // v1: creates an instance and passes it the state that follows, the instance is left on the stack
+    bool createInstance(const SQObjectPtr &classObj)
+    {
+        SQObjectPtr setState, inst;
+        if (!constructInstance(classObj, setState, inst))
+            return false;
+        vm->Push(inst);
+        if (!deserializeObject()) {
+            vm->Pop();
+            return false;
+        }
+        SQObjectPtr state = vm->Top();
+        vm->Pop();
+        if (!callSetState(inst, setState, state)) {
+            vm->Pop();
+            return false;
         }
         return true;
-      }
+    }
 
-      errorString = "Class constructor must be a closure or native closure during deserialization";
-      return false;
+    // v2 data is decoded from memory: the blob's own buffer or a copy of the payload read from the stream
+    bool rebaseInput()
+    {
+        // __setstate() and constructors may have resized the blob
+        if (!inBlob)
+            return true;
+        if (inBlob->Len() < inBlobStart + inLen) {
+            errorString = "The stream was modified during deserialization";
+            return false;
+        }
+        SQInteger offset = in - inStart;
+        inStart = (const uint8_t *)inBlob->GetBuf() + inBlobStart;
+        in = inStart + offset;
+        inEnd = inStart + inLen;
+        return true;
     }
 
-    SQRESULT deserialize(HSQUIRRELVM vm_, SQStream *src_, SQObjectPtr available_classes) {  // parsed value is left on the stack
-        vm = vm_;
-        stream = src_;
-        errorString = nullptr;
-        stringCounter = 0;
-        classCounter = 0;
-        stringTable.clear();
-        classTable.clear();
-        stringList.clear();
-        classList.clear();
-        availableClasses = available_classes;
-        depth = 0;
+    bool getVarint(uint64_t &u)
+    {
+        u = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (in == inEnd)
+                return unexpectedEndOfData();
+            uint8_t b = *in++;
+            u |= uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        errorString = "Invalid varint during deserialization";
+        return false;
+    }
 
-        uint8_t startMarker = 0;
-        if (stream->Read(&startMarker, sizeof(startMarker)) != sizeof(startMarker))
-            return sq_throwerror(vm, "Unexpected end of data during deserialization");
-        if (startMarker != START_MARKER)
-            return sq_throwerror(vm, "Invalid start marker during deserialization");
+    bool getCount(unsigned v, uint64_t &n)
+    {
+        if (v < 15) {
+            n = v;
+            return true;
+        }
+        if (!getVarint(n))
+            return false;
+        if (n >= SQ_DESER_MAX_OBJECT_SIZE) {
+            errorString = "Object too large during deserialization";
+            return false;
+        }
+        n += 15;
+        return true;
+    }
 
-        if (!deserializeObject())
-            return sq_throwerror(vm, errorString ? errorString : "Deserialization failed");
+    // every element takes at least min_size bytes, a count the rest of the data can't hold is broken
+    bool checkCount(uint64_t n, SQInteger min_size)
+    {
+        if (n > uint64_t(inEnd - in) / min_size)
+            return unexpectedEndOfData();
+        return true;
+    }
 
-        uint8_t endMarker = 0;
-        if (stream->Read(&endMarker, sizeof(endMarker)) != sizeof(endMarker))
-            return sq_throwerror(vm, "Unexpected end of data during deserialization");
-        if (endMarker != END_MARKER)
-            return sq_throwerror(vm, "Invalid end marker during deserialization");
+    bool checkDepth()
+    {
+        if (SQInteger(frames.size()) + nested - nestedBase >= MAX_DEPTH) {
+            errorString = "Maximum deserialization depth exceeded";
+            return false;
+        }
+        return true;
+    }
 
-        return SQ_OK;
+    // the count and the type of a TP_PACKED array, the numbers follow
+    bool getPackedHeader(unsigned kind, uint64_t &n, SQInteger &itemSize)
+    {
+        if (!getVarint(n))
+            return false;
+        if (kind > PK_FLOAT64) {
+            errorString = "Invalid packed array type during deserialization";
+            return false;
+        }
+        itemSize = kind == PK_FLOAT32 ? 4 : kind == PK_FLOAT64 ? 8 : 1;
+        return checkCount(n, itemSize);
     }
-};
+
+    // the class of an instance, either named right here or an index of one named before
+    bool getInstanceClass(unsigned v, SQObjectPtr &classObj)
+    {
+        if (!fillAvailableClassNamesOnDemand())
+            return false;
+        uint64_t n;
+        if (v == 0x0F) {
+            if (!getVarint(n) || !checkCount(n, 1))
+                return false;
+            const char *className = (const char *)in;
+            in += n;
+            if (indexed)
+                return findClass(className, uint32_t(n), classObj);
+            if (!addClass(className, uint32_t(n)))
+                return false;
+            classObj = classList.back();
+            return true;
+        }
+        if (v == 0x0E) {
+            if (!getVarint(n))
+                return false;
+            n += 14;
+        }
+        else
+            n = v;
+        if (n >= classList.size()) {
+            errorString = "Class index out of bounds during deserialization";
+            return false;
+        }
+        if (indexed && sq_isnull(classList[n])) {
+            const Span &name = classSpans[n];
+            if (!findClass((const char *)inStart + name.pos, name.len, classList[n]))
+                return false;
+        }
+        classObj = classList[n];
+        return true;
+    }
+
+    bool getString(unsigned v, SQObjectPtr &res)
+    {
+        uint64_t n;
+        if (!getCount(v, n) || !checkCount(n, 1))
+            return false;
+        res = SQString::Create(_ss(vm), (const char *)in, SQInteger(n));
+        in += n;
+        if (n && !indexed)
+            stringList.push_back(res);
+        return true;
+    }
+
+    bool getStringRef(unsigned v, SQObjectPtr &res)
+    {
+        uint64_t n;
+        if (!getCount(v, n))
+            return false;
+        if (n >= stringList.size()) {
+            errorString = "String index out of bounds during deserialization";
+            return false;
+        }
+        if (indexed && sq_isnull(stringList[n])) {
+            const Span &str = stringSpans[n];
+            stringList[n] = SQString::Create(_ss(vm), (const char *)inStart + str.pos, str.len);
+        }
+        res = stringList[n];
+        return true;
+    }
+
+    // roots holds the available classes and so on, then the container and the pending key of each frame,
+    // it only grows while decoding and the slots of closed frames are cleared
+    SQArray *rootsArray()
+    {
+        SQArray *r = _array(roots);
+        SQInteger size = ROOT_FRAMES + 2 * SQInteger(frames.size());
+        if (r->Size() < size) // also if script code got at the objectreader's copy and shrunk it
+            r->Resize(size);
+        return r;
+    }
+
+    bool openFrame(FrameKind kind, uint64_t n, const SQObjectPtr &obj, const SQObjectPtr &key, unsigned packedKind = 0)
+    {
+        // the garbage collector can only run in a constructor or __setstate() of a frame opened later,
+        // so the pending key of a table only has to be in the roots when a container is its value
+        if (frames.size() && frames.back().haveKey)
+            rootsArray()->_values[ROOT_FRAMES + 2 * SQInteger(frames.size()) - 1] = frames.back().key;
+        frames.emplace_back();
+        Frame &f = frames.back();
+        f.kind = uint8_t(kind);
+        f.packedKind = uint8_t(packedKind);
+        f.haveKey = false;
+        f.left = n;
+        f.prev = 0;
+        f.obj = obj;
+        f.key = key;
+        SQObjectPtr *slots = rootsArray()->_values._vals + ROOT_FRAMES + 2 * SQInteger(frames.size() - 1);
+        slots[0] = obj;
+        slots[1] = key;
+        if (kind == FR_INSTANCE)
+            instanceFrames++;
+        return true;
+    }
+
+    void closeFrame()
+    {
+        if (frames.back().kind == FR_INSTANCE)
+            instanceFrames--;
+        SQObjectPtr *slots = rootsArray()->_values._vals + ROOT_FRAMES + 2 * SQInteger(frames.size() - 1);
+        slots[0].Null();
+        slots[1].Null();
+        frames.pop_back();
+    }
+
+    // one value or the start of a container, opened is set for containers that have items to come in frames
+    bool readValue(SQObjectPtr &res, bool &opened)
+    {
+        uint8_t t = *in++;
+        unsigned v = t & 0x0F;
+        uint64_t n;
+        opened = false;
+
+        switch (t & 0xF0) {
+            case TP_NULL:
+                res.Null();
+                return true;
+
+            case TP_BOOL:
+                res = v != 0;
+                return true;
+
+            case TP_INTEGER:
+                if (v < 15) {
+                    res = SQInteger(int(v) - 1);
+                    return true;
+                }
+                if (!getVarint(n))
+                    return false;
+                res = SQInteger(unzigzag(n));
+                return true;
+
+            case TP_FLOAT:
+                switch (v) {
+                    case 0: res = SQFloat(-1.0); return true;
+                    case 1: res = SQFloat(-0.5); return true;
+                    case 2: res = SQFloat(0.0); return true;
+                    case 3: res = SQFloat(0.5); return true;
+                    case 4: res = SQFloat(1.0); return true;
+                    case 5: res = SQFloat(2.0); return true;
+                    case 6: {
+                        float ffv;
+                        if (inEnd - in < SQInteger(sizeof(ffv)))
+                            return unexpectedEndOfData();
+                        memcpy(&ffv, in, sizeof(ffv));
+                        in += sizeof(ffv);
+                        res = SQFloat(ffv);
+                        return true;
+                    }
+                    case 7: {
+                        double dfv;
+                        if (inEnd - in < SQInteger(sizeof(dfv)))
+                            return unexpectedEndOfData();
+                        memcpy(&dfv, in, sizeof(dfv));
+                        in += sizeof(dfv);
+                        res = SQFloat(dfv);
+                        return true;
+                    }
+                    default:
+                        errorString = "Invalid float type during deserialization";
+                        return false;
+                }
+
+            case TP_STRING:
+                return getString(v, res);
+
+            case TP_STRING_REF:
+                return getStringRef(v, res);
+
+            case TP_ARRAY: {
+                if (!checkDepth() || !getCount(v, n) || !checkCount(n, 1))
+                    return false;
+                SQArray *arr = SQArray::Create(_ss(vm), 0);
+                res = arr;
+                if (!n)
+                    return true;
+                arr->Reserve(SQInteger(n));
+                if (wholeValues)
+                    return readArrayItems(res, n);
+                opened = true;
+                return openFrame(FR_ARRAY, n, res, SQObjectPtr());
+            }
+
+            case TP_PACKED: {
+                SQInteger itemSize;
+                if (!checkDepth() || !getPackedHeader(v, n, itemSize))
+                    return false;
+                SQArray *arr = SQArray::Create(_ss(vm), 0);
+                res = arr;
+                if (!n)
+                    return true;
+                arr->Reserve(SQInteger(n));
+                // most packed arrays are read right away, only the ones that go past the step get a frame
+                uint64_t prev = 0;
+                if (!readPackedRange(arr, v, n, prev, inStart + decodeStop))
+                    return false;
+                if (!n)
+                    return true;
+                opened = true;
+                if (!openFrame(FR_PACKED, n, res, SQObjectPtr(), v))
+                    return false;
+                frames.back().prev = prev;
+                return true;
+            }
+
+            case TP_TABLE: {
+                if (!checkDepth())
+                    return false;
+                if (lazyTables && !instanceFrames) {
+                    in--;
+                    return newLazyTable(res);
+                }
+                if (!getCount(v, n) || !checkCount(n, 2))
+                    return false;
+                res = SQTable::CreateLiteral(_ss(vm), SQInteger(n));
+                if (!n)
+                    return true;
+                if (wholeValues)
+                    return readTableItems(res, n);
+                opened = true;
+                return openFrame(FR_TABLE, n, res, SQObjectPtr());
+            }
+
+            case TP_INSTANCE: {
+                SQObjectPtr classObj, setState;
+                if (!checkDepth() || !getInstanceClass(v, classObj))
+                    return false;
+                if (!constructInstance(classObj, setState, res) || !rebaseInput())
+                    return false;
+                if (wholeValues)
+                    return readInstanceState(res, setState);
+                opened = true;
+                return openFrame(FR_INSTANCE, 1, res, setState);
+            }
+
+            default:
+                errorString = "Unsupported object type during deserialization";
+                return false;
+        }
+    }
+
+    // adds a finished value to the containers waiting for it
+    bool complete(SQObjectPtr val)
+    {
+        while (frames.size()) {
+            Frame &f = frames.back();
+            switch (f.kind) {
+                case FR_ARRAY:
+                    _array(f.obj)->Append(val);
+                    if (--f.left)
+                        return true;
+                    break;
+
+                case FR_TABLE:
+                    if (!f.haveKey) {
+                        if (sq_isnull(val)) {
+                            errorString = "Null table key during deserialization";
+                            return false;
+                        }
+                        f.key = val;
+                        f.haveKey = true;
+                        return true;
+                    }
+                    _table(f.obj)->NewSlot(f.key, val);
+                    f.haveKey = false;
+                    if (--f.left)
+                        return true;
+                    break;
+
+                case FR_INSTANCE: {
+                    // __setstate() may read lazy tables which decode with frames of their own above this one
+                    SQObjectPtr inst = f.obj, setState = f.key;
+                    if (!callSetState(inst, setState, val) || !rebaseInput())
+                        return false;
+                    break;
+                }
+            }
+            val = frames.back().obj;
+            closeFrame();
+        }
+        rootsArray()->_values[ROOT_RESULT] = val;
+        decodingDone = true;
+        return true;
+    }
+
+    // appends the items of a packed array up to about stop, left and prev carry over to the next call
+    bool readPackedRange(SQArray *arr, unsigned kind, uint64_t &left, uint64_t &prev, const uint8_t *stop)
+    {
+        if (kind == PK_INTEGER || kind == PK_INTEGER_DELTA) {
+            uint64_t base = kind == PK_INTEGER_DELTA ? ~uint64_t(0) : 0;
+            uint64_t n = left, val = prev;
+            while (n && in < stop) {
+                uint64_t u;
+                if (*in < 0x80) // small numbers and deltas take a byte, in < stop means it is there
+                    u = *in++;
+                else if (!getVarint(u))
+                    return false;
+                val = uint64_t(unzigzag(u)) + (val & base);
+                arr->Append(SQObjectPtr(SQInteger(int64_t(val))));
+                n--;
+            }
+            left = n;
+            prev = val;
+            return true;
+        }
+
+        // getPackedHeader() made sure all of them are there
+        SQInteger itemSize = kind == PK_FLOAT32 ? 4 : 8;
+        uint64_t n = left;
+        if (in >= stop)
+            n = 0;
+        else if (n > uint64_t(stop - in) / itemSize) // the step ends within the array
+            n = uint64_t(stop - in) / itemSize + 1;
+        left -= n;
+        if (kind == PK_FLOAT32) {
+            for (uint64_t i = 0; i < n; ++i, in += 4) {
+                float f;
+                memcpy(&f, in, sizeof(f));
+                arr->Append(SQObjectPtr(SQFloat(f)));
+            }
+        }
+        else {
+            for (uint64_t i = 0; i < n; ++i, in += 8) {
+                double d;
+                memcpy(&d, in, sizeof(d));
+                arr->Append(SQObjectPtr(SQFloat(d)));
+            }
+        }
+        return true;
+    }
+
+    bool readPackedItems(const uint8_t *stop)
+    {
+        Frame &f = frames.back();
+        if (!readPackedRange(_array(f.obj), f.packedKind, f.left, f.prev, stop))
+            return false;
+        if (f.left)
+            return true;
+        SQObjectPtr res = f.obj;
+        closeFrame();
+        return complete(res);
+    }
+
+    // decodes the payload at in until the value is complete or about budget bytes were consumed, budget < 0 is no limit
+    bool decodeSome(SQInteger budget)
+    {
+        decodeStop = budget >= 0 && budget < inEnd - in ? (in - inStart) + budget : inLen;
+        SQObjectPtr val;
+        while (!decodingDone) {
+            // constructors and __setstate() may move the input, the stop is taken after each value
+            const uint8_t *stop = inStart + decodeStop;
+            if (in >= stop)
+                return in < inEnd ? true : unexpectedEndOfData();
+            if (frames.size() && frames.back().kind == FR_PACKED) {
+                if (!readPackedItems(stop))
+                    return false;
+                continue;
+            }
+            bool opened;
+            if (!readValue(val, opened))
+                return false;
+            if (!opened && !complete(val))
+                return false;
+        }
+        return true;
+    }
+
+    // containers filled by readValue() with wholeValues set wait in the roots above the frames
+    void pushRoot(const SQObjectPtr &o)
+    {
+        SQInteger idx = ROOT_FRAMES + 2 * SQInteger(frames.size()) + nested++;
+        SQArray *r = _array(roots);
+        if (r->Size() <= idx)
+            r->Resize(idx + 1);
+        r->_values[idx] = o;
+    }
+
+    void popRoot()
+    {
+        SQInteger idx = ROOT_FRAMES + 2 * SQInteger(frames.size()) + --nested;
+        SQArray *r = _array(roots);
+        if (idx < r->Size()) // unless script code got at the objectreader's copy
+            r->_values[idx].Null();
+    }
+
+    // with wholeValues set readValue() fills containers right away instead of opening frames,
+    // that is how readobject() and lazytables decode and a lot faster than going through the frames
+    bool readWhole(SQObjectPtr &res)
+    {
+        if (in == inEnd)
+            return unexpectedEndOfData();
+        bool opened;
+        return readValue(res, opened);
+    }
+
+    bool readArrayItems(const SQObjectPtr &arr, uint64_t n)
+    {
+        pushRoot(arr);
+        SQObjectPtr item;
+        bool ok = true;
+        for (uint64_t i = 0; i < n && ok; ++i)
+            if ((ok = readWhole(item)))
+                _array(arr)->Append(item);
+        popRoot();
+        return ok;
+    }
+
+    bool readTableItems(const SQObjectPtr &tbl, uint64_t n)
+    {
+        pushRoot(tbl);
+        SQObjectPtr key, val;
+        bool ok = true;
+        for (uint64_t i = 0; i < n && ok; ++i) {
+            if (!readWhole(key))
+                ok = false;
+            else if (sq_isnull(key)) {
+                errorString = "Null table key during deserialization";
+                ok = false;
+            }
+            else if (sq_type(key) & SQOBJECT_REF_COUNTED && !sq_isstring(key)) {
+                // a container key waits in the roots while its value is decoded
+                pushRoot(key);
+                ok = readWhole(val);
+                popRoot();
+            }
+            else
+                ok = readWhole(val);
+            if (ok)
+                _table(tbl)->NewSlot(key, val);
+        }
+        popRoot();
+        return ok;
+    }
+
+    bool readInstanceState(const SQObjectPtr &inst, const SQObjectPtr &setState)
+    {
+        pushRoot(inst);
+        instanceFrames++;
+        SQObjectPtr state;
+        bool ok = readWhole(state);
+        instanceFrames--;
+        ok = ok && callSetState(inst, setState, state) && rebaseInput();
+        popRoot();
+        return ok;
+    }
+
+    // the whole payload in one go, the result goes to the roots
+    bool decodeAll()
+    {
+        SQObjectPtr res;
+        decodeStop = inLen;
+        wholeValues = true;
+        bool ok = readWhole(res);
+        wholeValues = false;
+        if (!ok)
+            return false;
+        if (in != inEnd) {
+            errorString = "Invalid data size during deserialization";
+            return false;
+        }
+        rootsArray()->_values[ROOT_RESULT] = res;
+        decodingDone = true;
+        return true;
+    }
+
+    void initRoots()
+    {
+        SQArray *r = SQArray::Create(_ss(vm), ROOT_FRAMES);
+        roots = r;
+        r->_values[ROOT_CLASSES] = availableClasses;
+        r->_values[ROOT_CLASS_LIST] = SQArray::Create(_ss(vm), 0);
+    }
+
+    void startDecoding()
+    {
+        frames.clear();
+        nested = nestedBase = 0;
+        instanceFrames = 0;
+        decodingDone = false;
+    }
+
+    bool deserializeV2(SQBlob *blob)
+    {
+        // payload size, then the payload and the end marker
+        if (!readPayloadSize())
+            return false;
+
+        if (blob) {
+            inBlob = blob;
+            inBlobStart = blob->Tell();
+            if (inLen > blob->Len() - inBlobStart)
+                return unexpectedEndOfData();
+            inStart = nullptr;
+            rebaseInput();
+        }
+        else {
+            // read in growing pieces, a broken size ends with the data instead of a huge allocation
+            while (inCopyLen < inLen)
+                if (!readPayload(1024 * 1024))
+                    return false;
+            inStart = in = inCopy;
+            inEnd = inCopy + inLen;
+        }
+
+        initRoots();
+        startDecoding();
+        vm->Push(roots);
+        if (!decodeAll())
+            return false;
+        if (blob && blob->Seek(inBlobStart + inLen, SQ_SEEK_SET) != 0)
+            return unexpectedEndOfData();
+        vm->GetUp(-1) = rootsArray()->_values[ROOT_RESULT]; // the value takes the place of the roots
+        return true;
+    }
+
+    bool readPayloadSize()
+    {
+        uint64_t len = 0;
+        for (int shift = 0; ; shift += 7) {
+            uint8_t b;
+            if (stream->Read(&b, sizeof(b)) != sizeof(b))
+                return unexpectedEndOfData();
+            len |= uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                break;
+            if (shift >= 56) {
+                errorString = "Invalid data size during deserialization";
+                return false;
+            }
+        }
+        inLen = SQInteger(len);
+        inCopyLen = 0;
+        return true;
+    }
+
+    // reads up to max_size more bytes of the payload into inCopy
+    bool readPayload(SQInteger max_size)
+    {
+        SQInteger piece = inLen - inCopyLen < max_size ? inLen - inCopyLen : max_size;
+        if (inCopyLen + piece > inCopySize) {
+            SQInteger newSize = inCopySize * 2 > inCopyLen + piece ? inCopySize * 2 : inCopyLen + piece;
+            if (newSize > inLen)
+                newSize = inLen;
+            inCopy = (uint8_t *)sq_realloc(_ss(vm)->_alloc_ctx, inCopy, inCopySize, newSize);
+            inCopySize = newSize;
+        }
+        if (stream->Read(inCopy + inCopyLen, piece) != piece)
+            return unexpectedEndOfData();
+        inCopyLen += piece;
+        return true;
+    }
+
+    /*
+    * Lazy reading (objectreader with lazy set) goes over the whole payload once before anything is
+    * decoded: it checks it and notes where each string, class name and container is. Tables then
+    * become lazytable instances that decode a value when it is first read, string and class
+    * references resolve through the spans and values are skipped with the container ends.
+    */
+    bool scanSome(SQInteger budget)
+    {
+        const uint8_t *stop = budget >= 0 && budget < inEnd - in ? in + budget : inEnd;
+        while (!decodingDone) {
+            if (in >= stop)
+                return in < inEnd ? true : unexpectedEndOfData();
+            uint32_t start = uint32_t(in - inStart);
+            uint8_t t = *in++;
+            unsigned v = t & 0x0F;
+            uint64_t n = 0;
+            bool leaf = true;
+
+            switch (t & 0xF0) {
+                case TP_NULL:
+                case TP_BOOL:
+                    break;
+
+                case TP_INTEGER:
+                    if (v == 15 && !getVarint(n))
+                        return false;
+                    break;
+
+                case TP_FLOAT: {
+                    SQInteger size = v < 6 ? 0 : v == 6 ? 4 : v == 7 ? 8 : -1;
+                    if (size < 0) {
+                        errorString = "Invalid float type during deserialization";
+                        return false;
+                    }
+                    if (inEnd - in < size)
+                        return unexpectedEndOfData();
+                    in += size;
+                    break;
+                }
+
+                case TP_STRING:
+                    if (!getCount(v, n) || !checkCount(n, 1))
+                        return false;
+                    if (n)
+                        stringSpans.push_back({ uint32_t(in - inStart), uint32_t(n) });
+                    in += n;
+                    break;
+
+                case TP_STRING_REF:
+                    if (!getCount(v, n))
+                        return false;
+                    if (n >= stringSpans.size()) {
+                        errorString = "String index out of bounds during deserialization";
+                        return false;
+                    }
+                    break;
+
+                case TP_PACKED: {
+                    SQInteger itemSize;
+                    if (!checkScanDepth() || !getPackedHeader(v, n, itemSize))
+                        return false;
+                    if (v == PK_INTEGER || v == PK_INTEGER_DELTA) {
+                        for (uint64_t i = 0; i < n; ++i) {
+                            uint64_t u;
+                            if (!getVarint(u))
+                                return false;
+                        }
+                    }
+                    else
+                        in += n * itemSize;
+                    containerEnds.push_back({ start, uint32_t(in - inStart) });
+                    break;
+                }
+
+                case TP_ARRAY:
+                case TP_TABLE:
+                case TP_INSTANCE:
+                    if (!checkScanDepth())
+                        return false;
+                    if ((t & 0xF0) == TP_INSTANCE) {
+                        if (v == 0x0F) {
+                            if (!getVarint(n) || !checkCount(n, 1))
+                                return false;
+                            classSpans.push_back({ uint32_t(in - inStart), uint32_t(n) });
+                            in += n;
+                        }
+                        else {
+                            if (v == 0x0E && !getVarint(n))
+                                return false;
+                            if ((v == 0x0E ? n + 14 : v) >= classSpans.size()) {
+                                errorString = "Class index out of bounds during deserialization";
+                                return false;
+                            }
+                        }
+                        n = 1; // the state
+                    }
+                    else {
+                        if (!getCount(v, n) || !checkCount(n, (t & 0xF0) == TP_TABLE ? 2 : 1))
+                            return false;
+                        if ((t & 0xF0) == TP_TABLE)
+                            n *= 2;
+                    }
+                    containerEnds.push_back({ start, 0 });
+                    if (n) {
+                        scanFrames.push_back({ uint32_t(containerEnds.size() - 1), n });
+                        leaf = false;
+                    }
+                    else
+                        containerEnds.back().end = uint32_t(in - inStart);
+                    break;
+
+                default:
+                    errorString = "Unsupported object type during deserialization";
+                    return false;
+            }
+
+            if (!leaf)
+                continue;
+            while (!scanFrames.empty() && !--scanFrames.back().left) {
+                containerEnds[scanFrames.back().index].end = uint32_t(in - inStart);
+                scanFrames.pop_back();
+            }
+            if (scanFrames.empty())
+                decodingDone = true;
+        }
+        return true;
+    }
+
+    bool checkScanDepth()
+    {
+        if (scanFrames.size() >= MAX_DEPTH) {
+            errorString = "Maximum deserialization depth exceeded";
+            return false;
+        }
+        return true;
+    }
+
+    // after the scan: moves in past the value it points at
+    void skipValue()
+    {
+        uint8_t t = *in;
+        unsigned v = t & 0x0F;
+        uint64_t n = 0;
+        switch (t & 0xF0) {
+            case TP_NULL:
+            case TP_BOOL:
+                in++;
+                break;
+            case TP_INTEGER:
+            case TP_STRING_REF:
+                in++;
+                if (v == 15)
+                    getVarint(n);
+                break;
+            case TP_FLOAT:
+                in += v == 6 ? 5 : v == 7 ? 9 : 1;
+                break;
+            case TP_STRING:
+                in++;
+                getCount(v, n);
+                in += n;
+                break;
+            default: {
+                // containers were noted in the order they start
+                uint32_t start = uint32_t(in - inStart);
+                const ContainerSpan *c = STDLIB::lower_bound(containerEnds.data(), containerEnds.data() + containerEnds.size(),
+                    start, [](const ContainerSpan &s, uint32_t pos) { return s.pos < pos; });
+                in = inStart + c->end;
+                break;
+            }
+        }
+    }
+
+    bool newLazyTable(SQObjectPtr &res);
+
+    // decodes the value at pos while another decoding may be under way (lazy tables read from __setstate())
+    bool decodeAt(SQInteger pos, SQObjectPtr &res)
+    {
+        const uint8_t *prevIn = in;
+        SQInteger prevStop = decodeStop;
+        SQInteger prevNestedBase = nestedBase;
+        unsigned prevInstanceFrames = instanceFrames;
+        bool prevWhole = wholeValues;
+
+        in = inStart + pos;
+        decodeStop = inLen;
+        nestedBase = nested;
+        instanceFrames = 0;
+        wholeValues = true;
+        errorString = nullptr;
+        bool ok = readWhole(res);
+
+        in = prevIn;
+        decodeStop = prevStop;
+        nestedBase = prevNestedBase;
+        instanceFrames = prevInstanceFrames;
+        wholeValues = prevWhole;
+        return ok;
+    }
+
+    bool isClassConstructorValid(SQObjectPtr &constructor)
+    {
+      if (sq_isclosure(constructor))
+      {
+        SQFunctionProto *func = _closure(constructor)->_function;
+        SQInteger paramssize = func->_nparameters;
+        SQInteger ndef = func->_ndefaultparams;
+        SQInteger nargs = 1;
+        if (func->_varparams)
+          paramssize--;
+
+        if (paramssize != nargs && !(ndef && nargs < paramssize && (paramssize - nargs) <= ndef))
+        {
+          errorString = "Class constructor must accept call with all default arguments during deserialization";
+          return false;
+        }
+        return true;
+      }
+      else if (sq_isnativeclosure(constructor))
+      {
+        SQNativeClosure *nativeClosure = _nativeclosure(constructor);
+        if (nativeClosure->_nparamscheck > 1)
+        {
+          errorString = "Class constructor must accept call with all default arguments during deserialization";
+          return false;
+        }
+        return true;
+      }
+
+      errorString = "Class constructor must be a closure or native closure during deserialization";
+      return false;
+    }
+
+    SQRESULT deserialize(HSQUIRRELVM vm_, SQStream *src_, SQBlob *src_blob, SQObjectPtr available_classes) {  // parsed value is left on the stack
+        vm = vm_;
+        stream = src_;
+        errorString = nullptr;
+        stringCounter = 0;
+        classCounter = 0;
+        stringTable.clear();
+        classTable.clear();
+        stringList.clear();
+        classList.clear();
+        availableClasses = available_classes;
+        depth = 0;
+
+        uint8_t startMarker = 0;
+        if (stream->Read(&startMarker, sizeof(startMarker)) != sizeof(startMarker))
+            return sq_throwerror(vm, "Unexpected end of data during deserialization");
+        if (startMarker != START_MARKER && startMarker != START_MARKER_V2)
+            return sq_throwerror(vm, "Invalid start marker during deserialization");
+
+        // a few values per nesting level wait on the stack, it can't grow while in a metamethod
+        if (!vm->_nmetamethodscall)
+            sq_reservestack(vm, MAX_DEPTH * 3 + 16);
+
+        if (startMarker == START_MARKER_V2 ? !deserializeV2(src_blob) : !deserializeObject())
+            return sq_throwerror(vm, errorString ? errorString : "Deserialization failed");
+
+        uint8_t endMarker = 0;
+        if (stream->Read(&endMarker, sizeof(endMarker)) != sizeof(endMarker))
+            return sq_throwerror(vm, "Unexpected end of data during deserialization");
+        if (endMarker != END_MARKER)
+            return sq_throwerror(vm, "Invalid end marker during deserialization");
+
+        return SQ_OK;
+    }
+};
+
+
+/*
+* objectreader reads an object writeobject() wrote a piece at a time: each step() reads or decodes
+* about as many bytes as it is given, so loading a large object can be spread over several frames
+* with the script yielding in between. With lazy set the tables come out as lazytable instances
+* that decode a value when it is first read, see scanSome(). Data written before format version 2
+* is decoded in a single step and never lazily.
+* The reader state is shared by the objectreader and its lazytables, the last one of them frees it.
+*/
+struct SQObjectReader : public SQStreamSerializer
+{
+    enum Phase { RP_START, RP_PAYLOAD, RP_DECODE, RP_DONE, RP_FAILED };
+
+    SQAllocContext allocCtx;
+    SQInteger refs;
+    Phase phase;
+    bool lazy;
+    bool busy;
+    SQObjectPtr streamObj;
+    SQObjectPtr lazyTableClass;
+
+    SQObjectReader(SQAllocContext alloc_ctx) : allocCtx(alloc_ctx), refs(1), phase(RP_START), lazy(false), busy(false) {}
+
+    SQStream *getStream()
+    {
+        SQStream *s = NULL;
+        sq_pushobject(vm, streamObj);
+        sq_getinstanceup(vm, -1, (SQUserPointer *)&s, (SQUserPointer)((SQUnsignedInteger)SQSTD_STREAM_TYPE_TAG));
+        sq_poptop(vm);
+        if (!s || !s->IsValid()) {
+            errorString = "the stream is invalid";
+            return nullptr;
+        }
+        return s;
+    }
+
+    bool readEndMarker()
+    {
+        uint8_t endMarker = 0;
+        if (stream->Read(&endMarker, sizeof(endMarker)) != sizeof(endMarker))
+            return unexpectedEndOfData();
+        if (endMarker != END_MARKER) {
+            errorString = "Invalid end marker during deserialization";
+            return false;
+        }
+        return true;
+    }
+
+    bool stepPhase(SQInteger budget)
+    {
+        switch (phase) {
+            case RP_START: {
+                if (!(stream = getStream()))
+                    return false;
+                uint8_t startMarker = 0;
+                if (stream->Read(&startMarker, sizeof(startMarker)) != sizeof(startMarker))
+                    return unexpectedEndOfData();
+                if (startMarker == START_MARKER) {
+                    SQInteger top = sq_gettop(vm);
+                    sq_reservestack(vm, MAX_DEPTH * 3 + 16);
+                    if (!deserializeObject())
+                        return false;
+                    rootsArray()->_values[ROOT_RESULT] = vm->Top();
+                    sq_settop(vm, top);
+                    if (!readEndMarker())
+                        return false;
+                    phase = RP_DONE;
+                    return true;
+                }
+                if (startMarker != START_MARKER_V2) {
+                    errorString = "Invalid start marker during deserialization";
+                    return false;
+                }
+                if (!readPayloadSize())
+                    return false;
+                if (lazy && uint64_t(inLen) >= UINT32_MAX) {
+                    errorString = "Object too large for lazy deserialization";
+                    return false;
+                }
+                phase = RP_PAYLOAD;
+                return true;
+            }
+
+            case RP_PAYLOAD:
+                if (!(stream = getStream()) || !readPayload(budget))
+                    return false;
+                if (inCopyLen < inLen)
+                    return true;
+                if (!readEndMarker())
+                    return false;
+                inStart = in = inCopy;
+                inEnd = inCopy + inLen;
+                startDecoding();
+                phase = RP_DECODE;
+                return true;
+
+            case RP_DECODE:
+                // a step that covers all of the payload decodes it in one go, without the frames
+                if (!(lazy ? scanSome(budget) : in == inStart && budget >= inLen ? decodeAll() : decodeSome(budget)))
+                    return false;
+                if (!decodingDone)
+                    return true;
+                if (in != inEnd) {
+                    errorString = "Invalid data size during deserialization";
+                    return false;
+                }
+                if (lazy) {
+                    stringList.resize(stringSpans.size());
+                    classList.resize(classSpans.size());
+                    indexed = true;
+                    lazyTables = true;
+                    SQObjectPtr result;
+                    if (!decodeAt(0, result))
+                        return false;
+                    rootsArray()->_values[ROOT_RESULT] = result;
+                }
+                phase = RP_DONE;
+                return true;
+
+            default:
+                return true;
+        }
+    }
+
+    SQRESULT step(HSQUIRRELVM v, SQInteger budget)
+    {
+        if (busy)
+            return sq_throwerror(v, "objectreader.step() called while the reader is busy");
+        if (phase == RP_FAILED)
+            return sq_throwerror(v, errorString);
+        vm = v;
+        errorString = nullptr;
+        busy = true;
+        // a phase that finishes early lets the next one start in the same step, small objects take one call
+        bool ok;
+        Phase prev;
+        do {
+            prev = phase;
+            ok = stepPhase(budget);
+        } while (ok && phase != prev && phase != RP_DONE);
+        busy = false;
+        if (ok)
+            return SQ_OK;
+        phase = RP_FAILED;
+        if (!errorString)
+            errorString = "Deserialization failed";
+        while (frames.size())
+            closeFrame();
+        return sq_throwerror(v, errorString);
+    }
+
+    // release hooks also run when the VM is being closed, there is no vm to get the allocator from then
+    void release()
+    {
+        if (--refs)
+            return;
+        if (inCopy) {
+            sq_free(allocCtx, inCopy, inCopySize);
+            inCopy = nullptr;
+        }
+        SQAllocContext alloc_ctx = allocCtx;
+        this->~SQObjectReader();
+        sq_free(alloc_ctx, this, sizeof(SQObjectReader));
+    }
+};
+
+
+struct SQLazyTable
+{
+    SQObjectReader *reader;
+    SQInteger pos;           // the table in the payload
+    SQObjectPtr index;       // key -> number of the entry, once the keys were read
+    SQObjectPtr values;      // key -> value of the entries decoded so far
+    STDLIB::vector<SQObjectPtr> keys;
+    STDLIB::vector<uint32_t> valuePos;
+    bool keysRead;
+
+    SQLazyTable(SQObjectReader *reader_, SQInteger pos_) : reader(reader_), pos(pos_), keysRead(false) {}
+};
+
+// unique addresses for the type tags
+static SQUserPointer objectreader_typetag = (SQUserPointer)&objectreader_typetag;
+static SQUserPointer lazytable_typetag = (SQUserPointer)&lazytable_typetag;
+
+static SQInteger _lazytable_releasehook(HSQUIRRELVM SQ_UNUSED_ARG(vm), SQUserPointer p, SQInteger SQ_UNUSED_ARG(size))
+{
+    SQLazyTable *self = (SQLazyTable *)p;
+    SQObjectReader *reader = self->reader;
+    self->~SQLazyTable();
+    sq_free(reader->allocCtx, self, sizeof(SQLazyTable));
+    reader->release();
+    return 1;
+}
+
+// the lazytable instance keeps what it refers to reachable for the garbage collector in this member
+#define LAZYTABLE_ROOTS_FIELD "@roots"
+
+bool SQStreamSerializer::newLazyTable(SQObjectPtr &res)
+{
+    SQObjectReader *reader = static_cast<SQObjectReader *>(this);
+    SQInteger pos = in - inStart;
+    skipValue();
+
+    SQLazyTable *lt = new (sq_malloc(reader->allocCtx, sizeof(SQLazyTable))) SQLazyTable(reader, pos);
+    lt->index = SQTable::Create(_ss(vm), 0);
+    lt->values = SQTable::Create(_ss(vm), 0);
+    reader->refs++;
+
+    SQInstance *inst = _class(reader->lazyTableClass)->CreateInstance(vm);
+    res = inst;
+    inst->_userpointer = lt;
+    inst->_hook = _lazytable_releasehook;
+
+    SQArray *anchor = SQArray::Create(_ss(vm), 3);
+    anchor->_values[0] = lt->index;
+    anchor->_values[1] = lt->values;
+    anchor->_values[2] = roots;
+    inst->Set(SQObjectPtr(SQString::Create(_ss(vm), LAZYTABLE_ROOTS_FIELD)), SQObjectPtr(anchor));
+    return true;
+}
+
+
+#define SETUP_LAZYTABLE(v) \
+    SQLazyTable *self = NULL; \
+    if (SQ_FAILED(sq_getinstanceup(v, 1, (SQUserPointer *)&self, lazytable_typetag)) || !self) \
+        return sq_throwerror(v, "invalid type tag"); \
+    SQObjectReader *reader = self->reader; \
+    HSQUIRRELVM prevVm = reader->vm; \
+    reader->vm = v;
+
+// lazytable methods may run from __setstate() called by another one, the reader goes back to the vm it had
+#define LAZYTABLE_RETURN(res) \
+    do { reader->vm = prevVm; return (res); } while (0)
+
+static bool lazytable_read_keys(SQLazyTable *self)
+{
+    if (self->keysRead)
+        return true;
+    SQObjectReader *r = self->reader;
+    const uint8_t *prevIn = r->in;
+    r->errorString = nullptr;
+    r->in = r->inStart + self->pos;
+    uint8_t t = *r->in++;
+    uint64_t n = 0;
+    r->getCount(t & 0x0F, n); // the scan checked it
+    self->keys.reserve(size_t(n));
+    self->valuePos.reserve(size_t(n));
+    bool ok = true;
+    for (uint64_t i = 0; i < n && ok; ++i) {
+        // decodeAt() leaves the input where it was, the scan knows where the key ends
+        SQObjectPtr key;
+        ok = r->decodeAt(r->in - r->inStart, key);
+        r->skipValue();
+        if (ok && sq_isnull(key)) {
+            r->errorString = "Null table key during deserialization";
+            ok = false;
+        }
+        if (ok) {
+            _table(self->index)->NewSlot(key, SQObjectPtr(SQInteger(self->keys.size())));
+            self->keys.push_back(key);
+            self->valuePos.push_back(uint32_t(r->in - r->inStart));
+            r->skipValue();
+        }
+    }
+    r->in = prevIn;
+    if (!ok) {
+        self->keys.clear();
+        self->valuePos.clear();
+        _table(self->index)->Clear();
+        return false;
+    }
+    self->keysRead = true;
+    return true;
+}
+
+// the value of the entry with the given number, decoded on first access
+static bool lazytable_value(SQLazyTable *self, SQInteger entry, SQObjectPtr &res)
+{
+    const SQObjectPtr &key = self->keys[entry];
+    if (_table(self->values)->Get(key, res))
+        return true;
+    if (!self->reader->decodeAt(self->valuePos[entry], res))
+        return false;
+    _table(self->values)->NewSlot(key, res);
+    return true;
+}
+
+static SQInteger lazytable_error(HSQUIRRELVM v, SQObjectReader *reader)
+{
+    return sq_throwerror(v, reader->errorString ? reader->errorString : "Deserialization failed");
+}
+
+static SQInteger _lazytable__get(HSQUIRRELVM v)
+{
+    SETUP_LAZYTABLE(v);
+    if (!lazytable_read_keys(self))
+        LAZYTABLE_RETURN(lazytable_error(v, reader));
+    SQObjectPtr entry, res;
+    if (!_table(self->index)->Get(stack_get(v, 2), entry) || !sq_isinteger(entry) ||
+        _integer(entry) < 0 || _integer(entry) >= SQInteger(self->keys.size())) {
+        sq_pushnull(v);
+        LAZYTABLE_RETURN(sq_throwobject(v));
+    }
+    if (!lazytable_value(self, _integer(entry), res))
+        LAZYTABLE_RETURN(lazytable_error(v, reader));
+    v->Push(res);
+    LAZYTABLE_RETURN(1);
+}
+
+static SQInteger _lazytable__nexti(HSQUIRRELVM v)
+{
+    SETUP_LAZYTABLE(v);
+    if (!lazytable_read_keys(self))
+        LAZYTABLE_RETURN(lazytable_error(v, reader));
+    // keys go in the order they were written, the index gives the one after the previous key
+    SQInteger next = 0;
+    const SQObjectPtr &prev = stack_get(v, 2);
+    if (!sq_isnull(prev)) {
+        SQObjectPtr entry;
+        next = _table(self->index)->Get(prev, entry) ? _integer(entry) + 1 : SQInteger(self->keys.size());
+    }
+    if (next >= SQInteger(self->keys.size()))
+        sq_pushnull(v);
+    else
+        v->Push(self->keys[next]);
+    LAZYTABLE_RETURN(1);
+}
+
+static SQInteger _lazytable_len(HSQUIRRELVM v)
+{
+    SETUP_LAZYTABLE(v);
+    const uint8_t *prevIn = reader->in;
+    reader->in = reader->inStart + self->pos;
+    uint8_t t = *reader->in++;
+    uint64_t n = 0;
+    reader->getCount(t & 0x0F, n);
+    reader->in = prevIn;
+    sq_pushinteger(v, SQInteger(n));
+    LAZYTABLE_RETURN(1);
+}
+
+static SQInteger _lazytable_totable(HSQUIRRELVM v)
+{
+    SETUP_LAZYTABLE(v);
+    if (!lazytable_read_keys(self))
+        LAZYTABLE_RETURN(lazytable_error(v, reader));
+    SQInteger n = SQInteger(self->keys.size());
+    SQTable *tbl = SQTable::CreateLiteral(_ss(v), n);
+    v->Push(SQObjectPtr(tbl));
+    SQObjectPtr val;
+    for (SQInteger i = 0; i < n; ++i) {
+        if (!lazytable_value(self, i, val))
+            LAZYTABLE_RETURN(lazytable_error(v, reader));
+        tbl->NewSlot(self->keys[i], val);
+    }
+    LAZYTABLE_RETURN(1);
+}
+
+static SQInteger _lazytable__typeof(HSQUIRRELVM v)
+{
+    sq_pushstring(v, "lazytable", -1);
+    return 1;
+}
+
+static SQInteger _lazytable__cloned(HSQUIRRELVM v)
+{
+    return sq_throwerror(v, "lazytable cannot be cloned, use totable()");
+}
+
+static const SQRegFunctionFromStr lazytable_funcs[] = {
+    { _lazytable__get,     "instance._get(key): any",           "Returns the value of the key, decoding it on first access" },
+    { _lazytable__nexti,   "instance._nexti(prev): any",        "Iterator support: returns the next key or null" },
+    { _lazytable_len,      "instance.len(): int",               "Returns the number of keys" },
+    { _lazytable_totable,  "instance.totable(): table",         "Returns a table with all the keys and values, nested tables stay lazy" },
+    { _lazytable__typeof,  "instance._typeof(): string",        "Returns 'lazytable'" },
+    { _lazytable__cloned,  "instance._cloned(other: instance)", "Cloning is not supported" },
+    { NULL, NULL, NULL }
+};
+
+
+#define SETUP_OBJECTREADER(v) \
+    SQObjectReader *self = NULL; \
+    if (SQ_FAILED(sq_getinstanceup(v, 1, (SQUserPointer *)&self, objectreader_typetag)) || !self) \
+        return sq_throwerror(v, "invalid type tag");
+
+#define OBJECTREADER_ROOTS_FIELD "@roots"
+
+static SQInteger _objectreader_releasehook(HSQUIRRELVM SQ_UNUSED_ARG(vm), SQUserPointer p, SQInteger SQ_UNUSED_ARG(size))
+{
+    ((SQObjectReader *)p)->release();
+    return 1;
+}
+
+static SQInteger _objectreader_constructor(HSQUIRRELVM v)
+{
+    SQStream *stream = NULL;
+    if (SQ_FAILED(sq_getinstanceup(v, 2, (SQUserPointer *)&stream, (SQUserPointer)((SQUnsignedInteger)SQSTD_STREAM_TYPE_TAG))) ||
+        !stream || !stream->IsValid())
+        return sq_throwerror(v, "a valid stream expected");
+    SQBool lazy = SQFalse;
+    if (sq_gettop(v) > 3)
+        sq_getbool(v, 4, &lazy);
+
+    SQAllocContext alloc_ctx = sq_getallocctx(v);
+    SQObjectReader *reader = new (sq_malloc(alloc_ctx, sizeof(SQObjectReader))) SQObjectReader(alloc_ctx);
+    if (SQ_FAILED(sq_setinstanceup(v, 1, reader))) {
+        reader->~SQObjectReader();
+        sq_free(alloc_ctx, reader, sizeof(SQObjectReader));
+        return sq_throwerror(v, "cannot create objectreader");
+    }
+    sq_setreleasehook(v, 1, _objectreader_releasehook);
+
+    reader->vm = v;
+    reader->lazy = lazy != SQFalse;
+    reader->streamObj = stack_get(v, 2);
+    if (sq_gettop(v) > 2)
+        reader->availableClasses = stack_get(v, 3);
+    reader->initRoots();
+    reader->rootsArray()->_values[SQObjectReader::ROOT_STREAM] = reader->streamObj;
+    _instance(stack_get(v, 1))->Set(SQObjectPtr(SQString::Create(_ss(v), OBJECTREADER_ROOTS_FIELD)), reader->roots);
+
+    sq_pushregistrytable(v);
+    sq_pushstring(v, "std_lazytable", -1);
+    if (SQ_FAILED(sq_get(v, -2)))
+        return sq_throwerror(v, "lazytable class is not registered");
+    reader->lazyTableClass = stack_get(v, -1);
+    sq_pop(v, 2);
+    return 0;
+}
+
+static SQInteger _objectreader_step(HSQUIRRELVM v)
+{
+    SETUP_OBJECTREADER(v);
+    SQInteger budget;
+    sq_getinteger(v, 2, &budget);
+    if (budget <= 0)
+        return sq_throwerror(v, "step size must be positive");
+    if (SQ_FAILED(self->step(v, budget)))
+        return SQ_ERROR;
+    sq_pushbool(v, self->phase == SQObjectReader::RP_DONE);
+    return 1;
+}
+
+static SQInteger _objectreader_done(HSQUIRRELVM v)
+{
+    SETUP_OBJECTREADER(v);
+    sq_pushbool(v, self->phase == SQObjectReader::RP_DONE);
+    return 1;
+}
+
+static SQInteger _objectreader_result(HSQUIRRELVM v)
+{
+    SETUP_OBJECTREADER(v);
+    if (self->phase != SQObjectReader::RP_DONE)
+        return sq_throwerror(v, "the object is not read yet, step() returns true once it is");
+    // the result lives in the roots only, lazytables refer to the reader and would keep each other alive
+    v->Push(self->rootsArray()->_values[SQObjectReader::ROOT_RESULT]);
+    return 1;
+}
+
+static SQInteger _objectreader__cloned(HSQUIRRELVM v)
+{
+    return sq_throwerror(v, "objectreader cannot be cloned");
+}
+
+static const SQRegFunctionFromStr objectreader_funcs[] = {
+    { _objectreader_constructor, "constructor(stream: instance, [classes: table|null, lazy: bool]): instance",
+        "Creates a reader of the next object in the stream, with lazy set its tables are decoded on first access" },
+    { _objectreader_step,        "instance.step(size: int): bool", "Reads or decodes about size bytes, returns true once the object is complete" },
+    { _objectreader_done,        "instance.done(): bool",          "Returns true once the object is complete" },
+    { _objectreader_result,      "instance.result(): any",         "Returns the object once step() returned true" },
+    { _objectreader__cloned,     "instance._cloned(other: instance)", "Cloning is not supported" },
+    { NULL, NULL, NULL }
+};
+
+static void declare_class(HSQUIRRELVM v, const char *name, SQUserPointer typetag, const SQRegFunctionFromStr *funcs, const char *field)
+{
+    sq_pushstring(v, name, -1);
+    sq_newclass(v, SQFalse);
+    sq_settypetag(v, -1, typetag);
+    for (SQInteger i = 0; funcs[i].f; i++)
+        sq_new_closure_slot_from_decl_string(v, funcs[i].f, 0, funcs[i].declstring, funcs[i].docstring);
+    sq_pushstring(v, field, -1);
+    sq_pushnull(v);
+    sq_newslot(v, -3, SQFalse);
+}
+
+SQRESULT sqstd_register_objectreader(HSQUIRRELVM v)
+{
+    // lazytables are only made by objectreaders, the class stays in the registry
+    sq_pushregistrytable(v);
+    declare_class(v, "std_lazytable", lazytable_typetag, lazytable_funcs, LAZYTABLE_ROOTS_FIELD);
+    sq_newslot(v, -3, SQFalse);
+    sq_pop(v, 1);
+
+    declare_class(v, "objectreader", objectreader_typetag, objectreader_funcs, OBJECTREADER_ROOTS_FIELD);
+    sq_newslot(v, -3, SQFalse);
+    return SQ_OK;
+}
 
 
 SQRESULT sqstd_serialize_object_to_stream(HSQUIRRELVM vm, SQStream *dest, SQObjectPtr obj, SQObjectPtr available_classes) {
@@ -890,10 +2373,10 @@ SQRESULT sqstd_serialize_object_to_stream(HSQUIRRELVM vm, SQStream *dest, SQObje
     return serializer.serialize(vm, dest, obj, available_classes);
 }
 
-SQRESULT sqstd_deserialize_object_from_stream(HSQUIRRELVM vm, SQStream *src, SQObjectPtr available_classes) {
+SQRESULT sqstd_deserialize_object_from_stream(HSQUIRRELVM vm, SQStream *src, SQBlob *src_blob, SQObjectPtr available_classes) {
     int prevTop = sq_gettop(vm);
     SQStreamSerializer serializer;
-    SQRESULT res = serializer.deserialize(vm, src, available_classes);
+    SQRESULT res = serializer.deserialize(vm, src, src_blob, available_classes);
     sq_settop(vm, prevTop + 1);
     return res;
 }
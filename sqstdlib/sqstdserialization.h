@@ -2,5 +2,10 @@
 #pragma once
 #include <squirrel/sqpcheader.h>
 
+struct SQBlob;
+
 SQRESULT sqstd_serialize_object_to_stream(HSQUIRRELVM vm, SQStream *dest, SQObjectPtr obj, SQObjectPtr available_classes);
-SQRESULT sqstd_deserialize_object_from_stream(HSQUIRRELVM vm, SQStream *src, SQObjectPtr available_classes);
+// src_blob is src itself when it is a blob, the data is then decoded from its buffer in place
+SQRESULT sqstd_deserialize_object_from_stream(HSQUIRRELVM vm, SQStream *src, SQBlob *src_blob, SQObjectPtr available_classes);
+// the objectreader class into the table on top of the stack
+SQRESULT sqstd_register_objectreader(HSQUIRRELVM v);
@@ -270,7 +270,10 @@ SQInteger _stream_readobject(HSQUIRRELVM v)
     SQObjectPtr availableClasses;
     if (sq_gettop(v) > 1)
         availableClasses = stack_get(v, 2);
-    SQRESULT res = sqstd_deserialize_object_from_stream(v, self, availableClasses);
+    SQUserPointer tag = NULL;
+    sq_gettypetag(v, 1, &tag);
+    SQBlob *blob = tag == (SQUserPointer)SQSTD_BLOB_TYPE_TAG ? static_cast<SQBlob *>(self) : NULL;
+    SQRESULT res = sqstd_deserialize_object_from_stream(v, self, blob, availableClasses);
     return SQ_FAILED(res) ? res : 1;
 }
 
@@ -316,6 +319,8 @@ SQRESULT sqstd_init_streamclass(HSQUIRRELVM v)
         sq_pushstring(v,"std_stream",-1);
         sq_get(v,-3);
         sq_newslot(v,-4,SQFalse); // put to destination table (and name the class 'stream')
+        sq_pop(v,1);
+        return sqstd_register_objectreader(v);
     }
     else {
         sq_pop(v,1); //result
@@ -6,8 +6,10 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <new>
 #include <sqstringlib.h>
 #include <sq_char_class.h>
+#include <sqnumconv.h>
 
 #define MAX_FORMAT_LEN  20
 #define MAX_WFORMAT_LEN 3
@@ -23,7 +25,8 @@ static SQBool isfmtchr(char ch)
     return SQFalse;
 }
 
-static SQInteger validate_format(HSQUIRRELVM v, char *fmt, const char *src, SQInteger n,SQInteger &width)
+// parses the spec after a '%' into fmt, returns the position of the conversion char or -1 with err set
+static SQInteger validate_format(char *fmt, const char *src, SQInteger n, SQInteger &width, const char *&err)
 {
     char *dummy;
     char swidth[MAX_WFORMAT_LEN];
@@ -35,8 +38,10 @@ static SQInteger validate_format(HSQUIRRELVM v, char *fmt, const char *src, SQIn
         swidth[wc] = src[n];
         n++;
         wc++;
-        if(wc>=MAX_WFORMAT_LEN)
-            return sq_throwerror(v,"width format too long");
+        if(wc>=MAX_WFORMAT_LEN) {
+            err = "width format too long";
+            return -1;
+        }
     }
     swidth[wc] = '\0';
     if(wc > 0) {
@@ -52,8 +57,10 @@ static SQInteger validate_format(HSQUIRRELVM v, char *fmt, const char *src, SQIn
             swidth[wc] = src[n];
             n++;
             wc++;
-            if(wc>=MAX_WFORMAT_LEN)
-                return sq_throwerror(v,"precision format too long");
+            if(wc>=MAX_WFORMAT_LEN) {
+                err = "precision format too long";
+                return -1;
+            }
         }
         swidth[wc] = '\0';
         if(wc > 0) {
@@ -61,101 +68,222 @@ static SQInteger validate_format(HSQUIRRELVM v, char *fmt, const char *src, SQIn
 
         }
     }
-    if (n-start > MAX_FORMAT_LEN )
-        return sq_throwerror(v,"format too long");
+    if (n-start > MAX_FORMAT_LEN ) {
+        err = "format too long";
+        return -1;
+    }
     memcpy(&fmt[1],&src[start],((n-start)+1)*sizeof(char));
     fmt[(n-start)+2] = '\0';
     return n;
 }
 
-SQRESULT sqstd_format(HSQUIRRELVM v,SQInteger nformatstringidx,SQInteger *outlen,char **output)
+// the precision of a spec without flags or width, like the ".2" of "%.2f": -1 if the spec is
+// empty, -2 if it has anything else and has to go to printf()
+static int plain_precision(const char *spec, SQInteger len)
 {
-    const char *format;
-    char *dest;
+    if (len == 0)
+        return -1;
+    if (spec[0] != '.')
+        return -2;
+    int prec = 0;
+    for (SQInteger k = 1; k < len; k++)
+        prec = prec * 10 + (spec[k] - '0');
+    return prec;
+}
+
+/*
+* A format string is parsed once into a list of ops: runs of text copied as they are and
+* conversions with their printf() spec. Running the ops first checks the arguments and sums
+* up the output size, then prints into the scratchpad in one go. format(), printf() and
+* stringbuilder.appendf() keep the ops of recently used format strings in a small cache.
+*/
+enum SQFormatOpType { FOP_TEXT, FOP_STRING, FOP_INTEGER, FOP_FLOAT, FOP_ERROR };
+
+struct SQFormatOp
+{
+    SQFormatOpType type;
+    char conv;
+    int prec; // see plain_precision()
+    SQInteger width;
+    SQInteger pos, len; // FOP_TEXT: the range of the format string
+    const char *error; // FOP_ERROR: raised once the op is reached
     char fmt[MAX_FORMAT_LEN + 5];
-    const SQRESULT res = sq_getstring(v,nformatstringidx,&format);
-    if (SQ_FAILED(res)) {
-        return res; // propagate the error
-    }
-    SQInteger format_size = sq_getsize(v,nformatstringidx);
-    SQInteger allocated = (format_size+2)*sizeof(char);
-    dest = sq_getscratchpad(v,allocated);
-    SQInteger n = 0,i = 0, nparam = nformatstringidx+1, w = 0;
-    //while(format[n] != '\0')
+};
+
+struct SQFormatProgram
+{
+    SQInteger nops;
+    SQInteger capacity; // of ops, see format_max_ops()
+    SQInteger size; // of the format string
+    SQFormatOp *ops;
+    char *text; // copy of the format string a cached program was made for
+};
+
+// an upper bound of the number of ops for the format string
+static SQInteger format_max_ops(const char *format, SQInteger size)
+{
+    SQInteger nops = 1;
+    for (const char *p = format, *e = format + size; (p = (const char *)memchr(p, '%', e - p)) != NULL; p++)
+        nops += 2;
+    return nops;
+}
+
+static void format_compile(const char *format, SQInteger format_size, SQFormatProgram *prog)
+{
+    SQFormatOp *ops = prog->ops;
+    SQInteger nops = 0, n = 0;
+    prog->size = format_size;
     while(n < format_size)
     {
-        if(format[n] != '%') {
-            assert(i < allocated);
-            dest[i++] = format[n];
-            n++;
-        }
-        else if(format[n+1] == '%') { //handles %%
-                dest[i++] = '%';
+        if(format[n] != '%' || format[n+1] == '%') {
+            // '%%' prints '%', the text run continues after it
+            SQInteger start = n;
+            if (format[n] == '%')
                 n += 2;
+            else
+                n++;
+            while (n < format_size && format[n] != '%')
+                n++;
+            SQFormatOp &op = ops[nops++];
+            op.type = FOP_TEXT;
+            op.pos = format[start] == '%' ? start + 1 : start;
+            op.len = n - op.pos;
+            continue;
         }
-        else {
-            n++;
-            if( nparam > sq_gettop(v) )
-                return sq_throwerror(v,"not enough parameters for the given format string");
-            n = validate_format(v,fmt,format,n,w);
-            if(n < 0) return -1;
-            SQInteger addlen = 0;
-            SQInteger valtype = 0;
-            const char *ts = NULL;
-            SQInteger ti = 0;
-            SQFloat tf = 0;
-            switch(format[n]) {
-            case 's':
-                if(SQ_FAILED(sq_getstring(v,nparam,&ts)))
-                    return sq_throwerror(v,"string expected for the specified format");
-                addlen = (sq_getsize(v,nparam)*sizeof(char))+((w+1)*sizeof(char));
-                valtype = 's';
-                break;
-            case 'i': case 'd': case 'o': case 'u':  case 'x':  case 'X':
+        n++;
+        SQFormatOp &op = ops[nops++];
+        op.error = NULL;
+        SQInteger spec_start = n;
+        n = validate_format(op.fmt,format,n,op.width,op.error);
+        if (n < 0) {
+            op.type = FOP_ERROR;
+            break;
+        }
+        op.conv = format[n];
+        op.prec = plain_precision(&format[spec_start], n - spec_start);
+        switch(op.conv) {
+        case 's':
+            op.type = FOP_STRING;
+            break;
+        case 'i': case 'd': case 'o': case 'u':  case 'x':  case 'X':
 #ifdef _SQ64
-                {
-                size_t flen = strlen(fmt);
-                SQInteger fpos = flen - 1;
-                char f = fmt[fpos];
-                const char *prec = (const char *)_PRINT_INT_PREC;
-                while(*prec != '\0') {
-                    fmt[fpos++] = *prec++;
-                }
-                fmt[fpos++] = f;
-                fmt[fpos++] = '\0';
-                }
+            {
+            size_t flen = strlen(op.fmt);
+            SQInteger fpos = flen - 1;
+            char f = op.fmt[fpos];
+            const char *prec = (const char *)_PRINT_INT_PREC;
+            while(*prec != '\0') {
+                op.fmt[fpos++] = *prec++;
+            }
+            op.fmt[fpos++] = f;
+            op.fmt[fpos++] = '\0';
+            }
 #endif
-            case 'c':
-                if(SQ_FAILED(sq_getinteger(v,nparam,&ti)))
-                    return sq_throwerror(v,"integer expected for the specified format");
-                addlen = (ADDITIONAL_FORMAT_SPACE)+((w+1)*sizeof(char));
-                valtype = 'i';
-                break;
-            case 'f': case 'g': case 'G': case 'e':  case 'E':
-                if(SQ_FAILED(sq_getfloat(v,nparam,&tf)))
-                    return sq_throwerror(v,"float expected for the specified format");
-                addlen = (ADDITIONAL_FORMAT_SPACE)+((w+1)*sizeof(char));
-                valtype = 'f';
-                break;
-            default:
-                return sq_throwerror(v,"invalid format");
+        case 'c':
+            op.type = FOP_INTEGER;
+            break;
+        case 'f': case 'g': case 'G': case 'e':  case 'E':
+            op.type = FOP_FLOAT;
+            break;
+        default:
+            op.type = FOP_ERROR;
+            op.error = "invalid format";
+            break;
+        }
+        if (op.type == FOP_ERROR)
+            break;
+        n++;
+    }
+    prog->nops = nops;
+}
+
+static SQRESULT format_run(HSQUIRRELVM v, const SQFormatProgram *prog, const char *format, SQInteger nformatstringidx,
+                           SQInteger top, SQInteger *outlen, char **output)
+{
+    const SQFormatOp *ops = prog->ops, *end = ops + prog->nops;
+    SQInteger allocated = (prog->size+2)*sizeof(char);
+    SQInteger nparam = nformatstringidx+1;
+    for (const SQFormatOp *op = ops; op != end; op++) {
+        if (op->type == FOP_TEXT)
+            continue;
+        if( nparam > top )
+            return sq_throwerror(v,"not enough parameters for the given format string");
+        SQInteger addlen = 0;
+        SQInteger ti;
+        SQFloat tf;
+        switch(op->type) {
+        case FOP_STRING:
+            if(sq_gettype(v,nparam) != OT_STRING)
+                return sq_throwerror(v,"string expected for the specified format");
+            addlen = (sq_getsize(v,nparam)*sizeof(char))+((op->width+1)*sizeof(char));
+            break;
+        case FOP_INTEGER:
+            if(SQ_FAILED(sq_getinteger(v,nparam,&ti)))
+                return sq_throwerror(v,"integer expected for the specified format");
+            addlen = (ADDITIONAL_FORMAT_SPACE)+((op->width+1)*sizeof(char));
+            break;
+        case FOP_FLOAT:
+            if(SQ_FAILED(sq_getfloat(v,nparam,&tf)))
+                return sq_throwerror(v,"float expected for the specified format");
+            addlen = (ADDITIONAL_FORMAT_SPACE)+((op->width+1)*sizeof(char));
+            break;
+        default:
+            return sq_throwerror(v,op->error);
+        }
+        allocated += addlen + sizeof(char);
+        nparam++;
+    }
+
+    char *dest = sq_getscratchpad(v,allocated);
+    SQInteger i = 0;
+    nparam = nformatstringidx+1;
+    for (const SQFormatOp *op = ops; op != end; op++) {
+        switch(op->type) {
+        case FOP_TEXT:
+            memcpy(&dest[i], &format[op->pos], op->len);
+            i += op->len;
+            continue;
+        case FOP_STRING: {
+                const char *ts;
+                sq_getstring(v,nparam,&ts);
+                if (op->prec == -1) {
+                    size_t len = strlen(ts);
+                    memcpy(&dest[i], ts, len);
+                    i += len;
+                }
+                else
+                    i += scsprintf(&dest[i],allocated-i,op->fmt,ts);
             }
-            n++;
-            allocated += addlen + sizeof(char);
-            dest = sq_getscratchpad(v,allocated);
-            switch(valtype) {
-            case 's': i += scsprintf(&dest[i],allocated,fmt,ts); break;
-            case 'i': i += scsprintf(&dest[i],allocated,fmt,ti); break;
-            case 'f': {
-                int len = scsprintf(&dest[i], allocated, fmt, tf);
+            break;
+        case FOP_INTEGER: {
+                SQInteger ti;
+                sq_getinteger(v,nparam,&ti);
+                if (op->prec == -1 && (op->conv == 'd' || op->conv == 'i'))
+                    i += sqnum_print_integer(&dest[i],ti);
+                else
+                    i += scsprintf(&dest[i],allocated-i,op->fmt,ti);
+            }
+            break;
+        case FOP_FLOAT: {
+                SQFloat tf;
+                sq_getfloat(v,nparam,&tf);
+                if (op->prec != -2 && (op->conv == 'f' || op->conv == 'g' || op->conv == 'e')) {
+                    SQInteger len = sqnum_print_float_fmt(&dest[i], allocated - i, tf, op->conv, op->prec);
+                    if (len >= 0) {
+                        i += len;
+                        break;
+                    }
+                }
+                int len = scsprintf(&dest[i], allocated-i, op->fmt, tf);
                 for (; len > 0; len--, i++)
                     if (dest[i] == ',')
                         dest[i] = '.';
-                break;
-                }
-            };
-            nparam ++;
+            }
+            break;
+        default:
+            break;
         }
+        nparam++;
     }
     *outlen = i;
     dest[i] = '\0';
@@ -163,6 +291,114 @@ SQRESULT sqstd_format(HSQUIRRELVM v,SQInteger nformatstringidx,SQInteger *outlen
     return SQ_OK;
 }
 
+#define FORMAT_STACK_OPS 16
+
+static SQRESULT format_uncached(HSQUIRRELVM v, const char *format, SQInteger format_size, SQInteger nformatstringidx,
+                                SQInteger top, SQInteger *outlen, char **output)
+{
+    SQFormatOp stack_ops[FORMAT_STACK_OPS];
+    SQFormatProgram prog;
+    SQAllocContext alloc_ctx = sq_getallocctx(v);
+    prog.capacity = format_max_ops(format, format_size);
+    prog.ops = prog.capacity <= FORMAT_STACK_OPS ? stack_ops : (SQFormatOp *)sq_malloc(alloc_ctx, prog.capacity * sizeof(SQFormatOp));
+    format_compile(format, format_size, &prog);
+    SQRESULT r = format_run(v, &prog, format, nformatstringidx, top, outlen, output);
+    if (prog.ops != stack_ops)
+        sq_free(alloc_ctx, prog.ops, prog.capacity * sizeof(SQFormatOp));
+    return r;
+}
+
+SQRESULT sqstd_format(HSQUIRRELVM v,SQInteger nformatstringidx,SQInteger *outlen,char **output)
+{
+    const char *format;
+    const SQRESULT res = sq_getstring(v,nformatstringidx,&format);
+    if (SQ_FAILED(res)) {
+        return res; // propagate the error
+    }
+    return format_uncached(v, format, sq_getsize(v,nformatstringidx), nformatstringidx, sq_gettop(v), outlen, output);
+}
+
+// direct mapped by the address of the format string, entries are checked against a copy of it
+#define FORMAT_CACHE_SIZE 64
+// longer format strings are parsed on every call
+#define FORMAT_CACHE_MAX_LEN 1024
+
+struct SQFormatCache
+{
+    SQAllocContext alloc_ctx;
+    const char *keys[FORMAT_CACHE_SIZE];
+    SQFormatProgram *progs[FORMAT_CACHE_SIZE];
+};
+
+static SQUserPointer format_cache_typetag = (SQUserPointer)&format_cache_typetag;
+
+static SQInteger format_alloc_size(SQInteger max_ops, SQInteger size)
+{
+    return sizeof(SQFormatProgram) + max_ops * sizeof(SQFormatOp) + size + 1;
+}
+
+static void format_cache_free(SQFormatCache *cache, SQInteger slot)
+{
+    SQFormatProgram *prog = cache->progs[slot];
+    if (prog) {
+        sq_free(cache->alloc_ctx, prog, format_alloc_size(prog->capacity, prog->size));
+        cache->progs[slot] = NULL;
+        cache->keys[slot] = NULL;
+    }
+}
+
+static SQInteger _format_cache_releasehook(HSQUIRRELVM SQ_UNUSED_ARG(vm), SQUserPointer p, SQInteger SQ_UNUSED_ARG(size))
+{
+    SQFormatCache *cache = (SQFormatCache *)p;
+    for (SQInteger i = 0; i < FORMAT_CACHE_SIZE; i++)
+        format_cache_free(cache, i);
+    return 1;
+}
+
+static void push_format_cache(HSQUIRRELVM v)
+{
+    SQFormatCache *cache = (SQFormatCache *)sq_newuserdata(v, sizeof(SQFormatCache));
+    cache->alloc_ctx = sq_getallocctx(v);
+    memset(cache->keys, 0, sizeof(cache->keys));
+    memset(cache->progs, 0, sizeof(cache->progs));
+    sq_settypetag(v, -1, format_cache_typetag);
+    sq_setreleasehook(v, -1, _format_cache_releasehook);
+}
+
+// sqstd_format() for natives that have the cache as their free variable, it is right above the arguments
+static SQRESULT format_cached(HSQUIRRELVM v,SQInteger nformatstringidx,SQInteger *outlen,char **output)
+{
+    SQInteger cacheidx = sq_gettop(v);
+    SQFormatCache *cache = NULL;
+    SQUserPointer typetag = NULL;
+    const char *format;
+    if (SQ_FAILED(sq_getuserdata(v, cacheidx, (SQUserPointer *)&cache, &typetag)) || typetag != format_cache_typetag)
+        return sq_throwerror(v, "format cache expected");
+    if (SQ_FAILED(sq_getstring(v,nformatstringidx,&format)))
+        return SQ_ERROR;
+    SQInteger format_size = sq_getsize(v,nformatstringidx);
+    if (format_size > FORMAT_CACHE_MAX_LEN)
+        return format_uncached(v, format, format_size, nformatstringidx, cacheidx - 1, outlen, output);
+
+    uintptr_t addr = (uintptr_t)format;
+    SQInteger slot = SQInteger(((addr >> 4) ^ (addr >> 10)) % FORMAT_CACHE_SIZE);
+    SQFormatProgram *prog = cache->progs[slot];
+    if (!prog || cache->keys[slot] != format || prog->size != format_size || memcmp(prog->text, format, format_size) != 0) {
+        format_cache_free(cache, slot);
+        SQInteger max_ops = format_max_ops(format, format_size);
+        prog = (SQFormatProgram *)sq_malloc(cache->alloc_ctx, format_alloc_size(max_ops, format_size));
+        prog->capacity = max_ops;
+        prog->ops = (SQFormatOp *)(prog + 1);
+        prog->text = (char *)(prog->ops + max_ops);
+        memcpy(prog->text, format, format_size);
+        prog->text[format_size] = '\0';
+        format_compile(format, format_size, prog);
+        cache->keys[slot] = format;
+        cache->progs[slot] = prog;
+    }
+    return format_run(v, prog, format, nformatstringidx, cacheidx - 1, outlen, output);
+}
+
 void sqstd_pushstringf(HSQUIRRELVM v,const char *s,...)
 {
     SQInteger n=256;
@@ -186,7 +422,7 @@ static SQInteger _string_printf(HSQUIRRELVM v)
 {
     char *dest = NULL;
     SQInteger length = 0;
-    if(SQ_FAILED(sqstd_format(v,2,&length,&dest)))
+    if(SQ_FAILED(format_cached(v,2,&length,&dest)))
         return -1;
 
     SQPRINTFUNCTION printfunc = sq_getprintfunc(v);
@@ -199,7 +435,7 @@ static SQInteger _string_format(HSQUIRRELVM v)
 {
     char *dest = NULL;
     SQInteger length = 0;
-    if(SQ_FAILED(sqstd_format(v,2,&length,&dest)))
+    if(SQ_FAILED(format_cached(v,2,&length,&dest)))
         return -1;
     sq_pushstring(v,dest,length);
     return 1;
@@ -334,6 +570,203 @@ static const SQRegFunctionFromStr rexobj_funcs[] = {
     { NULL, NULL }
 };
 
+//stringbuilder
+
+// Growable buffer for building a string piece by piece, only tostring() creates (and interns)
+// a string from it. Numbers are printed right into the buffer, the same way tostring() does.
+struct SQStringBuilder
+{
+    SQAllocContext _alloc_ctx;
+    char *_buf;
+    SQInteger _len;
+    SQInteger _allocated;
+
+    SQStringBuilder(SQAllocContext alloc_ctx) : _alloc_ctx(alloc_ctx), _buf(NULL), _len(0), _allocated(0) {}
+    ~SQStringBuilder() { if (_buf) sq_free(_alloc_ctx, _buf, _allocated); }
+
+    void Reserve(SQInteger size)
+    {
+        if (size <= _allocated)
+            return;
+        _buf = (char *)sq_realloc(_alloc_ctx, _buf, _allocated, size);
+        _allocated = size;
+    }
+    // room for n more chars
+    char *Grow(SQInteger n)
+    {
+        if (_len + n > _allocated)
+            Reserve(_len + n > _allocated * 2 ? _len + n : _allocated * 2);
+        return _buf + _len;
+    }
+    void Append(const char *s, SQInteger n)
+    {
+        memcpy(Grow(n), s, n);
+        _len += n;
+    }
+};
+
+static SQUserPointer stringbuilder_typetag = (SQUserPointer)&stringbuilder_typetag;
+
+#define SETUP_STRINGBUILDER(v) \
+    SQStringBuilder *self = NULL; \
+    if(SQ_FAILED(sq_getinstanceup(v,1,(SQUserPointer *)&self,stringbuilder_typetag)) || !self) { \
+        return sq_throwerror(v,"invalid type tag"); \
+    }
+
+static SQInteger _stringbuilder_releasehook(HSQUIRRELVM SQ_UNUSED_ARG(vm), SQUserPointer p, SQInteger SQ_UNUSED_ARG(size))
+{
+    SQStringBuilder *self = (SQStringBuilder *)p;
+    SQAllocContext alloc_ctx = self->_alloc_ctx;
+    self->~SQStringBuilder();
+    sq_free(alloc_ctx, self, sizeof(SQStringBuilder));
+    return 1;
+}
+
+static SQInteger _stringbuilder_setup(HSQUIRRELVM v, SQInteger capacity)
+{
+    SQAllocContext alloc_ctx = sq_getallocctx(v);
+    SQStringBuilder *sb = new (sq_malloc(alloc_ctx, sizeof(SQStringBuilder))) SQStringBuilder(alloc_ctx);
+    if(SQ_FAILED(sq_setinstanceup(v,1,sb))) {
+        sb->~SQStringBuilder();
+        sq_free(alloc_ctx, sb, sizeof(SQStringBuilder));
+        return sq_throwerror(v, "cannot create stringbuilder");
+    }
+    sq_setreleasehook(v,1,_stringbuilder_releasehook);
+    sb->Reserve(capacity);
+    return 0;
+}
+
+static SQInteger _stringbuilder_constructor(HSQUIRRELVM v)
+{
+    SQInteger capacity = 0;
+    if(sq_gettop(v) > 1)
+        sq_getinteger(v,2,&capacity);
+    if(capacity < 0)
+        return sq_throwerror(v, "cannot create stringbuilder with negative capacity");
+    return _stringbuilder_setup(v, capacity);
+}
+
+static SQInteger _stringbuilder__cloned(HSQUIRRELVM v)
+{
+    SQStringBuilder *other = NULL;
+    if(SQ_FAILED(sq_getinstanceup(v,2,(SQUserPointer *)&other,stringbuilder_typetag)) || !other)
+        return sq_throwerror(v,"invalid type tag");
+    if(SQ_FAILED(_stringbuilder_setup(v, other->_len)))
+        return SQ_ERROR;
+    SQStringBuilder *self = NULL;
+    sq_getinstanceup(v,1,(SQUserPointer *)&self,stringbuilder_typetag);
+    self->Append(other->_buf, other->_len);
+    return 0;
+}
+
+static SQInteger _stringbuilder_append(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    SQInteger top = sq_gettop(v);
+    for(SQInteger i = 2; i <= top; i++) {
+        const char *str;
+        SQInteger len;
+        switch(sq_gettype(v,i)) {
+        case OT_STRING:
+            sq_getstringandsize(v,i,&str,&len);
+            self->Append(str,len);
+            break;
+        case OT_INTEGER: {
+                SQInteger n;
+                sq_getinteger(v,i,&n);
+                self->_len += sqnum_print_integer(self->Grow(SQNUM_BUF_SIZE),n);
+            }
+            break;
+        case OT_FLOAT: {
+                SQFloat f;
+                sq_getfloat(v,i,&f);
+                self->_len += sqnum_print_float(self->Grow(SQNUM_BUF_SIZE),f);
+            }
+            break;
+        default:
+            if(SQ_FAILED(sq_tostring(v,i)))
+                return SQ_ERROR;
+            sq_getstringandsize(v,-1,&str,&len);
+            self->Append(str,len);
+            sq_poptop(v);
+        }
+    }
+    sq_push(v,1);
+    return 1;
+}
+
+static SQInteger _stringbuilder_appendf(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    char *dest = NULL;
+    SQInteger length = 0;
+    if(SQ_FAILED(format_cached(v,2,&length,&dest)))
+        return SQ_ERROR;
+    self->Append(dest,length);
+    sq_push(v,1);
+    return 1;
+}
+
+static SQInteger _stringbuilder_reserve(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    SQInteger size;
+    sq_getinteger(v,2,&size);
+    if(size < 0)
+        return sq_throwerror(v,"negative size");
+    self->Reserve(size);
+    return 0;
+}
+
+static SQInteger _stringbuilder_clear(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    self->_len = 0;
+    return 0;
+}
+
+static SQInteger _stringbuilder_len(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    sq_pushinteger(v,self->_len);
+    return 1;
+}
+
+static SQInteger _stringbuilder_capacity(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    sq_pushinteger(v,self->_allocated);
+    return 1;
+}
+
+static SQInteger _stringbuilder_tostring(HSQUIRRELVM v)
+{
+    SETUP_STRINGBUILDER(v);
+    sq_pushstring(v,self->_len ? self->_buf : "",self->_len);
+    return 1;
+}
+
+static SQInteger _stringbuilder__typeof(HSQUIRRELVM v)
+{
+    sq_pushstring(v,"stringbuilder",-1);
+    return 1;
+}
+
+static const SQRegFunctionFromStr stringbuilder_funcs[] = {
+    { _stringbuilder_constructor, "constructor([capacity: int]): instance", "Creates an empty string builder with room for capacity chars" },
+    { _stringbuilder_append, "instance.append(...): instance", "Appends the arguments converted like tostring(), numbers are printed directly into the buffer; returns the builder" },
+    { _stringbuilder_appendf, "instance.appendf(fmt: string, ...): instance", "Appends format(fmt, ...); returns the builder" },
+    { _stringbuilder_reserve, "instance.reserve(capacity: int)", "Makes room for at least capacity chars" },
+    { _stringbuilder_clear, "instance.clear()", "Empties the builder, keeps the allocated buffer" },
+    { _stringbuilder_len, "instance.len(): int", "Returns the number of chars built so far" },
+    { _stringbuilder_capacity, "instance.capacity(): int", "Returns the number of chars the buffer has room for" },
+    { _stringbuilder_tostring, "instance.tostring(): string", "Returns the built string" },
+    { _stringbuilder_tostring, "instance._tostring(): string", "Returns the built string" },
+    { _stringbuilder__typeof, "instance._typeof(): string", "Returns 'stringbuilder'" },
+    { _stringbuilder__cloned, "instance._cloned(other: instance)", "Copies the contents of the given builder" },
+    { NULL, NULL, NULL }
+};
+
 static const SQRegFunctionFromStr stringlib_funcs[] = {
     { _string_format, "pure format(fmt: string, ...): string" },
     { _string_printf, "printf(fmt: string, ...)" },
@@ -348,9 +781,22 @@ static const SQRegFunctionFromStr stringlib_funcs[] = {
 };
 #undef _DECL_FUNC
 
+// pushes the format cache as the free variable of the functions using format_cached(), returns their number
+static SQUnsignedInteger push_freevars(HSQUIRRELVM v, SQFUNCTION f, SQInteger cacheidx)
+{
+    if (f == _string_format || f == _string_printf || f == _stringbuilder_appendf) {
+        sq_push(v, cacheidx);
+        return 1;
+    }
+    return 0;
+}
 
 SQRESULT sqstd_register_stringlib(HSQUIRRELVM v)
 {
+    push_format_cache(v);
+    SQInteger cacheidx = sq_gettop(v);
+    sq_push(v, -2);
+
     sq_pushstring(v, "regexp", -1);
     sq_newclass(v, SQFalse);
     rex_typetag = (SQUserPointer)rexobj_funcs;
@@ -362,10 +808,23 @@ SQRESULT sqstd_register_stringlib(HSQUIRRELVM v)
     }
     sq_newslot(v, -3, SQFalse);
 
+    sq_pushstring(v, "stringbuilder", -1);
+    sq_newclass(v, SQFalse);
+    sq_settypetag(v, -1, stringbuilder_typetag);
+    i = 0;
+    while (stringbuilder_funcs[i].f) {
+        SQUnsignedInteger nfreevars = push_freevars(v, stringbuilder_funcs[i].f, cacheidx);
+        sq_new_closure_slot_from_decl_string(v, stringbuilder_funcs[i].f, nfreevars, stringbuilder_funcs[i].declstring, stringbuilder_funcs[i].docstring);
+        i++;
+    }
+    sq_newslot(v, -3, SQFalse);
+
     i = 0;
     while (stringlib_funcs[i].f) {
-        sq_new_closure_slot_from_decl_string(v, stringlib_funcs[i].f, 0, stringlib_funcs[i].declstring, stringlib_funcs[i].docstring);
+        SQUnsignedInteger nfreevars = push_freevars(v, stringlib_funcs[i].f, cacheidx);
+        sq_new_closure_slot_from_decl_string(v, stringlib_funcs[i].f, nfreevars, stringlib_funcs[i].declstring, stringlib_funcs[i].docstring);
         i++;
     }
+    sq_pop(v, 2);
     return SQ_OK;
 }
@@ -8,6 +8,7 @@
 #include "constgen.h"
 #include "sqvm.h"
 #include "optimizer.h"
+#include "optimizations/chainFusion.h"
 #include "sqtable.h"
 #include "sqarray.h"
 #include "sqclass.h"
@@ -85,9 +86,11 @@ CodeGenVisitor::CodeGenVisitor(Arena *arena, const HSQOBJECT *bindings, SQVM *vm
     _visit_arrays_and_tables(false),
     _variable_node(nullptr),
     _arena(arena),
-    _scope() {
+    _scope(),
+    _fused_appends(arena) {
 
     _complexity_level = 0;
+    _fused_chains = 0;
 
     if (bindings) {
         assert(sq_type(*bindings) == OT_TABLE || sq_type(*bindings) == OT_NULL);
@@ -1721,7 +1724,95 @@ static bool isCalleeAnOuter(SQFuncState *_fs, const Expr *expr, SQInteger &outer
     return outer_pos != -1;
 }
 
+// Answers ChainFusionOpt's questions about the call site, without registering outers
+// or otherwise changing the function state.
+class CodeGenFusionScope : public ChainFusionOpt::FusionScope {
+    CodeGenVisitor *_cg;
+    SQFuncState *_fs;
+
+public:
+    CodeGenFusionScope(CodeGenVisitor *cg) : _cg(cg), _fs(cg->_fs) {}
+
+    bool isArray(Expr *expr) override {
+        return _cg->inferExprTypeMask(expr) == _RT_ARRAY;
+    }
+
+    bool allowsImplicitTypeMethods() override {
+        return (_fs->lang_features & LF_FORBID_IMPLICIT_TYPE_METHODS) == 0;
+    }
+
+    FunctionExpr *hoistedClosure(Id *id) override {
+        if (strncmp(id->name(), "$ch", 3) != 0)
+            return nullptr;
+        SQObjectPtr name(_fs->CreateString(id->name()));
+        SQCompiletimeVarInfo varInfo;
+        for (SQFuncState *fs = _fs; fs; fs = fs->_parent) {
+            if (fs->GetLocalVariable(name, varInfo) != -1) {
+                if ((varInfo.var_flags & (VF_ASSIGNABLE | VF_PARAM)) == 0
+                    && varInfo.initializer && varInfo.initializer->op() == TO_FUNCTION)
+                    return varInfo.initializer->asFunctionExpr();
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    bool isNameTaken(const char *name) override {
+        SQObjectPtr nameObj(_fs->CreateString(name));
+        SQObjectPtr constant;
+        return isLocal(name) || isFunctionName(name) || _cg->IsConstant(nameObj, constant);
+    }
+
+    bool isLocal(const char *name) override {
+        SQCompiletimeVarInfo varInfo;
+        return _fs->GetLocalVariable(_fs->CreateString(name), varInfo) != -1;
+    }
+
+    bool isFunctionName(const char *name) override {
+        return sq_isstring(_fs->_name) && strcmp(_stringval(_fs->_name), name) == 0;
+    }
+
+    void resultAppend(CallExpr *call) override {
+        _cg->_fused_appends.push_back(call);
+    }
+};
+
+bool CodeGenVisitor::visitFusedChain(CallExpr *call) {
+    CodeGenFusionScope scope(this);
+    ChainFusionOpt opt(_arena, scope, _fused_chains);
+    CodeBlockExpr *fused = opt.fuse(call);
+    if (!fused)
+        return false;
+    _fused_chains++;
+    visitCodeBlockExpr(fused);
+    return true;
+}
+
+// The array is a fresh literal nobody else can reach, so it can't be frozen
+// and appending doesn't need the type method call.
+bool CodeGenVisitor::visitFusedAppend(CallExpr *call) {
+    for (CallExpr *append : _fused_appends) {
+        if (append != call)
+            continue;
+        maybeAddInExprLine(call);
+        visitForValue(call->callee()->asGetField()->receiver());
+        visitForValue(call->arguments()[0]);
+        SQInteger val = _fs->PopTarget();
+        _fs->AddInstruction(_OP_APPENDARRAY, _fs->TopTarget(), val, AAT_STACK);
+        return true;
+    }
+    return false;
+}
+
 void CodeGenVisitor::visitCallExpr(CallExpr *call) {
+    if (_fs->_sharedstate->checkCompilationOption(CompilationOptions::CO_CHAIN_FUSION_OPT)
+        && (visitFusedAppend(call) || visitFusedChain(call)))
+        return;
+
+    if (GLOBAL_OPTIMIZATION_SWITCH && !(_fs->lang_features & LF_DISABLE_OPTIMIZER)
+        && (emitStringTemplate(call) || emitLiteralMerge(call)))
+        return;
+
     maybeAddInExprLine(call);
 
     Expr *callee = deparen(call->callee());
@@ -1975,6 +2066,195 @@ void CodeGenVisitor::emitShortCircuitLogicalOp(SQOpcode op, Expr *lhs, Expr *rhs
     _fs->SetInstructionParam(jpos, 1, (_fs->GetCurrentPos() - jpos));
 }
 
+// Longer chains take several _OP_CONCATN, each one folds its operands into the first of them
+#define CONCATN_MAX_OPERANDS 32
+
+void CodeGenVisitor::emitConcat(ArenaVector<ConcatOperand> &operands) {
+    SQInteger first = -1, count = 0;
+    for (ConcatOperand &operand : operands) {
+        if (count == CONCATN_MAX_OPERANDS) {
+            for (SQInteger i = 0; i < count; ++i)
+                _fs->PopTarget();
+            _fs->AddInstruction(_OP_CONCATN, _fs->PushTarget(), first, count);
+            count = 1;
+        }
+        if (operand.expr) {
+            visitForValueMaybeStaticMemo(operand.expr);
+            MoveIfCurrentTargetIsLocal();
+        }
+        else {
+            _fs->AddInstruction(_OP_LOAD, _fs->PushTarget(), _fs->GetConstant(_fs->CreateString(operand.str, operand.len)));
+        }
+        if (count++ == 0)
+            first = _fs->TopTarget();
+    }
+    for (SQInteger i = 0; i < count; ++i)
+        _fs->PopTarget();
+    _fs->AddInstruction(_OP_CONCATN, _fs->PushTarget(), first, count);
+}
+
+// a + b + c + ... with a string operand: from the first '+' that has one on every '+' is a
+// string concatenation, so that part of the chain is built at once instead of allocating and
+// interning a string per '+'. The operands before the string one are added up as usual.
+bool CodeGenVisitor::emitConcatChain(BinExpr *expr) {
+    ArenaVector<Expr *> chain(_arena);
+    Expr *e = expr;
+    while (e->op() == TO_ADD && !isConstEvaluable(e)) {
+        chain.push_back(e->asBinExpr()->rhs());
+        e = deparen(e->asBinExpr()->lhs());
+    }
+    chain.push_back(e);
+
+    // chain is in reverse order, find the leftmost '+' with a string operand
+    SQInteger start = -1;
+    for (SQInteger i = SQInteger(chain.size()) - 1; i >= 0; --i) {
+        if (inferExprTypeMask(chain[i]) == _RT_STRING) {
+            start = i;
+            break;
+        }
+    }
+    if (start < 0)
+        return false;
+    if (start == SQInteger(chain.size()) - 1)
+        start--; // the first operand, concatenated with the second one
+
+    if (start < 1) // less than 3 operands, _OP_ADD does the same
+        return false;
+
+    ArenaVector<ConcatOperand> operands(_arena);
+    // the sum of the operands before the string one
+    Expr *head = expr;
+    for (SQInteger i = 0; i <= start; ++i)
+        head = deparen(head->asBinExpr()->lhs());
+    operands.push_back({ head, nullptr, 0 });
+    for (SQInteger i = start; i >= 0; --i)
+        operands.push_back({ chain[i], nullptr, 0 });
+
+    emitConcat(operands);
+    return true;
+}
+
+// $"..." is parsed into "{0}...{1}".subst(arg0, arg1), concatenate the pieces of the format
+// and the arguments directly. Only done when all braces in the format are the placeholders
+// the parser made, in order, so subst() would do exactly the same.
+bool CodeGenVisitor::emitStringTemplate(CallExpr *call) {
+    Expr *callee = call->callee();
+    if (call->isNullable() || callee->op() != TO_GETFIELD)
+        return false;
+    GetFieldExpr *getField = callee->asGetField();
+    if (!getField->isTypeMethod() || strcmp(getField->fieldName(), "subst") != 0)
+        return false;
+    Expr *receiver = getField->receiver();
+    if (receiver->op() != TO_LITERAL || receiver->asLiteral()->kind() != LK_STRING)
+        return false;
+
+    const ArenaVector<Expr *> &args = call->arguments();
+    ArenaVector<ConcatOperand> operands(_arena);
+    const char *fmt = receiver->asLiteral()->s();
+    const char *piece = fmt;
+    SQUnsignedInteger argIdx = 0;
+    for (const char *p = fmt; *p; ++p) {
+        if (*p == '}')
+            return false;
+        if (*p != '{')
+            continue;
+        SQUnsignedInteger index = 0;
+        const char *q = p + 1;
+        for (; *q >= '0' && *q <= '9'; ++q)
+            index = index * 10 + (*q - '0');
+        if (q == p + 1 || *q != '}' || index != argIdx || argIdx >= args.size())
+            return false;
+        if (p > piece)
+            operands.push_back({ nullptr, piece, SQInteger(p - piece) });
+        operands.push_back({ args[argIdx++], nullptr, 0 });
+        p = q;
+        piece = q + 1;
+    }
+    if (argIdx != args.size() || argIdx == 0)
+        return false;
+    if (*piece)
+        operands.push_back({ nullptr, piece, SQInteger(strlen(piece)) });
+
+    maybeAddInExprLine(call);
+    emitConcat(operands);
+    return true;
+}
+
+// t.__merge({a = x, b = y}) with t known to be a table: instead of building the literal just to
+// copy it, clone t and put the slots right into the clone. _OP_MERGE checks at runtime that t
+// is a plain table whose __merge() is the type method, otherwise the slots go into a table
+// that is passed to the real call. The values are evaluated before anything is copied, as
+// they would be for the call.
+bool CodeGenVisitor::emitLiteralMerge(CallExpr *call) {
+    Expr *callee = deparen(call->callee());
+    if (call->isNullable() || callee->op() != TO_GETFIELD)
+        return false;
+    GetFieldExpr *getField = callee->asGetField();
+    bool isTypeMethod = getField->isTypeMethod();
+    if (getField->isNullable() || strcmp(getField->fieldName(), "__merge") != 0)
+        return false;
+    if (!isTypeMethod && (_fs->lang_features & LF_FORBID_IMPLICIT_TYPE_METHODS))
+        return false;
+    Expr *receiver = getField->receiver();
+    if (receiver->op() == TO_BASE || inferExprTypeMask(receiver) != _RT_TABLE)
+        return false;
+
+    const ArenaVector<Expr *> &args = call->arguments();
+    if (args.size() != 1 || args[0]->op() != TO_TABLE)
+        return false;
+    TableExpr *literal = static_cast<TableExpr *>(args[0]);
+    if (!literal->docObject.isEmpty())
+        return false;
+    const auto &members = literal->members();
+    for (const TableMember &m : members) {
+        if (m.isStatic() || m.isDynamicKey() || m.key->op() != TO_LITERAL)
+            return false;
+    }
+
+    maybeAddInExprLine(call);
+
+    visitForValue(receiver);
+    SQInteger self = _fs->TopTarget();
+
+    ArenaVector<Expr *> memberConstantKeys(_arena);
+    ArenaVector<SQInteger> values(_arena);
+    for (const TableMember &m : members) {
+        CheckMemberUniqueness(memberConstantKeys, m.key);
+        visitForValueMaybeStaticMemo(m.value);
+        values.push_back(_fs->TopTarget());
+    }
+
+    SQInteger mergeKey = _fs->GetConstant(_fs->CreateString("__merge"));
+    SQInteger flags = isTypeMethod ? MERGE_FLAG_TYPE_METHOD : 0;
+    if (_fs->lang_features & LF_ALLOW_AUTO_FREEZE)
+        flags |= MERGE_FLAG_FREEZE_LITERAL;
+
+    SQInteger result = _fs->PushTarget();
+    _fs->AddInstruction(_OP_MERGE, result, mergeKey, self, MERGE_BEGIN | flags);
+    for (SQUnsignedInteger i = 0; i < members.size(); ++i) {
+        LiteralExpr *key = members[i].key->asLiteral();
+        SQInteger constantI;
+        switch (key->kind()) {
+        case LK_STRING: constantI = _fs->GetConstant(_fs->CreateString(key->s())); break;
+        case LK_INT: constantI = _fs->GetNumericConstant(key->i()); break;
+        case LK_FLOAT: constantI = _fs->GetNumericConstant(key->f()); break;
+        case LK_BOOL: constantI = _fs->GetConstant(SQObjectPtr(key->b())); break;
+        default: constantI = _fs->GetConstant(SQObjectPtr()); break;
+        }
+        _fs->AddInstruction(_OP_NEWSLOTK, 0xFF, constantI, result, values[i]);
+    }
+    _fs->AddInstruction(_OP_MERGE, result, mergeKey, self, MERGE_END | flags);
+
+    _fs->PopTarget();
+    for (SQUnsignedInteger i = 0; i < members.size(); ++i)
+        _fs->PopTarget();
+    _fs->PopTarget();
+    SQInteger target = _fs->PushTarget();
+    if (target != result)
+        _fs->AddInstruction(_OP_MOVE, target, result);
+    return true;
+}
+
 void CodeGenVisitor::emitCompoundArith(SQOpcode op, SQInteger opcode, Expr *lvalue, Expr *rvalue) {
 
     if (lvalue->isAccessExpr() && lvalue->asAccessExpr()->isFieldAccessExpr()) {
@@ -2365,6 +2645,8 @@ void CodeGenVisitor::visitBinExpr(BinExpr *expr) {
     case TO_DIVEQ:   emitCompoundArith(_OP_DIV, '/', expr->lhs(), expr->rhs()); break;
     case TO_MODEQ:   emitCompoundArith(_OP_MOD, '%', expr->lhs(), expr->rhs()); break;
     case TO_ADD:
+      if (GLOBAL_OPTIMIZATION_SWITCH && !(_fs->lang_features & LF_DISABLE_OPTIMIZER) && emitConcatChain(expr))
+          break;
       if ( is_literal_in_int_range(expr->lhs()) )
       {
           visitForValue(expr->rhs());
@@ -31,11 +31,15 @@ class CodeGenVisitor : public Visitor {
 
     bool _inside_static_memo;
     int _complexity_level;
+    int _fused_chains;
 
     const char *_sourceName;
 
     Arena *_arena;
 
+    // appends to the result arrays of fused chains, see visitFusedChain()
+    ArenaVector<CallExpr *> _fused_appends;
+
     // This is used to pass variable stack positions from visitVarDecl() to visitDestructuringDecl()
     // This is somewhat implicit and should be redone.
     SQInteger _last_declared_var_pos = -1;
@@ -79,6 +83,17 @@ private:
     void emitDelete(UnExpr *argument);
     void emitSimpleBinaryOp(SQOpcode op, Expr *lhs, Expr *rhs, SQInteger op3 = 0);
     void emitShortCircuitLogicalOp(SQOpcode op, Expr *lhs, Expr *rhs);
+
+    // an operand of _OP_CONCATN, either an expression or a piece of a string literal
+    struct ConcatOperand {
+        Expr *expr;
+        const char *str;
+        SQInteger len;
+    };
+    bool emitConcatChain(BinExpr *expr);
+    bool emitStringTemplate(CallExpr *call);
+    void emitConcat(ArenaVector<ConcatOperand> &operands);
+    bool emitLiteralMerge(CallExpr *call);
     void emitCompoundArith(SQOpcode op, SQInteger opcode, Expr *lvalue, Expr *rvalue);
     void emitStaticMemo(Expr *static_memo_arg, bool is_auto_memo = false);
     void emitInlineConst(Expr *const_initializer);
@@ -127,6 +142,10 @@ private:
     unsigned inferExprTypeMaskImpl(Expr *expr);
     bool checkInferredType(Node *reportNode, Expr *expr, unsigned declaredMask);
 
+    friend class CodeGenFusionScope;
+    bool visitFusedChain(CallExpr *call);
+    bool visitFusedAppend(CallExpr *call);
+
     Expr *deparen(Expr *e) const;
     bool isFreezeCall(Expr *node);
     Expr *skipConstFreezePure(Expr *expr);
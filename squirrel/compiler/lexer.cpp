@@ -9,6 +9,7 @@
 #include "lexer.h"
 #include "lex_tokens.h"
 #include <sq_char_class.h>
+#include <sqnumconv.h>
 
 #define CUR_CHAR (_currdata)
 #define RETURN_TOKEN(t) { _prevtoken = _curtoken; _prevflags = _flags; _flags = 0; _curtoken = t; return t;}
@@ -676,9 +677,10 @@ SQInteger SQLexer::ReadNumber()
         }
 #else
         {
-            char *sTemp;
-            volatile SQFloat value;
-            value = (SQFloat)strtod(&_longstr[0], &sTemp);
+            volatile SQFloat value = 0;
+            SQFloat parsed = 0;
+            sqnum_parse_float(&_longstr[0], &_longstr[0] + _longstr.size() - 1, parsed);
+            value = parsed;
             _fvalue = value;
             if(value == 0)
             {
@@ -0,0 +1,432 @@
+/*****
+
+Fusion of array type method chains.
+
+A chain of map()/filter() calls optionally ended with each() or reduce(), e.g.
+
+  src.filter(@(v) v > 0).map(@(x, i) x * i).reduce(@(acc, y) acc + y, 0)
+
+where src is known to be an array and every callback is a closure literal
+(or a closure hoisted into a '$chN' binding) whose body is a single returned
+expression, is compiled as
+
+  $${
+    let $src = src
+    local acc = 0
+    local $i1 = 0
+    foreach (v in $src) {
+      if (v > 0) {
+        let x = v
+        let i = $i1++
+        let y = x * i
+        acc = acc + y
+      }
+    }
+    return acc
+  }
+
+Closure parameters become loop locals, so no intermediate arrays are built
+and no closures are called. Index parameters of later stages count the
+elements that reached that stage, like the index the original call would see
+in its (intermediate) source array.
+
+The fused loop differs from the original calls in what can be observed:
+  * callbacks of different stages interleave per element instead of running
+    stage after stage,
+  * the source array is iterated in place, callbacks must not resize it,
+  * 'throw null' from inside a map() callback does not skip the element,
+  * errors are reported from the calling function, not from the callback.
+That's why it's only done when CO_CHAIN_FUSION_OPT is enabled.
+
+A chain is left alone when the names of callback parameters conflict with
+each other, with names visible at the call site or with names other
+callbacks refer to.
+
+*****/
+
+#include "chainFusion.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace SQCompilation {
+
+namespace {
+
+Expr *deparen(Expr *e) {
+  while (e->op() == TO_PAREN)
+    e = static_cast<UnExpr *>(e)->argument();
+  return e;
+}
+
+// Collects the names a callback body refers to and checks that it can be
+// inlined: no nested functions and classes, no 'this', 'base' or 'vargv'
+// and no assignments to the callback's own parameters.
+class BodyScanner : public Visitor {
+  ArenaVector<const char *> &names;
+  FunctionExpr *func;
+
+  bool isParam(Expr *e) const {
+    e = deparen(e);
+    if (e->op() != TO_ID)
+      return false;
+    for (ParamDecl *p : func->parameters())
+      if (strcmp(p->name(), e->asId()->name()) == 0)
+        return true;
+    return false;
+  }
+
+public:
+  bool ok;
+
+  BodyScanner(ArenaVector<const char *> &n, FunctionExpr *f) : names(n), func(f), ok(true) {}
+
+  void visitId(Id *id) override {
+    if (strcmp(id->name(), "this") == 0 || strcmp(id->name(), "vargv") == 0)
+      ok = false;
+    names.push_back(id->name());
+  }
+
+  void visitUnExpr(UnExpr *expr) override {
+    if (expr->op() == TO_STATIC_MEMO || expr->op() == TO_INLINE_CONST)
+      ok = false;
+    else
+      Visitor::visitUnExpr(expr);
+  }
+
+  void visitBinExpr(BinExpr *expr) override {
+    if (expr->op() >= TO_NEWSLOT && expr->op() <= TO_MODEQ && isParam(expr->lhs()))
+      ok = false;
+    else if (expr->op() == TO_ASSIGN && isParam(expr->lhs()))
+      ok = false;
+    Visitor::visitBinExpr(expr);
+  }
+
+  void visitIncExpr(IncExpr *expr) override {
+    if (isParam(expr->argument()))
+      ok = false;
+    Visitor::visitIncExpr(expr);
+  }
+
+  void visitBaseExpr(BaseExpr *) override { ok = false; }
+  void visitFunctionExpr(FunctionExpr *) override { ok = false; }
+  void visitClassExpr(ClassExpr *) override { ok = false; }
+  void visitCodeBlockExpr(CodeBlockExpr *) override { ok = false; }
+};
+
+bool containsName(const ArenaVector<const char *> &names, const char *name) {
+  for (const char *n : names)
+    if (strcmp(n, name) == 0)
+      return true;
+  return false;
+}
+
+} // namespace
+
+
+ChainFusionOpt::ChainFusionOpt(Arena *arena, FusionScope &scope, int index)
+  : _arena(arena)
+  , _scope(scope)
+  , _index(index)
+  , _span(SourceSpan::invalid())
+{}
+
+
+CodeBlockExpr *ChainFusionOpt::fuse(CallExpr *call) {
+  ArenaVector<Stage> stages(_arena);
+  Expr *source = nullptr;
+
+  if (!collectStages(call, stages, source))
+    return nullptr;
+  if (!bindNames(stages))
+    return nullptr;
+  if (!_scope.isArray(source))
+    return nullptr;
+
+  _span = call->sourceSpan();
+  return generate(stages, source);
+}
+
+
+bool ChainFusionOpt::collectStages(CallExpr *call, ArenaVector<Stage> &stages, Expr *&source) {
+  Expr *expr = call;
+  while (expr->op() == TO_CALL) {
+    Stage stage;
+    if (!initStage(expr->asCallExpr(), stages.empty(), stage))
+      break;
+    stages.push_back(stage);
+    expr = deparen(deparen(expr->asCallExpr()->callee())->asGetField()->receiver());
+  }
+
+  if (stages.empty())
+    return false;
+
+  // collected from the last call, the loop runs them from the first one
+  for (unsigned i = 0, j = stages.size() - 1; i < j; i++, j--) {
+    Stage t = stages[i];
+    stages[i] = stages[j];
+    stages[j] = t;
+  }
+
+  source = expr;
+  return true;
+}
+
+
+bool ChainFusionOpt::initStage(CallExpr *call, bool terminal, Stage &stage) {
+  if (call->isNullable())
+    return false;
+
+  Expr *callee = deparen(call->callee());
+  if (callee->op() != TO_GETFIELD)
+    return false;
+
+  GetFieldExpr *field = callee->asGetField();
+  if (field->isNullable() || (!field->isTypeMethod() && !_scope.allowsImplicitTypeMethods()))
+    return false;
+
+  const char *method = field->fieldName();
+  const ArenaVector<Expr *> &args = call->arguments();
+  unsigned maxParams = 2;
+
+  if (strcmp(method, "map") == 0)
+    stage.kind = SK_MAP;
+  else if (strcmp(method, "filter") == 0)
+    stage.kind = SK_FILTER;
+  else if (terminal && strcmp(method, "each") == 0)
+    stage.kind = SK_EACH;
+  else if (terminal && strcmp(method, "reduce") == 0) {
+    stage.kind = SK_REDUCE;
+    maxParams = 3;
+  }
+  else
+    return false;
+
+  if (args.size() != 1 && !(stage.kind == SK_REDUCE && args.size() == 2))
+    return false;
+
+  Expr *arg = deparen(args[0]);
+  if (arg->op() == TO_FUNCTION) {
+    stage.func = arg->asFunctionExpr();
+    stage.hoisted = false;
+  }
+  else if (arg->op() == TO_ID) {
+    stage.func = _scope.hoistedClosure(arg->asId());
+    stage.hoisted = true;
+    if (!stage.func)
+      return false;
+  }
+  else
+    return false;
+
+  FunctionExpr *f = stage.func;
+  if (f->isVararg() || f->getResultTypeMask() != ~0u || f->parameters().size() > maxParams)
+    return false;
+
+  // reduce() always passes the accumulator and the value, a callback taking fewer gets them shifted
+  if (stage.kind == SK_REDUCE && f->parameters().size() < 2)
+    return false;
+
+  for (ParamDecl *p : f->parameters()) {
+    if (p->hasDefaultValue() || p->getDestructuring() || p->isVararg() || p->getTypeMask() != ~0u)
+      return false;
+  }
+
+  Block *body = f->body();
+  if (!body || body->statements().size() != 1 || body->statements()[0]->op() != TO_RETURN)
+    return false;
+
+  stage.body = static_cast<ReturnStatement *>(body->statements()[0])->argument();
+  if (!stage.body)
+    return false;
+
+  const ArenaVector<ParamDecl *> &params = f->parameters();
+  unsigned p = 0;
+  stage.accName = stage.kind == SK_REDUCE ? params[p++]->name() : nullptr;
+  stage.valueName = p < params.size() ? params[p]->name() : nullptr;
+  p++;
+  stage.indexName = p < params.size() ? params[p]->name() : nullptr;
+
+  stage.init = args.size() > 1 ? args[1] : nullptr;
+  stage.inName = nullptr;
+  stage.counterName = nullptr;
+  return true;
+}
+
+
+bool ChainFusionOpt::bindNames(ArenaVector<Stage> &stages) {
+  // parameters of all callbacks end up as locals of the same loop
+  ArenaVector<const char *> declared(_arena);
+  for (unsigned k = 0; k < stages.size(); k++) {
+    Stage &s = stages[k];
+    const char *value = s.valueName;
+
+    // filter passes its value on, the next callback shares its local unless it names the value differently
+    if (k > 0 && stages[k - 1].kind == SK_FILTER && (!value || strcmp(value, stages[k - 1].inName) == 0)) {
+      s.inName = stages[k - 1].inName;
+      value = nullptr;
+    }
+    else
+      s.inName = value ? value : makeName("v", k);
+
+    for (const char *name : { s.accName, value, s.indexName }) {
+      if (!name)
+        continue;
+      if (containsName(declared, name) || _scope.isNameTaken(name))
+        return false;
+      declared.push_back(name);
+    }
+  }
+
+  for (const Stage &s : stages) {
+    ArenaVector<const char *> names(_arena);
+    BodyScanner scanner(names, s.func);
+    s.body->visit(&scanner);
+    if (!scanner.ok)
+      return false;
+
+    for (const char *name : names) {
+      bool own = false;
+      for (ParamDecl *p : s.func->parameters())
+        own = own || strcmp(p->name(), name) == 0;
+      if (own)
+        continue;
+      // would refer to a parameter of another callback
+      if (containsName(declared, name))
+        return false;
+      // a closure referring to itself by name or to the function it's called from
+      if ((s.func->name() && strcmp(s.func->name(), name) == 0) || _scope.isFunctionName(name))
+        return false;
+      // hoisted closures don't capture locals of this function, the same name here is another variable
+      if (s.hoisted && _scope.isLocal(name))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+const char *ChainFusionOpt::makeName(const char *what, int stage) {
+  char buffer[48];
+  int n = stage < 0
+    ? snprintf(buffer, sizeof(buffer), "$cf%d_%s", _index, what)
+    : snprintf(buffer, sizeof(buffer), "$cf%d_%s%d", _index, what, stage);
+  char *result = (char *)_arena->allocate((n + 1) * sizeof(char));
+  strcpy(result, buffer);
+  return result;
+}
+
+Id *ChainFusionOpt::id(const char *name) {
+  return new (_arena) Id(_span, name);
+}
+
+VarDecl *ChainFusionOpt::decl(const char *name, Expr *init, bool assignable) {
+  return new (_arena) VarDecl(_span.start, id(name), init, assignable);
+}
+
+Statement *ChainFusionOpt::assign(const char *name, Expr *value) {
+  return new (_arena) ExprStatement(new (_arena) BinExpr(TO_ASSIGN, id(name), value));
+}
+
+
+CodeBlockExpr *ChainFusionOpt::generate(ArenaVector<Stage> &stages, Expr *source) {
+  Block *block = new (_arena) Block(_arena, _span.start);
+  const char *srcName = makeName("src");
+  const char *resultName = nullptr;
+  const char *hasName = nullptr;
+
+  // evaluated first, before any of the callbacks' names are declared
+  block->addStatement(decl(srcName, source, false));
+
+  Stage &last = stages.back();
+  if (last.kind == SK_REDUCE) {
+    block->addStatement(decl(last.accName, last.init, true));
+    if (!last.init) {
+      // the first element becomes the initial value
+      hasName = makeName("has");
+      block->addStatement(decl(hasName, new (_arena) LiteralExpr(_span, false), true));
+    }
+    resultName = last.accName;
+  }
+  else if (last.kind != SK_EACH) {
+    ArrayExpr *res = new (_arena) ArrayExpr(_arena, _span.start);
+    res->setSpanEnd(_span.end);
+    resultName = makeName("res");
+    block->addStatement(decl(resultName, res, false));
+  }
+
+  for (unsigned k = 1; k < stages.size(); k++) {
+    Stage &s = stages[k];
+    if (s.indexName) {
+      s.counterName = makeName("i", k);
+      block->addStatement(decl(s.counterName, new (_arena) LiteralExpr(_span, (SQInteger)0), true));
+    }
+  }
+
+  Block *loop = new (_arena) Block(_arena, _span.start);
+  loop->setSpanEnd(_span.end);
+  Block *body = loop;
+  for (unsigned k = 0; k < stages.size(); k++) {
+    Stage &s = stages[k];
+    bool isLast = k + 1 == stages.size();
+
+    if (k > 0 && stages[k - 1].kind == SK_FILTER && s.inName != stages[k - 1].inName)
+      body->addStatement(decl(s.inName, id(stages[k - 1].inName), false));
+    if (s.counterName)
+      body->addStatement(decl(s.indexName, new (_arena) IncExpr(id(s.counterName), 1, IF_POSTFIX, _span.end), false));
+
+    Expr *appended = nullptr;
+    switch (s.kind) {
+    case SK_MAP:
+      if (isLast)
+        appended = s.body;
+      else
+        body->addStatement(decl(stages[k + 1].inName, s.body, false));
+      break;
+    case SK_FILTER: {
+      // the rest of the chain runs for the elements that pass
+      Block *passed = new (_arena) Block(_arena, _span.start);
+      passed->setSpanEnd(_span.end);
+      body->addStatement(new (_arena) IfStatement(_span.start, s.body, passed, nullptr));
+      body = passed;
+      if (isLast)
+        appended = id(s.inName);
+      break;
+    }
+    case SK_EACH:
+      body->addStatement(new (_arena) ExprStatement(s.body));
+      break;
+    case SK_REDUCE:
+      if (hasName) {
+        Block *first = new (_arena) Block(_arena, _span.start);
+        first->addStatement(assign(s.accName, id(s.inName)));
+        first->addStatement(assign(hasName, new (_arena) LiteralExpr(_span, true)));
+        first->setSpanEnd(_span.end);
+        body->addStatement(new (_arena) IfStatement(_span.start, id(hasName), assign(s.accName, s.body), first));
+      }
+      else
+        body->addStatement(assign(s.accName, s.body));
+      break;
+    }
+
+    if (appended) {
+      GetFieldExpr *append = new (_arena) GetFieldExpr(id(resultName), "append", false, true, _span.end);
+      CallExpr *call = new (_arena) CallExpr(_arena, append, false, _span.end);
+      call->addArgument(appended);
+      body->addStatement(new (_arena) ExprStatement(call));
+      _scope.resultAppend(call);
+    }
+  }
+
+  Stage &first = stages[0];
+  VarDecl *idxDecl = first.indexName ? decl(first.indexName, nullptr, false) : nullptr;
+  block->addStatement(new (_arena) ForeachStatement(_span.start, idxDecl, decl(first.inName, nullptr, false), id(srcName), loop));
+  block->addStatement(new (_arena) ReturnStatement(_span, resultName ? id(resultName) : nullptr));
+  block->setIsExprBlock();
+  block->setSpanEnd(_span.end);
+
+  return new (_arena) CodeBlockExpr(block);
+}
+
+} // namespace SQCompilation
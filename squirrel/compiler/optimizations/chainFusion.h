@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../ast.h"
+#include "../arena.h"
+
+namespace SQCompilation {
+
+// Rewrites a chain of array type method calls like
+//   arr.filter(@(v) v > 0).map(@(v) v * 2).reduce(@(acc, v) acc + v, 0)
+// into a single loop over the source array, see chainFusion.cpp for details.
+// Runs during code generation since it needs to know the receiver is an array,
+// the code generator answers questions about the call site through FusionScope.
+class ChainFusionOpt {
+public:
+  class FusionScope {
+  public:
+    virtual ~FusionScope() {}
+    // the expression is known to evaluate to an array
+    virtual bool isArray(Expr *expr) = 0;
+    // calls without explicit '$' resolve to type methods
+    virtual bool allowsImplicitTypeMethods() = 0;
+    // the closure a hoisted '$chN' variable was initialized with, if any
+    virtual FunctionExpr *hoistedClosure(Id *id) = 0;
+    // declaring a local with this name would conflict with a visible local, constant or the function name
+    virtual bool isNameTaken(const char *name) = 0;
+    // an Id with this name is a local of the current function
+    virtual bool isLocal(const char *name) = 0;
+    // an Id with this name refers to the function being compiled
+    virtual bool isFunctionName(const char *name) = 0;
+    // the call appends to the array the fused chain builds, nothing else has seen that array yet
+    virtual void resultAppend(CallExpr *call) = 0;
+  };
+
+  ChainFusionOpt(Arena *arena, FusionScope &scope, int index);
+
+  // nullptr if the call doesn't end a chain that can be fused
+  CodeBlockExpr *fuse(CallExpr *call);
+
+private:
+  enum StageKind { SK_MAP, SK_FILTER, SK_EACH, SK_REDUCE };
+
+  struct Stage {
+    StageKind kind;
+    FunctionExpr *func;
+    Expr *body;             // the returned expression
+    bool hoisted;
+    const char *valueName;  // value parameter, nullptr if the closure doesn't take it
+    const char *indexName;  // index parameter
+    const char *accName;    // reduce accumulator parameter
+    Expr *init;             // reduce initial value
+    const char *inName;     // local holding the value this stage gets
+    const char *counterName;
+  };
+
+  Arena *_arena;
+  FusionScope &_scope;
+  int _index;
+  SourceSpan _span;
+
+  bool collectStages(CallExpr *call, ArenaVector<Stage> &stages, Expr *&source);
+  bool initStage(CallExpr *call, bool terminal, Stage &stage);
+  // picks the locals holding each stage's value, false on name conflicts
+  bool bindNames(ArenaVector<Stage> &stages);
+  CodeBlockExpr *generate(ArenaVector<Stage> &stages, Expr *source);
+
+  const char *makeName(const char *what, int stage = -1);
+  Id *id(const char *name);
+  VarDecl *decl(const char *name, Expr *init, bool assignable);
+  Statement *assign(const char *name, Expr *value);
+};
+
+} // namespace SQCompilation
@@ -437,6 +437,10 @@ void DumpInstructions(OutputStream *stream, SQLineInfosHeader *lineinfos, int nl
                 break;
             }
 
+            case _OP_CONCATN:
+                streamprintf(stream, "  // r%d .. r%d -> r%d", int(inst._arg1), int(inst._arg1 + inst._arg2 - 1), int(inst._arg0));
+                break;
+
             case _OP_NEG:
                 streamprintf(stream, "  // -r%d -> r%d", int(inst._arg1), int(inst._arg0));
                 break;
@@ -547,6 +551,13 @@ void DumpInstructions(OutputStream *stream, SQLineInfosHeader *lineinfos, int nl
                 streamprintf(stream, "  // clone r%d -> r%d", int(inst._arg1), int(inst._arg0));
                 break;
 
+            case _OP_MERGE:
+                if ((inst._arg3 & MERGE_STEP_MASK) == MERGE_BEGIN)
+                    streamprintf(stream, "  // clone r%d or new table -> r%d", int(inst._arg2), int(inst._arg0));
+                else
+                    streamprintf(stream, "  // if not cloned r%d.__merge(r%d) -> r%d", int(inst._arg2), int(inst._arg0), int(inst._arg0));
+                break;
+
             case _OP_TYPEOF:
                 streamprintf(stream, "  // typeof r%d -> r%d", int(inst._arg1), int(inst._arg0));
                 break;
@@ -511,6 +511,7 @@ void SQFuncState::AddInstruction(SQInstruction &i)
             switch(pi.op) {
             case _OP_GET: case _OP_GETK:
             case _OP_ADD: case _OP_SUB: case _OP_MUL: case _OP_DIV: case _OP_MOD: case _OP_BITW:
+            case _OP_CONCATN:
             case _OP_LOADINT: case _OP_LOADFLOAT: case _OP_LOADBOOL: case _OP_LOAD:
             case _OP_NEG: case _OP_NOT: case _OP_BWNOT:
             case _OP_ADDI:
@@ -586,7 +587,7 @@ void SQFuncState::AddInstruction(SQInstruction &i)
 
 SQObjectPtr SQFuncState::CreateString(const char *s,SQInteger len)
 {
-    return SQObjectPtr(SQString::Create(_sharedstate,s,len));
+    return SQObjectPtr(SQString::CreateInterned(_sharedstate,s,len));
 }
 
 void SQFuncState::CheckForPurity()
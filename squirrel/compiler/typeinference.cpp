@@ -258,6 +258,13 @@ unsigned CodeGenVisitor::inferExprTypeMaskImpl(Expr *expr) {
         else if (callee->op() == TO_FUNCTION) {
             retMask = callee->asFunctionExpr()->getResultTypeMask();
         }
+        else if (callee->op() == TO_GETFIELD && !callee->asGetField()->isNullable()) {
+            // map() and filter() of an array build a new array
+            GetFieldExpr *field = callee->asGetField();
+            if ((strcmp(field->fieldName(), "map") == 0 || strcmp(field->fieldName(), "filter") == 0)
+                && inferExprTypeMask(field->receiver()) == _RT_ARRAY)
+                retMask = _RT_ARRAY;
+        }
 
         if (call->isNullable() && retMask != ~0u)
             retMask |= _RT_NULL;
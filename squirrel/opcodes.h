@@ -31,6 +31,16 @@ enum NewObjectType {
     NEWOBJ_CLASS = 2
 };
 
+// _OP_MERGE goes around the slots of the literal in t.__merge({...}), a plain table is cloned
+// and gets them directly, anything else gets a fresh table for them and the real call
+enum MergeStep {
+    MERGE_BEGIN = 0,
+    MERGE_END = 1,
+    MERGE_STEP_MASK = 1,
+    MERGE_FLAG_TYPE_METHOD = 2,     // called as t.$__merge(), own slots don't matter
+    MERGE_FLAG_FREEZE_LITERAL = 4   // the literal would have been frozen
+};
+
 enum AppendArrayType {
     AAT_STACK = 0,
     AAT_LITERAL = 1,
@@ -70,6 +80,7 @@ enum AppendArrayType {
     SQ_OPCODE(_OP_DIV) \
     SQ_OPCODE(_OP_MOD) \
     SQ_OPCODE(_OP_BITW) \
+    SQ_OPCODE(_OP_CONCATN) \
     SQ_OPCODE(_OP_RETURN) \
     SQ_OPCODE(_OP_LOADNULLS) \
     SQ_OPCODE(_OP_LOADROOT) \
@@ -106,6 +117,7 @@ enum AppendArrayType {
     SQ_OPCODE(_OP_POSTFOREACH) \
     SQ_OPCODE(_OP_FOREACH) \
     SQ_OPCODE(_OP_CLONE) \
+    SQ_OPCODE(_OP_MERGE) \
     SQ_OPCODE(_OP_TYPEOF) \
     SQ_OPCODE(_OP_PUSHTRAP) \
     SQ_OPCODE(_OP_POPTRAP) \
@@ -201,6 +213,7 @@ inline bool sq_is_pure_op(int op) {
         op != _OP_YIELD &&
         op != _OP_RESUME &&
         op != _OP_CLONE &&
+        op != _OP_MERGE &&
         op != _OP_PUSHTRAP &&
         op != _OP_POPTRAP &&
         op != _OP_THROW &&
@@ -10,6 +10,7 @@
 #include "sqclosure.h"
 #include "squserdata.h"
 #include "sqclass.h"
+#include "sqmemprofiler.h"
 #include "compiler/sqtypeparser.h"
 #include "compiler/compiler.h"
 #include "compiler/sqfuncstate.h"
@@ -493,6 +494,9 @@ static bool fastEqualByValue(const SQObjectPtr &a, const SQObjectPtr &b, int dep
     if (_rawval(a) == _rawval(b))
         return true;
 
+    if (sq_isstring(a))
+        return _string(a)->Equals(_string(b));
+
     if (depth <= 0)
         return false;
 
@@ -506,9 +510,13 @@ static bool fastEqualByValue(const SQObjectPtr &a, const SQObjectPtr &b, int dep
         if (aa->Size() > MAX_FAST_COMPARE_SIZE)
             return false;
 
-        for (SQInteger i = 0; i < aa->Size(); i++)
-            if (!fastEqualByValue(aa->_values[i], ab->_values[i], depth - 1))
+        SQObjectPtr va, vb;
+        for (SQInteger i = 0; i < aa->Size(); i++) {
+            if (aa->IsPacked()) aa->Get(i, va);
+            if (ab->IsPacked()) ab->Get(i, vb);
+            if (!fastEqualByValue(aa->IsPacked() ? va : aa->_values[i], ab->IsPacked() ? vb : ab->_values[i], depth - 1))
                 return false;
+        }
 
         return true;
     }
@@ -707,18 +715,7 @@ SQRESULT sq_arrayreverse(HSQUIRRELVM v,SQInteger idx)
     sq_aux_paramscheck(v, 1);
     SQObjectPtr *o;
     _GETSAFE_OBJ(v, idx, OT_ARRAY,o);
-    SQArray *arr = _array(*o);
-    if(arr->Size() > 0) {
-        SQObjectPtr t;
-        SQInteger size = arr->Size();
-        SQInteger n = size >> 1; size -= 1;
-        for(SQInteger i = 0; i < n; i++) {
-            t = arr->_values[i];
-            arr->_values[i] = arr->_values[size-i];
-            arr->_values[size-i] = t;
-        }
-        return SQ_OK;
-    }
+    _array(*o)->Reverse();
     return SQ_OK;
 }
 
@@ -986,6 +983,81 @@ SQRESULT sq_clear(HSQUIRRELVM v,SQInteger idx, SQBool freemem)
     return SQ_OK;
 }
 
+static void compact_push(SQTable *visited, SQObjectPtrVec &pending, const SQObjectPtr &o)
+{
+    switch(sq_type(o)) {
+        case OT_TABLE: case OT_ARRAY: case OT_CLASS: case OT_INSTANCE:
+            if (visited->NewSlot(o, SQObjectPtr(true)))
+                pending.push_back(o);
+            break;
+        default:
+            break;
+    }
+}
+
+SQRESULT sq_compact(HSQUIRRELVM v,SQInteger idx,SQBool recursive)
+{
+    SQObjectPtr &o=stack_get(v,idx);
+    if (sq_type(o) != OT_TABLE && sq_type(o) != OT_ARRAY)
+        return sq_throwerror(v, "compact only works on table and array");
+    if (!recursive) {
+        if (sq_type(o) == OT_TABLE)
+            _table(o)->Compact();
+        else
+            _array(o)->Compact();
+        return SQ_OK;
+    }
+
+    // walks tables, arrays, classes and instances reachable from the object, each one once
+    SQObjectPtr visited(SQTable::Create(_ss(v), 0));
+    SQObjectPtrVec pending(_ss(v)->_alloc_ctx);
+    compact_push(_table(visited), pending, o);
+    while (!pending.empty()) {
+        SQObjectPtr cur = pending.back();
+        pending.pop_back();
+        switch(sq_type(cur)) {
+            case OT_TABLE: {
+                SQTable *t = _table(cur);
+                t->Compact();
+                if (t->_delegate)
+                    compact_push(_table(visited), pending, SQObjectPtr(t->_delegate));
+                SQObjectPtr pos((SQInteger)0), key, val;
+                for (SQInteger ridx; (ridx = t->Next(true, pos, key, val)) != -1; pos = ridx) {
+                    compact_push(_table(visited), pending, key);
+                    compact_push(_table(visited), pending, val);
+                }
+                break;
+            }
+            case OT_ARRAY: {
+                SQArray *a = _array(cur);
+                a->Compact();
+                for (SQUnsignedInteger i = 0; i < a->_values.size(); i++) // packed arrays only hold numbers
+                    compact_push(_table(visited), pending, a->_values[i]);
+                break;
+            }
+            case OT_CLASS: {
+                SQClass *c = _class(cur);
+                c->_members->Compact();
+                if (c->_base)
+                    compact_push(_table(visited), pending, SQObjectPtr(c->_base));
+                for (SQUnsignedInteger i = 0; i < c->_defaultvalues.size(); i++)
+                    compact_push(_table(visited), pending, c->_defaultvalues[i].val);
+                break;
+            }
+            case OT_INSTANCE: {
+                SQInstance *inst = _instance(cur);
+                compact_push(_table(visited), pending, SQObjectPtr(inst->_class));
+                for (SQUnsignedInteger i = 0; i < inst->_class->_defaultvalues.size(); i++)
+                    compact_push(_table(visited), pending, inst->_values[i]);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return SQ_OK;
+}
+
 void sq_pushroottable(HSQUIRRELVM v)
 {
     v->Push(v->_roottable);
@@ -2207,6 +2279,38 @@ SQAllocContext sq_getallocctx(HSQUIRRELVM v)
     return _ss(v)->_alloc_ctx;
 }
 
+void sq_setmemorylimit(HSQUIRRELVM v, SQUnsignedInteger limit)
+{
+    _ss(v)->_memlimitenabled = limit != 0;
+    sq_vm_set_alloc_limit(_ss(v)->_alloc_ctx, limit);
+}
+
+void sq_getmemorystats(HSQUIRRELVM v, SQMemoryStats *stats)
+{
+    sq_vm_get_alloc_stats(_ss(v)->_alloc_ctx, stats);
+}
+
+void sq_enablememprofiler(HSQUIRRELVM v, SQBool enable, SQUnsignedInteger sample_bytes)
+{
+    SQSharedState *ss = _ss(v);
+    if (ss->_memprofiler) {
+        SQMemProfiler *prof = ss->_memprofiler;
+        // strings referenced by the profiler are released with it, don't track that
+        ss->_memprofiler = NULL;
+        sq_delete(ss->_alloc_ctx, prof, SQMemProfiler);
+    }
+    if (enable)
+        sq_new(ss->_alloc_ctx, ss->_memprofiler, SQMemProfiler, ss, sample_bytes);
+}
+
+SQInteger sq_getmemprofile(HSQUIRRELVM v, SQMemProfileSite *sites, SQInteger maxsites)
+{
+    SQMemProfiler *prof = _ss(v)->_memprofiler;
+    if (!prof)
+        return sq_throwerror(v, "memory profiler is not enabled");
+    return prof->GetReport(sites, maxsites);
+}
+
 void *sq_malloc(SQAllocContext ctx, SQUnsignedInteger size)
 {
     return SQ_MALLOC(ctx, size);
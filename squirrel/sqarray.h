@@ -4,23 +4,45 @@
 
 #include "vartrace.h"
 
+/*
+* Packed arrays: while all elements are integers or all are floats, only their raw values are kept
+* in _packed (8 bytes each instead of a 16 byte SQObjectPtr) and _packedtype tells their type, _values
+* is empty then. An array starts packed when an empty one gets a number, the first write of any other
+* value moves the elements to _values for good. Code touching _values directly has to handle both.
+* Disabled with variable tracing, varTrace follows _values.
+*/
+#ifndef SQ_PACKED_ARRAYS
+#if SQ_VAR_TRACE_ENABLED == 1
+#define SQ_PACKED_ARRAYS 0
+#else
+#define SQ_PACKED_ARRAYS 1
+#endif
+#endif
+
 struct SQArray : public CHAINABLE_OBJ
 {
 private:
     SQArray(SQSharedState *ss,SQInteger nsize) :
       _values(ss->_alloc_ctx)
+#if SQ_PACKED_ARRAYS
+      , _packed(ss->_alloc_ctx)
+      , _packedtype(OT_NULL)
+      , _nopack(false)
+#endif
       VT_DECL_CTR(ss->_alloc_ctx)
     {
         _values.resize(nsize); VT_RESIZE(nsize); INIT_CHAIN();ADD_TO_CHAIN(&_ss(this)->_gc_chain,this);
     }
     ~SQArray()
     {
+        SQ_MEMPROF_FREE(_ss(this), this);
         REMOVE_FROM_CHAIN(&_ss(this)->_gc_chain,this);
     }
 public:
     static SQArray* Create(SQSharedState *ss,SQInteger nInitialSize){
         SQArray *newarray=(SQArray*)SQ_MALLOC(ss->_alloc_ctx, sizeof(SQArray));
         new (newarray) SQArray(ss,nInitialSize);
+        SQ_MEMPROF_ALLOC(ss, newarray, OT_ARRAY, sizeof(SQArray) + nInitialSize * sizeof(SQObjectPtr));
         return newarray;
     }
 #ifndef NO_GARBAGE_COLLECTOR
@@ -34,9 +56,43 @@ public:
 
     VT_CODE(VarTrace * GetVarTracePtr(const SQInteger nidx) { return &varTrace[nidx]; })
 
+#if SQ_PACKED_ARRAYS
+    bool IsPacked() const { return _packedtype != OT_NULL; }
+    static bool IsPackable(const SQObject &o) { return (sq_type(o) == OT_INTEGER || sq_type(o) == OT_FLOAT) && !o._flags; }
+    bool FitsPacked(const SQObject &o) const { return sq_type(o) == _packedtype && !o._flags; }
+    void GetPacked(SQUnsignedInteger idx, SQObjectPtr &val) const
+    {
+        if (_packedtype == OT_INTEGER)
+            val = _packed[idx].nInteger;
+        else
+            val = _packed[idx].fFloat;
+    }
+    // an empty array picks its storage for the first value it gets
+    bool StartPacked(const SQObject &o)
+    {
+        if (_nopack || !IsPackable(o))
+            return false;
+        if (!IsPacked() && _values.capacity()) {
+            _packed.reserve(_values.capacity());
+            _values.reset();
+        }
+        _packedtype = sq_type(o);
+        return true;
+    }
+    void Unpack();
+#else
+    bool IsPacked() const { return false; }
+#endif
+
     bool Get(const SQInteger nidx,SQObjectPtr &val)
     {
-        if((SQUnsignedInteger)nidx<(SQUnsignedInteger)_values.size()){
+        if((SQUnsignedInteger)nidx<(SQUnsignedInteger)Size()){
+#if SQ_PACKED_ARRAYS
+            if (IsPacked()) {
+                GetPacked(nidx, val);
+                return true;
+            }
+#endif
             SQObjectPtr &o = _values[nidx];
             val = _realval(o);
             return true;
@@ -45,7 +101,16 @@ public:
     }
     bool Set(const SQInteger nidx,const SQObjectPtr &val)
     {
-        if((SQUnsignedInteger)nidx<(SQUnsignedInteger)_values.size()){
+        if((SQUnsignedInteger)nidx<(SQUnsignedInteger)Size()){
+#if SQ_PACKED_ARRAYS
+            if (IsPacked()) {
+                if (FitsPacked(val)) {
+                    _packed[nidx] = val._unVal;
+                    return true;
+                }
+                Unpack();
+            }
+#endif
             _values[nidx]=val;
             VT_TRACE(nidx, val, _ss(this)->_root_vm);
             return true;
@@ -55,19 +120,31 @@ public:
     SQInteger Next(const SQObjectPtr &refpos,SQObjectPtr &outkey,SQObjectPtr &outval)
     {
         SQUnsignedInteger idx=TranslateIndex(refpos);
-        if (idx<_values.size()) {
+        if (idx<(SQUnsignedInteger)Size()) {
             //first found
             outkey=(SQInteger)idx;
-            SQObjectPtr &o = _values[idx];
-            outval = _realval(o);
+#if SQ_PACKED_ARRAYS
+            if (IsPacked())
+                GetPacked(idx, outval);
+            else
+#endif
+            {
+                SQObjectPtr &o = _values[idx];
+                outval = _realval(o);
+            }
             //return idx for the next iteration
             return ++idx;
         }
         //nothing to iterate anymore
         return -1;
     }
-    SQArray *Clone(){SQArray *anew=Create(_opt_ss(this),0); anew->_values.copy(_values); VT_CLONE_FROM_TO(this, anew); return anew; }
+    SQArray *Clone(){SQArray *anew=Create(_opt_ss(this),0); anew->CopyFrom(this); return anew; }
+    void CopyFrom(const SQArray *src);
+#if SQ_PACKED_ARRAYS
+    SQInteger Size() const {return _values.size() + _packed.size();} // one of them is empty
+#else
     SQInteger Size() const {return _values.size();}
+#endif
     void Resize(SQInteger size, SQBool shrink = SQTrue)
     {
         SQObjectPtr _null;
@@ -75,32 +152,139 @@ public:
     }
     void Resize(SQInteger size,SQObjectPtr &fill, SQBool shrink = SQTrue)
     {
+#if SQ_PACKED_ARRAYS
+        if (Size() == 0 && size > 0)
+            StartPacked(fill);
+        if (IsPacked()) {
+            if (size <= Size() || FitsPacked(fill)) {
+                _packed.resize(size, fill._unVal);
+                if (shrink)
+                    ShrinkIfNeeded();
+                return;
+            }
+            Unpack();
+        }
+#endif
       _values.resize(size,fill);
       VT_RESIZE(size);
       if (shrink)
         ShrinkIfNeeded();
     }
-    void Reserve(SQInteger size) { _values.reserve(size); VT_RESERVE(size); }
-    void Append(const SQObject &o){_values.push_back(SQObjectPtr(o)); VT_PUSHBACK(o, _ss(this)->_root_vm); }
+    void Reserve(SQInteger size)
+    {
+#if SQ_PACKED_ARRAYS
+        if (IsPacked()) {
+            _packed.reserve(size);
+            return;
+        }
+#endif
+        _values.reserve(size); VT_RESERVE(size);
+    }
+    void Append(const SQObject &o)
+    {
+#if SQ_PACKED_ARRAYS
+        if ((IsPacked() && FitsPacked(o)) || (Size() == 0 && StartPacked(o))) {
+            _packed.push_back(o._unVal);
+            return;
+        }
+        if (IsPacked())
+            Unpack();
+#endif
+        _values.push_back(SQObjectPtr(o)); VT_PUSHBACK(o, _ss(this)->_root_vm);
+    }
     void Extend(const SQArray *a);
-    SQObjectPtr &Top(){return _values.top();}
-    void Pop(){_values.pop_back(); VT_POPBACK(); ShrinkIfNeeded(); }
+    SQObjectPtr Top()
+    {
+#if SQ_PACKED_ARRAYS
+        if (IsPacked()) {
+            SQObjectPtr val;
+            GetPacked(_packed.size() - 1, val);
+            return val;
+        }
+#endif
+        return _values.top();
+    }
+    void Pop()
+    {
+#if SQ_PACKED_ARRAYS
+        if (IsPacked()) {
+            _packed.pop_back();
+            ShrinkIfNeeded();
+            return;
+        }
+#endif
+        _values.pop_back(); VT_POPBACK(); ShrinkIfNeeded();
+    }
     bool Insert(SQInteger idx,const SQObject &val){
-        if(idx < 0 || idx > (SQInteger)_values.size())
+        if(idx < 0 || idx > Size())
             return false;
+#if SQ_PACKED_ARRAYS
+        if ((IsPacked() && FitsPacked(val)) || (Size() == 0 && StartPacked(val))) {
+            _packed.insert(idx, val._unVal);
+            return true;
+        }
+        if (IsPacked())
+            Unpack();
+#endif
         _values.insert(idx,SQObjectPtr(val));
         VT_INSERT(idx, val, _ss(this)->_root_vm);
         return true;
     }
+    void Swap(SQInteger i, SQInteger j)
+    {
+#if SQ_PACKED_ARRAYS
+        if (IsPacked()) {
+            SQObjectValue t = _packed[i];
+            _packed[i] = _packed[j];
+            _packed[j] = t;
+            return;
+        }
+#endif
+        _Swap(_values[i], _values[j]);
+    }
+    void Reverse()
+    {
+        for (SQInteger i = 0, j = Size() - 1; i < j; i++, j--)
+            Swap(i, j);
+    }
     void ShrinkIfNeeded() {
+#if SQ_PACKED_ARRAYS
+        if (IsPacked()) {
+            if(_packed.size() <= _packed.capacity()>>2)
+                _packed.shrinktofit();
+            return;
+        }
+#endif
         if(_values.size() <= _values.capacity()>>2) //shrink the array
             _values.shrinktofit();
     }
+    void Compact()
+    {
+#if SQ_PACKED_ARRAYS
+        _packed.shrinktofit();
+#endif
+        _values.shrinktofit();
+    }
+    SQUnsignedInteger MemSize() const
+    {
+#if SQ_PACKED_ARRAYS
+        return sizeof(SQArray) + _values.capacity() * sizeof(SQObjectPtr) + _packed.capacity() * sizeof(SQObjectValue);
+#else
+        return sizeof(SQArray) + _values.capacity() * sizeof(SQObjectPtr);
+#endif
+    }
     bool Remove(SQInteger idx, bool shrink=true){
-        if(idx < 0 || idx >= (SQInteger)_values.size())
+        if(idx < 0 || idx >= Size())
             return false;
-        _values.remove(idx);
-        VT_REMOVE(idx);
+#if SQ_PACKED_ARRAYS
+        if (IsPacked())
+            _packed.remove(idx);
+        else
+#endif
+        {
+            _values.remove(idx);
+            VT_REMOVE(idx);
+        }
         if (shrink)
             ShrinkIfNeeded();
         return true;
@@ -113,6 +297,11 @@ public:
     bool IsBinaryEqual(const SQArray *o);
 
     SQObjectPtrVec _values;
+#if SQ_PACKED_ARRAYS
+    sqvector<SQObjectValue> _packed;
+    SQObjectType _packedtype; // OT_INTEGER or OT_FLOAT while packed, OT_NULL otherwise
+    bool _nopack; // was unpacked once, stays generic
+#endif
     VT_DECL_VEC;
 };
 #endif //_SQARRAY_H_
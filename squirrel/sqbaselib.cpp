@@ -9,7 +9,10 @@
 #include "sqfuncproto.h"
 #include "sqclosure.h"
 #include "sqclass.h"
+#include "sqsort.h"
 #include <sqstringlib.h>
+#include <sqnumconv.h>
+#include <sqstrscan.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include "compiler/sqtypeparser.h"
@@ -36,28 +39,15 @@ SQInteger sq_deduplicate_object(HSQUIRRELVM vm, int index);
 
 static bool sq_parse_float(const char* str_begin, const char * str_end, SQObjectPtr& res, SQInteger base)
 {
-#if SQ_USE_STD_FROM_CHARS
     SQFloat r;
-    auto ret = std::from_chars(str_begin, str_end, r);
-    for (const char* ptr = ret.ptr; ptr != str_end; ++ptr)
-        if (*ptr != '0')
-            return false;
-    if (ret.ec == std::errc::invalid_argument)
-        return false;
-    res = r;
-#else
-    char* end;
-    SQFloat r = SQFloat(strtod(str_begin, &end));
-    if (str_begin == end)
+    if (!sqnum_parse_float(str_begin, str_end, r))
         return false;
     res = r;
-#endif
     return true;
 }
 
 static bool sq_parse_int(const char* str_begin, const char* str_end, SQObjectPtr& res, SQInteger base)
 {
-    char* end;
     const char* e = str_begin;
     bool iseintbase = base > 13; //to fix error converting hexadecimals with e like 56f0791e
     char c;
@@ -68,8 +58,8 @@ static bool sq_parse_int(const char* str_begin, const char* str_end, SQObjectPtr
         e++;
     }
 
-    SQInteger r = SQInteger(scstrtol(str_begin, &end, (int)base));
-    if (str_begin == end)
+    SQInteger r;
+    if (!sqnum_parse_integer(str_begin, str_end, (int)base, r))
         return false;
     res = r;
     return true;
@@ -291,6 +281,8 @@ static SQInteger builtin_array_ctor(HSQUIRRELVM v)
     SQInteger size = tointeger(stack_get(v,2));
     if (size < 0)
         return sq_throwerror(v, "array size must be non-negative");
+    if (!v->CheckMemoryLimit(SQUnsignedInteger(size), sizeof(SQObjectPtr)))
+        return SQ_ERROR;
 
     SQArray *a;
     if(sq_gettop(v) > 2) {
@@ -517,6 +509,17 @@ static SQInteger obj_clear(HSQUIRRELVM v)
     return SQ_SUCCEEDED(sq_clear(v,-1)) ? 1 : SQ_ERROR;
 }
 
+static SQInteger container_compact(HSQUIRRELVM v)
+{
+    SQBool recursive = SQFalse;
+    if (sq_gettop(v) > 1)
+        sq_tobool(v, 2, &recursive);
+    if (SQ_FAILED(sq_compact(v, 1, recursive)))
+        return SQ_ERROR;
+    sq_push(v, 1);
+    return 1;
+}
+
 
 static SQInteger number_type_method_tochar(HSQUIRRELVM v)
 {
@@ -856,7 +859,7 @@ static SQInteger swap(HSQUIRRELVM v)
             if( k1 >= asize || k2 >= asize || k1 < 0 || k2 < 0)
                 return sq_throwerror(v,"index is out of range");
 
-            _Swap(_array(o)->_values[k1], _array(o)->_values[k2]);
+            arr->Swap(k1, k2);
             break;
         }
         case OT_TABLE: {
@@ -1075,6 +1078,7 @@ const SQRegFunction SQSharedState::_table_default_type_methods_funcz[]={
     {"weakref",obj_type_method_weakref,1, NULL },
     {"tostring",default_type_method_tostring,1, "."},
     {"clear",obj_clear,1, "."},
+    {"compact",container_compact,-1, "tb"},
     {"map",table_map,2, "tc"},
     {"filter",table_filter,2, "tc"},
     {"reduce",table_reduce, -2, "tc"},
@@ -1104,10 +1108,8 @@ static SQInteger array_append(HSQUIRRELVM v)
 
     SQArray *arr = _array(stack_get(v, 1));
     SQInteger nitems = sq_gettop(v)-1;
-    SQInteger offs = arr->Size();
-    arr->Resize(offs + nitems);
     for (SQInteger i=0; i<nitems; ++i)
-        arr->Set(offs+i, stack_get(v, 2+i));
+        arr->Append(stack_get(v, 2+i));
 
     v->Push(stack_get(v, 1));
     return 1;
@@ -1198,6 +1200,8 @@ static SQInteger array_resize(HSQUIRRELVM v)
         SQInteger sz = tointeger(nsize);
         if (sz<0)
           return sq_throwerror(v, "resizing to negative length");
+        if (sz > _array(o)->Size() && !v->CheckMemoryLimit(SQUnsignedInteger(sz - _array(o)->Size()), sizeof(SQObjectPtr)))
+          return SQ_ERROR;
 
         if(sq_gettop(v) > 2)
             fill = stack_get(v, 3);
@@ -1387,112 +1391,258 @@ static SQInteger array_contains(HSQUIRRELVM v)
 }
 
 
-static bool _sort_compare(HSQUIRRELVM v, SQArray *arr, SQObjectPtr &a, SQObjectPtr &b,
+static bool _sort_compare(HSQUIRRELVM v, const SQObjectPtr &a, const SQObjectPtr &b,
                           const SQObjectPtr &func, SQInteger &ret)
 {
-    if (sq_isnull(func)) {
-        if (!v->ObjCmp(a,b,ret))
-            return false;
+    if (sq_isnull(func))
+        return v->ObjCmp(a,b,ret);
+
+    SQInteger top = sq_gettop(v);
+    v->PushNull();
+    v->Push(a);
+    v->Push(b);
+    SQObjectPtr out;
+    bool callSucceeded = v->Call(func, 3, v->_top-3, out, false);
+    if (!callSucceeded) {
+        if (!sq_isstring( v->_lasterror))
+            v->Raise_Error("compare func failed");
+        return false;
     }
-    else {
-        SQInteger top = sq_gettop(v);
-        v->PushNull();
-        v->Push(a);
-        v->Push(b);
-        SQObjectPtr *valptr = arr->_values._vals;
-        SQUnsignedInteger precallsize = arr->_values.size();
-        SQObjectPtr out;
-        bool callSucceeded = v->Call(func, 3, v->_top-3, out, false);
-        if (!callSucceeded) {
-            if (!sq_isstring( v->_lasterror))
-                v->Raise_Error("compare func failed");
-            return false;
-        }
-        if (!sq_isnumeric(out)) {
-            v->Raise_Error("numeric value expected as return value of the compare function");
+    if (!sq_isnumeric(out)) {
+        v->Raise_Error("numeric value expected as return value of the compare function");
+        return false;
+    }
+    ret = tointeger(out);
+    sq_settop(v, top);
+    return true;
+}
+
+// a < b with the compare function or ObjCmp(), both can run script code and fail
+struct SQSortLess
+{
+    SQSortLess(HSQUIRRELVM vm, const SQObjectPtr &f) : v(vm), func(f), failed(false) {}
+    bool operator()(const SQObjectPtr &a, const SQObjectPtr &b)
+    {
+        SQInteger ret;
+        if (failed)
             return false;
-        }
-        if (precallsize != arr->_values.size() || valptr != arr->_values._vals) {
-            v->Raise_Error("array resized during sort operation");
+        if (!_sort_compare(v, a, b, func, ret)) {
+            failed = true;
             return false;
         }
-        ret = tointeger(out);
-        sq_settop(v, top);
-        return true;
+        return ret < 0;
     }
-    return true;
+    HSQUIRRELVM v;
+    const SQObjectPtr &func;
+    bool failed;
+};
+
+// same results as ObjCmp() for arrays of one of these types
+enum SQSortKind { SORT_GENERIC, SORT_INTEGER, SORT_FLOAT, SORT_STRING };
+
+struct SQSortIntegerLess { bool operator()(const SQObjectPtr &a, const SQObjectPtr &b) const { return _integer(a) < _integer(b); } };
+struct SQSortFloatLess { bool operator()(const SQObjectPtr &a, const SQObjectPtr &b) const { return _float(a) < _float(b); } };
+struct SQSortStringLess {
+    bool operator()(const SQObjectPtr &a, const SQObjectPtr &b) const {
+        return _string(a) != _string(b) && strcmp(_stringval(a), _stringval(b)) < 0;
+    }
+};
+
+static SQSortKind _sort_kind(const SQObjectPtr *vals, SQInteger n)
+{
+    if (n == 0)
+        return SORT_GENERIC;
+    SQObjectType t = sq_type(vals[0]);
+    if (t != OT_INTEGER && t != OT_FLOAT && t != OT_STRING)
+        return SORT_GENERIC;
+    for (SQInteger i = 0; i < n; i++) {
+        if (sq_type(vals[i]) != t)
+            return SORT_GENERIC;
+        if (t == OT_FLOAT && _float(vals[i]) != _float(vals[i])) // NaN doesn't order
+            return SORT_GENERIC;
+    }
+    return t == OT_INTEGER ? SORT_INTEGER : (t == OT_FLOAT ? SORT_FLOAT : SORT_STRING);
 }
 
-static bool _hsort_sift_down(HSQUIRRELVM v,SQArray *arr, SQInteger root, SQInteger bottom, const SQObjectPtr &func)
+template<typename T, typename Less>
+static void _sort_range(SQAllocContext ctx, T *vals, SQInteger n, Less &less, bool stable)
 {
-    SQInteger maxChild;
-    SQInteger done = 0;
-    SQInteger ret;
-    SQInteger root2;
-    while (((root2 = root * 2) <= bottom) && (!done))
-    {
-        if (root2 == bottom) {
-            maxChild = root2;
+    if (stable) {
+        sqvector<T> tmp(ctx);
+        tmp.resize(n);
+        sq_mergesort(vals, tmp._vals, n, less);
+    }
+    else
+        sq_pdqsort(vals, n, less);
+}
+
+// sorts in place without compare function calls if all elements are integers, floats or strings.
+// Equal integers or strings can't be told apart, so those don't need a stable sort, 0.0 and -0.0 can.
+static bool _sort_native(SQAllocContext ctx, SQArray *arr, bool stable)
+{
+    SQInteger n = arr->Size();
+#if SQ_PACKED_ARRAYS
+    if (arr->IsPacked()) {
+        SQObjectValue *vals = arr->_packed._vals;
+        if (arr->_packedtype == OT_INTEGER) {
+            auto less = [](const SQObjectValue &a, const SQObjectValue &b) { return a.nInteger < b.nInteger; };
+            sq_pdqsort(vals, n, less);
+            return true;
         }
-        else {
-            if(!_sort_compare(v,arr,arr->_values[root2],arr->_values[root2 + 1],func,ret))
+        for (SQInteger i = 0; i < n; i++)
+            if (vals[i].fFloat != vals[i].fFloat)
                 return false;
-            if (ret > 0) {
-                maxChild = root2;
-            }
-            else {
-                maxChild = root2 + 1;
-            }
+        auto less = [](const SQObjectValue &a, const SQObjectValue &b) { return a.fFloat < b.fFloat; };
+        _sort_range(ctx, vals, n, less, stable);
+        return true;
+    }
+#endif
+    SQObjectPtr *vals = arr->_values._vals;
+    switch (_sort_kind(vals, n)) {
+        case SORT_INTEGER: {
+            SQSortIntegerLess less;
+            sq_pdqsort(vals, n, less);
+            return true;
         }
-
-        if(!_sort_compare(v,arr,arr->_values[root],arr->_values[maxChild],func,ret))
-            return false;
-        if (ret < 0) {
-            if (root == maxChild) {
-                v->Raise_Error("inconsistent compare function");
-                return false; // We'd be swapping ourselve. The compare function is incorrect
-            }
-
-            _Swap(arr->_values[root],arr->_values[maxChild]);
-            root = maxChild;
+        case SORT_FLOAT: {
+            SQSortFloatLess less;
+            _sort_range(ctx, vals, n, less, stable);
+            return true;
         }
-        else {
-            done = 1;
+        case SORT_STRING: {
+            SQSortStringLess less;
+            sq_pdqsort(vals, n, less);
+            return true;
         }
+        default:
+            return false;
     }
-    return true;
 }
 
-static bool _hsort(HSQUIRRELVM v,SQObjectPtr &arr, SQInteger SQ_UNUSED_ARG(l), SQInteger SQ_UNUSED_ARG(r),const SQObjectPtr &func)
+// elements as they are stored, weak references are kept as they are
+static void _sort_copy_values(SQArray *arr, SQObjectPtrVec &vals)
 {
-    SQArray *a = _array(arr);
-    SQInteger i;
-    SQInteger array_size = a->Size();
-    for (i = (array_size / 2); i >= 0; i--) {
-        if(!_hsort_sift_down(v,a, i, array_size - 1,func)) return false;
+    SQInteger n = arr->Size();
+    vals.resize(n);
+    for (SQInteger i = 0; i < n; i++) {
+        if (arr->IsPacked())
+            arr->Get(i, vals[i]);
+        else
+            vals[i] = arr->_values[i];
     }
+}
 
-    for (i = array_size-1; i >= 1; i--)
-    {
-        _Swap(a->_values[0],a->_values[i]);
-        if(!_hsort_sift_down(v,a, 0, i-1,func)) return false;
-    }
-    return true;
+// the compare function sorts a copy, so whatever it does to the array can't break the sort itself
+static SQInteger _sort_generic(HSQUIRRELVM v, SQArray *arr, const SQObjectPtr &func, bool stable)
+{
+    SQInteger n = arr->Size();
+    SQObjectPtrVec vals(_ss(v)->_alloc_ctx);
+    _sort_copy_values(arr, vals);
+    SQSortLess less(v, func);
+    _sort_range(_ss(v)->_alloc_ctx, vals._vals, n, less, stable);
+    if (less.failed)
+        return SQ_ERROR;
+    if (arr->Size() != n)
+        return sq_throwerror(v, "array resized during sort operation");
+    for (SQInteger i = 0; i < n; i++)
+        arr->Set(i, vals[i]);
+    return 0;
 }
 
-static SQInteger array_sort(HSQUIRRELVM v)
+static SQInteger _array_sort(HSQUIRRELVM v, bool stable)
 {
-    SQObjectPtr func;
     SQObjectPtr &o = stack_get(v,1);
     SQ_CHECK_IMMUTABLE_OBJ(o);
+    SQArray *arr = _array(o);
 
-    if (_array(o)->Size() > 1) {
+    if (arr->Size() > 1) {
+        SQObjectPtr func;
         if(sq_gettop(v) == 2)
             func = stack_get(v, 2);
-        if(!_hsort(v, o, 0, _array(o)->Size()-1, func))
+        if (!sq_isnull(func) || !_sort_native(_ss(v)->_alloc_ctx, arr, stable))
+            if (SQ_FAILED(_sort_generic(v, arr, func, stable)))
+                return SQ_ERROR;
+    }
+    sq_settop(v,1);
+    return 1;
+}
+
+static SQInteger array_sort(HSQUIRRELVM v)
+{
+    return _array_sort(v, false);
+}
+
+static SQInteger array_sort_stable(HSQUIRRELVM v)
+{
+    return _array_sort(v, true);
+}
+
+template<typename Less>
+static void _sort_order_by_keys(SQAllocContext ctx, SQInteger *order, SQInteger n, const SQObjectPtr *keys, Less &keyless)
+{
+    auto less = [&](SQInteger a, SQInteger b) { return keyless(keys[a], keys[b]); };
+    _sort_range(ctx, order, n, less, true);
+}
+
+static SQInteger array_sort_by(HSQUIRRELVM v)
+{
+    SQObjectPtr &o = stack_get(v,1);
+    SQ_CHECK_IMMUTABLE_OBJ(o);
+    SQArray *arr = _array(o);
+    SQObjectPtr keyfn = stack_get(v,2);
+    SQAllocContext ctx = _ss(v)->_alloc_ctx;
+    SQInteger n = arr->Size();
+
+    // the key function is called once per element
+    SQObjectPtrVec keys(ctx);
+    keys.resize(n);
+    SQObjectPtr val;
+    for (SQInteger i = 0; i < n; i++) {
+        if (!arr->Get(i, val))
+            return sq_throwerror(v, "array resized during sort operation");
+        v->PushNull();
+        v->Push(val);
+        bool callRes = v->Call(keyfn, 2, v->_top - 2, keys[i], SQ_BASELIB_INVOKE_CB_ERR_HANDLER);
+        v->Pop(2);
+        if (!callRes)
             return SQ_ERROR;
+    }
 
+    sqvector<SQInteger> order(ctx);
+    order.resize(n);
+    for (SQInteger i = 0; i < n; i++)
+        order[i] = i;
+    switch (_sort_kind(keys._vals, n)) {
+        case SORT_INTEGER: {
+            SQSortIntegerLess less;
+            _sort_order_by_keys(ctx, order._vals, n, keys._vals, less);
+            break;
+        }
+        case SORT_FLOAT: {
+            SQSortFloatLess less;
+            _sort_order_by_keys(ctx, order._vals, n, keys._vals, less);
+            break;
+        }
+        case SORT_STRING: {
+            SQSortStringLess less;
+            _sort_order_by_keys(ctx, order._vals, n, keys._vals, less);
+            break;
+        }
+        default: {
+            SQObjectPtr nofunc;
+            SQSortLess less(v, nofunc);
+            _sort_order_by_keys(ctx, order._vals, n, keys._vals, less);
+            if (less.failed)
+                return SQ_ERROR;
+        }
     }
+
+    if (arr->Size() != n)
+        return sq_throwerror(v, "array resized during sort operation");
+    SQObjectPtrVec vals(ctx);
+    _sort_copy_values(arr, vals);
+    for (SQInteger i = 0; i < n; i++)
+        arr->Set(i, vals[order[i]]);
     sq_settop(v,1);
     return 1;
 }
@@ -1546,9 +1696,8 @@ static SQInteger array_replace_with(HSQUIRRELVM v)
 
     SQArray *dst = _array(stack_get(v, 1));
     SQArray *src = _array(stack_get(v, 2));
-    dst->_values.copy(src->_values);
+    dst->CopyFrom(src);
     dst->ShrinkIfNeeded();
-    VT_CLONE_FROM_TO(src, dst);
     v->Pop(1);
     return 1;
 }
@@ -1565,10 +1714,13 @@ const SQRegFunction SQSharedState::_array_default_type_methods_funcz[]={
     {"resize",array_resize,-2, "an"},
     {"reverse",array_reverse,1, "a"},
     {"sort",array_sort,-1, "ac"},
+    {"sort_stable",array_sort_stable,-1, "ac"},
+    {"sort_by",array_sort_by,2, "ac"},
     {"slice",array_slice,-1, "ann"},
     {"weakref",obj_type_method_weakref,1, NULL },
     {"tostring",default_type_method_tostring,1, "."},
     {"clear",obj_clear,1, "."},
+    {"compact",container_compact,-1, "ab"},
     {"map",array_map,2, "ac"},
     {"apply",array_apply,2, "ac"},
     {"reduce",array_reduce,-2, "ac."},
@@ -1595,7 +1747,7 @@ static SQInteger string_hash(HSQUIRRELVM v)
 {
     union { SQHash hash; SQInteger i; SQUnsignedInteger u; } convert;
     memset(&convert, 0, sizeof(convert));
-    convert.hash = _string(stack_get(v, 1))->_hash;
+    convert.hash = _string(stack_get(v, 1))->Hash();
     if (convert.i < 0)
         convert.u = ~convert.u;
     sq_pushinteger(v, convert.i);
@@ -1618,7 +1770,10 @@ static SQInteger string_slice(HSQUIRRELVM v)
       return 1;
     }
 
-    v->Push(SQObjectPtr(SQString::Create(_ss(v),&_stringval(o)[sidx],eidx-sidx)));
+    if (sidx == 0 && eidx == slen)
+        v->Push(o); // strings are immutable, the whole string is the slice
+    else
+        v->Push(SQObjectPtr(SQString::Create(_ss(v),&_stringval(o)[sidx],eidx-sidx)));
     return 1;
 }
 
@@ -1632,14 +1787,14 @@ static SQInteger string_hasindex(HSQUIRRELVM v)
 
 static SQInteger _string_scan_for_substring(HSQUIRRELVM v, SQInteger (*push_result)(HSQUIRRELVM v, SQInteger index))
 {
-    SQInteger top,start_idx=0;
+    SQInteger top,start_idx=0,len,sublen;
     const char *str,*substr,*ret;
-    if(((top=sq_gettop(v))>1) && SQ_SUCCEEDED(sq_getstring(v,1,&str)) && SQ_SUCCEEDED(sq_getstring(v,2,&substr))){
-        if (sq_getsize(v,2)<1)
+    if(((top=sq_gettop(v))>1) && SQ_SUCCEEDED(sq_getstringandsize(v,1,&str,&len)) && SQ_SUCCEEDED(sq_getstringandsize(v,2,&substr,&sublen))){
+        if (sublen<1)
             return sq_throwerror(v, "empty substring");
         if(top>2)sq_getinteger(v,3,&start_idx);
-        if((sq_getsize(v,1)>start_idx) && (start_idx>=0)){
-            ret=strstr(&str[start_idx],substr);
+        if((len>start_idx) && (start_idx>=0)){
+            ret=sqstr_find(&str[start_idx],len-start_idx,substr,sublen);
             if(ret)
                 return push_result(v, ret-str);
         }
@@ -1658,172 +1813,392 @@ static SQInteger string_contains(HSQUIRRELVM v)
     return _string_scan_for_substring(v, _push_scan_found_flag);
 }
 
-static char* replace_all(SQAllocContext allocctx, char *s, SQInteger &buf_len, SQInteger &len,
-                          const char *from, SQInteger len_from, const char *to, SQInteger len_to)
+// large results are written straight into the new string, others go through the scratchpad
+static char *string_result_buf(HSQUIRRELVM v, SQInteger len, SQString *&large)
 {
-    for (SQInteger pos=0; pos<=len-len_from; ) {
-        if (memcmp(s+pos, from, len_from*sizeof(char))==0) {
-            SQInteger d_size = len_to - len_from;
-            if (d_size > 0) {
-                s = (char*)sq_realloc(allocctx, s, buf_len*sizeof(char), (buf_len+d_size)*sizeof(char));
-                buf_len += d_size;
-            }
-            if (d_size!=0)
-                memmove(s+pos+len_to, s+pos+len_from, (len-pos-len_from)*sizeof(char));
-            memcpy(s+pos, to, len_to*sizeof(char));
-            len += d_size;
-            pos += len_to;
-        }
-        else
-            ++pos;
-    }
-    return s;
+    large = SQString::IsLarge(len) ? SQString::CreateLarge(_ss(v), len) : NULL;
+    return large ? large->_val : _ss(v)->GetScratchPad(len + 1);
 }
 
-static char* replace_substring_internal(SQAllocContext allocctx, char *s, SQInteger &buf_len, SQInteger &len,
-    int pos, SQInteger len_from, const char *to, SQInteger len_to)
+static void push_string_result(HSQUIRRELVM v, char *buf, SQInteger len, SQString *large)
 {
-    SQInteger d_size = len_to - len_from;
-    if (d_size > 0) {
-        s = (char*)sq_realloc(allocctx, s, buf_len * sizeof(char), (buf_len + d_size) * sizeof(char));
-        buf_len += d_size;
-    }
-    if (d_size != 0)
-        memmove(s + pos + len_to, s + pos + len_from, (len - pos - len_from) * sizeof(char));
-    memcpy(s + pos, to, len_to * sizeof(char));
-    len += d_size;
-
-    return s;
+    if (large)
+        v->Push(SQObjectPtr(large));
+    else
+        sq_pushstring(v, buf, len);
 }
 
 
+static char *subst_append(SQAllocContext allocctx, char *buf, SQInteger &buf_len, SQInteger &len,
+    const char *s, SQInteger n)
+{
+    if (len + n > buf_len) {
+        SQInteger new_len = (len + n) * 2;
+        buf = (char *)sq_realloc(allocctx, buf, buf_len, new_len);
+        buf_len = new_len;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+    return buf;
+}
+
+// the result is appended to a buffer of its own, converting values may call _tostring
+// metamethods that use the scratchpad, nothing is allocated if there is nothing to substitute
 static SQInteger string_substitute(HSQUIRRELVM v)
 {
     SQAllocContext allocctx = _ss(v)->_alloc_ctx;
     const char *fmt;
     SQInteger len;
     sq_getstringandsize(v, 1, &fmt, &len);
-    SQInteger buf_len = len;
-    char *s = (char *)sq_malloc(allocctx, len*sizeof(char));
-    memcpy(s, fmt, len * sizeof(char));
-
     SQInteger top = sq_gettop(v);
 
-    for (int i = 0; i < int(len) - 2; i++)
-        if (s[i] == '{') {
+    char *res = NULL;
+    SQInteger buf_len = 0, res_len = 0;
+    SQInteger copied = 0;
+
+    for (SQInteger i = 0; i < len - 2; i++)
+        if (fmt[i] == '{') {
             int depth = 0;
-            for (int j = i + 1; j < len; j++) {
-                if (s[j] == '}') {
+            for (SQInteger j = i + 1; j < len; j++) {
+                if (fmt[j] == '}') {
                     depth--;
                     if (depth < 0) {
                         if (i + 1 == j)
                           break;
 
-                        int index = 0;
-                        for (int k = i + 1; k < j; k++)
-                            if (s[k] >= '0' && s[k] <= '9')
-                                index = index * 10 + s[k] - '0';
+                        SQInteger index = 0;
+                        for (SQInteger k = i + 1; k < j; k++)
+                            if (fmt[k] >= '0' && fmt[k] <= '9') {
+                                if (index <= top)
+                                    index = index * 10 + fmt[k] - '0';
+                            }
                             else {
                                 index = -1;
                                 break;
                             }
 
-                        if (index >= 0) {
-                            index += 2;
-                            if (index <= top) {
-                                SQObjectPtr &val = stack_get(v, index);
-                                SQObjectPtr valStr;
-                                if (v->ToString(val, valStr)) {
-                                    int delta = (int)_string(valStr)->_len - (j + 1 - i);
-                                    s = replace_substring_internal(allocctx, s, buf_len, len, i, j + 1 - i,
-                                        _stringval(valStr), _string(valStr)->_len);
-                                    i = j + delta;
+                        SQObjectPtr valStr;
+                        bool converted = true;
+                        if (index >= 0 && index + 2 <= top)
+                            converted = v->ToString(stack_get(v, index + 2), valStr);
+                        else {
+                            for (SQInteger idx = 2; idx <= top; idx++) {
+                                SQObjectPtr &arg = stack_get(v, idx);
+                                SQObjectPtr val;
+                                if (sq_type(arg) == OT_TABLE && _table(arg)->GetStr(fmt + i + 1, j - i - 1, val)) {
+                                    converted = v->ToString(val, valStr);
                                     break;
                                 }
-                                else {
-                                    sq_free(allocctx, s, buf_len * sizeof(char));
-                                    return sq_throwerror(v, "subst: Failed to convert value to string");
-                                }
                             }
                         }
+                        if (!converted) {
+                            if (res)
+                                sq_free(allocctx, res, buf_len);
+                            return sq_throwerror(v, "subst: Failed to convert value to string");
+                        }
 
-                        for (int idx = 2; idx <= top; idx++) {
-                            SQObjectPtr &arg = stack_get(v, idx);
-                            if (sq_type(arg) == OT_TABLE) {
-                                SQTable *table = _table(arg);
-                                SQObjectPtr val;
-                                SQObjectPtr valStr;
-                                if (table->GetStr(s + i + 1, j - i - 1, val)) {
-                                    if (v->ToString(val, valStr)) {
-                                        int delta = (int)_string(valStr)->_len - (j + 1 - i);
-                                        s = replace_substring_internal(allocctx, s, buf_len, len, i, j + 1 - i,
-                                            _stringval(valStr), _string(valStr)->_len);
-                                        i = j + delta;
-                                        break;
-                                    }
-                                    else {
-                                        sq_free(allocctx, s, buf_len * sizeof(char));
-                                        return sq_throwerror(v, "subst: Failed to convert value to string");
-                                    }
-                                }
+                        if (sq_type(valStr) == OT_STRING) {
+                            if (!res) {
+                                buf_len = len * 2 + 16;
+                                res = (char *)sq_malloc(allocctx, buf_len);
                             }
+                            res = subst_append(allocctx, res, buf_len, res_len, fmt + copied, i - copied);
+                            res = subst_append(allocctx, res, buf_len, res_len, _stringval(valStr), _string(valStr)->_len);
+                            copied = j + 1;
+                            i = j;
                         }
-
                         break; // depth < 0
                     }
                 }
-                else if (s[j] == '{')
+                else if (fmt[j] == '{')
                   depth++;
             }
         }
 
-    sq_pushstring(v, s, len);
-    sq_free(allocctx, s, buf_len * sizeof(char));
+    if (!res) {
+        sq_push(v, 1);
+        return 1;
+    }
+    res = subst_append(allocctx, res, buf_len, res_len, fmt + copied, len - copied);
+    sq_pushstring(v, res, res_len);
+    sq_free(allocctx, res, buf_len);
+    return 1;
+}
+
+
+/*
+* replace() with a table of from -> to strings: an Aho-Corasick automaton over the keys finds
+* them all in one scan. Replacements are leftmost, the longest key wins among those starting at
+* the same position, and replaced text is not searched again, so the order of the keys doesn't
+* matter.
+*/
+struct ReplaceNode
+{
+    SQInteger edges;  // the first edge, -1 for none
+    SQInteger fail;   // the longest proper suffix that is a node too
+    SQInteger dict;   // the nearest node on the fail chain a key ends at, -1 for none
+    SQInteger key;    // the key ending here, -1 for none
+    SQInteger depth;
+};
+
+struct ReplaceEdge
+{
+    SQInteger to;
+    SQInteger next;
+    unsigned char c;
+};
+
+struct ReplaceKey
+{
+    SQObjectPtr key;    // holds the string, _tostring of a value may remove it from the table
+    const char *from;
+    SQInteger from_len;
+    SQObjectPtr to;
+};
+
+class ReplaceAutomaton
+{
+public:
+    ReplaceAutomaton(SQAllocContext ctx) : _nodes(ctx), _edges(ctx), _nfirst(0)
+    {
+        ReplaceNode root = {-1, 0, -1, -1, 0};
+        _nodes.push_back(root);
+        for (int c = 0; c < 256; c++)
+            _root[c] = -1;
+    }
+
+    // for keys of len chars in total
+    void reserve(SQInteger len)
+    {
+        _nodes.reserve(len + 1);
+        _edges.reserve(len);
+    }
+
+    void add(const char *key, SQInteger len, SQInteger index)
+    {
+        SQInteger n = 0;
+        for (SQInteger i = 0; i < len; i++) {
+            unsigned char c = (unsigned char)key[i];
+            SQInteger next = child(n, c);
+            if (next < 0) {
+                next = _nodes.size();
+                ReplaceNode node = {-1, 0, -1, -1, i + 1};
+                _nodes.push_back(node);
+                if (n == 0) {
+                    _root[c] = next;
+                    if (_nfirst < 8)
+                        _first[_nfirst] = char(c);
+                    _nfirst++;
+                }
+                else {
+                    ReplaceEdge e = {next, _nodes[n].edges, c};
+                    _nodes[n].edges = _edges.size();
+                    _edges.push_back(e);
+                }
+            }
+            n = next;
+        }
+        _nodes[n].key = index;
+    }
+
+    // fail links in breadth first order, the fail target of a node is always shallower
+    void build()
+    {
+        sqvector<SQInteger> queue(_nodes._alloc_ctx);
+        queue.reserve(_nodes.size());
+        for (int c = 0; c < 256; c++)
+            if (_root[c] >= 0)
+                queue.push_back(_root[c]);
+        for (SQUnsignedInteger qi = 0; qi < queue.size(); qi++) {
+            SQInteger n = queue[qi];
+            for (SQInteger e = _nodes[n].edges; e >= 0; e = _edges[e].next) {
+                SQInteger to = _edges[e].to;
+                SQInteger f = step(_nodes[n].fail, _edges[e].c);
+                _nodes[to].fail = f;
+                _nodes[to].dict = _nodes[f].key >= 0 ? f : _nodes[f].dict;
+                queue.push_back(to);
+            }
+        }
+    }
+
+    SQInteger step(SQInteger n, unsigned char c) const
+    {
+        for (; n; n = _nodes[n].fail) {
+            SQInteger next = child(n, c);
+            if (next >= 0)
+                return next;
+        }
+        return _root[c] >= 0 ? _root[c] : 0;
+    }
+
+    // where a key may start next, from the root state
+    const char *skip(const char *s, const char *end) const
+    {
+        if (_nfirst <= 8)
+            return sqstr_find_first_of(s, end, _first, _nfirst);
+        while (s < end && _root[(unsigned char)*s] < 0)
+            s++;
+        return s;
+    }
+
+    const ReplaceNode &node(SQInteger n) const { return _nodes[n]; }
+
+private:
+    SQInteger child(SQInteger n, unsigned char c) const
+    {
+        if (n == 0)
+            return _root[c];
+        for (SQInteger e = _nodes[n].edges; e >= 0; e = _edges[e].next)
+            if (_edges[e].c == c)
+                return _edges[e].to;
+        return -1;
+    }
+
+    sqvector<ReplaceNode> _nodes;
+    sqvector<ReplaceEdge> _edges;
+    SQInteger _root[256];
+    char _first[8];     // the chars keys start with, while there are few of them
+    SQInteger _nfirst;
+};
+
+static SQInteger replace_by_table(HSQUIRRELVM v, const char *s, SQInteger len_s, SQTable *table)
+{
+    SQAllocContext ctx = _ss(v)->_alloc_ctx;
+    sqvector<ReplaceKey> keys(ctx);
+    ReplaceAutomaton automaton(ctx);
+
+    keys.reserve(table->CountUsed());
+    SQInteger keys_len = 0;
+    SQObjectPtr itr, key, val;
+    SQInteger nitr;
+    while ((nitr = table->Next(false, itr, key, val)) != -1) {
+        itr = (SQInteger)nitr;
+        if (sq_type(key) != OT_STRING)
+            return sq_throwerror(v, "replace: table keys must be strings");
+        if (!_string(key)->_len)
+            continue;
+        ReplaceKey k = {key, _stringval(key), _string(key)->_len, SQObjectPtr()};
+        if (!v->ToString(val, k.to))
+            return sq_throwerror(v, "replace: failed to convert value to string");
+        keys.push_back(k);
+        keys_len += k.from_len;
+    }
+    if (keys.empty()) {
+        sq_push(v, 1);
+        return 1;
+    }
+    automaton.reserve(keys_len);
+    for (SQUnsignedInteger k = 0; k < keys.size(); k++)
+        automaton.add(keys[k].from, keys[k].from_len, k);
+    automaton.build();
+
+    // (position, key) pairs
+    sqvector<SQInteger> found(ctx);
+    found.reserve(32);
+    SQInteger res_len = len_s;
+    SQInteger state = 0, best = -1, best_start = 0;
+    for (SQInteger i = 0; i < len_s; ) {
+        if (state == 0 && best < 0) {
+            i = automaton.skip(s + i, s + len_s) - s;
+            if (i == len_s)
+                break;
+        }
+        state = automaton.step(state, (unsigned char)s[i++]);
+        const ReplaceNode &n = automaton.node(state);
+        for (SQInteger d = n.key >= 0 ? state : n.dict; d >= 0; d = automaton.node(d).dict) {
+            SQInteger k = automaton.node(d).key;
+            SQInteger start = i - keys[k].from_len;
+            if (best < 0 || start < best_start || (start == best_start && keys[k].from_len > keys[best].from_len)) {
+                best = k;
+                best_start = start;
+            }
+        }
+        // no key ending later can start at best_start or before it, the text after the
+        // replaced part is scanned again from the root
+        if (best >= 0 && (i == len_s || i - n.depth > best_start)) {
+            found.push_back(best_start);
+            found.push_back(best);
+            res_len += _string(keys[best].to)->_len - keys[best].from_len;
+            i = best_start + keys[best].from_len;
+            state = 0;
+            best = -1;
+        }
+    }
+    if (found.empty()) {
+        sq_push(v, 1);
+        return 1;
+    }
+
+    SQString *large;
+    char *res = string_result_buf(v, res_len, large);
+    char *out = res;
+    SQInteger pos = 0;
+    for (SQUnsignedInteger m = 0; m < found.size(); m += 2) {
+        const ReplaceKey &k = keys[found[m + 1]];
+        memcpy(out, s + pos, found[m] - pos);
+        out += found[m] - pos;
+        memcpy(out, _stringval(k.to), _string(k.to)->_len);
+        out += _string(k.to)->_len;
+        pos = found[m] + k.from_len;
+    }
+    memcpy(out, s + pos, len_s - pos);
+    assert(out + (len_s - pos) == res + res_len);
+    push_string_result(v, res, res_len, large);
     return 1;
 }
 
+#define REPLACE_KNOWN_MATCHES 32
 
+// counts the occurrences first, then writes the result at once, where the first matches are
+// is remembered so usually the text is searched only once
 static SQInteger string_replace(HSQUIRRELVM v)
 {
     const char *s, *from, *to;
     SQInteger len_s, len_from, len_to;
     sq_getstringandsize(v, 1, &s, &len_s);
+
+    if (sq_type(stack_get(v, 2)) == OT_TABLE) {
+        if (sq_gettop(v) != 2)
+            return sq_throwerror(v, "replace: a table of replacements takes no other arguments");
+        return replace_by_table(v, s, len_s, _table(stack_get(v, 2)));
+    }
+    if (sq_gettop(v) != 3 || sq_type(stack_get(v, 3)) != OT_STRING)
+        return sq_throwerror(v, "replace: expected from and to strings or a table");
     sq_getstringandsize(v, 2, &from, &len_from);
     sq_getstringandsize(v, 3, &to, &len_to);
 
-    if (len_from <= 0) {
+    const char *end = s + len_s;
+    const char *known[REPLACE_KNOWN_MATCHES];
+    SQInteger count = 0;
+    if (len_from > 0)
+        for (const char *p = s; (p = sqstr_find(p, end - p, from, len_from)) != NULL; p += len_from) {
+            if (count < REPLACE_KNOWN_MATCHES)
+                known[count] = p;
+            count++;
+        }
+    if (!count) {
         sq_push(v, 1);
         return 1;
     }
 
-    // can be optimized by avoiding unnecessary copying
-    SQInteger buf_len = len_s;
-    char *dest = (char *)sq_malloc(_ss(v)->_alloc_ctx, buf_len*sizeof(char));
-    SQInteger len_dest = len_s;
-    memcpy(dest, s, len_s*sizeof(char));
-    dest = replace_all(_ss(v)->_alloc_ctx, dest, buf_len, len_dest, from, len_from, to, len_to);
-
-    sq_pushstring(v, dest, len_dest);
-    sq_free(_ss(v)->_alloc_ctx, dest, buf_len*sizeof(char));
+    SQInteger res_len = len_s + count * (len_to - len_from);
+    SQString *large;
+    char *res = string_result_buf(v, res_len, large);
+    char *out = res;
+    const char *p = s;
+    for (SQInteger i = 0; i < count; i++) {
+        const char *found = i < REPLACE_KNOWN_MATCHES ? known[i] : sqstr_find(p, end - p, from, len_from);
+        memcpy(out, p, found - p);
+        out += found - p;
+        memcpy(out, to, len_to);
+        out += len_to;
+        p = found + len_from;
+    }
+    memcpy(out, p, end - p);
+    push_string_result(v, res, res_len, large);
     return 1;
 }
 
-static SQInteger buf_concat(sqvector<char> &res, const SQObjectPtrVec &strings, const char *sep, SQInteger sep_len)
-{
-    SQInteger out_pos = 0;
-    for (SQInteger i=0, nitems=strings.size(); i<nitems; ++i) {
-        if (i) {
-            memcpy(res._vals+out_pos, sep, sep_len*sizeof(char));
-            out_pos += sep_len;
-        }
-
-        SQString *s = _string(strings[i]);
-        memcpy(res._vals+out_pos, s->_val, s->_len*sizeof(char));
-        out_pos += s->_len;
-    }
-    return out_pos;
-}
-
 static SQInteger string_join(HSQUIRRELVM v)
 {
     const char *sep;
@@ -1831,9 +2206,8 @@ static SQInteger string_join(HSQUIRRELVM v)
     sq_getstringandsize(v, 1, &sep, &sep_len);
     SQArray *arr = _array(stack_get(v, 2));
 
-    SQObjectPtrVec strings(_ss(v)->_alloc_ctx);
-    strings.reserve(arr->Size());
-    SQObjectPtr tmp;
+    SQObjectPtrVec items(_ss(v)->_alloc_ctx);
+    items.reserve(arr->Size());
     SQObjectPtr flt;
 
     if (sq_gettop(v) > 3)
@@ -1842,9 +2216,12 @@ static SQInteger string_join(HSQUIRRELVM v)
     if (sq_gettop(v) == 3)
         flt = stack_get(v, 3);
 
-    SQInteger res_len = 0;
+    SQObjectPtr item;
     for (SQInteger i=0; i<arr->Size(); ++i) {
-        SQObjectPtr &item = arr->_values[i];
+        if (arr->IsPacked())
+            arr->Get(i, item);
+        else
+            item = arr->_values[i];
         if (sq_isbool(flt) && sq_objtobool(&flt)) {
             if (sq_isnull(item) || (sq_isstring(item) && !_string(item)->_len))
                 continue;
@@ -1860,26 +2237,14 @@ static SQInteger string_join(HSQUIRRELVM v)
                 continue;
         }
 
-        if (!v->ToString(item, tmp))
-            return sq_throwerror(v, "Failed to convert array item to string");
-
-        strings.push_back(tmp);
-        res_len += _string(tmp)->_len;
+        items.push_back(item);
     }
 
-    if (strings.empty()) {
-        sq_pushstring(v, "", 0);
-        return 1;
-    }
-
-    res_len += sep_len * (strings.size()-1);
-
-    sqvector<char> res(_ss(v)->_alloc_ctx);
-    res.resize(res_len);
-    SQInteger out_pos = buf_concat(res, strings, sep, sep_len);
-    (void)out_pos;
-    assert(out_pos == res_len);
-    sq_pushstring(v, res._vals, res_len);
+    // the items are copies, StringCatN() may replace them with their strings
+    SQObjectPtr res;
+    if (!v->StringCatN(items.size() ? &items[0] : NULL, items.size(), res, sep, sep_len))
+        return sq_throwerror(v, "Failed to convert array item to string");
+    v->Push(res);
     return 1;
 }
 
@@ -1895,22 +2260,11 @@ static SQInteger string_concat(HSQUIRRELVM v)
         return 1;
     }
 
-    SQObjectPtrVec strings(_ss(v)->_alloc_ctx);
-    strings.resize(nitems);
-
-    SQInteger res_len = sep_len * (nitems-1);
-    for (SQInteger i=0; i<nitems; ++i) {
-        if (!v->ToString(stack_get(v, i+2), strings[i]))
-            return sq_throwerror(v, "Failed to convert array item to string");
-        res_len += _string(strings[i])->_len;
-    }
-
-    sqvector<char> res(_ss(v)->_alloc_ctx);
-    res.resize(res_len);
-    SQInteger out_pos = buf_concat(res, strings, sep, sep_len);
-    (void)out_pos;
-    assert(out_pos == res_len);
-    sq_pushstring(v, res._vals, res_len);
+    // the arguments belong to this call, StringCatN() may replace them with their strings
+    SQObjectPtr res;
+    if (!v->StringCatN(&stack_get(v, 2), nitems, res, sep, sep_len))
+        return sq_throwerror(v, "Failed to convert array item to string");
+    v->Push(res);
     return 1;
 }
 
@@ -1924,13 +2278,12 @@ static SQInteger string_split(HSQUIRRELVM v)
     SQArray *res = SQArray::Create(_ss(v),0);
 
     if (sq_gettop(v) == 1) {
-        SQInteger start = 0;
-        for (SQInteger pos=0; pos<=len; ++pos) {
-            if (pos==len || sq_isspace(str[pos])) {
-                if (pos > start)
-                    res->Append(SQObjectPtr(SQString::Create(_ss(v), str+start, pos-start)));
-                start = pos+1;
-            }
+        const char *end = str + len;
+        for (const char *start = str; start < end; ) {
+            const char *pos = sqstr_find_space(start, end);
+            if (pos > start)
+                res->Append(SQObjectPtr(SQString::Create(_ss(v), start, pos-start)));
+            start = pos+1;
         }
     } else {
         const char *sep;
@@ -1939,18 +2292,15 @@ static SQInteger string_split(HSQUIRRELVM v)
         if (sep_len < 1)
             return sq_throwerror(v, "empty separator");
         SQInteger start = 0;
-        for (SQInteger pos=0; pos<=len;) {
-            if (pos>len-sep_len) {
+        for (;;) {
+            const char *found = sqstr_find(str+start, len-start, sep, sep_len);
+            if (!found) {
                 res->Append(SQObjectPtr(SQString::Create(_ss(v), str+start, len-start)));
                 break;
             }
-            else if (strncmp(str+pos, sep, sep_len)==0) {
-                res->Append(SQObjectPtr(SQString::Create(_ss(v), str+start, pos-start)));
-                pos += sep_len;
-                start = pos;
-            }
-            else
-                ++pos;
+            SQInteger pos = found - str;
+            res->Append(SQObjectPtr(SQString::Create(_ss(v), str+start, pos-start)));
+            start = pos + sep_len;
         }
     }
     v->Push(SQObjectPtr(res));
@@ -1972,14 +2322,14 @@ static SQInteger string_split(HSQUIRRELVM v)
     const char *sthis=_stringval(str); \
     char *snew=(_ss(v)->GetScratchPad(len)); \
     memcpy(snew,sthis,len);\
-    for(SQInteger i=sidx;i<eidx;i++) snew[i] = (char)call_func(sthis[i]); \
+    call_func(snew+sidx,sthis+sidx,eidx-sidx); \
     v->Push(SQObjectPtr(SQString::Create(_ss(v),snew,len))); \
     return 1; \
 }
 
 
-STRING_TOFUNCZ(tolower, sq_tolower)
-STRING_TOFUNCZ(toupper, sq_toupper)
+STRING_TOFUNCZ(tolower, sqstr_tolower)
+STRING_TOFUNCZ(toupper, sqstr_toupper)
 
 #define IMPL_STRING_FUNC(name) static SQInteger _baselib_string_##name(HSQUIRRELVM v) { return _sq_string_ ## name ## _impl(v, 1); }
 
@@ -2008,7 +2358,7 @@ const SQRegFunction SQSharedState::_string_default_type_methods_funcz[]={
     {"tolower",string_tolower,-1, "s n n", NULL, true},
     {"toupper",string_toupper,-1, "s n n", NULL, true},
     {"subst",string_substitute,-2, "s", NULL, true},
-    {"replace",string_replace, 3, "s s s", NULL, true},
+    {"replace",string_replace, -2, "s s|t s", NULL, true},
     {"join",string_join, -2, "s a b|c", NULL, true},
     {"concat",string_concat, -2, "s.", NULL, true},
     {"split",string_split, -1, "s s", NULL, true},
@@ -2199,7 +2549,11 @@ static SQInteger _closure_acall(HSQUIRRELVM v,SQBool invoke_err_handler)
     SQArray *aparams=_array(stack_get(v,2));
     SQInteger nparams=aparams->Size();
     v->Push(stack_get(v,1));
-    for(SQInteger i=0;i<nparams;i++)v->Push(aparams->_values[i]);
+    SQObjectPtr param;
+    for(SQInteger i=0;i<nparams;i++) {
+        if (aparams->IsPacked()) aparams->Get(i, param);
+        v->Push(aparams->IsPacked() ? param : aparams->_values[i]);
+    }
     return SQ_SUCCEEDED(sq_call(v,nparams,SQTrue,invoke_err_handler))?1:SQ_ERROR;
 }
 
@@ -249,6 +249,7 @@ void SQInstance::Finalize()
 
 SQInstance::~SQInstance()
 {
+    SQ_MEMPROF_FREE(_sharedstate, this);
     REMOVE_FROM_CHAIN(&_sharedstate->_gc_chain, this);
     if(_class){ Finalize(); } //if _class is null it was already finalized by the GC
 }
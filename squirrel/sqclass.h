@@ -151,6 +151,7 @@ public:
         if(theclass->_udsize) {
             newinst->_userpointer = ((unsigned char *)newinst) + (size - theclass->_udsize);
         }
+        SQ_MEMPROF_ALLOC(ss, newinst, OT_INSTANCE, size);
         return newinst;
     }
     SQInstance *Clone(SQSharedState *ss)
@@ -161,6 +162,7 @@ public:
         if(_class->_udsize) {
             newinst->_userpointer = ((unsigned char *)newinst) + (size - _class->_udsize);
         }
+        SQ_MEMPROF_ALLOC(ss, newinst, OT_INSTANCE, size);
         return newinst;
     }
     ~SQInstance();
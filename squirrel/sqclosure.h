@@ -24,6 +24,7 @@ public:
         nc->_defaultparams = &nc->_outervalues[func->_noutervalues];
         _CONSTRUCT_VECTOR(SQObjectPtr,func->_noutervalues,nc->_outervalues);
         _CONSTRUCT_VECTOR(SQObjectPtr,func->_ndefaultparams,nc->_defaultparams);
+        SQ_MEMPROF_ALLOC(ss, nc, OT_CLOSURE, size);
         return nc;
     }
     void Release(){
@@ -15,6 +15,20 @@ static inline uint32_t calc_shrinker_hash(uint32_t * data, int bytes)
   return (hash >> 19) ^ hash;
 }
 
+// objects are hashed field by field, the padding after _flags is not initialized
+static inline uint32_t add_objects_shrinker_hash(uint32_t hash, const SQObjectPtr * objs, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint64_t raw = uint64_t(objs[i]._unVal.raw);
+    hash = (hash ^ uint32_t(objs[i]._type)) * SHRINK_HASH_MUL;
+    hash = (hash ^ uint32_t(objs[i]._flags)) * SHRINK_HASH_MUL;
+    hash = (hash ^ uint32_t(raw)) * SHRINK_HASH_MUL;
+    hash = (hash ^ uint32_t(raw >> 32)) * SHRINK_HASH_MUL;
+  }
+  return hash;
+}
+
 struct SQDeduplicateShrinker
 {
 private:
@@ -25,6 +39,29 @@ private:
   sqvector<void *> visitedTables;
   sqvector<void *> visitedArrays;
 
+  // covers everything SQTable::IsBinaryEqual compares, tables keeping their
+  // values out of _nodes must not all land in the same cache entry
+  static uint32_t calc_table_hash(const SQTable *t)
+  {
+    uint32_t hash = SHRINK_HASH_INIT;
+    for (SQInteger i = 0; i < t->AllocatedNodes(); i++)
+    {
+      hash = add_objects_shrinker_hash(hash, &t->_nodes[i].key, 1);
+      hash = add_objects_shrinker_hash(hash, &t->_nodes[i].val, 1);
+    }
+#if SQ_TABLE_ARRAY_PART
+    hash = add_objects_shrinker_hash(hash, t->_array, t->_arraysize);
+#endif
+#if SQ_TABLE_SHAPES
+    if (t->_shape)
+    {
+      hash = (hash ^ uint32_t(t->_shape->_id ^ (t->_shape->_id >> 32))) * SHRINK_HASH_MUL;
+      hash = add_objects_shrinker_hash(hash, t->_slots, t->_shape->_nkeys);
+    }
+#endif
+    return (hash >> 19) ^ hash;
+  }
+
 public:
 
   SQDeduplicateShrinker(HSQUIRRELVM vm) : arrayCache(vm->_sharedstate->_alloc_ctx), tableCache(vm->_sharedstate->_alloc_ctx),
@@ -57,7 +94,7 @@ public:
 
         if (itemsCount <= CACHE_ITEMS_LIMIT)
         {
-          uint32_t hash = calc_shrinker_hash((uint32_t *)nodes, allocatedNodes * sizeof(SQTable::_HashNode));
+          uint32_t hash = calc_table_hash(t);
           cacheIndex = hash & (CACHE_SIZE - 1);
           if (sq_istable(tableCache[cacheIndex]) && t->IsBinaryEqual(_table(tableCache[cacheIndex])))
           {
@@ -76,7 +113,7 @@ public:
         {
           if (!(sq_type(nodes[i].key) & OT_FREE_TABLE_SLOT))
           {
-            if (!sq_isstring(nodes[i].key) || (!sq_isnull(nodes[i].val) && !sq_isstring(nodes[i].val) && !sq_isinteger(nodes[i].val) && !sq_isfloat(nodes[i].val) && !sq_isbool(nodes[i].val)))
+            if ((!sq_isstring(nodes[i].key) && !sq_isinteger(nodes[i].key)) || (!sq_isnull(nodes[i].val) && !sq_isstring(nodes[i].val) && !sq_isinteger(nodes[i].val) && !sq_isfloat(nodes[i].val) && !sq_isbool(nodes[i].val)))
               simpleTypes = false;
 
             if (sq_isarray(nodes[i].val) || sq_istable(nodes[i].val))
@@ -84,6 +121,30 @@ public:
           }
         }
 
+#if SQ_TABLE_ARRAY_PART
+        for (uint32_t i = 0; i < t->_arraysize; i++)
+        {
+          SQObjectPtr &val = t->_array[i];
+          if (sq_type(val) & OT_FREE_TABLE_SLOT)
+            continue;
+          if (!sq_isstring(val) && !sq_isinteger(val) && !sq_isfloat(val) && !sq_isbool(val))
+            simpleTypes = false;
+          if (sq_isarray(val) || sq_istable(val))
+            shrink(val);
+        }
+#endif
+
+#if SQ_TABLE_SHAPES
+        for (uint32_t i = 0; t->_shape && i < t->_shape->_nkeys; i++)
+        {
+          SQObjectPtr &val = t->_slots[i];
+          if (!sq_isnull(val) && !sq_isstring(val) && !sq_isinteger(val) && !sq_isfloat(val) && !sq_isbool(val))
+            simpleTypes = false;
+          if (sq_isarray(val) || sq_istable(val))
+            shrink(val);
+        }
+#endif
+
         visitedTables.pop_back();
 
         if (simpleTypes && itemsCount <= CACHE_ITEMS_LIMIT)
@@ -101,7 +162,13 @@ public:
 
         if (array->Size() <= CACHE_ITEMS_LIMIT)
         {
+#if SQ_PACKED_ARRAYS
+          uint32_t hash = array->IsPacked() ?
+            calc_shrinker_hash((uint32_t *)&array->_packed[0], array->Size() * sizeof(SQObjectValue)) :
+            calc_shrinker_hash((uint32_t *)&array->_values[0], array->Size() * sizeof(SQObjectPtr));
+#else
           uint32_t hash = calc_shrinker_hash((uint32_t *)&array->_values[0], array->Size() * sizeof(SQObjectPtr));
+#endif
           cacheIndex = hash & (CACHE_SIZE - 1);
           if (sq_isarray(arrayCache[cacheIndex]) && array->IsBinaryEqual(_array(arrayCache[cacheIndex])))
           {
@@ -116,7 +183,7 @@ public:
 
         visitedArrays.push_back(_array(obj));
 
-        for (int i = 0; i < int(array->Size()); i++)
+        for (int i = 0; i < int(array->_values.size()); i++) // packed arrays only hold numbers
         {
           if (!sq_isnull(array->_values[i]) && !sq_isstring(array->_values[i]) && !sq_isinteger(array->_values[i]) && !sq_isfloat(array->_values[i]) && !sq_isbool(array->_values[i]))
             simpleTypes = false;
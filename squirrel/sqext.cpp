@@ -47,11 +47,26 @@ SQRESULT sq_ext_get_array_floats(HSQOBJECT obj, int start, int count, float * de
 
   SQArray * array = _array(obj);
   SQObjectPtrVec & values = array->_values;
-  int arraySize = values.size();
+  int arraySize = array->Size();
 
   if (count + start > arraySize)
     return SQ_ERROR;
 
+#if SQ_PACKED_ARRAYS
+  if (array->IsPacked())
+  {
+    // no per element type checks
+    const SQObjectValue * src = array->_packed._vals + start;
+    if (array->_packedtype == OT_FLOAT)
+      for (int i = 0; i < count; i++)
+        dest[i] = float(src[i].fFloat);
+    else
+      for (int i = 0; i < count; i++)
+        dest[i] = float(src[i].nInteger);
+    return SQ_OK;
+  }
+#endif
+
   for (int i = 0; i < count; i++)
   {
     SQObjectPtr & v = values[i + start];
@@ -72,11 +87,15 @@ int sq_ext_get_array_int(HSQOBJECT obj, int index, int def)
   if (sq_type(obj) != OT_ARRAY)
     return def;
 
-  SQObjectPtrVec & values = _array(obj)->_values;
-  if (index < 0 || index >= values.size())
+  SQArray * array = _array(obj);
+  if (index < 0 || index >= array->Size())
     return def;
 
-  SQObjectPtr & v = values[index];
+  SQObjectPtr v;
+  if (array->IsPacked())
+    array->Get(index, v);
+  else
+    v = array->_values[index];
   if (sq_type(v) == OT_INTEGER || sq_type(v) == OT_BOOL)
     return _integer(v);
   else if (sq_type(v) == OT_FLOAT)
@@ -91,11 +110,15 @@ float sq_ext_get_array_float(HSQOBJECT obj, int index, float def)
   if (sq_type(obj) != OT_ARRAY)
     return def;
 
-  SQObjectPtrVec & values = _array(obj)->_values;
-  if (index < 0 || index >= values.size())
+  SQArray * array = _array(obj);
+  if (index < 0 || index >= array->Size())
     return def;
 
-  SQObjectPtr & v = values[index];
+  SQObjectPtr v;
+  if (array->IsPacked())
+    array->Get(index, v);
+  else
+    v = array->_values[index];
   if (sq_type(v) == OT_FLOAT)
     return _float(v);
   if (sq_type(v) == OT_INTEGER || sq_type(v) == OT_BOOL)
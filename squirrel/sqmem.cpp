@@ -4,19 +4,284 @@
 #include "sqpcheader.h"
 #ifndef SQ_EXCLUDE_DEFAULT_MEMFUNCTIONS
 
-void sq_vm_init_alloc_context(SQAllocContext *) {}
-void sq_vm_destroy_alloc_context(SQAllocContext *) {}
+#ifndef SQ_USE_POOL_ALLOCATOR
+#define SQ_USE_POOL_ALLOCATOR 1
+#endif
+
+/*
+* Every allocation context keeps track of live and peak bytes. Sizes come from the
+* callers (SQ_MALLOC/SQ_REALLOC/SQ_FREE always pass them), so accounting is just a
+* counter update. When a limit is set and live bytes go over it, the allocation still
+* succeeds (callers don't expect NULL), but the context remembers that the limit was hit,
+* and the VM raises a script error at its next safe point (see SQVM::CheckMemoryLimit).
+*/
+
+#if SQ_USE_POOL_ALLOCATOR
+
+/*
+* Size-class pooled allocator.
+* VM objects are small and short-lived (table/array/closure/instance headers, strings,
+* small node arrays), and every SQ_FREE/SQ_REALLOC already passes the exact block size,
+* so blocks need no header: the size class is derived from the size itself.
+* Blocks up to SQ_POOL_MAX_BLOCK_SIZE bytes are carved from slabs and recycled through
+* per-class free lists. Slabs are owned by the allocation context and released with it.
+* Bigger blocks go straight to libc.
+*/
+
+#define SQ_POOL_GRANULARITY_SHIFT 4
+#define SQ_POOL_GRANULARITY (1 << SQ_POOL_GRANULARITY_SHIFT)
+#define SQ_POOL_MAX_BLOCK_SIZE 512
+#define SQ_POOL_NUM_CLASSES (SQ_POOL_MAX_BLOCK_SIZE >> SQ_POOL_GRANULARITY_SHIFT)
+#define SQ_POOL_MIN_SLAB_SIZE (4 << 10)
+#define SQ_POOL_MAX_SLAB_SIZE (64 << 10)
+
+struct SQPoolFreeBlock
+{
+    SQPoolFreeBlock *next;
+};
+
+struct SQPoolSlab
+{
+    SQPoolSlab *next;
+    SQUnsignedInteger size;
+};
+
+#define SQ_POOL_SLAB_HEADER_SIZE ((sizeof(SQPoolSlab) + SQ_POOL_GRANULARITY - 1) & ~(SQ_POOL_GRANULARITY - 1))
+
+struct SQPoolSizeClass
+{
+    SQPoolFreeBlock *freelist;
+    char *bump;
+    char *bumpEnd;
+    SQUnsignedInteger nextSlabSize;
+};
+
+#endif // SQ_USE_POOL_ALLOCATOR
+
+struct SQAllocContextT
+{
+    SQUnsignedInteger usedBytes;
+    SQUnsignedInteger peakBytes;
+    SQUnsignedInteger limitBytes; // 0 - unlimited
+    bool limitExceeded;
+#if SQ_USE_POOL_ALLOCATOR
+    SQPoolSizeClass classes[SQ_POOL_NUM_CLASSES];
+    SQPoolSlab *slabs;
+#endif
+};
+
+static inline void sq_account_alloc(SQAllocContext ctx, SQUnsignedInteger size)
+{
+    ctx->usedBytes += size;
+    if (ctx->usedBytes > ctx->peakBytes)
+        ctx->peakBytes = ctx->usedBytes;
+    if (ctx->limitBytes && ctx->usedBytes > ctx->limitBytes)
+        ctx->limitExceeded = true;
+}
+
+static inline void sq_account_free(SQAllocContext ctx, SQUnsignedInteger size)
+{
+    assert(ctx->usedBytes >= size);
+    ctx->usedBytes -= size;
+}
+
+void sq_vm_set_alloc_limit(SQAllocContext ctx, SQUnsignedInteger limit)
+{
+    ctx->limitBytes = limit;
+    ctx->limitExceeded = limit && ctx->usedBytes > limit;
+}
+
+void sq_vm_get_alloc_stats(SQAllocContext ctx, SQMemoryStats *stats)
+{
+    stats->usedBytes = ctx->usedBytes;
+    stats->peakBytes = ctx->peakBytes;
+    stats->limitBytes = ctx->limitBytes;
+}
+
+bool sq_vm_check_alloc_limit(SQAllocContext ctx)
+{
+    if (SQ_LIKELY(!ctx->limitExceeded))
+        return true;
+    // report once, the flag is raised again by the next allocation over the limit
+    ctx->limitExceeded = false;
+    return ctx->usedBytes <= ctx->limitBytes;
+}
+
+void sq_vm_init_alloc_context(SQAllocContext *ctx)
+{
+    SQAllocContext c = (SQAllocContext)malloc(sizeof(SQAllocContextT));
+    memset(c, 0, sizeof(SQAllocContextT));
+#if SQ_USE_POOL_ALLOCATOR
+    for (SQUnsignedInteger i = 0; i < SQ_POOL_NUM_CLASSES; i++)
+        c->classes[i].nextSlabSize = SQ_POOL_MIN_SLAB_SIZE;
+#endif
+    *ctx = c;
+}
+
+void sq_vm_destroy_alloc_context(SQAllocContext *ctx)
+{
+    SQAllocContext c = *ctx;
+    if (!c)
+        return;
+#if SQ_USE_POOL_ALLOCATOR
+    SQPoolSlab *slab = c->slabs;
+    while (slab) {
+        SQPoolSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+#endif
+    free(c);
+    *ctx = NULL;
+}
+
 void sq_vm_assign_to_alloc_context(SQAllocContext, HSQUIRRELVM) {}
 
-void *sq_vm_malloc(SQAllocContext SQ_UNUSED_ARG(ctx), SQUnsignedInteger size) {
-    return malloc(size);
+#if SQ_USE_POOL_ALLOCATOR
+
+static inline SQUnsignedInteger sq_pool_class_idx(SQUnsignedInteger size)
+{
+    return size ? ((size - 1) >> SQ_POOL_GRANULARITY_SHIFT) : 0;
+}
+
+static inline SQUnsignedInteger sq_pool_class_size(SQUnsignedInteger idx)
+{
+    return (idx + 1) << SQ_POOL_GRANULARITY_SHIFT;
+}
+
+static void *sq_pool_refill(SQAllocContext ctx, SQUnsignedInteger idx)
+{
+    SQPoolSizeClass &sc = ctx->classes[idx];
+    SQUnsignedInteger blockSize = sq_pool_class_size(idx);
+    SQUnsignedInteger slabSize = sc.nextSlabSize;
+    if (slabSize < SQ_POOL_SLAB_HEADER_SIZE + blockSize * 4)
+        slabSize = SQ_POOL_SLAB_HEADER_SIZE + blockSize * 4;
+
+    SQPoolSlab *slab = (SQPoolSlab *)malloc(slabSize);
+    if (!slab)
+        return NULL;
+    slab->next = ctx->slabs;
+    slab->size = slabSize;
+    ctx->slabs = slab;
+
+    // grow slabs geometrically so that rarely used classes don't waste memory
+    if (sc.nextSlabSize < SQ_POOL_MAX_SLAB_SIZE)
+        sc.nextSlabSize <<= 1;
+
+    char *p = (char *)slab + SQ_POOL_SLAB_HEADER_SIZE;
+    sc.bump = p + blockSize;
+    sc.bumpEnd = p + ((slabSize - SQ_POOL_SLAB_HEADER_SIZE) / blockSize) * blockSize;
+    return p;
+}
+
+static inline void *sq_pool_malloc(SQAllocContext ctx, SQUnsignedInteger size)
+{
+    if (size > SQ_POOL_MAX_BLOCK_SIZE)
+        return malloc(size);
+
+    SQUnsignedInteger idx = sq_pool_class_idx(size);
+    SQPoolSizeClass &sc = ctx->classes[idx];
+    if (SQ_LIKELY(sc.freelist != NULL)) {
+        SQPoolFreeBlock *b = sc.freelist;
+        sc.freelist = b->next;
+        return b;
+    }
+    if (sc.bump != sc.bumpEnd) {
+        void *p = sc.bump;
+        sc.bump += sq_pool_class_size(idx);
+        return p;
+    }
+    return sq_pool_refill(ctx, idx);
+}
+
+static inline void sq_pool_free(SQAllocContext ctx, void *p, SQUnsignedInteger size)
+{
+    if (size > SQ_POOL_MAX_BLOCK_SIZE) {
+        free(p);
+        return;
+    }
+    SQPoolSizeClass &sc = ctx->classes[sq_pool_class_idx(size)];
+    SQPoolFreeBlock *b = (SQPoolFreeBlock *)p;
+    b->next = sc.freelist;
+    sc.freelist = b;
+}
+
+static inline void *sq_pool_realloc(SQAllocContext ctx, void *p, SQUnsignedInteger oldsize, SQUnsignedInteger size)
+{
+    bool oldPooled = oldsize <= SQ_POOL_MAX_BLOCK_SIZE;
+    bool newPooled = size <= SQ_POOL_MAX_BLOCK_SIZE;
+    if (!oldPooled && !newPooled)
+        return realloc(p, size);
+    if (oldPooled && newPooled && sq_pool_class_idx(oldsize) == sq_pool_class_idx(size))
+        return p;
+
+    void *np = sq_pool_malloc(ctx, size);
+    if (!np)
+        return NULL;
+    memcpy(np, p, oldsize < size ? oldsize : size);
+    sq_pool_free(ctx, p, oldsize);
+    return np;
 }
 
-void *sq_vm_realloc(SQAllocContext SQ_UNUSED_ARG(ctx), void *p, SQUnsignedInteger SQ_UNUSED_ARG(oldsize), SQUnsignedInteger size) {
-    return realloc(p, size);
+#else // SQ_USE_POOL_ALLOCATOR
+
+static inline void *sq_pool_malloc(SQAllocContext, SQUnsignedInteger size) { return malloc(size); }
+static inline void sq_pool_free(SQAllocContext, void *p, SQUnsignedInteger) { free(p); }
+static inline void *sq_pool_realloc(SQAllocContext, void *p, SQUnsignedInteger, SQUnsignedInteger size) { return realloc(p, size); }
+
+#endif // SQ_USE_POOL_ALLOCATOR
+
+void *sq_vm_malloc(SQAllocContext ctx, SQUnsignedInteger size)
+{
+    if (!ctx)
+        return malloc(size);
+    sq_account_alloc(ctx, size);
+    return sq_pool_malloc(ctx, size);
+}
+
+void sq_vm_free(SQAllocContext ctx, void *p, SQUnsignedInteger size)
+{
+    if (!p)
+        return;
+    if (!ctx) {
+        free(p);
+        return;
+    }
+    sq_account_free(ctx, size);
+    sq_pool_free(ctx, p, size);
+}
+
+void *sq_vm_realloc(SQAllocContext ctx, void *p, SQUnsignedInteger oldsize, SQUnsignedInteger size)
+{
+    if (!ctx)
+        return realloc(p, size);
+    if (!p)
+        return sq_vm_malloc(ctx, size);
+    sq_account_free(ctx, oldsize);
+    sq_account_alloc(ctx, size);
+    return sq_pool_realloc(ctx, p, oldsize, size);
+}
+
+#endif // SQ_EXCLUDE_DEFAULT_MEMFUNCTIONS
+
+#if defined(SQ_EXCLUDE_DEFAULT_MEMFUNCTIONS) && !defined(SQ_EXCLUDE_DEFAULT_MEMLIMIT_FUNCTIONS)
+
+/*
+* Custom memory functions don't have to keep accounting. Unless the embedder provides
+* the accounting hooks too (and defines SQ_EXCLUDE_DEFAULT_MEMLIMIT_FUNCTIONS), nothing
+* is counted and memory limits are never hit.
+*/
+
+void sq_vm_set_alloc_limit(SQAllocContext SQ_UNUSED_ARG(ctx), SQUnsignedInteger SQ_UNUSED_ARG(limit)) {}
+
+void sq_vm_get_alloc_stats(SQAllocContext SQ_UNUSED_ARG(ctx), SQMemoryStats *stats)
+{
+    memset(stats, 0, sizeof(SQMemoryStats));
 }
 
-void sq_vm_free(SQAllocContext SQ_UNUSED_ARG(ctx), void *p, SQUnsignedInteger SQ_UNUSED_ARG(size)) {
-    free(p);
+bool sq_vm_check_alloc_limit(SQAllocContext SQ_UNUSED_ARG(ctx))
+{
+    return true;
 }
+
 #endif
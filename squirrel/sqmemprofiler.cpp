@@ -0,0 +1,275 @@
+/*
+    see copyright notice in squirrel.h
+*/
+#include "sqpcheader.h"
+#include "sqvm.h"
+#include "sqstring.h"
+#include "sqtable.h"
+#include "sqarray.h"
+#include "sqfuncproto.h"
+#include "sqclosure.h"
+#include "sqclass.h"
+#include "sqmemprofiler.h"
+
+#define hashsite(src, line, type) (hashptr(src) ^ SQHash(line) * 31 ^ SQHash(type))
+#define hashliveptr(p) (SQHash(SQUnsignedInteger(p) >> 4) * SQHash(0x9E3779B97F4A7C15ull))
+
+SQMemProfiler::SQMemProfiler(SQSharedState *ss, SQUnsignedInteger sampleBytes)
+    : _sharedstate(ss)
+    , _alloc_ctx(ss->_alloc_ctx)
+    , _sampleBytes(sampleBytes)
+    , _rand(0x2545F491)
+    , _sites(ss->_alloc_ctx)
+    , _siteBuckets(ss->_alloc_ctx)
+{
+    _bytesUntilSample = NextSampleInterval();
+    _siteBuckets.resize(64, -1);
+    _numLiveSlots = 256;
+    _numLive = 0;
+    _live = (LiveObject *)SQ_MALLOC(_alloc_ctx, _numLiveSlots * sizeof(LiveObject));
+    memset(_live, 0, _numLiveSlots * sizeof(LiveObject));
+}
+
+SQMemProfiler::~SQMemProfiler()
+{
+    SQ_FREE(_alloc_ctx, _live, _numLiveSlots * sizeof(LiveObject));
+}
+
+SQUnsignedInteger SQMemProfiler::NextSampleInterval()
+{
+    if (!_sampleBytes)
+        return 0;
+    // uniform in [1, 2*sample_bytes] - the same mean, but doesn't lock onto periodic allocation patterns
+    _rand ^= _rand << 13;
+    _rand ^= _rand >> 17;
+    _rand ^= _rand << 5;
+    return 1 + SQUnsignedInteger(_rand) % (_sampleBytes * 2);
+}
+
+void SQMemProfiler::GetAllocLocation(SQString *&source, SQInteger &line)
+{
+    source = NULL;
+    line = -1;
+    SQVM *v = _sharedstate->_executingvm;
+    // the root vm is already gone when objects are freed during shared state teardown
+    if (!v && sq_type(_sharedstate->_root_vm) == OT_THREAD)
+        v = _thread(_sharedstate->_root_vm);
+    if (!v)
+        return;
+    // natives like array.map() are attributed to the script line that called them
+    for (SQInteger i = v->_callsstacksize - 1; i >= 0; i--) {
+        SQVM::CallInfo &ci = v->_callsstack[i];
+        if (sq_type(ci._closure) == OT_CLOSURE) {
+            SQFunctionProto *func = _closure(ci._closure)->_function;
+            if (sq_type(func->_sourcename) == OT_STRING)
+                source = _string(func->_sourcename);
+            // _ip already points past the instruction being executed
+            line = func->GetLine(ci._ip > func->_instructions ? ci._ip - 1 : ci._ip);
+            return;
+        }
+    }
+}
+
+uint32_t SQMemProfiler::FindOrAddSite(SQString *source, SQInteger line, SQObjectType type)
+{
+    SQHash h = hashsite(source, line, type) & (_siteBuckets.size() - 1);
+    for (SQInteger idx = _siteBuckets[h]; idx >= 0; idx = _sites[idx].next) {
+        Site &s = _sites[idx];
+        if (s.line == line && s.type == type && (source ? _rawval(s.source) == SQRawObjectVal(source) : sq_isnull(s.source)))
+            return uint32_t(idx);
+    }
+
+    Site &s = _sites.push_back();
+    if (source)
+        s.source = source;
+    s.line = line;
+    s.type = type;
+    s.totalBytes = s.totalCount = 0;
+    s.liveBytes = s.liveCount = 0;
+    s.next = _siteBuckets[h];
+    uint32_t idx = _sites.size() - 1;
+    _siteBuckets[h] = idx;
+
+    if (_sites.size() > _siteBuckets.size()) {
+        _siteBuckets.resize(_siteBuckets.size() * 2);
+        for (SQUnsignedInteger i = 0; i < _siteBuckets.size(); i++)
+            _siteBuckets[i] = -1;
+        for (SQUnsignedInteger i = 0; i < _sites.size(); i++) {
+            Site &rs = _sites[i];
+            SQHash rh = hashsite(sq_isnull(rs.source) ? NULL : _string(rs.source), rs.line, rs.type) & (_siteBuckets.size() - 1);
+            rs.next = _siteBuckets[rh];
+            _siteBuckets[rh] = i;
+        }
+    }
+    return idx;
+}
+
+void SQMemProfiler::OnAlloc(const SQRefCounted *obj, SQObjectType type, SQUnsignedInteger size)
+{
+    double scale = 1.0;
+    if (_sampleBytes) {
+        if (size < _bytesUntilSample) {
+            _bytesUntilSample -= size;
+            return;
+        }
+        _bytesUntilSample = NextSampleInterval();
+        if (size < _sampleBytes)
+            scale = double(_sampleBytes) / double(size ? size : 1);
+    }
+
+    SQString *source;
+    SQInteger line;
+    GetAllocLocation(source, line);
+    uint32_t site = FindOrAddSite(source, line, type);
+    _sites[site].totalBytes += double(size) * scale;
+    _sites[site].totalCount += scale;
+
+    LiveObject lo;
+    lo.obj = obj;
+    lo.type = type;
+    lo.site = site;
+    lo.scale = scale;
+    InsertLive(lo);
+}
+
+void SQMemProfiler::OnFree(const SQRefCounted *obj)
+{
+    if (_numLive == 0)
+        return;
+    LiveObject *lo = FindLive(obj);
+    if (lo)
+        EraseLive(lo);
+}
+
+// Live objects: open addressing with linear probing and backward shift deletion
+
+SQMemProfiler::LiveObject *SQMemProfiler::FindLive(const SQRefCounted *obj)
+{
+    SQUnsignedInteger mask = _numLiveSlots - 1;
+    for (SQUnsignedInteger i = hashliveptr(obj) & mask; _live[i].obj; i = (i + 1) & mask) {
+        if (_live[i].obj == obj)
+            return &_live[i];
+    }
+    return NULL;
+}
+
+void SQMemProfiler::InsertLive(const LiveObject &lo)
+{
+    if ((_numLive + 1) * 4 > _numLiveSlots * 3)
+        GrowLive();
+    SQUnsignedInteger mask = _numLiveSlots - 1;
+    SQUnsignedInteger i = hashliveptr(lo.obj) & mask;
+    while (_live[i].obj) {
+        if (_live[i].obj == lo.obj) { // address reuse of an object freed while not tracked
+            _live[i] = lo;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    _live[i] = lo;
+    _numLive++;
+}
+
+void SQMemProfiler::EraseLive(LiveObject *lo)
+{
+    SQUnsignedInteger mask = _numLiveSlots - 1;
+    SQUnsignedInteger hole = lo - _live;
+    SQUnsignedInteger i = hole;
+    for (;;) {
+        i = (i + 1) & mask;
+        if (!_live[i].obj)
+            break;
+        SQUnsignedInteger home = hashliveptr(_live[i].obj) & mask;
+        // move the entry into the hole if its home position is not between the hole and it
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            _live[hole] = _live[i];
+            hole = i;
+        }
+    }
+    _live[hole].obj = NULL;
+    _numLive--;
+}
+
+void SQMemProfiler::GrowLive()
+{
+    LiveObject *old = _live;
+    SQUnsignedInteger oldSlots = _numLiveSlots;
+    _numLiveSlots *= 2;
+    _live = (LiveObject *)SQ_MALLOC(_alloc_ctx, _numLiveSlots * sizeof(LiveObject));
+    memset(_live, 0, _numLiveSlots * sizeof(LiveObject));
+    _numLive = 0;
+    for (SQUnsignedInteger i = 0; i < oldSlots; i++)
+        if (old[i].obj)
+            InsertLive(old[i]);
+    SQ_FREE(_alloc_ctx, old, oldSlots * sizeof(LiveObject));
+}
+
+SQUnsignedInteger SQMemProfiler::CurrentSize(const SQRefCounted *obj, SQObjectType type)
+{
+    switch (type) {
+        case OT_TABLE:
+            return ((const SQTable *)obj)->MemSize();
+        case OT_ARRAY:
+            return ((const SQArray *)obj)->MemSize();
+        case OT_STRING:
+            return sizeof(SQString) + ((const SQString *)obj)->_len;
+        case OT_CLOSURE:
+            return _CALC_CLOSURE_SIZE(((const SQClosure *)obj)->_function);
+        case OT_INSTANCE:
+            return ((const SQInstance *)obj)->_memsize;
+        default:
+            return 0;
+    }
+}
+
+SQInteger SQMemProfiler::GetReport(SQMemProfileSite *out, SQInteger maxsites)
+{
+    SQInteger nsites = _sites.size();
+    for (SQInteger i = 0; i < nsites; i++)
+        _sites[i].liveBytes = _sites[i].liveCount = 0;
+
+    // objects grow after creation (table nodes, array storage), so sizes are taken now
+    for (SQUnsignedInteger i = 0; i < _numLiveSlots; i++) {
+        const LiveObject &lo = _live[i];
+        if (!lo.obj)
+            continue;
+        Site &s = _sites[lo.site];
+        s.liveBytes += double(CurrentSize(lo.obj, lo.type)) * lo.scale;
+        s.liveCount += lo.scale;
+    }
+
+    // partial selection of the biggest sites, reports are usually small
+    SQInteger nout = nsites < maxsites ? nsites : maxsites;
+    sqvector<SQInteger> order(_alloc_ctx);
+    order.resize(nsites);
+    for (SQInteger i = 0; i < nsites; i++)
+        order[i] = i;
+    for (SQInteger i = 0; i < nout; i++) {
+        SQInteger best = i;
+        for (SQInteger j = i + 1; j < nsites; j++)
+            if (_sites[order[j]].liveBytes > _sites[order[best]].liveBytes)
+                best = j;
+        SQInteger t = order[i]; order[i] = order[best]; order[best] = t;
+
+        const Site &s = _sites[order[i]];
+        SQMemProfileSite &r = out[i];
+        r.source = sq_isstring(s.source) ? _stringval(s.source) : "native";
+        r.line = s.line;
+        r.type = s.type;
+        r.liveBytes = SQUnsignedInteger(s.liveBytes + 0.5);
+        r.liveCount = SQUnsignedInteger(s.liveCount + 0.5);
+        r.totalBytes = SQUnsignedInteger(s.totalBytes + 0.5);
+        r.totalCount = SQUnsignedInteger(s.totalCount + 0.5);
+    }
+    return nsites;
+}
+
+void sq_memprof_alloc(SQSharedState *ss, const SQRefCounted *obj, SQObjectType type, SQUnsignedInteger size)
+{
+    ss->_memprofiler->OnAlloc(obj, type, size);
+}
+
+void sq_memprof_free(SQSharedState *ss, const SQRefCounted *obj)
+{
+    ss->_memprofiler->OnFree(obj);
+}
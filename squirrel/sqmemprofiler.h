@@ -0,0 +1,68 @@
+/*  see copyright notice in squirrel.h */
+#ifndef _SQMEMPROFILER_H_
+#define _SQMEMPROFILER_H_
+
+// Allocation-site memory profiler.
+// Tags tables, arrays, strings, closures and instances with the script source/line
+// they were created at and keeps live objects in a pointer map, so that live memory
+// can be reported grouped by allocation site.
+// With sampling enabled only about one allocation per sample_bytes bytes is recorded
+// and counters are scaled accordingly.
+
+struct SQMemProfiler
+{
+    SQMemProfiler(SQSharedState *ss, SQUnsignedInteger sampleBytes);
+    ~SQMemProfiler();
+
+    void OnAlloc(const SQRefCounted *obj, SQObjectType type, SQUnsignedInteger size);
+    void OnFree(const SQRefCounted *obj);
+
+    SQInteger GetReport(SQMemProfileSite *sites, SQInteger maxsites);
+
+private:
+    struct Site
+    {
+        SQObjectPtr source;
+        SQInteger line;
+        SQObjectType type;
+        double totalBytes;
+        double totalCount;
+        double liveBytes;
+        double liveCount;
+        SQInteger next; // hash chain
+    };
+
+    struct LiveObject
+    {
+        const SQRefCounted *obj;
+        SQObjectType type;
+        uint32_t site;
+        double scale;
+    };
+
+    void GetAllocLocation(SQString *&source, SQInteger &line);
+    uint32_t FindOrAddSite(SQString *source, SQInteger line, SQObjectType type);
+    SQUnsignedInteger NextSampleInterval();
+
+    void InsertLive(const LiveObject &lo);
+    LiveObject *FindLive(const SQRefCounted *obj);
+    void EraseLive(LiveObject *lo);
+    void GrowLive();
+
+    static SQUnsignedInteger CurrentSize(const SQRefCounted *obj, SQObjectType type);
+
+    SQSharedState *_sharedstate;
+    SQAllocContext _alloc_ctx;
+    SQUnsignedInteger _sampleBytes;
+    SQUnsignedInteger _bytesUntilSample;
+    uint32_t _rand;
+
+    sqvector<Site> _sites;
+    sqvector<SQInteger> _siteBuckets;
+
+    LiveObject *_live;
+    SQUnsignedInteger _numLiveSlots; // pow2
+    SQUnsignedInteger _numLive;
+};
+
+#endif //_SQMEMPROFILER_H_
@@ -0,0 +1,125 @@
+/*  see copyright notice in squirrel.h */
+#include <sqnumconv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#define SQNUM_INT_CHARCONV 1
+#endif
+#endif
+
+// floating point to_chars()/from_chars() came years after the integer ones
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define SQNUM_FLOAT_CHARCONV 1
+#endif
+
+SQInteger sqnum_print_integer(char *buf, SQInteger i)
+{
+#ifdef SQNUM_INT_CHARCONV
+    return std::to_chars(buf, buf + SQNUM_BUF_SIZE, i).ptr - buf;
+#else
+    return scsprintf(buf, SQNUM_BUF_SIZE, _PRINT_INT_FMT, i);
+#endif
+}
+
+#ifndef SQNUM_FLOAT_CHARCONV
+// printf() follows the C locale, scripts always get a '.'
+static SQInteger fix_decimal_point(char *buf, int n)
+{
+    for (int i = n - 1; i >= 0; i--)
+        if (buf[i] == ',')
+            buf[i] = '.';
+    return n;
+}
+#endif
+
+SQInteger sqnum_print_float(char *buf, SQFloat f)
+{
+    SQInteger n = sqnum_print_float_fmt(buf, SQNUM_BUF_SIZE, f, 'g', -1);
+    assert(n > 0);
+    return n;
+}
+
+SQInteger sqnum_print_float_fmt(char *buf, SQInteger size, SQFloat f, char conv, int precision)
+{
+    if (precision < 0)
+        precision = 6;
+#ifdef SQNUM_FLOAT_CHARCONV
+    std::chars_format fmt = conv == 'f' ? std::chars_format::fixed :
+        conv == 'e' ? std::chars_format::scientific : std::chars_format::general;
+    // printf() gets floats promoted to double, so does to_chars() to print the same digits
+    std::to_chars_result r = std::to_chars(buf, buf + size, double(f), fmt, precision);
+    if (r.ec != std::errc())
+        return -1;
+    return r.ptr - buf;
+#else
+    char spec[8] = {'%', '.', '*', conv, 0};
+    int n = scsprintf(buf, size, spec, precision, double(f));
+    if (n < 0 || n >= size)
+        return -1;
+    return fix_decimal_point(buf, n);
+#endif
+}
+
+SQInteger sqnum_print_float_roundtrip(char *buf, SQFloat f)
+{
+#ifdef SQNUM_FLOAT_CHARCONV
+    // without a precision to_chars() prints the shortest round trip digits of the type itself
+    std::to_chars_result r = std::to_chars(buf, buf + SQNUM_BUF_SIZE, f);
+    assert(r.ec == std::errc());
+    return r.ptr - buf;
+#else
+    // a double needs at most 17 significant digits, most values get away with far fewer
+    for (int precision = 6; ; precision++) {
+        SQInteger n = sqnum_print_float_fmt(buf, SQNUM_BUF_SIZE, f, 'g', precision);
+        SQFloat back;
+        if (precision >= 17 || (sqnum_parse_float(buf, buf + n, back) && back == f))
+            return n;
+    }
+#endif
+}
+
+bool sqnum_parse_float(const char *begin, const char *end, SQFloat &res)
+{
+#ifdef SQNUM_FLOAT_CHARCONV
+    // strtod() also takes leading spaces, a '+' and hex floats, those and out of range values go the slow way
+    double d;
+    std::from_chars_result fc = std::from_chars(begin, end, d);
+    if (fc.ec == std::errc() && (fc.ptr == end || (*fc.ptr != 'x' && *fc.ptr != 'X'))) {
+        res = SQFloat(d);
+        return true;
+    }
+#endif
+    (void)end;
+    char *e;
+    SQFloat r = SQFloat(strtod(begin, &e));
+    if (begin == e)
+        return false;
+    res = r;
+    return true;
+}
+
+bool sqnum_parse_integer(const char *begin, const char *end, int base, SQInteger &res)
+{
+#ifdef SQNUM_INT_CHARCONV
+    // strtoll() takes leading spaces, a '+' and a 0x prefix with base 16 and saturates on overflow
+    if (base == 10) {
+        SQInteger i;
+        std::from_chars_result fc = std::from_chars(begin, end, i);
+        if (fc.ec == std::errc()) {
+            res = i;
+            return true;
+        }
+    }
+#endif
+    (void)end;
+    char *e;
+    SQInteger r = SQInteger(scstrtol(begin, &e, base));
+    if (begin == e)
+        return false;
+    res = r;
+    return true;
+}
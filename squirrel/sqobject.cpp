@@ -54,10 +54,33 @@ SQObjectPtr::SQObjectPtr(SQVM *vm, const char *str, SQInteger len)
 
 SQString *SQString::Create(SQSharedState *ss,const char *s,SQInteger len)
 {
+    if (len < 0)
+        len = (SQInteger)strlen(s);
+    if (IsLarge(len)) {
+        SQString *str = CreateLarge(ss, len);
+        memcpy(str->_val, s, len);
+        return str;
+    }
     SQString *str=ADD_STRING(ss,s,len);
     return str;
 }
 
+SQString *SQString::CreateInterned(SQSharedState *ss,const char *s,SQInteger len)
+{
+    return ADD_STRING(ss,s,len);
+}
+
+SQString *SQString::CreateLarge(SQSharedState *ss, SQInteger len)
+{
+    assert(IsLarge(len));
+    return ss->_stringtable->AddUninterned(len);
+}
+
+SQString *SQString::Interned()
+{
+    return _interned ? this : _sharedstate->_stringtable->Intern(this);
+}
+
 void SQString::Release()
 {
     REMOVE_STRING(_sharedstate,this);
@@ -204,19 +227,76 @@ bool SQGenerator::Resume(SQVM *v,SQObjectPtr &dest)
 
 void SQArray::Extend(const SQArray *a){
     SQInteger xlen;
-    if((xlen=a->Size()))
-        for(SQInteger i=0;i<xlen;i++)
-            Append(a->_values[i]);
+    if(!(xlen=a->Size()))
+        return;
+#if SQ_PACKED_ARRAYS
+    if (a->IsPacked()) {
+        SQObjectPtr val;
+        a->GetPacked(0, val);
+        if ((IsPacked() && FitsPacked(val)) || (Size() == 0 && StartPacked(val))) {
+            _packed.reserve(_packed.size() + xlen);
+            for(SQInteger i=0;i<xlen;i++)
+                _packed.push_back(a->_packed[i]);
+            return;
+        }
+        for(SQInteger i=0;i<xlen;i++) {
+            a->GetPacked(i, val);
+            Append(val);
+        }
+        return;
+    }
+#endif
+    for(SQInteger i=0;i<xlen;i++)
+        Append(a->_values[i]);
 }
 
+void SQArray::CopyFrom(const SQArray *src)
+{
+#if SQ_PACKED_ARRAYS
+    if (src->IsPacked()) {
+        _values.reset();
+        _packed.copy(src->_packed);
+        _packedtype = src->_packedtype;
+        return;
+    }
+    _packed.reset();
+    _packedtype = OT_NULL;
+    _nopack = src->_nopack;
+#endif
+    _values.copy(src->_values);
+    VT_CLONE_FROM_TO(src, this);
+}
+
+#if SQ_PACKED_ARRAYS
+void SQArray::Unpack()
+{
+    SQInteger n = _packed.size();
+    _values.reserve(_packed.capacity());
+    for (SQInteger i = 0; i < n; i++) {
+        if (_packedtype == OT_INTEGER)
+            _values.push_back(SQObjectPtr(_packed[i].nInteger));
+        else
+            _values.push_back(SQObjectPtr(_packed[i].fFloat));
+    }
+    _packed.reset();
+    _packedtype = OT_NULL;
+    _nopack = true;
+}
+#endif
+
 bool SQArray::IsBinaryEqual(const SQArray *o)
 {
     if (this == o)
         return true;
-    if (_values.size() != o->_values.size())
+    if (Size() != o->Size())
         return false;
-    if (_values.size() == 0)
+    if (Size() == 0)
         return true;
+#if SQ_PACKED_ARRAYS
+    if (IsPacked() || o->IsPacked())
+        return _packedtype == o->_packedtype &&
+            memcmp(_packed._vals, o->_packed._vals, _packed.size() * sizeof(SQObjectValue)) == 0;
+#endif
 
     return memcmp(_values._vals, o->_values._vals, _values.size() * sizeof(SQObjectPtr)) == 0;
 }
@@ -325,6 +405,7 @@ SQInteger SQFunctionProto::GetLine(const SQInstruction *curr, int *hint, bool *i
 
 SQClosure::~SQClosure()
 {
+    SQ_MEMPROF_FREE(_ss(this), this);
     __ObjRelease(_env);
     __ObjRelease(_base);
     REMOVE_FROM_CHAIN(&_ss(this)->_gc_chain,this);
@@ -398,7 +479,7 @@ static bool ReadObject(HSQUIRRELVM v,SQUserPointer up,SQREADFUNC read,SQObjectPt
         SQInteger len;
         _CHECK_IO(SafeRead(v,read,up,&len,sizeof(SQInteger)));
         _CHECK_IO(SafeRead(v,read,up,_ss(v)->GetScratchPad(len),len));
-        o=SQString::Create(_ss(v),_ss(v)->GetScratchPad(-1),len);
+        o=SQString::CreateInterned(_ss(v),_ss(v)->GetScratchPad(-1),len);
                    }
         break;
     case OT_INTEGER:{
@@ -666,6 +747,15 @@ void SQTable::Mark(SQCollectable **chain)
             SQSharedState::MarkObject(_nodes[i].key, chain);
             SQSharedState::MarkObject(_nodes[i].val, chain);
         }
+#if SQ_TABLE_ARRAY_PART
+        for(uint32_t i = 0; i < _arraysize; i++)
+            SQSharedState::MarkObject(_array[i], chain);
+#endif
+#if SQ_TABLE_SHAPES
+        if(_shape)
+            for(uint32_t i = 0; i < _shape->_nkeys; i++)
+                SQSharedState::MarkObject(_slots[i], chain);
+#endif
     END_MARK()
 }
 
@@ -6,6 +6,10 @@
 #include <crtdbg.h>
 #endif
 
+#if defined(_MSC_VER)
+#include <intrin.h> // _umul128, _BitScanForward
+#endif
+
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
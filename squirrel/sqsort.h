@@ -0,0 +1,252 @@
+/*  see copyright notice in squirrel.h */
+#ifndef _SQSORT_H_
+#define _SQSORT_H_
+
+#include <type_traits>
+
+/*
+* Sorting used by array.sort(), sort_stable() and sort_by().
+* sq_pdqsort() is a pattern-defeating quicksort: insertion sort on short ranges, median of 3 pivot
+* (pseudo-median of 9 on long ranges), an early exit for already partitioned ranges, a partition that
+* skips runs of elements equal to the previous pivot and a heap sort fallback once too many partitions
+* came out unbalanced. sq_mergesort() is a stable bottom-up merge sort of insertion sorted runs.
+* The comparator is called as less(a,b) and returns a<b. It may fail (a script compare function raised
+* an error), then it has to keep returning false and the caller checks for the failure afterwards.
+* All loops are bounds checked, so a failed or inconsistent comparator leaves the range in some order
+* but never reads or writes outside of it.
+*/
+
+template<typename T> inline void _SortSwap(T &a, T &b) { T t = a; a = b; b = t; }
+inline void _SortSwap(SQObjectPtr &a, SQObjectPtr &b) { _Swap(a, b); }
+
+template<typename T, typename Less>
+class SQPdqSort
+{
+public:
+    SQPdqSort(T *a, Less &less) : _a(a), _less(less) {}
+    void Sort(SQInteger n)
+    {
+        SQInteger log2 = 0;
+        for (SQInteger i = n; i > 1; i >>= 1)
+            log2++;
+        Loop(0, n, log2, true);
+    }
+private:
+    enum {
+        INSERTION_SORT_THRESHOLD = 24,
+        NINTHER_THRESHOLD = 128,
+        PARTIAL_INSERTION_SORT_LIMIT = 8
+    };
+
+    bool Lt(SQInteger i, SQInteger j) { return _less(_a[i], _a[j]); }
+    void Swap(SQInteger i, SQInteger j) { _SortSwap(_a[i], _a[j]); }
+    void Sort2(SQInteger i, SQInteger j) { if (Lt(j, i)) Swap(i, j); }
+    void Sort3(SQInteger i, SQInteger j, SQInteger k) { Sort2(i, j); Sort2(j, k); Sort2(i, j); }
+
+    void InsertionSort(SQInteger b, SQInteger e)
+    {
+        for (SQInteger i = b + 1; i < e; i++)
+            Insert(b, i);
+    }
+
+    // moves a[i] down into the sorted a[b..i), returns how far it went
+    SQInteger Insert(SQInteger b, SQInteger i)
+    {
+        SQInteger j = i;
+        if (std::is_trivially_copyable<T>::value) {
+            if (!Lt(i, i - 1))
+                return 0;
+            T t = _a[i];
+            do {
+                _a[j] = _a[j - 1];
+                j--;
+            } while (j > b && _less(t, _a[j - 1]));
+            _a[j] = t;
+        }
+        else {
+            for (; j > b && Lt(j, j - 1); j--)
+                Swap(j, j - 1);
+        }
+        return i - j;
+    }
+
+    // gives up once too many elements had to be moved, true if [b,e) got sorted
+    bool PartialInsertionSort(SQInteger b, SQInteger e)
+    {
+        SQInteger moved = 0;
+        for (SQInteger i = b + 1; i < e; i++) {
+            moved += Insert(b, i);
+            if (moved > PARTIAL_INSERTION_SORT_LIMIT)
+                return false;
+        }
+        return true;
+    }
+
+    void SiftDown(SQInteger b, SQInteger root, SQInteger n)
+    {
+        for (;;) {
+            SQInteger child = root * 2 + 1;
+            if (child >= n)
+                return;
+            if (child + 1 < n && Lt(b + child, b + child + 1))
+                child++;
+            if (!Lt(b + root, b + child))
+                return;
+            Swap(b + root, b + child);
+            root = child;
+        }
+    }
+
+    void HeapSort(SQInteger b, SQInteger e)
+    {
+        SQInteger n = e - b;
+        for (SQInteger i = n / 2; i-- > 0; )
+            SiftDown(b, i, n);
+        for (SQInteger i = n - 1; i > 0; i--) {
+            Swap(b, b + i);
+            SiftDown(b, 0, i);
+        }
+    }
+
+    // the pivot is at b, elements less than it end up on its left, returns its final position
+    SQInteger PartitionRight(SQInteger b, SQInteger e, bool &already)
+    {
+        SQInteger first = b, last = e;
+        while (++first < e && Lt(first, b)) {}
+        while (--last > first && !Lt(last, b)) {}
+        already = first >= last;
+        while (first < last) {
+            Swap(first, last);
+            while (++first < e && Lt(first, b)) {}
+            while (--last > first && !Lt(last, b)) {}
+        }
+        Swap(b, first - 1);
+        return first - 1;
+    }
+
+    // the pivot is at b, elements equal to it end up on its left, returns its final position
+    SQInteger PartitionLeft(SQInteger b, SQInteger e)
+    {
+        SQInteger first = b, last = e;
+        while (--last > b && Lt(b, last)) {}
+        while (++first < last && !Lt(b, first)) {}
+        while (first < last) {
+            Swap(first, last);
+            while (--last > first && Lt(b, last)) {}
+            while (++first < last && !Lt(b, first)) {}
+        }
+        Swap(b, last);
+        return last;
+    }
+
+    void Loop(SQInteger b, SQInteger e, SQInteger badallowed, bool leftmost)
+    {
+        for (;;) {
+            SQInteger size = e - b;
+            if (size < INSERTION_SORT_THRESHOLD) {
+                InsertionSort(b, e);
+                return;
+            }
+
+            SQInteger half = size / 2;
+            if (size > NINTHER_THRESHOLD) {
+                Sort3(b, b + half, e - 1);
+                Sort3(b + 1, b + (half - 1), e - 2);
+                Sort3(b + 2, b + (half + 1), e - 3);
+                Sort3(b + (half - 1), b + half, b + (half + 1));
+                Swap(b, b + half);
+            }
+            else
+                Sort3(b + half, b, e - 1);
+
+            // everything here is >= the previous pivot, if the new one equals it skip over the run of equal elements
+            if (!leftmost && !Lt(b - 1, b)) {
+                b = PartitionLeft(b, e) + 1;
+                continue;
+            }
+
+            bool already;
+            SQInteger p = PartitionRight(b, e, already);
+            SQInteger lsize = p - b, rsize = e - (p + 1);
+            if (lsize < size / 8 || rsize < size / 8) {
+                if (--badallowed == 0) {
+                    HeapSort(b, e);
+                    return;
+                }
+                // shuffle a few elements around to break patterns that made the partition unbalanced
+                if (lsize >= INSERTION_SORT_THRESHOLD) {
+                    Swap(b, b + lsize / 4);
+                    Swap(p - 1, p - lsize / 4);
+                    if (lsize > NINTHER_THRESHOLD) {
+                        Swap(b + 1, b + (lsize / 4 + 1));
+                        Swap(b + 2, b + (lsize / 4 + 2));
+                        Swap(p - 2, p - (lsize / 4 + 1));
+                        Swap(p - 3, p - (lsize / 4 + 2));
+                    }
+                }
+                if (rsize >= INSERTION_SORT_THRESHOLD) {
+                    Swap(p + 1, p + (1 + rsize / 4));
+                    Swap(e - 1, e - rsize / 4);
+                    if (rsize > NINTHER_THRESHOLD) {
+                        Swap(p + 2, p + (2 + rsize / 4));
+                        Swap(p + 3, p + (3 + rsize / 4));
+                        Swap(e - 2, e - (1 + rsize / 4));
+                        Swap(e - 3, e - (2 + rsize / 4));
+                    }
+                }
+            }
+            else if (already && PartialInsertionSort(b, p) && PartialInsertionSort(p + 1, e))
+                return;
+
+            Loop(b, p, badallowed, leftmost);
+            b = p + 1;
+            leftmost = false;
+        }
+    }
+
+    T *_a;
+    Less &_less;
+};
+
+template<typename T, typename Less>
+void sq_pdqsort(T *a, SQInteger n, Less &less)
+{
+    if (n > 1)
+        SQPdqSort<T, Less>(a, less).Sort(n);
+}
+
+// tmp has to have room for n elements
+template<typename T, typename Less>
+void sq_mergesort(T *a, T *tmp, SQInteger n, Less &less)
+{
+    const SQInteger RUN = 16;
+    for (SQInteger b = 0; b < n; b += RUN) {
+        SQInteger e = b + RUN < n ? b + RUN : n;
+        for (SQInteger i = b + 1; i < e; i++)
+            for (SQInteger j = i; j > b && less(a[j], a[j - 1]); j--)
+                _SortSwap(a[j], a[j - 1]);
+    }
+
+    T *src = a, *dst = tmp;
+    for (SQInteger width = RUN; width < n; width *= 2) {
+        for (SQInteger b = 0; b < n; b += width * 2) {
+            SQInteger m = b + width < n ? b + width : n;
+            SQInteger e = b + width * 2 < n ? b + width * 2 : n;
+            SQInteger i = b, j = m, k = b;
+            if (m < e && less(src[m], src[m - 1])) {
+                while (i < m && j < e)
+                    dst[k++] = less(src[j], src[i]) ? src[j++] : src[i++];
+            }
+            while (i < m)
+                dst[k++] = src[i++];
+            while (j < e)
+                dst[k++] = src[j++];
+        }
+        T *t = src; src = dst; dst = t;
+    }
+    if (src != a)
+        for (SQInteger i = 0; i < n; i++)
+            a[i] = src[i];
+}
+
+#endif //_SQSORT_H_
@@ -11,6 +11,7 @@
 #include "sqarray.h"
 #include "squserdata.h"
 #include "sqclass.h"
+#include "sqmemprofiler.h"
 
 SQSharedState::SQSharedState(SQAllocContext allocctx) :
     _alloc_ctx(allocctx),
@@ -23,6 +24,7 @@ SQSharedState::SQSharedState(SQAllocContext allocctx) :
     _errorfunc = NULL;
     _lineInfoInExpressions = false;
     _varTraceEnabled = false;
+    _memlimitenabled = false;
     _notifyallexceptions = false;
     _foreignptr = NULL;
     _releasehook = NULL;
@@ -31,6 +33,10 @@ SQSharedState::SQSharedState(SQAllocContext allocctx) :
     rand_seed = 0;
     watchdog_last_alive_time_msec = 0;
     watchdog_threshold_msec = 0;
+    _executingvm = NULL;
+    _memprofiler = NULL;
+    _rootshape = NULL;
+    _lastshapeid = 0;
 }
 
 
@@ -125,6 +131,9 @@ void SQSharedState::Init()
 
     _stringtable = (SQStringTable*)SQ_MALLOC(_alloc_ctx, sizeof(SQStringTable));
     new (_stringtable) SQStringTable(this);
+#if SQ_TABLE_SHAPES
+    _rootshape = SQTableShape::CreateRoot(this);
+#endif
     sq_new(_alloc_ctx, _metamethodnames, SQObjectPtrVec, _alloc_ctx);
     sq_new(_alloc_ctx, _systemstrings, SQObjectPtrVec, _alloc_ctx);
     sq_new(_alloc_ctx, _types, SQObjectPtrVec, _alloc_ctx);
@@ -187,6 +196,11 @@ void SQSharedState::Init()
 SQSharedState::~SQSharedState()
 {
     if(_releasehook) { _releasehook(_thread(_root_vm),_foreignptr,0); _releasehook = NULL; }
+    if(_memprofiler) {
+        SQMemProfiler *prof = _memprofiler;
+        _memprofiler = NULL;
+        sq_delete(_alloc_ctx, prof, SQMemProfiler);
+    }
     _constructorstr.Null();
     _table(_registry)->Finalize();
     _table(_consts)->Finalize();
@@ -240,6 +254,10 @@ SQSharedState::~SQSharedState()
     }
 #endif
 
+#if SQ_TABLE_SHAPES
+    _rootshape->DestroyTree();
+    _rootshape = NULL;
+#endif
     sq_delete(_alloc_ctx, _types, SQObjectPtrVec);
     sq_delete(_alloc_ctx, _systemstrings, SQObjectPtrVec);
     sq_delete(_alloc_ctx, _metamethodnames, SQObjectPtrVec);
@@ -604,9 +622,21 @@ void RefTable::AllocNodes(SQUnsignedInteger size)
 * http://www.lua.org/source/4.0.1/src_lstring.c.html
 */
 
+/*
+* Resizing is incremental: Resize() only allocates the new bucket array, and each
+* Add()/Remove() moves a few buckets from the old one, so that interning doesn't stall
+* on rehashing all strings at once. The table doubles when there are more strings than
+* buckets, and every step moves at least one old bucket, so the migration is always
+* over long before the next resize.
+*/
+#define SQ_STRINGTABLE_REHASH_STEP 8
+
 SQStringTable::SQStringTable(SQSharedState *ss)
 {
     _sharedstate = ss;
+    _oldstrings = NULL;
+    _oldnumofslots = 0;
+    _rehashpos = 0;
     AllocNodes(4);
     _slotused = 0;
 }
@@ -615,6 +645,10 @@ SQStringTable::~SQStringTable()
 {
     SQ_FREE(_sharedstate->_alloc_ctx, _strings,sizeof(SQString*)*_numofslots);
     _strings = NULL;
+    if (_oldstrings) {
+        SQ_FREE(_sharedstate->_alloc_ctx, _oldstrings, sizeof(SQString*)*_oldnumofslots);
+        _oldstrings = NULL;
+    }
 }
 
 void SQStringTable::AllocNodes(SQInteger size)
@@ -624,17 +658,76 @@ void SQStringTable::AllocNodes(SQInteger size)
     memset(_strings,0,sizeof(SQString*)*_numofslots);
 }
 
-SQString *SQStringTable::Add(const char *news,SQInteger len)
+void SQStringTable::RehashStep()
+{
+    SQUnsignedInteger mask = _numofslots - 1;
+    SQUnsignedInteger moved = 0, visited = 0;
+    // empty buckets are cheap to skip, so visit more of them than strings moved
+    while (_rehashpos < _oldnumofslots && moved < SQ_STRINGTABLE_REHASH_STEP && visited < SQ_STRINGTABLE_REHASH_STEP * 4) {
+        SQString *p = _oldstrings[_rehashpos++];
+        while (p) {
+            SQString *next = p->_next;
+            SQHash h = p->_hash & mask;
+            p->_next = _strings[h];
+            _strings[h] = p;
+            p = next;
+            moved++;
+        }
+        visited++;
+    }
+    if (_rehashpos == _oldnumofslots) {
+        SQ_FREE(_sharedstate->_alloc_ctx, _oldstrings, _oldnumofslots*sizeof(SQString*));
+        _oldstrings = NULL;
+        _oldnumofslots = 0;
+        _rehashpos = 0;
+    }
+}
+
+void SQStringTable::FinishRehash()
+{
+    while (_oldstrings)
+        RehashStep();
+}
+
+SQString *SQStringTable::Find(const char *news, SQInteger len, SQHash hash)
 {
-    if(len<0)
-        len = (SQInteger)strlen(news);
-    SQHash newhash = ::_hashstr(news,len);
-    SQHash h = newhash&(_numofslots-1);
     SQString *s;
-    for (s = _strings[h]; s; s = s->_next){
+    if (_oldstrings) {
+        SQHash oh = hash&(_oldnumofslots-1);
+        if (oh >= _rehashpos) {
+            for (s = _oldstrings[oh]; s; s = s->_next){
+                if(s->_len == len && (!memcmp(news,s->_val,len)))
+                    return s; //found in a bucket not migrated yet
+            }
+        }
+    }
+    for (s = _strings[hash&(_numofslots-1)]; s; s = s->_next){
         if(s->_len == len && (!memcmp(news,s->_val,len)))
             return s; //found
     }
+    return NULL;
+}
+
+void SQStringTable::Link(SQString *t)
+{
+    SQHash h = t->_hash&(_numofslots-1);
+    t->_interned = true;
+    t->_next = _strings[h];
+    _strings[h] = t;
+    _slotused++;
+    if (_slotused > _numofslots)  /* too crowded? */
+        Resize(_numofslots*2);
+}
+
+SQString *SQStringTable::Add(const char *news,SQInteger len)
+{
+    if(len<0)
+        len = (SQInteger)strlen(news);
+    if (_oldstrings)
+        RehashStep();
+    SQHash newhash = ::_hashstr(news,len);
+    if (SQString *s = Find(news, len, newhash))
+        return s;
 
     SQString *t = (SQString *)SQ_MALLOC(_sharedstate->_alloc_ctx, len+sizeof(SQString));
     new (t) SQString;
@@ -643,52 +736,86 @@ SQString *SQStringTable::Add(const char *news,SQInteger len)
     t->_val[len] = '\0';
     t->_len = len;
     t->_hash = newhash;
-    t->_next = _strings[h];
-    _strings[h] = t;
-    _slotused++;
-    if (_slotused > _numofslots)  /* too crowded? */
-        Resize(_numofslots*2);
+    t->_hashed = true;
+    Link(t);
+    SQ_MEMPROF_ALLOC(_sharedstate, t, OT_STRING, len+sizeof(SQString));
     return t;
 }
 
+SQString *SQStringTable::AddUninterned(SQInteger len)
+{
+    SQString *t = (SQString *)SQ_MALLOC(_sharedstate->_alloc_ctx, len+sizeof(SQString));
+    new (t) SQString;
+    t->_sharedstate = _sharedstate;
+    t->_next = NULL;
+    t->_val[len] = '\0';
+    t->_len = len;
+    t->_hash = 0;
+    t->_interned = false;
+    t->_hashed = false;
+    SQ_MEMPROF_ALLOC(_sharedstate, t, OT_STRING, len+sizeof(SQString));
+    return t;
+}
+
+SQString *SQStringTable::Intern(SQString *bs)
+{
+    if (bs->_interned)
+        return bs;
+    if (_oldstrings)
+        RehashStep();
+    if (SQString *s = Find(bs->_val, bs->_len, bs->Hash()))
+        return s;
+    Link(bs);
+    return bs;
+}
+
 void SQStringTable::Resize(SQInteger size)
 {
-    SQInteger oldsize=_numofslots;
-    SQString **oldtable=_strings;
+    if (_oldstrings)
+        FinishRehash();
+    _oldstrings = _strings;
+    _oldnumofslots = _numofslots;
+    _rehashpos = 0;
     AllocNodes(size);
-    for (SQInteger i=0; i<oldsize; i++){
-        SQString *p = oldtable[i];
-        while(p){
-            SQString *next = p->_next;
-            SQHash h = p->_hash&(_numofslots-1);
-            p->_next = _strings[h];
-            _strings[h] = p;
-            p = next;
-        }
-    }
-    SQ_FREE(_sharedstate->_alloc_ctx, oldtable, oldsize*sizeof(SQString*));
 }
 
 void SQStringTable::Remove(SQString *bs)
 {
-    SQString *s;
-    SQString *prev=NULL;
-    SQHash h = bs->_hash&(_numofslots - 1);
-
-    for (s = _strings[h]; s; ){
-        if(s == bs){
-            if(prev)
-                prev->_next = s->_next;
-            else
-                _strings[h] = s->_next;
-            _slotused--;
-            SQInteger slen = s->_len;
-            s->~SQString();
-            SQ_FREE(_sharedstate->_alloc_ctx, s, sizeof(SQString) + slen);
-            return;
+    if (!bs->_interned) {
+        FreeString(bs);
+        return;
+    }
+    if (_oldstrings)
+        RehashStep();
+    bool unlinked = false;
+    if (_oldstrings) {
+        // strings added during the resize are in the new buckets even if their old one isn't migrated yet
+        SQHash oh = bs->_hash&(_oldnumofslots - 1);
+        unlinked = oh >= _rehashpos && Unlink(&_oldstrings[oh], bs);
+    }
+    if (!unlinked && !Unlink(&_strings[bs->_hash&(_numofslots - 1)], bs)) {
+        assert(0);//if this fail something is wrong
+        return;
+    }
+    _slotused--;
+    FreeString(bs);
+}
+
+void SQStringTable::FreeString(SQString *bs)
+{
+    SQ_MEMPROF_FREE(_sharedstate, bs);
+    SQInteger slen = bs->_len;
+    bs->~SQString();
+    SQ_FREE(_sharedstate->_alloc_ctx, bs, sizeof(SQString) + slen);
+}
+
+bool SQStringTable::Unlink(SQString **head, SQString *bs)
+{
+    for (SQString **p = head; *p; p = &(*p)->_next) {
+        if (*p == bs) {
+            *p = bs->_next;
+            return true;
         }
-        prev = s;
-        s = s->_next;
     }
-    assert(0);//if this fail something is wrong
+    return false;
 }
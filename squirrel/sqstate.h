@@ -6,19 +6,34 @@
 #include "sqobject.h"
 struct SQString;
 struct SQTable;
+struct SQMemProfiler;
+struct SQTableShape;
 
 struct SQStringTable
 {
     SQStringTable(SQSharedState*ss);
     ~SQStringTable();
     SQString *Add(const char *,SQInteger len);
+    // a string outside of the table, see SQ_STRING_INTERN_LIMIT
+    SQString *AddUninterned(SQInteger len);
+    SQString *Intern(SQString *bs);
     void Remove(SQString *);
 private:
+    SQString *Find(const char *news, SQInteger len, SQHash hash);
+    void Link(SQString *t);
+    void FreeString(SQString *bs);
     void Resize(SQInteger size);
     void AllocNodes(SQInteger size);
+    void RehashStep();
+    void FinishRehash();
+    static bool Unlink(SQString **head, SQString *bs);
     SQString **_strings;
     SQUnsignedInteger _numofslots;
     SQUnsignedInteger _slotused;
+    // buckets not yet moved to _strings while a resize is in progress
+    SQString **_oldstrings;
+    SQUnsignedInteger _oldnumofslots;
+    SQUnsignedInteger _rehashpos;
     SQSharedState *_sharedstate;
 };
 
@@ -53,6 +68,12 @@ private:
 #define ADD_STRING(ss,str,len) ss->_stringtable->Add(str,len)
 #define REMOVE_STRING(ss,bstr) ss->_stringtable->Remove(bstr)
 
+void sq_memprof_alloc(SQSharedState *ss, const SQRefCounted *obj, SQObjectType type, SQUnsignedInteger size);
+void sq_memprof_free(SQSharedState *ss, const SQRefCounted *obj);
+
+#define SQ_MEMPROF_ALLOC(ss,obj,type,size) { if (SQ_UNLIKELY((ss)->_memprofiler != NULL)) sq_memprof_alloc(ss,obj,type,size); }
+#define SQ_MEMPROF_FREE(ss,obj) { if (SQ_UNLIKELY((ss)->_memprofiler != NULL)) sq_memprof_free(ss,obj); }
+
 struct SQObjectPtr;
 
 struct SQSharedState
@@ -94,6 +115,10 @@ public:
     SQCollectable *_gc_chain;
 #endif
     SQObjectPtr _root_vm;
+    SQVM *_executingvm;
+    SQMemProfiler *_memprofiler;
+    SQTableShape *_rootshape;
+    uint64_t _lastshapeid;
 
     // Built-in type classes
     SQObjectPtr _null_class;
@@ -134,6 +159,7 @@ public:
     bool _notifyallexceptions;
     bool _lineInfoInExpressions;
     bool _varTraceEnabled;
+    bool _memlimitenabled;
     SQUnsignedInteger compilationOptions;
     SQUnsignedInteger defaultLangFeatures;
     SQUserPointer _foreignptr;
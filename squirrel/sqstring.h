@@ -42,13 +42,105 @@ inline uint64_t _hashstr_fnv1a_64(const char *s, size_t l)
     result = (result ^ s[l-1]) * 1099511628211LU;
   return result;
 }
+
+/*
+* Full-length hash in the style of wyhash (public domain, Wang Yi).
+* Unlike the functions above it covers every byte, so long strings that differ only in
+* a few characters (paths, generated keys) don't collide. Input is consumed with
+* unaligned 8-byte loads, 48 bytes per iteration in three independent lanes, and each
+* lane is mixed with a 64x64->128 bit multiply.
+*/
+inline void _wymum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = *a;
+  r *= *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  *a = _umul128(*a, *b, b);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+  uint64_t c = t < rl, lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t _wymix(uint64_t a, uint64_t b) { _wymum(&a, &b); return a ^ b; }
+inline uint64_t _wyr8(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+inline uint64_t _wyr4(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+inline uint64_t _wyr3(const unsigned char *p, size_t k) { return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1]; }
+
+inline uint64_t _hashstr_wyhash(const char *s, size_t l)
+{
+  static const uint64_t secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+  const unsigned char *p = (const unsigned char *)s;
+  uint64_t seed = 0xca813bf4c7abf0a9ull; // _wymix(secret[0], secret[1]), i.e. zero seed
+  uint64_t a, b;
+  if (SQ_LIKELY(l <= 16)) {
+    if (SQ_LIKELY(l >= 4)) {
+      a = (_wyr4(p) << 32) | _wyr4(p + ((l >> 3) << 2));
+      b = (_wyr4(p + l - 4) << 32) | _wyr4(p + l - 4 - ((l >> 3) << 2));
+    }
+    else if (l > 0) {
+      a = _wyr3(p, l);
+      b = 0;
+    }
+    else
+      a = b = 0;
+  }
+  else {
+    size_t i = l;
+    if (SQ_UNLIKELY(i >= 48)) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = _wymix(_wyr8(p) ^ secret[1], _wyr8(p + 8) ^ seed);
+        see1 = _wymix(_wyr8(p + 16) ^ secret[2], _wyr8(p + 24) ^ see1);
+        see2 = _wymix(_wyr8(p + 32) ^ secret[3], _wyr8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (SQ_LIKELY(i >= 48));
+      seed ^= see1 ^ see2;
+    }
+    while (SQ_UNLIKELY(i > 16)) {
+      seed = _wymix(_wyr8(p) ^ secret[1], _wyr8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = _wyr8(p + i - 16); // tail overlaps already hashed bytes, l > 16 here
+    b = _wyr8(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  _wymum(&a, &b);
+  return _wymix(a ^ secret[0] ^ l, b ^ secret[1]);
+}
+
 //inline SQHash _hashstr (const char *s, size_t l){return _hashstr_lua5(s, l);}//worst
 //inline SQHash _hashstr (const char *s, size_t l){return _hashstr_djb2(s, l);}//good
+#if SQ_LEGACY_STRING_HASH // sampled, only for compatibility with hash values of older builds
 #ifdef _SQ64//assume we run on 64 bit platform
 inline SQHash _hashstr (const char *s, size_t l){return _hashstr_fnv1a_64(s, l);}
 #else
 inline SQHash _hashstr (const char *s, size_t l){return _hashstr_fnv1a(s, l);}
 #endif
+#else
+inline SQHash _hashstr (const char *s, size_t l){uint64_t h = _hashstr_wyhash(s, l); return SQHash(h ^ (h >> 32));}
+#endif
+
+/*
+* Strings of at least SQ_STRING_INTERN_LIMIT bytes (file contents, results of join() or long
+* concatenations) are not put into the string table: creating them costs no hashing and no
+* table lookup, but two of them with the same contents may be different objects. Their hash is
+* computed on first use. Code that compares strings by pointer has to go through IsEqual() or
+* use Interned(), table keys are always interned.
+*/
+#ifndef SQ_STRING_INTERN_LIMIT
+#define SQ_STRING_INTERN_LIMIT 4096
+#endif
 
 struct SQString : public SQRefCounted
 {
@@ -56,12 +148,37 @@ struct SQString : public SQRefCounted
     ~SQString(){}
 public:
     static SQString *Create(SQSharedState *ss, const char *, SQInteger len = -1 );
+    // always interned, for the compiler and other code that compares the result by pointer
+    static SQString *CreateInterned(SQSharedState *ss, const char *, SQInteger len = -1 );
+    // an uninterned string of len bytes to be filled in place, only for IsLarge() lengths
+    static SQString *CreateLarge(SQSharedState *ss, SQInteger len);
+    static bool IsLarge(SQInteger len) { return len >= SQ_STRING_INTERN_LIMIT; }
     SQInteger Next(const SQObjectPtr &refpos, SQObjectPtr &outkey, SQObjectPtr &outval);
     void Release();
+    // the string table entry with the same contents, this string itself is adopted if there is none
+    SQString *Interned();
+    SQHash Hash()
+    {
+        if (!_hashed) {
+            _hash = _hashstr(_val, _len);
+            _hashed = true;
+        }
+        return _hash;
+    }
+    bool Equals(const SQString *o) const
+    {
+        if (this == o)
+            return true;
+        if ((_interned && o->_interned) || _len != o->_len || (_hashed && o->_hashed && _hash != o->_hash))
+            return false;
+        return memcmp(_val, o->_val, _len) == 0;
+    }
     SQSharedState *_sharedstate;
     SQString *_next; //chain for the string table
     SQInteger _len;
     SQHash _hash;
+    bool _interned;
+    bool _hashed;
     char _val[1];
 };
 
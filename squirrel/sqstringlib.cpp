@@ -1,4 +1,5 @@
 #include <sqstringlib.h>
+#include <sqstrscan.h>
 #include <squirrel.h>
 #include <string.h>
 #include <stdio.h>
@@ -55,33 +56,27 @@ SQInteger _sq_string_rstrip_impl(HSQUIRRELVM v, SQInteger arg_stack_start)
 SQInteger _sq_string_split_by_chars_impl(HSQUIRRELVM v, SQInteger arg_stack_start)
 {
     const char *str,*seps;
-    SQInteger sepsize;
+    SQInteger size,sepsize;
     SQBool skipempty = SQFalse;
-    sq_getstring(v,arg_stack_start,&str);
+    sq_getstringandsize(v,arg_stack_start,&str,&size);
     sq_getstringandsize(v,arg_stack_start+1,&seps,&sepsize);
     if(sepsize == 0) return sq_throwerror(v,"empty separators string");
     if(sq_gettop(v)>arg_stack_start+1) {
         sq_getbool(v,arg_stack_start+2,&skipempty);
     }
+    // the string ends at the first zero char
+    const char *strend = (const char *)memchr(str,'\0',size);
+    if(!strend) strend = str + size;
     const char *start = str;
-    const char *end = str;
+    const char *end;
     sq_newarray(v,0);
-    while(*end != '\0')
+    while((end = sqstr_find_first_of(start,strend,seps,sepsize)) != strend)
     {
-        char cur = *end;
-        for(SQInteger i = 0; i < sepsize; i++)
-        {
-            if(cur == seps[i])
-            {
-                if(!skipempty || (end != start)) {
-                    sq_pushstring(v,start,end-start);
-                    sq_arrayappend(v,-2);
-                }
-                start = end + 1;
-                break;
-            }
+        if(!skipempty || (end != start)) {
+            sq_pushstring(v,start,end-start);
+            sq_arrayappend(v,-2);
         }
-        end++;
+        start = end + 1;
     }
     if(end != start)
     {
@@ -102,6 +97,13 @@ SQInteger _sq_string_escape_impl(HSQUIRRELVM v, SQInteger arg_stack_start)
         return 1;
     }
 
+    const char *end = str + size;
+    const char *run = sqstr_find_escape(str,end);
+    if(run == end) {
+        sq_push(v,arg_stack_start); //nothing escaped
+        return 1;
+    }
+
     const char *escpat = "\\x%02x";
     const SQInteger maxescsize = 4;
 
@@ -110,8 +112,15 @@ SQInteger _sq_string_escape_impl(HSQUIRRELVM v, SQInteger arg_stack_start)
     char c;
     char escch;
     SQInteger escaped = 0;
-    for(int n = 0; n < size; n++){
+    while(str < end){
+        // the chars up to the next one to escape are copied as they are
+        memcpy(dest,str,run-str);
+        dest += run - str;
+        str = run;
+        if(str == end)
+            break;
         c = *str++;
+        run = sqstr_find_escape(str,end);
         escch = 0;
         if(sq_isprint(c) || c == 0) {
             switch(c) {
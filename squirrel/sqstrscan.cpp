@@ -0,0 +1,217 @@
+/*  see copyright notice in squirrel.h */
+#include <sqstrscan.h>
+#include <sq_char_class.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SQSTR_SSE2 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define SQSTR_SSE2 0
+#endif
+
+#if SQSTR_SSE2
+
+#define SQSTR_BLOCK 16
+
+static inline unsigned sqstr_ctz(unsigned x)
+{
+#if !defined(_MSC_VER) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    unsigned long idx;
+    _BitScanForward(&idx, x);
+    return idx;
+#endif
+}
+
+static inline __m128i sqstr_load(const char *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+// chars of c in [lo,hi], both below 0x80: chars from 0x80 up are negative for the signed compares
+static inline __m128i sqstr_in_range(__m128i c, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(char(lo - 1))), _mm_cmplt_epi8(c, _mm_set1_epi8(char(hi + 1))));
+}
+
+#endif // SQSTR_SSE2
+
+const char *sqstr_find(const char *hay, SQInteger hay_len, const char *needle, SQInteger needle_len)
+{
+    if (needle_len > hay_len)
+        return NULL;
+    if (needle_len == 1)
+        return (const char *)memchr(hay, needle[0], hay_len);
+
+    const char *last = hay + hay_len - needle_len; // the last position needle can start at
+    const char *p = hay;
+#if SQSTR_SSE2
+    // candidates have both the first and the last char of needle in place, only those get compared
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i lastc = _mm_set1_epi8(needle[needle_len - 1]);
+    for (; last - p >= SQSTR_BLOCK - 1; p += SQSTR_BLOCK) {
+        __m128i f = _mm_cmpeq_epi8(first, sqstr_load(p));
+        __m128i l = _mm_cmpeq_epi8(lastc, sqstr_load(p + needle_len - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(f, l));
+        while (mask) {
+            const char *c = p + sqstr_ctz(mask);
+            if (memcmp(c + 1, needle + 1, needle_len - 2) == 0)
+                return c;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    while (p <= last) {
+        p = (const char *)memchr(p, needle[0], last - p + 1);
+        if (!p)
+            return NULL;
+        if (p[needle_len - 1] == needle[needle_len - 1] && memcmp(p + 1, needle + 1, needle_len - 2) == 0)
+            return p;
+        p++;
+    }
+    return NULL;
+}
+
+const char *sqstr_find_first_of(const char *s, const char *end, const char *chars, SQInteger nchars)
+{
+    if (nchars == 1) {
+        const char *p = (const char *)memchr(s, chars[0], end - s);
+        return p ? p : end;
+    }
+#if SQSTR_SSE2
+    // a compare per char is cheaper than the table below for the usual few separators
+    if (nchars <= 8) {
+        __m128i c[8];
+        for (SQInteger i = 0; i < nchars; i++)
+            c[i] = _mm_set1_epi8(chars[i]);
+        for (; end - s >= SQSTR_BLOCK; s += SQSTR_BLOCK) {
+            __m128i b = sqstr_load(s);
+            __m128i m = _mm_cmpeq_epi8(b, c[0]);
+            for (SQInteger i = 1; i < nchars; i++)
+                m = _mm_or_si128(m, _mm_cmpeq_epi8(b, c[i]));
+            unsigned mask = (unsigned)_mm_movemask_epi8(m);
+            if (mask)
+                return s + sqstr_ctz(mask);
+        }
+        for (; s < end; s++)
+            if (memchr(chars, *s, nchars))
+                return s;
+        return end;
+    }
+#endif
+    bool table[256];
+    memset(table, 0, sizeof(table));
+    for (SQInteger i = 0; i < nchars; i++)
+        table[(unsigned char)chars[i]] = true;
+    for (; s < end; s++)
+        if (table[(unsigned char)*s])
+            return s;
+    return end;
+}
+
+const char *sqstr_find_space(const char *s, const char *end)
+{
+#if SQSTR_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    for (; end - s >= SQSTR_BLOCK; s += SQSTR_BLOCK) {
+        __m128i b = sqstr_load(s);
+        // '\t' '\n' '\v' '\f' '\r' are 9..13
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(b, space), sqstr_in_range(b, '\t', '\r'));
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask)
+            return s + sqstr_ctz(mask);
+    }
+#endif
+    for (; s < end; s++)
+        if (sq_isspace(*s))
+            return s;
+    return end;
+}
+
+static inline bool sqstr_needs_escape(char c)
+{
+    return !sq_isprint(c) || c == '\\' || c == '\"' || c == '\'';
+}
+
+const char *sqstr_find_escape(const char *s, const char *end)
+{
+#if SQSTR_SSE2
+    const __m128i backslash = _mm_set1_epi8('\\'), dquote = _mm_set1_epi8('\"'), squote = _mm_set1_epi8('\'');
+    for (; end - s >= SQSTR_BLOCK; s += SQSTR_BLOCK) {
+        __m128i b = sqstr_load(s);
+        __m128i m = _mm_andnot_si128(sqstr_in_range(b, 32, 126), _mm_set1_epi8(-1));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, backslash));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, dquote));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, squote));
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask)
+            return s + sqstr_ctz(mask);
+    }
+#endif
+    for (; s < end; s++)
+        if (sqstr_needs_escape(*s))
+            return s;
+    return end;
+}
+
+const char *sqstr_find_json_escape(const char *s, const char *end)
+{
+#if SQSTR_SSE2
+    const __m128i backslash = _mm_set1_epi8('\\'), dquote = _mm_set1_epi8('\"');
+    for (; end - s >= SQSTR_BLOCK; s += SQSTR_BLOCK) {
+        __m128i b = sqstr_load(s);
+        __m128i m = _mm_or_si128(sqstr_in_range(b, 0, 31), _mm_cmpeq_epi8(b, backslash));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(b, dquote));
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask)
+            return s + sqstr_ctz(mask);
+    }
+#endif
+    for (; s < end; s++)
+        if ((unsigned char)*s < 0x20 || *s == '\\' || *s == '\"')
+            return s;
+    return end;
+}
+
+#if SQSTR_SSE2
+// flips the case bit of the chars in [lo,hi]
+static void sqstr_flip_case(char *dst, const char *src, SQInteger len, char lo, char hi)
+{
+    const __m128i bit = _mm_set1_epi8(0x20);
+    SQInteger i = 0;
+    for (; len - i >= SQSTR_BLOCK; i += SQSTR_BLOCK) {
+        __m128i b = sqstr_load(src + i);
+        b = _mm_xor_si128(b, _mm_and_si128(sqstr_in_range(b, lo, hi), bit));
+        _mm_storeu_si128((__m128i *)(dst + i), b);
+    }
+    for (; i < len; i++) {
+        char c = src[i];
+        dst[i] = (c >= lo && c <= hi) ? char(c ^ 0x20) : c;
+    }
+}
+#endif
+
+void sqstr_tolower(char *dst, const char *src, SQInteger len)
+{
+#if SQSTR_SSE2
+    sqstr_flip_case(dst, src, len, 'A', 'Z');
+#else
+    for (SQInteger i = 0; i < len; i++)
+        dst[i] = (char)sq_tolower(src[i]);
+#endif
+}
+
+void sqstr_toupper(char *dst, const char *src, SQInteger len)
+{
+#if SQSTR_SSE2
+    sqstr_flip_case(dst, src, len, 'a', 'z');
+#else
+    for (SQInteger i = 0; i < len; i++)
+        dst[i] = (char)sq_toupper(src[i]);
+#endif
+}
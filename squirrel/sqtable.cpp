@@ -34,13 +34,45 @@ static inline uint64_t class_type_hash_update_4(uint64_t hashval, uint32_t x) {
     return hashval;
 }
 
+// Tables with the same string keys inserted in the same order into the same positions share the id,
+// so a key position cached by _OP_GET_LITERAL/_OP_SET_LITERAL for one of them is valid for all.
+static inline uint64_t class_type_id_update(uint64_t classTypeId, uint32_t usedNodes, uint32_t numOfNodesMinusOne,
+                                            const SQObjectPtr &key, uint32_t insertPos)
+{
+    if (!sq_isstring(key) || numOfNodesMinusOne >= (1<<TBL_CLASS_TYPE_MEMBER_BITS))
+        return 0;
+    if (classTypeId == 0 && usedNodes != 0)
+        return 0;
+
+    classTypeId = class_type_hash_update_1(classTypeId ? classTypeId : CLASS_TYPE_HASH_INIT, uint8_t(insertPos));
+
+    // Use SQString address as identifier, strings are unique, immutable and strored in a table.
+    // That means that all script strings share the same reference to SQString.
+    // 32 provides more than realistic address range.
+    uint32_t strIdBits = uint32_t( (uintptr_t(_string(key)) >> 3) & 0xFFFFFFFF );
+    return class_type_hash_update_4(classTypeId, strIdBits);
+}
+
 
 SQTable::SQTable(SQSharedState *ss,SQInteger nInitialSize)
     : _alloc_ctx(ss->_alloc_ctx)
     , _classTypeId(0)
 {
+#if SQ_TABLE_ARRAY_PART
+    _array = NULL;
+    _arraysize = 0;
+    _arrayused = 0;
+#endif
+#if SQ_TABLE_SHAPES
+    _shape = NULL;
+    _slots = NULL;
+    _slotscap = 0;
+#endif
     SQInteger pow2size=MINPOWER2;
     while(nInitialSize>pow2size)pow2size=pow2size<<1;
+#if SQ_SWISS_TABLE
+    while(MaxUsedNodes(uint32_t(pow2size)) < nInitialSize)pow2size=pow2size<<1;
+#endif
     AllocNodes(pow2size);
     _usednodes = 0;
     _delegate = NULL;
@@ -48,43 +80,350 @@ SQTable::SQTable(SQSharedState *ss,SQInteger nInitialSize)
     ADD_TO_CHAIN(&_sharedstate->_gc_chain,this);
 }
 
-void SQTable::Remove(const SQObjectPtr &key)
+SQTable *SQTable::CreateLiteral(SQSharedState *ss, SQInteger nkeys)
+{
+#if SQ_TABLE_SHAPES
+    SQTable *t = Create(ss, 0);
+    if (nkeys > SQInteger(SQ_TBL_MAX_SHAPE_KEYS))
+        nkeys = SQ_TBL_MAX_SHAPE_KEYS;
+    t->_shape = ss->_rootshape;
+    t->AllocSlots(uint32_t(nkeys));
+    return t;
+#else
+    return Create(ss, nkeys ? nkeys + 1 : 0);
+#endif
+}
+
+#if SQ_TABLE_SHAPES
+SQTableShape *SQTableShape::Alloc(SQSharedState *ss, uint32_t nkeys)
+{
+    SQTableShape *shape = (SQTableShape *)SQ_MALLOC(ss->_alloc_ctx, AllocSize(nkeys));
+    new (&shape->_lastkey) SQObjectPtr;
+    shape->_id = ++ss->_lastshapeid << TBL_CLASS_TYPE_MEMBER_BITS;
+    shape->_keymask = 0;
+    shape->_nkeys = nkeys;
+    shape->_nchildren = 0;
+    shape->_ss = ss;
+    shape->_children = NULL;
+    shape->_nextsibling = NULL;
+    return shape;
+}
+
+SQTableShape *SQTableShape::CreateRoot(SQSharedState *ss)
+{
+    return Alloc(ss, 0);
+}
+
+SQTableShape *SQTableShape::Transition(SQString *key)
+{
+    for (SQTableShape *c = _children; c; c = c->_nextsibling)
+        if (c->_keys[_nkeys] == key)
+            return c;
+    if (_nkeys >= SQ_TBL_MAX_SHAPE_KEYS || _nchildren >= SQ_TBL_MAX_SHAPE_TRANSITIONS
+        || _ss->_lastshapeid >= SQ_TBL_MAX_SHAPES)
+        return NULL;
+
+    SQTableShape *c = Alloc(_ss, _nkeys + 1);
+    memcpy(c->_keys, _keys, _nkeys * sizeof(SQString *));
+    c->_keys[_nkeys] = key;
+    c->_lastkey = key;
+    c->_keymask = _keymask | (uint64_t(1) << (key->_hash & 63));
+    c->_nextsibling = _children;
+    _children = c;
+    _nchildren++;
+    return c;
+}
+
+void SQTableShape::DestroyTree()
+{
+    for (SQTableShape *c = _children, *next; c; c = next) {
+        next = c->_nextsibling;
+        c->DestroyTree();
+    }
+    SQAllocContext ctx = _ss->_alloc_ctx;
+    _lastkey.~SQObjectPtr();
+    SQ_FREE(ctx, this, AllocSize(_nkeys));
+}
+
+void SQTable::AllocSlots(uint32_t cap)
+{
+    _slots = NULL;
+    if (cap)
+        _slots = (SQObjectPtr *)SQ_MALLOC(_alloc_ctx, cap * sizeof(SQObjectPtr));
+    for (uint32_t i = 0; i < cap; i++)
+        new (&_slots[i]) SQObjectPtr;
+    _slotscap = cap;
+}
+
+void SQTable::FreeSlots(SQObjectPtr *slots, uint32_t cap)
+{
+    for (uint32_t i = 0; i < cap; i++)
+        slots[i].~SQObjectPtr();
+    if (slots)
+        SQ_FREE(_alloc_ctx, slots, cap * sizeof(SQObjectPtr));
+}
+
+void SQTable::ReleaseShape()
+{
+    if (!_shape)
+        return;
+    FreeSlots(_slots, _slotscap);
+    _slots = NULL;
+    _slotscap = 0;
+    _shape = NULL;
+}
+
+// the table stops using shapes, string keys move to the hash part
+void SQTable::DropShape()
+{
+    SQTableShape *shape = _shape;
+    SQObjectPtr *slots = _slots;
+    uint32_t cap = _slotscap;
+    _shape = NULL;
+    _slots = NULL;
+    _slotscap = 0;
+    for (uint32_t i = 0; i < shape->_nkeys; i++)
+        _HashNewSlot(SQObjectPtr(shape->_keys[i]), slots[i]);
+    FreeSlots(slots, cap);
+}
+
+bool SQTable::_ShapeNewSlot(const SQObjectPtr &key, const SQObjectPtr &val)
+{
+    SQString *skey = _string(key);
+    int32_t idx = _shape->Find(skey);
+    if (idx >= 0) {
+        _slots[idx] = val;
+        return false;
+    }
+    SQTableShape *next = _shape->Transition(skey);
+    if (!next) {
+        DropShape();
+        return _HashNewSlot(key, val);
+    }
+    uint32_t n = _shape->_nkeys;
+    if (n == _slotscap) {
+        SQObjectPtr *old = _slots;
+        uint32_t oldcap = _slotscap;
+        uint32_t cap = oldcap ? oldcap * 2 : 4;
+        if (cap > SQ_TBL_MAX_SHAPE_KEYS)
+            cap = SQ_TBL_MAX_SHAPE_KEYS;
+        AllocSlots(cap);
+        for (uint32_t i = 0; i < n; i++)
+            _slots[i] = old[i];
+        FreeSlots(old, oldcap);
+    }
+    _slots[n] = val;
+    _shape = next;
+    return true;
+}
+
+bool SQTable::_GetShapeStr(const char *key, SQInteger keylen, SQObjectPtr &val) const
 {
-    _HashNode *n = _Get(key, HashObj(key) & _numofnodes_minus_one);
+    if (!_shape)
+        return false;
+    for (uint32_t i = 0; i < _shape->_nkeys; i++) {
+        const SQString *k = _shape->_keys[i];
+        if (k->_len == keylen && strncmp(k->_val, key, keylen) == 0) {
+            val = _realval(_slots[i]);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#if SQ_ORDERED_TABLE
+void SQTable::_HashRemove(const SQObjectPtr &key)
+{
+    uint32_t mask = IndexMask();
+    uint32_t pos = IndexHash(HashObj(key)) & mask;
+    _HashNode *n = NULL;
+    for (uint32_t e; (e = _index[pos]) != 0; pos = (pos + 1) & mask) {
+        _HashNode *c = &_nodes[e - 1];
+        if (_rawval(c->key) == _rawval(key) && sq_type(c->key) == sq_type(key)) {
+            n = c;
+            break;
+        }
+    }
+    if (!n)
+        return;
+
+    // backward shift deletion keeps the index free of tombstones
+    uint32_t hole = pos;
+    for (uint32_t i = (pos + 1) & mask, e; (e = _index[i]) != 0; i = (i + 1) & mask) {
+        uint32_t home = IndexHash(HashObj(_nodes[e - 1].key)) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            _index[hole] = e;
+            hole = i;
+        }
+    }
+    _index[hole] = 0;
+
+    // the entry itself stays behind as a free slot, so iteration positions don't move
+    n->val.Null();
+    n->key.Null();
+    n->key._type = OT_FREE_TABLE_SLOT;
+    VT_CLEAR_SINGLE(n);
+    while (_entriesend && (sq_type(_nodes[_entriesend - 1].key) & OT_FREE_TABLE_SLOT))
+        _entriesend--;
+    _usednodes--;
+    Rehash(false);
+    _classTypeId = 0;
+}
+#else
+void SQTable::_HashRemove(const SQObjectPtr &key)
+{
+    _HashNode *n = _Get(key, HashObj(key));
     if (n) {
         n->val.Null();
         n->key.Null();
         n->key._type = OT_FREE_TABLE_SLOT;
         VT_CLEAR_SINGLE(n);
+#if SQ_SWISS_TABLE
+        // a table that fits in one group is always probed as a whole, so the slot may become empty,
+        // bigger ones need a tombstone to keep probe sequences going through it
+        if (_numofnodes_minus_one < SQ_TBL_GROUP_WIDTH) {
+            SetCtrl(uint32_t(n - _nodes), SQ_TBL_CTRL_EMPTY);
+            _growthleft++;
+        }
+        else
+            SetCtrl(uint32_t(n - _nodes), SQ_TBL_CTRL_DELETED);
+#endif
         _usednodes--;
         Rehash(false);
         _classTypeId = 0;
     }
 }
+#endif
 
 void SQTable::AllocNodes(SQInteger nSize)
 {
     assert((nSize & (nSize-1)) == 0); // pow2
-    _HashNode *nodes=(_HashNode *)SQ_MALLOC(_alloc_ctx, sizeof(_HashNode)*nSize);
+    _HashNode *nodes=(_HashNode *)SQ_MALLOC(_alloc_ctx, NodesAllocSize(nSize));
     _numofnodes_minus_one=(uint32_t)(nSize-1);
     _nodes=nodes;
+#if SQ_SWISS_TABLE
+    _ctrl=(uint8_t *)(nodes + nSize);
+    memset(_ctrl, SQ_TBL_CTRL_EMPTY, nSize + SQ_TBL_GROUP_WIDTH);
+    _growthleft=MaxUsedNodes(uint32_t(nSize));
+#elif SQ_ORDERED_TABLE
+    _index=(uint32_t *)(nodes + nSize);
+    memset(_index, 0, nSize * 2 * sizeof(uint32_t));
+    _entriesend=0;
+#else
     _firstfree=&_nodes[_numofnodes_minus_one];
+#endif
     for (_HashNode *i = nodes, *e = i + nSize; i != e; i++)
         new (i) _HashNode;
 }
 
-void SQTable::Rehash(bool force)
+#if SQ_TABLE_ARRAY_PART
+static inline uint32_t array_key_bin(uint32_t k)
+{
+    // 0 for key 0, i for keys in [2^(i-1), 2^i)
+    if (k == 0)
+        return 0;
+#if !defined(_MSC_VER) || defined(__clang__)
+    return 32 - __builtin_clz(k);
+#else
+    unsigned long log2;
+    _BitScanReverse(&log2, k);
+    return log2 + 1;
+#endif
+}
+
+void SQTable::AllocArray(uint32_t size)
+{
+    _array = NULL;
+    if (size)
+        _array = (SQObjectPtr *)SQ_MALLOC(_alloc_ctx, size * sizeof(SQObjectPtr));
+    for (uint32_t i = 0; i < size; i++) {
+        new (&_array[i]) SQObjectPtr;
+        _array[i]._type = OT_FREE_TABLE_SLOT;
+    }
+    _arraysize = size;
+    _arrayused = 0;
+}
+
+void SQTable::FreeArray(SQObjectPtr *arr, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+        arr[i].~SQObjectPtr();
+    if (arr)
+        SQ_FREE(_alloc_ctx, arr, size * sizeof(SQObjectPtr));
+}
+
+// the biggest power of 2 for which more than a half of keys 0..n-1 would be used, inarray gets their count
+uint32_t SQTable::ComputeArraySize(const SQObjectPtr *newkey, uint32_t &inarray) const
+{
+    uint32_t nums[SQ_TBL_MAX_ARRAY_BITS + 1];
+    memset(nums, 0, sizeof(nums));
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < _arraysize; i++) {
+        if (!(sq_type(_array[i]) & OT_FREE_TABLE_SLOT)) {
+            nums[array_key_bin(i)]++;
+            total++;
+        }
+    }
+    for (uint32_t i = 0; i <= _numofnodes_minus_one; i++) {
+        const SQObjectPtr &k = _nodes[i].key;
+        if (sq_type(k) == OT_INTEGER && SQUnsignedInteger(_integer(k)) < (SQUnsignedInteger(1) << SQ_TBL_MAX_ARRAY_BITS)) {
+            nums[array_key_bin(uint32_t(_integer(k)))]++;
+            total++;
+        }
+    }
+    bool newint = newkey && sq_type(*newkey) == OT_INTEGER &&
+        SQUnsignedInteger(_integer(*newkey)) < (SQUnsignedInteger(1) << SQ_TBL_MAX_ARRAY_BITS);
+    if (newint) {
+        nums[array_key_bin(uint32_t(_integer(*newkey)))]++;
+        total++;
+    }
+
+    uint32_t size = 0, a = 0, na = 0;
+    for (uint32_t i = 0, twotoi = 1; i <= SQ_TBL_MAX_ARRAY_BITS && twotoi / 2 < total; i++, twotoi <<= 1) {
+        a += nums[i];
+        if (a > twotoi / 2) {
+            size = twotoi;
+            na = a;
+        }
+    }
+    if (newint && SQUnsignedInteger(_integer(*newkey)) < size)
+        na--;
+    inarray = na;
+    return size;
+}
+#endif
+
+void SQTable::Rehash(bool force, const SQObjectPtr *newkey)
 {
     SQInteger oldsize=_numofnodes_minus_one+1;
     //prevent problems with the integer division
     if (oldsize < MINPOWER2) oldsize = MINPOWER2;
-    _HashNode *nold=_nodes;
-    SQInteger nelems=CountUsed();
+    SQInteger nelems=_usednodes;
+#if SQ_TABLE_ARRAY_PART
+    uint32_t newarraysize = _arraysize;
+    if (force) {
+        uint32_t inarray;
+        newarraysize = ComputeArraySize(newkey, inarray);
+        if (newarraysize != _arraysize) {
+            nelems = _usednodes + _arrayused - inarray;
+            if (newkey && !(sq_type(*newkey) == OT_INTEGER && SQUnsignedInteger(_integer(*newkey)) < newarraysize))
+                nelems++;
+        }
+    }
+    if (newarraysize != _arraysize) // keys migrate between the parts, the hash part is rebuilt for what is left
+        Resize(MinNodes(nelems), newarraysize);
+    else
+#endif
     if (nelems >= oldsize - oldsize/4)  /* using more than 3/4? */
-        AllocNodes(oldsize*2);
+        Resize(oldsize*2 SQ_TBL_ARRAY_ARG(_arraysize));
     else if (nelems < oldsize/4 &&  /* less than 1/4? */
         oldsize > MINPOWER2)
-        AllocNodes(oldsize/2);
+        Resize(oldsize/2 SQ_TBL_ARRAY_ARG(_arraysize));
+#if !SQ_CHAINED_TABLE
+    else if (force) // out of free slots because of removed ones, rebuild at the same size
+        Resize(oldsize SQ_TBL_ARRAY_ARG(_arraysize));
+#else
     else if (force)
     {
         assert(oldsize > 0);
@@ -94,27 +433,145 @@ void SQTable::Rehash(bool force)
         unsigned long log2;
         _BitScanReverse(&log2, oldsize);
 #endif
-        AllocNodes(unsigned(1 << (log2 + 1)));
+        Resize(SQInteger(1) << (log2 + 1) SQ_TBL_ARRAY_ARG(_arraysize));
         assert(_numofnodes_minus_one + 1 > oldsize);
     }
-    else
-        return;
+#endif
+}
+
+#if SQ_TABLE_ARRAY_PART
+// called when less than a quarter of the array part is used, keys that don't fit the smaller one go to the hash part
+void SQTable::ShrinkArray()
+{
+    uint32_t inarray;
+    uint32_t newarraysize = ComputeArraySize(NULL, inarray);
+    if (newarraysize < _arraysize)
+        Resize(MinNodes(_usednodes + _arrayused - inarray), newarraysize);
+}
+#endif
+
+void SQTable::Compact()
+{
+#if SQ_TABLE_SHAPES
+    if (_shape && _slotscap > _shape->_nkeys) {
+        SQObjectPtr *old = _slots;
+        uint32_t oldcap = _slotscap;
+        AllocSlots(_shape->_nkeys);
+        for (uint32_t i = 0; i < _shape->_nkeys; i++)
+            _slots[i] = old[i];
+        FreeSlots(old, oldcap);
+    }
+#endif
+    SQInteger nelems = _usednodes;
+#if SQ_TABLE_ARRAY_PART
+    uint32_t inarray;
+    uint32_t newarraysize = ComputeArraySize(NULL, inarray);
+    if (newarraysize != _arraysize)
+        nelems = _usednodes + _arrayused - inarray;
+#endif
+    SQInteger newsize = MinNodes(nelems);
+    bool rebuild = newsize < SQInteger(_numofnodes_minus_one) + 1;
+#if SQ_TABLE_ARRAY_PART
+    rebuild = rebuild || newarraysize != _arraysize;
+#endif
+#if SQ_ORDERED_TABLE
+    rebuild = rebuild || _entriesend != _usednodes; // removed entries leave holes
+#endif
+    if (rebuild)
+        Resize(newsize SQ_TBL_ARRAY_ARG(newarraysize));
+}
+
+// smallest hash part that keeps the load under 3/4
+SQInteger SQTable::MinNodes(SQInteger nelems)
+{
+    SQInteger size = MINPOWER2;
+    while (nelems >= size - size/4)
+        size <<= 1;
+    return size;
+}
+
+// rebuilds the table with the given number of nodes (and array part size), keys are reinserted
+void SQTable::Resize(SQInteger newsize SQ_TBL_ARRAY_ARG(uint32_t newarraysize))
+{
+    SQInteger oldsize=_numofnodes_minus_one+1;
+    _HashNode *nold=_nodes;
+#if SQ_TABLE_ARRAY_PART
+    SQObjectPtr *oldarray = _array;
+    uint32_t oldarraysize = _arraysize;
+#endif
+    AllocNodes(newsize);
     _usednodes = 0;
+#if SQ_TABLE_ARRAY_PART
+    if (newarraysize != oldarraysize) {
+        AllocArray(newarraysize);
+        for (uint32_t i = 0; i < oldarraysize; i++)
+            if (!(sq_type(oldarray[i]) & OT_FREE_TABLE_SLOT))
+                NewSlot(SQObjectPtr(SQInteger(i)), oldarray[i]);
+        FreeArray(oldarray, oldarraysize);
+    }
+#endif
     for (SQInteger i=0; i<oldsize; i++) {
         _HashNode *old = nold+i;
         if (!(sq_type(old->key) & OT_FREE_TABLE_SLOT))
+#if SQ_ORDERED_TABLE && SQ_TABLE_ARRAY_PART // keys are known to be unique, entries keep their order
+            if (newarraysize == oldarraysize)
+                _Append(old->key, old->val, HashObj(old->key));
+            else
+                NewSlot(old->key,old->val);
+#elif SQ_ORDERED_TABLE
+            _Append(old->key, old->val, HashObj(old->key)  VT_REF(old));
+#else
             NewSlot(old->key,old->val  VT_REF(old));
+#endif
     }
     for(SQInteger k=0;k<oldsize;k++)
         nold[k].~_HashNode();
-    SQ_FREE(_alloc_ctx, nold, oldsize*sizeof(_HashNode));
+    SQ_FREE(_alloc_ctx, nold, NodesAllocSize(oldsize));
 }
 
 SQTable *SQTable::Clone()
 {
     const uint32_t cnt = _numofnodes_minus_one+1;
+#if SQ_SWISS_TABLE && defined(_FAST_CLONE)
+    // slots are copied as is, so the clone needs exactly the same number of them
+    SQTable *__restrict nt=Create(_opt_ss(this), 0);
+    if (nt->_numofnodes_minus_one + 1 != cnt) {
+        nt->_nodes->~_HashNode();
+        SQ_FREE(_alloc_ctx, nt->_nodes, NodesAllocSize(nt->_numofnodes_minus_one + 1));
+        nt->AllocNodes(cnt);
+    }
+    _HashNode *__restrict src = _nodes;
+    _HashNode *__restrict dst = nt->_nodes;
+    for(_HashNode *__restrict srcE=src + cnt; src != srcE; src++, dst++) {
+        dst->key = src->key;
+        dst->val = src->val;
+        VT_COPY_SINGLE(src, dst);
+        VT_TRACE_SINGLE(dst, dst->val, _ss(this)->_root_vm);
+    }
+    memcpy(nt->_ctrl, _ctrl, cnt + SQ_TBL_GROUP_WIDTH);
+    nt->_growthleft = _growthleft;
+    nt->_usednodes = _usednodes;
+#elif SQ_ORDERED_TABLE && defined(_FAST_CLONE)
+    // entries and index are copied as is, so the clone needs exactly the same number of them
+    SQTable *__restrict nt=Create(_opt_ss(this), 0);
+    if (nt->_numofnodes_minus_one + 1 != cnt) {
+        nt->_nodes->~_HashNode();
+        SQ_FREE(_alloc_ctx, nt->_nodes, NodesAllocSize(nt->_numofnodes_minus_one + 1));
+        nt->AllocNodes(cnt);
+    }
+    _HashNode *__restrict src = _nodes;
+    _HashNode *__restrict dst = nt->_nodes;
+    for(_HashNode *__restrict srcE=src + _entriesend; src != srcE; src++, dst++) {
+        dst->key = src->key;
+        dst->val = src->val;
+        VT_COPY_SINGLE(src, dst);
+        VT_TRACE_SINGLE(dst, dst->val, _ss(this)->_root_vm);
+    }
+    memcpy(nt->_index, _index, cnt * 2 * sizeof(uint32_t));
+    nt->_entriesend = _entriesend;
+    nt->_usednodes = _usednodes;
+#elif defined(_FAST_CLONE)
     SQTable *__restrict nt=Create(_opt_ss(this), cnt);
-#ifdef _FAST_CLONE
     _HashNode *__restrict basesrc = _nodes;
     _HashNode *__restrict basedst = nt->_nodes;
     _HashNode *__restrict src = _nodes;
@@ -135,27 +592,84 @@ SQTable *SQTable::Clone()
     nt->_firstfree = basedst + (_firstfree - basesrc);
     nt->_usednodes = _usednodes;
 #else
+    SQTable *__restrict nt=Create(_opt_ss(this), cnt);
     SQInteger ridx=0;
     SQObjectPtr key,val;
     while((ridx=Next(true,ridx,key,val))!=-1){
         nt->NewSlot(key,val VT_CODE(VT_COMMA &_nodes[ridx].varTrace));
     }
+#endif
+#if SQ_TABLE_SHAPES && defined(_FAST_CLONE)
+    if (_shape) {
+        nt->_shape = _shape;
+        nt->AllocSlots(_shape->_nkeys);
+        for (uint32_t i = 0; i < _shape->_nkeys; i++)
+            nt->_slots[i] = _slots[i];
+    }
+#endif
+#if SQ_TABLE_ARRAY_PART && defined(_FAST_CLONE)
+    if (_arraysize) {
+        nt->AllocArray(_arraysize);
+        for (uint32_t i = 0; i < _arraysize; i++)
+            nt->_array[i] = _array[i];
+        nt->_arrayused = _arrayused;
+    }
 #endif
     nt->_classTypeId = _classTypeId;
     nt->SetDelegate(_delegate);
     return nt;
 }
 
+// weak references become the objects they point to, as copying through Get()/NewSlot() does
+void SQTable::ResolveWeakRefs()
+{
+#if SQ_TABLE_ARRAY_PART
+    for (uint32_t i = 0; i < _arraysize; i++)
+        if (sq_type(_array[i]) == OT_WEAKREF)
+            _array[i] = _realval(_array[i]);
+#endif
+#if SQ_TABLE_SHAPES
+    for (uint32_t i = 0; _shape && i < _shape->_nkeys; i++)
+        if (sq_type(_slots[i]) == OT_WEAKREF)
+            _slots[i] = _realval(_slots[i]);
+#endif
+    for (uint32_t i = 0; i <= _numofnodes_minus_one; i++) {
+        _HashNode &n = _nodes[i];
+        if (!(sq_type(n.key) & OT_FREE_TABLE_SLOT) && sq_type(n.val) == OT_WEAKREF) {
+            n.val = _realval(n.val);
+            VT_TRACE_SINGLE(&n, n.val, _ss(this)->_root_vm);
+        }
+    }
+}
+
 SQTable::_HashNode *SQTable::_Get(const SQObjectPtr &key) const
 {
+    if (SQ_UNLIKELY(_IsUninternedKey(key)))
+        return _Get(SQObjectPtr(_string(key)->Interned()));
     if (sq_type(key) == OT_STRING)
-        return _GetStr(_rawval(key), _string(key)->_hash & _numofnodes_minus_one);
+        return _GetStr(_rawval(key), _string(key)->_hash);
     else
-        return _Get(key, HashObj(key) & _numofnodes_minus_one);
+        return _Get(key, HashObj(key));
 }
 
 bool SQTable::Get(const SQObjectPtr &key,SQObjectPtr &val) const
 {
+    if (SQ_UNLIKELY(_IsUninternedKey(key)))
+        return Get(SQObjectPtr(_string(key)->Interned()), val);
+#if SQ_TABLE_ARRAY_PART
+    if (const SQObjectPtr *slot = _ArraySlot(key)) {
+        if (sq_type(*slot) & OT_FREE_TABLE_SLOT)
+            return false;
+        val = _realval(*slot);
+        return true;
+    }
+#endif
+#if SQ_TABLE_SHAPES
+    if (const SQObjectPtr *slot = _ShapeSlot(key)) {
+        val = _realval(*slot);
+        return true;
+    }
+#endif
     const _HashNode *n = _Get(key);
     if (n) {
         val = _realval(n->val);
@@ -164,10 +678,35 @@ bool SQTable::Get(const SQObjectPtr &key,SQObjectPtr &val) const
     return false;
 }
 
+SQObjectPtr *SQTable::GetValuePtr(const SQObjectPtr &key)
+{
+    if (SQ_UNLIKELY(_IsUninternedKey(key)))
+        return GetValuePtr(SQObjectPtr(_string(key)->Interned()));
+#if SQ_TABLE_ARRAY_PART
+    if (SQObjectPtr *slot = _ArraySlot(key))
+        return (sq_type(*slot) & OT_FREE_TABLE_SLOT) ? NULL : slot;
+#endif
+#if SQ_TABLE_SHAPES
+    if (SQObjectPtr *slot = _ShapeSlot(key))
+        return slot;
+#endif
+    _HashNode *n = _Get(key);
+    return n ? &n->val : NULL;
+}
+
 bool SQTable::GetStrToInt(const SQObjectPtr &key,uint32_t &val) const//for class members
 {
     assert(sq_type(key) == OT_STRING);
-    const _HashNode *n = _GetStr(_rawval(key), _string(key)->_hash & _numofnodes_minus_one);
+    if (SQ_UNLIKELY(_IsUninternedKey(key)))
+        return GetStrToInt(SQObjectPtr(_string(key)->Interned()), val);
+#if SQ_TABLE_SHAPES
+    if (const SQObjectPtr *slot = _ShapeSlot(key)) {
+        assert(sq_type(*slot) == OT_INTEGER);
+        val = _integer(*slot);
+        return true;
+    }
+#endif
+    const _HashNode *n = _GetStr(_rawval(key), _string(key)->_hash);
     if (!n)
       return false;
     assert(sq_type(n->val) == OT_INTEGER);
@@ -178,7 +717,9 @@ bool SQTable::GetStrToInt(const SQObjectPtr &key,uint32_t &val) const//for class
 #if SQ_VAR_TRACE_ENABLED == 1
 VarTrace * SQTable::GetVarTracePtr(const SQObjectPtr &key)
 {
-  _HashNode *n = _Get(key, HashObj(key) & _numofnodes_minus_one);
+  if (_IsUninternedKey(key))
+    return GetVarTracePtr(SQObjectPtr(_string(key)->Interned()));
+  _HashNode *n = _Get(key, HashObj(key));
   if (n)
     return &(n->varTrace);
   else
@@ -187,7 +728,92 @@ VarTrace * SQTable::GetVarTracePtr(const SQObjectPtr &key)
 #endif
 
 
-bool SQTable::NewSlot(const SQObjectPtr &__restrict key,const SQObjectPtr &__restrict val  VT_DECL_ARG)
+#if SQ_SWISS_TABLE
+int64_t SQTable::FindFreeSlot(SQHash hash) const
+{
+    uint32_t mask = _numofnodes_minus_one;
+    uint32_t pos = uint32_t(hash) & mask;
+    // same probe sequence as _Find(), so the key is found before any empty slot
+    for (uint32_t probe = 0;;) {
+        SQTableGroup g(_ctrl + pos);
+        if (uint32_t m = g.MatchFree())
+            return (pos + sq_tbl_ctz(m)) & mask;
+        if ((probe += SQ_TBL_GROUP_WIDTH) > mask)
+            return -1;
+        pos = (pos + probe) & mask;
+    }
+}
+
+bool SQTable::_HashNewSlot(const SQObjectPtr &__restrict key,const SQObjectPtr &__restrict val  VT_DECL_ARG)
+{
+    SQHash hash = HashObj(key);
+    _HashNode *n = _Get(key, hash);
+    if (n) {
+        n->val = val;
+        VT_CODE(if (var_trace_arg) n->varTrace = *var_trace_arg);
+        VT_TRACE_SINGLE(n, val, _ss(this)->_root_vm);
+        return false;
+    }
+
+    int64_t slot = FindFreeSlot(hash);
+    if (slot < 0 || (_ctrl[slot] == SQ_TBL_CTRL_EMPTY && _growthleft == 0)) {
+        Rehash(true, &key);
+        return NewSlot(key, val  VT_CODE(VT_COMMA var_trace_arg));
+    }
+    if (_ctrl[slot] == SQ_TBL_CTRL_EMPTY)
+        _growthleft--;
+    SetCtrl(uint32_t(slot), sq_tbl_h2(hash));
+
+    n = &_nodes[slot];
+    n->key = key;
+    n->val = val;
+    VT_CODE(if (var_trace_arg) n->varTrace = *var_trace_arg);
+    VT_TRACE_SINGLE(n, val, _ss(this)->_root_vm);
+
+    _classTypeId = class_type_id_update(_classTypeId, _usednodes, _numofnodes_minus_one, key, uint32_t(slot));
+    ++_usednodes;
+    return true;
+}
+#elif SQ_ORDERED_TABLE
+bool SQTable::_HashNewSlot(const SQObjectPtr &__restrict key,const SQObjectPtr &__restrict val  VT_DECL_ARG)
+{
+    SQHash hash = HashObj(key);
+    _HashNode *n = _Get(key, hash);
+    if (n) {
+        n->val = val;
+        VT_CODE(if (var_trace_arg) n->varTrace = *var_trace_arg);
+        VT_TRACE_SINGLE(n, val, _ss(this)->_root_vm);
+        return false;
+    }
+
+    if (_entriesend > _numofnodes_minus_one) {
+        Rehash(true, &key);
+        return NewSlot(key, val  VT_CODE(VT_COMMA var_trace_arg));
+    }
+    _Append(key, val, hash  VT_CODE(VT_COMMA var_trace_arg));
+    return true;
+}
+
+void SQTable::_Append(const SQObjectPtr &key, const SQObjectPtr &val, SQHash hash  VT_DECL_ARG)
+{
+    uint32_t idx = _entriesend++;
+    uint32_t mask = IndexMask();
+    uint32_t pos = IndexHash(hash) & mask;
+    while (_index[pos])
+        pos = (pos + 1) & mask;
+    _index[pos] = idx + 1;
+
+    _HashNode *n = &_nodes[idx];
+    n->key = key;
+    n->val = val;
+    VT_CODE(if (var_trace_arg) n->varTrace = *var_trace_arg);
+    VT_TRACE_SINGLE(n, val, _ss(this)->_root_vm);
+
+    _classTypeId = class_type_id_update(_classTypeId, _usednodes, _numofnodes_minus_one, key, idx);
+    ++_usednodes;
+}
+#else
+bool SQTable::_HashNewSlot(const SQObjectPtr &__restrict key,const SQObjectPtr &__restrict val  VT_DECL_ARG)
 {
     SQHash h = HashObj(key) & _numofnodes_minus_one;
     _HashNode *n = _Get(key, h);
@@ -240,21 +866,7 @@ bool SQTable::NewSlot(const SQObjectPtr &__restrict key,const SQObjectPtr &__res
             VT_CODE(if (var_trace_arg) mp->varTrace = *var_trace_arg);
             VT_TRACE_SINGLE(mp, val, _ss(this)->_root_vm);
 
-            // update class type id
-            if (sq_isstring(key) && (_numofnodes_minus_one < (1<<TBL_CLASS_TYPE_MEMBER_BITS))) {
-                if (_classTypeId != 0 || _usednodes==0) {
-                    uint8_t insertPos = mp - _nodes;
-                    _classTypeId = class_type_hash_update_1(_classTypeId ? _classTypeId : CLASS_TYPE_HASH_INIT, insertPos);
-
-                    // Use SQString address as identifier, strings are unique, immutable and strored in a table.
-                    // That means that all script strings share the same reference to SQString.
-                    // 32 provides more than realistic address range.
-                    uint32_t strIdBits = uint32_t( (uintptr_t(_string(key)) >> 3) & 0xFFFFFFFF );
-                    _classTypeId = class_type_hash_update_4(_classTypeId, strIdBits);
-                }
-            } else {
-                _classTypeId = 0;
-            }
+            _classTypeId = class_type_id_update(_classTypeId, _usednodes, _numofnodes_minus_one, key, uint32_t(mp - _nodes));
 
             ++_usednodes;
 
@@ -263,21 +875,54 @@ bool SQTable::NewSlot(const SQObjectPtr &__restrict key,const SQObjectPtr &__res
         else if (_firstfree == _nodes) break;  /* cannot decrement from here */
         else (_firstfree)--;
     }
-    Rehash(true);
+    // the key is inserted again after the rehash, it must not be counted and moved as an existing one
+    mp->key.Null();
+    mp->key._type = OT_FREE_TABLE_SLOT;
+    Rehash(true, &key);
     return NewSlot(key, val  VT_CODE(VT_COMMA var_trace_arg));
 }
+#endif
 
 SQInteger SQTable::Next(bool getweakrefs,const SQObjectPtr &__restrict refpos, SQObjectPtr &__restrict outkey, SQObjectPtr &__restrict outval)
 {
     uint32_t idx = (uint32_t)TranslateIndex(refpos);
+    uint32_t base = 0;
+#if SQ_TABLE_ARRAY_PART
+    // positions [0, _arraysize) are array slots, hash nodes follow
+    for (; idx < _arraysize; ++idx) {
+        if (!(sq_type(_array[idx]) & OT_FREE_TABLE_SLOT)) {
+            outkey = SQInteger(idx);
+            outval = getweakrefs?(SQObject)_array[idx]:_realval(_array[idx]);
+            return ++idx;
+        }
+    }
+    base = _arraysize;
+    idx -= base;
+#endif
+#if SQ_TABLE_SHAPES
+    // then the shape slots
+    if (_shape) {
+        if (idx < _shape->_nkeys) {
+            outkey = _shape->_keys[idx];
+            outval = getweakrefs?(SQObject)_slots[idx]:_realval(_slots[idx]);
+            return base + ++idx;
+        }
+        base += _shape->_nkeys;
+        idx -= _shape->_nkeys;
+    }
+#endif
+#if SQ_ORDERED_TABLE
+    while (idx < _entriesend) {
+#else
     while (idx <= _numofnodes_minus_one) {
+#endif
         if(!(sq_type(_nodes[idx].key) & OT_FREE_TABLE_SLOT)) {
             //first found
             _HashNode &n = _nodes[idx];
             outkey = n.key;
             outval = getweakrefs?(SQObject)n.val:_realval(n.val);
             //return idx for the next iteration
-            return ++idx;
+            return base + ++idx;
         }
         ++idx;
     }
@@ -288,6 +933,22 @@ SQInteger SQTable::Next(bool getweakrefs,const SQObjectPtr &__restrict refpos, S
 
 bool SQTable::Set(const SQObjectPtr &key, const SQObjectPtr &val)
 {
+    if (SQ_UNLIKELY(_IsUninternedKey(key)))
+        return Set(SQObjectPtr(_string(key)->Interned()), val);
+#if SQ_TABLE_ARRAY_PART
+    if (SQObjectPtr *slot = _ArraySlot(key)) {
+        if (sq_type(*slot) & OT_FREE_TABLE_SLOT)
+            return false;
+        *slot = val;
+        return true;
+    }
+#endif
+#if SQ_TABLE_SHAPES
+    if (SQObjectPtr *slot = _ShapeSlot(key)) {
+        *slot = val;
+        return true;
+    }
+#endif
     _HashNode *n = _Get(key);
     if (n) {
         n->val = val;
@@ -303,9 +964,29 @@ void SQTable::_ClearNodes()
       i->key.Null();
       i->key._type = OT_FREE_TABLE_SLOT;
       i->val.Null();
+#if SQ_CHAINED_TABLE
       i->next = NULL;
+#endif
       VT_CLEAR_SINGLE(i);
     }
+#if SQ_SWISS_TABLE
+    memset(_ctrl, SQ_TBL_CTRL_EMPTY, _numofnodes_minus_one + 1 + SQ_TBL_GROUP_WIDTH);
+    _growthleft = MaxUsedNodes(_numofnodes_minus_one + 1);
+#elif SQ_ORDERED_TABLE
+    memset(_index, 0, (_numofnodes_minus_one + 1) * 2 * sizeof(uint32_t));
+    _entriesend = 0;
+#endif
+#if SQ_TABLE_ARRAY_PART
+    for (uint32_t i = 0; i < _arraysize; i++) {
+        _array[i].Null();
+        _array[i]._type = OT_FREE_TABLE_SLOT;
+    }
+    _arrayused = 0;
+#endif
+#if SQ_TABLE_SHAPES
+    for (uint32_t i = 0; i < _slotscap; i++)
+        _slots[i].Null();
+#endif
 }
 
 void SQTable::Finalize()
@@ -319,20 +1000,55 @@ void SQTable::Clear(SQBool rehash)
     _ClearNodes();
     _usednodes = 0;
     _classTypeId = 0;
+#if SQ_TABLE_SHAPES
+    if (_shape) // start over from the root, slots are kept for reuse unless memory is freed
+        _shape = _sharedstate->_rootshape;
+#endif
+#if SQ_CHAINED_TABLE
+    _firstfree=&_nodes[_numofnodes_minus_one];
+#endif
     if (rehash)
-      Rehash(true);
-    else
-      _firstfree=&_nodes[_numofnodes_minus_one];
+      Compact();
+}
+
+// compared field by field, the padding after _flags is not initialized
+static inline bool AreBinaryEqual(const SQObjectPtr *a, const SQObjectPtr *b, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+        if (a[i]._type != b[i]._type || a[i]._flags != b[i]._flags || a[i]._unVal.raw != b[i]._unVal.raw)
+            return false;
+    return true;
 }
 
 bool SQTable::IsBinaryEqual(SQTable *o)
 {
     if (o->_usednodes != _usednodes || o->_classTypeId != _classTypeId)
         return false;
+#if SQ_TABLE_ARRAY_PART
+    if (o->_arraysize != _arraysize || o->_arrayused != _arrayused)
+        return false;
+#endif
+#if SQ_TABLE_SHAPES
+    if (o->_shape != _shape)
+        return false;
+#endif
     if (o == this)
         return true;
+#if SQ_TABLE_ARRAY_PART
+    if (_arrayused && !AreBinaryEqual(_array, o->_array, _arraysize))
+        return false;
+#endif
+#if SQ_TABLE_SHAPES
+    if (_shape && !AreBinaryEqual(_slots, o->_slots, _shape->_nkeys))
+        return false;
+#endif
     if (o->_usednodes == 0)
         return true;
 
-    return memcmp(_nodes, o->_nodes, sizeof(_HashNode) * (_numofnodes_minus_one + 1)) == 0;
+    if (o->_numofnodes_minus_one != _numofnodes_minus_one)
+        return false;
+    for (uint32_t i = 0; i <= _numofnodes_minus_one; i++)
+        if (!AreBinaryEqual(&_nodes[i].key, &o->_nodes[i].key, 1) || !AreBinaryEqual(&_nodes[i].val, &o->_nodes[i].val, 1))
+            return false;
+    return true;
 }
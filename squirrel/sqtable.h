@@ -16,6 +16,164 @@
 #define TBL_CLASS_TYPE_MEMBER_MASK ((1u<<TBL_CLASS_TYPE_MEMBER_BITS)-1)
 #define TBL_CLASS_CLASS_MASK ( (~(uint64_t(0))) ^ TBL_CLASS_TYPE_MEMBER_MASK )
 
+#ifndef SQ_SWISS_TABLE
+#define SQ_SWISS_TABLE 0
+#endif
+
+#ifndef SQ_ORDERED_TABLE
+#define SQ_ORDERED_TABLE 0
+#endif
+
+#if SQ_SWISS_TABLE && SQ_ORDERED_TABLE
+#error SQ_SWISS_TABLE and SQ_ORDERED_TABLE are mutually exclusive
+#endif
+
+/*
+* Ordered layout (SQ_ORDERED_TABLE): _nodes is a dense array of entries in insertion order
+* and lookups go through a separate index of 2x as many uint32 buckets (linear probing, entry
+* index + 1, 0 is empty). Removed entries stay in place as free slots until the next rehash
+* compacts them, so Next() walks only [0, _entriesend) and iteration order is the insertion order
+* (integer keys kept in the array part come first).
+* Free entries look the same as with the other layouts, so node-index type hints, the GC,
+* the serializer and the dedup shrinker don't need to know about it.
+*/
+#define SQ_CHAINED_TABLE (!SQ_SWISS_TABLE && !SQ_ORDERED_TABLE)
+
+/*
+* Array part (Lua 5 style): values of integer keys 0..n-1 live in a plain array next to
+* the hash part, n is the biggest power of 2 for which more than a half of these keys is used.
+* The size is recomputed when the hash part runs out of space, keys migrate between the parts then.
+* Keys in the array range are never stored in the hash part, free array slots have OT_FREE_TABLE_SLOT type.
+* Next() enumerates the array part first.
+* Disabled with variable tracing, array slots have no VarTrace.
+*/
+#ifndef SQ_TABLE_ARRAY_PART
+#if SQ_VAR_TRACE_ENABLED == 1
+#define SQ_TABLE_ARRAY_PART 0
+#else
+#define SQ_TABLE_ARRAY_PART 1
+#endif
+#endif
+#define SQ_TBL_MAX_ARRAY_BITS 26
+#if SQ_TABLE_ARRAY_PART
+#define SQ_TBL_ARRAY_ARG(x) , x
+#else
+#define SQ_TBL_ARRAY_ARG(x)
+#endif
+
+/*
+* Shapes (hidden classes): tables created from literals and their clones keep string keys in a
+* shared immutable SQTableShape and only values in a compact slot vector, key i of the shape is in slot i.
+* Shapes form a transition tree on newslot rooted at SQSharedState::_rootshape, so tables built
+* the same way share one shape and _OP_GET_LITERAL/_OP_SET_LITERAL cache (shape id, slot) for all of them.
+* Shapes are owned by the tree and live as long as the shared state, so hints stay valid after
+* the tables are gone; SQ_TBL_MAX_SHAPES bounds the tree.
+* Deleting a shape key, too many keys or transitions move the keys to the hash part for good.
+* Disabled with variable tracing, slots have no VarTrace.
+*/
+#ifndef SQ_TABLE_SHAPES
+#if SQ_VAR_TRACE_ENABLED == 1
+#define SQ_TABLE_SHAPES 0
+#else
+#define SQ_TABLE_SHAPES 1
+#endif
+#endif
+#define SQ_TBL_MAX_SHAPE_KEYS (1u << TBL_CLASS_TYPE_MEMBER_BITS) // slot index has to fit in a literal hint
+#define SQ_TBL_MAX_SHAPE_TRANSITIONS 64
+#define SQ_TBL_MAX_SHAPES 16384
+
+#if SQ_TABLE_SHAPES
+struct SQTableShape
+{
+    static SQTableShape *CreateRoot(SQSharedState *ss);
+    void DestroyTree();
+    // child shape with the key added, NULL if this shape can't get more keys or transitions
+    SQTableShape *Transition(SQString *key);
+
+    inline int32_t Find(const SQString *key) const
+    {
+        if (!(_keymask & (uint64_t(1) << (key->_hash & 63))))
+            return -1;
+        for (uint32_t i = 0; i < _nkeys; i++)
+            if (_keys[i] == key)
+                return int32_t(i);
+        return -1;
+    }
+
+    uint64_t _id; // shifted by TBL_CLASS_TYPE_MEMBER_BITS, ready to be combined with a slot in a literal hint
+    uint64_t _keymask; // a bit per key hash, rejects most missing keys without the scan
+    uint32_t _nkeys;
+    uint32_t _nchildren;
+    SQSharedState *_ss;
+    SQTableShape *_children;
+    SQTableShape *_nextsibling;
+    SQObjectPtr _lastkey; // keeps _keys[_nkeys - 1] alive, the others are kept by the parents
+    SQString *_keys[1];
+
+private:
+    static SQTableShape *Alloc(SQSharedState *ss, uint32_t nkeys);
+    static SQUnsignedInteger AllocSize(uint32_t nkeys) { return sizeof(SQTableShape) + (nkeys ? nkeys - 1 : 0) * sizeof(SQString *); }
+};
+#endif
+
+#if SQ_SWISS_TABLE
+/*
+* Open addressing layout in the style of Swiss tables (Abseil / Google).
+* Besides the node array there is an array of control bytes, one per node: either a
+* free marker or 7 bits of the key hash. Lookups compare a whole group of 16 control
+* bytes at once (SSE2, or 64-bit SWAR elsewhere) and only touch nodes whose control
+* byte matches, so there is no pointer chasing. Nodes stay in a plain array indexed
+* by slot, so iteration order (Next), node-index type hints, the GC, the serializer
+* and the dedup shrinker work on them the same way as with the chained layout.
+* The first SQ_TBL_GROUP_WIDTH control bytes are mirrored past the end, so a group can be
+* loaded at any position without wrapping.
+*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SQ_TBL_SSE2 1
+#else
+#define SQ_TBL_SSE2 0
+#endif
+
+#define SQ_TBL_GROUP_WIDTH 16
+#define SQ_TBL_CTRL_EMPTY 0x80
+#define SQ_TBL_CTRL_DELETED 0xFE
+
+inline uint8_t sq_tbl_h2(SQHash hash) { return uint8_t((uint64_t(hash) * 0x9E3779B97F4A7C15ull) >> 57); }
+
+inline uint32_t sq_tbl_ctz(uint32_t x)
+{
+#if !defined(_MSC_VER) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    unsigned long idx;
+    _BitScanForward(&idx, x);
+    return idx;
+#endif
+}
+
+struct SQTableGroup
+{
+#if SQ_TBL_SSE2
+    __m128i ctrl;
+    SQTableGroup(const uint8_t *p) : ctrl(_mm_loadu_si128((const __m128i *)p)) {}
+    uint32_t Match(uint8_t h2) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(char(h2)), ctrl)); }
+    uint32_t MatchEmpty() const { return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(char(SQ_TBL_CTRL_EMPTY)), ctrl)); }
+    uint32_t MatchFree() const { return _mm_movemask_epi8(ctrl); } // empty and deleted have the high bit set
+#else
+    uint64_t lo, hi;
+    SQTableGroup(const uint8_t *p) { memcpy(&lo, p, 8); memcpy(&hi, p + 8, 8); }
+    static uint32_t Bits(uint64_t msbs) { return uint32_t(((msbs >> 7) * 0x0102040810204080ull) >> 56); }
+    // may report false positives above a real match, callers compare keys anyway
+    static uint64_t MatchWord(uint64_t w, uint8_t h2) { uint64_t x = w ^ (0x0101010101010101ull * h2); return (x - 0x0101010101010101ull) & ~x & 0x8080808080808080ull; }
+    static uint64_t EmptyWord(uint64_t w) { return w & (~w << 6) & 0x8080808080808080ull; }
+    uint32_t Match(uint8_t h2) const { return Bits(MatchWord(lo, h2)) | (Bits(MatchWord(hi, h2)) << 8); }
+    uint32_t MatchEmpty() const { return Bits(EmptyWord(lo)) | (Bits(EmptyWord(hi)) << 8); }
+    uint32_t MatchFree() const { return Bits(lo & 0x8080808080808080ull) | (Bits(hi & 0x8080808080808080ull) << 8); }
+#endif
+};
+#endif // SQ_SWISS_TABLE
+
 inline SQUnsignedInteger32 sq_float_hash32(float v)
 {
     SQUnsignedInteger32 i;
@@ -26,7 +184,7 @@ inline SQUnsignedInteger32 sq_float_hash32(float v)
 inline SQHash HashObj(const SQObject &key)
 {
     switch(sq_type(key)) {
-        case OT_STRING:     return _string(key)->_hash;
+        case OT_STRING:     return _string(key)->Hash();
         case OT_FLOAT:      return (SQHash)(sq_float_hash32(_float(key)));
         case OT_BOOL: case OT_INTEGER:  return (SQHash)((SQInteger)_integer(key));
         default:            return hashptr(key._unVal.pRefCounted);
@@ -41,50 +199,203 @@ private:
     friend struct SQStreamSerializer;
     struct _HashNode
     {
+#if SQ_CHAINED_TABLE
         _HashNode() { key._type = OT_FREE_TABLE_SLOT; next = NULL; }
+#else
+        _HashNode() { key._type = OT_FREE_TABLE_SLOT; }
+#endif
         SQObjectPtr val;
         SQObjectPtr key;
+#if SQ_CHAINED_TABLE
         _HashNode *next;
+#endif
         VT_DECL_SINGLE;
     };
+#if SQ_SWISS_TABLE
+    uint8_t *_ctrl; // _numofnodes_minus_one + 1 + SQ_TBL_GROUP_WIDTH bytes, allocated together with _nodes
+    uint32_t _growthleft; // empty slots that may still be filled before a rehash
+#elif SQ_ORDERED_TABLE
+    uint32_t *_index; // 2 * (_numofnodes_minus_one + 1) buckets, allocated together with _nodes
+    uint32_t _entriesend; // entries past this one have never been used since the last rehash
+#else
     _HashNode *_firstfree;
+#endif
     _HashNode *_nodes;
     uint32_t _numofnodes_minus_one;
     uint32_t _usednodes;
+#if SQ_TABLE_ARRAY_PART
+    SQObjectPtr *_array;
+    uint32_t _arraysize;
+    uint32_t _arrayused;
+#endif
+#if SQ_TABLE_SHAPES
+    SQTableShape *_shape; // while set, string keys are in the shape and their values in _slots
+    SQObjectPtr *_slots;
+    uint32_t _slotscap;
+#endif
     SQAllocContext _alloc_ctx;
     uint64_t _classTypeId;
     ///////////////////////
     void AllocNodes(SQInteger nSize);
-    void Rehash(bool force);
+    void Rehash(bool force, const SQObjectPtr *newkey = NULL);
+    void Resize(SQInteger newsize SQ_TBL_ARRAY_ARG(uint32_t newarraysize));
+    static SQInteger MinNodes(SQInteger nelems);
+#if SQ_TABLE_ARRAY_PART
+    void ShrinkArray();
+    void AllocArray(uint32_t size);
+    void FreeArray(SQObjectPtr *arr, uint32_t size);
+    uint32_t ComputeArraySize(const SQObjectPtr *newkey, uint32_t &inarray) const;
+    inline SQObjectPtr *_ArraySlot(const SQObjectPtr &key) const
+    {
+        if (sq_type(key) == OT_INTEGER && SQUnsignedInteger(_integer(key)) < _arraysize)
+            return &_array[_integer(key)];
+        return NULL;
+    }
+#endif
+    // string keys are compared by pointer, a string that skipped interning is looked up by its interned twin
+    static bool _IsUninternedKey(const SQObjectPtr &key) { return sq_type(key) == OT_STRING && !_string(key)->_interned; }
+    bool _HashNewSlot(const SQObjectPtr &key,const SQObjectPtr &val  VT_DECL_ARG);
+    void _HashRemove(const SQObjectPtr &key);
+#if SQ_TABLE_SHAPES
+    inline SQObjectPtr *_ShapeSlot(const SQObjectPtr &key) const
+    {
+        if (_shape && sq_type(key) == OT_STRING) {
+            int32_t idx = _shape->Find(_string(key));
+            if (idx >= 0)
+                return &_slots[idx];
+        }
+        return NULL;
+    }
+    bool _ShapeNewSlot(const SQObjectPtr &key, const SQObjectPtr &val);
+    bool _GetShapeStr(const char *key, SQInteger keylen, SQObjectPtr &val) const;
+    void AllocSlots(uint32_t cap);
+    void FreeSlots(SQObjectPtr *slots, uint32_t cap);
+    void ReleaseShape();
+    void DropShape();
+#endif
     SQTable(SQSharedState *ss, SQInteger nInitialSize);
     void _ClearNodes();
+#if SQ_SWISS_TABLE
+    static SQUnsignedInteger NodesAllocSize(SQUnsignedInteger n) { return n * sizeof(_HashNode) + n + SQ_TBL_GROUP_WIDTH; }
+    // at most 7/8 of big tables are used, small ones fit in a single group and can be full
+    static uint32_t MaxUsedNodes(uint32_t n) { return n <= 8 ? n : n - n / 8; }
+    void SetCtrl(uint32_t idx, uint8_t c)
+    {
+        _ctrl[idx] = c;
+        for (uint32_t m = idx + _numofnodes_minus_one + 1; m < _numofnodes_minus_one + 1 + SQ_TBL_GROUP_WIDTH; m += _numofnodes_minus_one + 1)
+            _ctrl[m] = c;
+    }
+    int64_t FindFreeSlot(SQHash hash) const;
+
+    template <typename Eq>
+    inline _HashNode *_Find(SQHash hash, Eq eq) const
+    {
+        uint32_t mask = _numofnodes_minus_one;
+        uint8_t h2 = sq_tbl_h2(hash);
+        uint32_t pos = uint32_t(hash) & mask;
+        // triangular probing over groups visits every group once when the size is a power of 2
+        for (uint32_t probe = 0;;) {
+            SQTableGroup g(_ctrl + pos);
+            for (uint32_t m = g.Match(h2); m; m &= m - 1) {
+                _HashNode *n = &_nodes[(pos + sq_tbl_ctz(m)) & mask];
+                if (eq(n->key))
+                    return n;
+            }
+            if (g.MatchEmpty() || (probe += SQ_TBL_GROUP_WIDTH) > mask)
+                return NULL;
+            pos = (pos + probe) & mask;
+        }
+    }
+#elif SQ_ORDERED_TABLE
+    static SQUnsignedInteger NodesAllocSize(SQUnsignedInteger n) { return n * (sizeof(_HashNode) + 2 * sizeof(uint32_t)); }
+    uint32_t IndexMask() const { return (_numofnodes_minus_one << 1) | 1; }
+    // integer keys hash to themselves and ranges of them would form long runs with linear probing
+    static uint32_t IndexHash(SQHash hash)
+    {
+        uint32_t h = uint32_t(hash) * 0x9E3779B1u;
+        return h ^ (h >> 15);
+    }
+    void _Append(const SQObjectPtr &key, const SQObjectPtr &val, SQHash hash  VT_DECL_ARG);
+
+    template <typename Eq>
+    inline _HashNode *_Find(SQHash hash, Eq eq) const
+    {
+        uint32_t mask = IndexMask();
+        for (uint32_t pos = IndexHash(hash) & mask, e; (e = _index[pos]) != 0; pos = (pos + 1) & mask) {
+            _HashNode *n = &_nodes[e - 1];
+            if (eq(n->key))
+                return n;
+        }
+        return NULL;
+    }
+#else
+    static SQUnsignedInteger NodesAllocSize(SQUnsignedInteger n) { return n * sizeof(_HashNode); }
+#endif
 public:
     static SQTable* Create(SQSharedState *ss,SQInteger nInitialSize)
     {
         SQTable *newtable = (SQTable*)SQ_MALLOC(ss->_alloc_ctx, sizeof(SQTable));
         new (newtable) SQTable(ss, nInitialSize);
         newtable->_delegate = NULL;
+        SQ_MEMPROF_ALLOC(ss, newtable, OT_TABLE, newtable->MemSize());
         return newtable;
     }
+    // tables of literals start with the root shape, nkeys is a hint of how many keys they get
+    static SQTable* CreateLiteral(SQSharedState *ss, SQInteger nkeys);
     void Finalize();
     SQTable *Clone();
+    void ResolveWeakRefs();
     ~SQTable()
     {
         uint32_t cnt = _numofnodes_minus_one + 1;
         _HashNode *__restrict lNodes = _nodes;
+        SQ_MEMPROF_FREE(_sharedstate, this);
         SetDelegate(NULL);
         REMOVE_FROM_CHAIN(&_sharedstate->_gc_chain, this);
         for (_HashNode *i = lNodes, *e = i + cnt; i != e; i++)
           i->~_HashNode();
-        SQ_FREE(_alloc_ctx, lNodes, cnt  * sizeof(_HashNode));
+        SQ_FREE(_alloc_ctx, lNodes, NodesAllocSize(cnt));
+#if SQ_TABLE_ARRAY_PART
+        FreeArray(_array, _arraysize);
+#endif
+#if SQ_TABLE_SHAPES
+        ReleaseShape();
+#endif
     }
 #ifndef NO_GARBAGE_COLLECTOR
     void Mark(SQCollectable **chain);
     SQObjectType GetType() {return OT_TABLE;}
 #endif
+    // hash is the full key hash, not the main position
+#if !SQ_CHAINED_TABLE
     inline _HashNode *_GetStr(const SQRawObjectVal key, SQHash hash) const
     {
-        _HashNode *n = &_nodes[hash];
+        return _Find(hash, [key](const SQObjectPtr &k) { return _rawval(k) == key && sq_type(k) == OT_STRING; });
+    }
+    inline _HashNode *_Get(const SQObjectPtr &key, SQHash hash) const
+    {
+        return _Find(hash, [&key](const SQObjectPtr &k) { return _rawval(k) == _rawval(key) && sq_type(k) == sq_type(key); });
+    }
+    //for compiler use
+    inline bool GetStr(const char* key,SQInteger keylen,SQObjectPtr &val) const
+    {
+#if SQ_TABLE_SHAPES
+        if (_GetShapeStr(key, keylen, val))
+            return true;
+#endif
+        _HashNode *res = _Find(_hashstr(key,keylen), [key, keylen](const SQObjectPtr &k) {
+            return sq_type(k) == OT_STRING && keylen == _string(k)->_len && strncmp(_stringval(k), key, keylen) == 0;
+        });
+        if (res) {
+            val = _realval(res->val);
+            return true;
+        }
+        return false;
+    }
+#else
+    inline _HashNode *_GetStr(const SQRawObjectVal key, SQHash hash) const
+    {
+        _HashNode *n = &_nodes[hash & _numofnodes_minus_one];
         do{
             if(_rawval(n->key) == key && sq_type(n->key) == OT_STRING){
                 return n;
@@ -94,7 +405,7 @@ public:
     }
     inline _HashNode *_Get(const SQObjectPtr &key, SQHash hash) const
     {
-        _HashNode *n = &_nodes[hash];
+        _HashNode *n = &_nodes[hash & _numofnodes_minus_one];
         do{
             if(_rawval(n->key) == _rawval(key) && sq_type(n->key) == sq_type(key)){
                 return n;
@@ -105,6 +416,10 @@ public:
     //for compiler use
     inline bool GetStr(const char* key,SQInteger keylen,SQObjectPtr &val) const
     {
+#if SQ_TABLE_SHAPES
+        if (_GetShapeStr(key, keylen, val))
+            return true;
+#endif
         SQHash hash = _hashstr(key,keylen);
         _HashNode *n = &_nodes[hash & _numofnodes_minus_one];
         _HashNode *res = NULL;
@@ -122,9 +437,25 @@ public:
         }
         return false;
     }
+#endif
     _HashNode *_Get(const SQObjectPtr &key) const;
     bool Get(const SQObjectPtr &key,SQObjectPtr &val) const;
     bool GetStrToInt(const SQObjectPtr &key,uint32_t &val) const;//for class members
+    SQObjectPtr *GetValuePtr(const SQObjectPtr &key);
+#if SQ_TABLE_SHAPES
+    // slot of a literal key of a table with a shape, the hint caches (shape id, slot) per instruction
+    inline SQObjectPtr *GetShapeSlotFromHint(uint64_t *hintP, const SQObjectPtr &key) const
+    {
+        uint64_t hint = *hintP;
+        if (SQ_LIKELY((hint & TBL_CLASS_CLASS_MASK) == _shape->_id))
+            return &_slots[hint & TBL_CLASS_TYPE_MEMBER_MASK];
+        int32_t idx = _shape->Find(_string(key));
+        if (idx < 0)
+            return NULL;
+        *hintP = _shape->_id | uint64_t(idx);
+        return &_slots[idx];
+    }
+#endif
 
     inline _HashNode *GetNodeFromTypeHint(uint64_t hint, const SQObjectPtr &key) const {
         size_t nodeIdx = size_t(hint & TBL_CLASS_TYPE_MEMBER_MASK);
@@ -141,16 +472,83 @@ public:
 
     VT_CODE(VarTrace * GetVarTracePtr(const SQObjectPtr &key));
 
-    void Remove(const SQObjectPtr &key);
+    inline void Remove(const SQObjectPtr &key)
+    {
+        if (SQ_UNLIKELY(_IsUninternedKey(key))) {
+            Remove(SQObjectPtr(_string(key)->Interned()));
+            return;
+        }
+#if SQ_TABLE_ARRAY_PART
+        if (SQObjectPtr *slot = _ArraySlot(key)) {
+            if (!(sq_type(*slot) & OT_FREE_TABLE_SLOT)) {
+                slot->Null();
+                slot->_type = OT_FREE_TABLE_SLOT;
+                _arrayused--;
+                if (_arrayused < (_arraysize >> 2))
+                    ShrinkArray();
+            }
+            return;
+        }
+#endif
+#if SQ_TABLE_SHAPES
+        if (_ShapeSlot(key))
+            DropShape();
+#endif
+        _HashRemove(key);
+    }
     bool Set(const SQObjectPtr &key, const SQObjectPtr &val);
     //returns true if a new slot has been created false if it was already present
-    bool NewSlot(const SQObjectPtr &key,const SQObjectPtr &val  VT_DECL_ARG_DEF);
+    inline bool NewSlot(const SQObjectPtr &key,const SQObjectPtr &val  VT_DECL_ARG_DEF)
+    {
+        if (SQ_UNLIKELY(_IsUninternedKey(key)))
+            return NewSlot(SQObjectPtr(_string(key)->Interned()), val  VT_CODE(VT_COMMA var_trace_arg));
+#if SQ_TABLE_ARRAY_PART
+        if (SQObjectPtr *slot = _ArraySlot(key)) {
+            bool added = (sq_type(*slot) & OT_FREE_TABLE_SLOT) != 0;
+            *slot = val;
+            if (added) {
+                _arrayused++;
+                _classTypeId = 0;
+            }
+            return added;
+        }
+#endif
+#if SQ_TABLE_SHAPES
+        if (_shape && sq_type(key) == OT_STRING)
+            return _ShapeNewSlot(key, val);
+#endif
+        return _HashNewSlot(key, val  VT_CODE(VT_COMMA var_trace_arg));
+    }
     SQInteger Next(bool getweakrefs,const SQObjectPtr &refpos, SQObjectPtr &outkey, SQObjectPtr &outval);
 
-    SQInteger CountUsed(){ return _usednodes;}
-    SQInteger AllocatedNodes(){ return _numofnodes_minus_one + 1; }
+    SQInteger CountUsed()
+    {
+        SQInteger n = _usednodes;
+#if SQ_TABLE_ARRAY_PART
+        n += _arrayused;
+#endif
+#if SQ_TABLE_SHAPES
+        if (_shape)
+            n += _shape->_nkeys;
+#endif
+        return n;
+    }
+    SQUnsignedInteger MemSize() const
+    {
+        SQUnsignedInteger size = sizeof(SQTable) + NodesAllocSize(_numofnodes_minus_one + 1);
+#if SQ_TABLE_ARRAY_PART
+        size += _arraysize * sizeof(SQObjectPtr);
+#endif
+#if SQ_TABLE_SHAPES
+        size += _slotscap * sizeof(SQObjectPtr);
+#endif
+        return size;
+    }
+    SQInteger AllocatedNodes() const { return _numofnodes_minus_one + 1; }
     bool IsBinaryEqual(SQTable *o);
     void Clear(SQBool rehash = SQTrue);
+    // shrinks the node array, the array part and the shape slots to what the table holds
+    void Compact();
     void Release()
     {
         sq_delete(_alloc_ctx, this, SQTable);
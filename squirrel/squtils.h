@@ -12,6 +12,9 @@ void sq_vm_assign_to_alloc_context(SQAllocContext ctx, HSQUIRRELVM vm);
 void *sq_vm_malloc(SQAllocContext ctx, SQUnsignedInteger size);
 void *sq_vm_realloc(SQAllocContext ctx, void *p,SQUnsignedInteger oldsize,SQUnsignedInteger size);
 void sq_vm_free(SQAllocContext ctx, void *p,SQUnsignedInteger size);
+void sq_vm_set_alloc_limit(SQAllocContext ctx, SQUnsignedInteger limit);
+void sq_vm_get_alloc_stats(SQAllocContext ctx, SQMemoryStats *stats);
+bool sq_vm_check_alloc_limit(SQAllocContext ctx);
 
 #define sq_new(__ctx,__ptr,__type, ...) {__ptr=(__type *)sq_vm_malloc((__ctx),sizeof(__type));new (__ptr) __type(__VA_ARGS__);}
 #define sq_delete(__ctx,__ptr,__type) {__ptr->~__type();sq_vm_free((__ctx),__ptr,sizeof(__type));}
@@ -102,7 +105,8 @@ public:
         }
     }
     void clear() { resize(0); }
-    void shrinktofit() { if(_size > 4) { _realloc(_size); } }
+    void reset() { _releasedata(); _vals = NULL; _size = 0; _allocated = 0; } // clears and frees the storage
+    void shrinktofit() { if(_allocated > 4 && _size < _allocated) { _realloc(_size); } }
     T& top() const { return _vals[_size - 1]; }
     inline size_type size() const { return _size; }
     bool empty() const { return (_size <= 0); }
@@ -138,7 +142,7 @@ public:
         }
         _size--;
     }
-    size_type capacity() { return _allocated; }
+    size_type capacity() const { return _allocated; }
     inline T &back() const { return _vals[_size - 1]; }
     inline T& operator[](size_type pos) const{ return _vals[pos]; }
     T* _vals;
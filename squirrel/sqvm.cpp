@@ -16,6 +16,7 @@
 #include "vartrace.h"
 #include "compiler/sqtypeparser.h" // for sq_stringify_type_mask
 #include "sq_safe_shift.h"
+#include "sqnumconv.h"
 
 #define TARGET _stkbase[arg0]
 #define STK(a) _stkbase[(a)]
@@ -63,7 +64,7 @@ bool SQVM::BW_OP(SQUnsignedInteger op,SQObjectPtr &trg,const SQObjectPtr &o1,con
         case OT_INTEGER: trg = _integer(o1) op _integer(o2);break; \
         case (OT_FLOAT|OT_INTEGER): \
         case (OT_FLOAT): trg = tofloat(o1) op tofloat(o2); break; \
-        default: _GUARD(ARITH_OP((#op)[0],trg,o1,o2)); break;\
+        default: SYNC_IP(); _GUARD(ARITH_OP((#op)[0],trg,o1,o2)); break;\
     } \
 }
 
@@ -399,30 +400,42 @@ bool SQVM::CMP_OP(CmpOP op, const SQObjectPtr &o1,const SQObjectPtr &o2,SQObject
     return false;
 }
 
+// big enough for any integer, float, bool or null
+#define SCALAR_STRING_BUF_SIZE 48
+
+// prints integers, floats, bools and null the way tostring() does, -1 for other types
+static SQInteger PrintScalar(const SQObject &o, char *buf, SQInteger size)
+{
+    switch(sq_type(o)) {
+    case OT_FLOAT:
+        assert(size >= SQNUM_BUF_SIZE);
+        return sqnum_print_float(buf, _float(o));
+    case OT_INTEGER:
+        assert(size >= SQNUM_BUF_SIZE);
+        return sqnum_print_integer(buf, _integer(o));
+    case OT_BOOL:
+        return scsprintf(buf, size, _integer(o) ? "true" : "false");
+    case OT_NULL:
+        return scsprintf(buf, size, "null");
+    default:
+        return -1;
+    }
+}
+
 bool SQVM::ToString(const SQObjectPtr &o,SQObjectPtr &res)
 {
-    char buf[48];
+    char buf[SCALAR_STRING_BUF_SIZE];
 
     switch(sq_type(o)) {
     case OT_STRING:
         res = o;
         return true;
-    case OT_FLOAT: {
-            int i = scsprintf(buf, sizeof(buf), "%g", _float(o));
-            for (; i >= 0; i--)
-                if (buf[i] == ',')
-                    buf[i] = '.';
-        }
-        break;
+    case OT_FLOAT:
     case OT_INTEGER:
-        scsprintf(buf, sizeof(buf), _PRINT_INT_FMT, _integer(o));
-        break;
     case OT_BOOL:
-        scsprintf(buf, sizeof(buf), _integer(o) ? "true" : "false");
-        break;
     case OT_NULL:
-        scsprintf(buf, sizeof(buf), "null");
-        break;
+        res = SQString::Create(_ss(this), buf, PrintScalar(o, buf, sizeof(buf)));
+        return true;
     case OT_TABLE:
     case OT_USERDATA:
     case OT_INSTANCE:
@@ -453,6 +466,13 @@ bool SQVM::StringCat(const SQObjectPtr &str,const SQObjectPtr &obj,SQObjectPtr &
     if(!ToString(str, a)) return false;
     if(!ToString(obj, b)) return false;
     SQInteger l = _string(a)->_len , ol = _string(b)->_len;
+    if (SQString::IsLarge(l + ol)) {
+        SQString *res = SQString::CreateLarge(_ss(this), l + ol);
+        memcpy(res->_val, _stringval(a), l);
+        memcpy(res->_val + l, _stringval(b), ol);
+        dest = res;
+        return true;
+    }
     char *s = _sp(l + ol + 1);
     memcpy(s, _stringval(a), l);
     memcpy(s + l, _stringval(b), ol);
@@ -460,6 +480,65 @@ bool SQVM::StringCat(const SQObjectPtr &str,const SQObjectPtr &obj,SQObjectPtr &
     return true;
 }
 
+// Concatenates n values like a chain of '+' with strings does, with sep between them. The
+// values are temporaries, the ones that need tostring() are replaced with their strings first
+// (that may call a _tostring metamethod, which may use the scratchpad too), then everything
+// is written into the scratchpad at once and only the result gets interned. Large results
+// of strings only are written straight into the new string.
+bool SQVM::StringCatN(SQObjectPtr *args, SQInteger n, SQObjectPtr &dest, const char *sep, SQInteger sep_len)
+{
+    SQInteger len = n > 1 ? sep_len * (n - 1) : 0;
+    bool exact = true;
+    for (SQInteger i = 0; i < n; i++) {
+        SQObjectPtr &o = args[i];
+        switch(sq_type(o)) {
+        case OT_STRING:
+            len += _string(o)->_len;
+            break;
+        case OT_FLOAT: case OT_INTEGER: case OT_BOOL: case OT_NULL:
+            len += SCALAR_STRING_BUF_SIZE;
+            exact = false;
+            break;
+        default: {
+                SQObjectPtr str;
+                if(!ToString(o, str)) return false;
+                o = str;
+                len += _string(o)->_len;
+            }
+        }
+    }
+
+    char *s;
+    SQString *large = NULL;
+    if (exact && SQString::IsLarge(len)) {
+        large = SQString::CreateLarge(_ss(this), len);
+        s = large->_val;
+    }
+    else
+        s = _sp(len + 1);
+    SQInteger pos = 0;
+    for (SQInteger i = 0; i < n; i++) {
+        const SQObjectPtr &o = args[i];
+        if (i && sep_len) {
+            memcpy(s + pos, sep, sep_len);
+            pos += sep_len;
+        }
+        if (sq_type(o) == OT_STRING) {
+            memcpy(s + pos, _stringval(o), _string(o)->_len);
+            pos += _string(o)->_len;
+        }
+        else
+            pos += PrintScalar(o, s + pos, len + 1 - pos);
+    }
+    if (large) {
+        assert(pos == len);
+        dest = large;
+    }
+    else
+        dest = SQString::Create(_ss(this), s, pos);
+    return true;
+}
+
 bool SQVM::TypeOf(const SQObjectPtr &obj1,SQObjectPtr &dest)
 {
     if(is_delegable(obj1) && _delegable(obj1)->_delegate) {
@@ -681,9 +760,7 @@ bool SQVM::DerefInc(SQInteger op,SQObjectPtr &target, SQObjectPtr &self, SQObjec
             return true;
         }
     } else if (sq_type(tself) == OT_TABLE) {
-        SQTable::_HashNode *node = _table(tself)->_Get(tkey);
-        if (node)
-            instanceValue = &node->val;
+        instanceValue = _table(tself)->GetValuePtr(tkey);
     } else if (sq_type(tself) == OT_ARRAY){
         if (sq_isnumeric(key)) {
            SQArray * __restrict array = _array(tself);
@@ -874,6 +951,8 @@ bool SQVM::IsEqual(const SQObject &o1,const SQObject &o2)
     if(t1 == t2) {
         if (t1 == OT_FLOAT)
             return (_float(o1) == _float(o2));
+        else if (t1 == OT_STRING)
+            return _string(o1)->Equals(_string(o2));
         else
             return (_rawval(o1) == _rawval(o2));
     }
@@ -930,9 +1009,45 @@ bool SQVM::IsInstanceOf(const SQObject &obj, const SQClass *cls)
 #define SQ_WATCHDOG_CHECK()
 #endif
 
+inline bool SQVM::CheckMemoryLimit()
+{
+    if (SQ_LIKELY(!_sharedstate->_memlimitenabled) || sq_vm_check_alloc_limit(_sharedstate->_alloc_ctx))
+        return true;
+    Raise_Error("memory limit exceeded");
+    return false;
+}
+
+bool SQVM::CheckMemoryLimit(SQUnsignedInteger count, SQUnsignedInteger itemSize)
+{
+    if (SQ_LIKELY(!_sharedstate->_memlimitenabled))
+        return true;
+    SQMemoryStats stats;
+    sq_vm_get_alloc_stats(_sharedstate->_alloc_ctx, &stats);
+    // compare item counts, count * itemSize may wrap around for huge script-given sizes
+    if (!stats.limitBytes ||
+        (stats.usedBytes <= stats.limitBytes && count <= (stats.limitBytes - stats.usedBytes) / itemSize))
+        return true;
+    Raise_Error("memory limit exceeded");
+    return false;
+}
+
+#define SQ_MEMLIMIT_CHECK() \
+    do { \
+        if (!CheckMemoryLimit()) \
+            SQ_THROW(); \
+    } while (0)
+
 
 extern SQInstructionDesc g_InstrDesc[];
 
+// Tells allocation hooks (e.g. the memory profiler) which thread is running script code
+struct AutoExecutingVM {
+    AutoExecutingVM(SQSharedState *ss, SQVM *v) : _sharedstate(ss), _prev(ss->_executingvm) { ss->_executingvm = v; }
+    ~AutoExecutingVM() { _sharedstate->_executingvm = _prev; }
+    SQSharedState *_sharedstate;
+    SQVM *_prev;
+};
+
 template <bool debughookPresent>
 bool SQVM::Execute(const SQObjectPtr &closure, SQInteger nargs, SQInteger stackbase,SQObjectPtr &outres, SQBool invoke_err_handler,ExecutionType et)
 {
@@ -954,6 +1069,7 @@ bool SQVM::Execute(const SQObjectPtr &closure, SQInteger nargs, SQInteger stackb
     if ((_nnativecalls + 1) > MAX_NATIVE_CALLS) { Raise_Error("Native stack overflow"); return false; }
     _nnativecalls++;
     AutoDec ad(&_nnativecalls);
+    AutoExecutingVM aev(_ss(this), this);
     SQInteger traps = 0;
     SQInteger prevci_idx = _callsstacksize;
 
@@ -1262,6 +1378,17 @@ exception_restore:
                         }
                     }
                 }
+#if SQ_TABLE_SHAPES
+                else if (sqType == OT_TABLE && _table(from)->_shape && !(from._flags & SQOBJ_FLAG_IMMUTABLE))
+                {
+                    SQObjectPtr *slot = _table(from)->GetShapeSlotFromHint(hintP, key);
+                    if (slot) {
+                        *slot = val;
+                    } else {
+                        if (!Set(from, key, val)) { SQ_THROW(); }
+                    }
+                }
+#endif
                 else if (sqType == OT_TABLE &&  !(from._flags & SQOBJ_FLAG_IMMUTABLE))//for wrong access go to normal Set
                 {
                     SQTable *__restrict tbl = _table(from);
@@ -1272,7 +1399,7 @@ exception_restore:
                         if (SQ_LIKELY((cid & TBL_CLASS_CLASS_MASK) == (hint & TBL_CLASS_CLASS_MASK))) {
                             node = tbl->GetNodeFromTypeHint(hint, key);
                         } else {
-                            node = tbl->_GetStr(_rawval(key), _string(key)->_hash & tbl->_numofnodes_minus_one);
+                            node = tbl->_GetStr(_rawval(key), _string(key)->_hash);
                             if (SQ_LIKELY(node)) {
                                 size_t nodeIdx = node - tbl->_nodes;
                                 assert(nodeIdx <= TBL_CLASS_TYPE_MEMBER_MASK);
@@ -1347,6 +1474,20 @@ exception_restore:
                     }
                     propagate_immutable(from, temp_reg);
                 }
+#if SQ_TABLE_SHAPES
+                else if (sqType == OT_TABLE && _table(from)->_shape)
+                {
+                    const SQObjectPtr *slot = _table(from)->GetShapeSlotFromHint(hintP, key);
+                    if (slot) {
+                        temp_reg = _realval(*slot);
+                        propagate_immutable(from, temp_reg);
+                    } else {
+                        if (!Get(from, key, temp_reg, getFlagsByOp)) {
+                            SQ_THROW();
+                        }
+                    }
+                }
+#endif
                 else if (sqType == OT_TABLE)
                 {
                     SQTable *__restrict tbl = _table(from);
@@ -1357,7 +1498,7 @@ exception_restore:
                         if (SQ_LIKELY((cid & TBL_CLASS_CLASS_MASK) == (hint & TBL_CLASS_CLASS_MASK))) {
                             node = tbl->GetNodeFromTypeHint(hint, key);
                         } else {
-                            node = tbl->_GetStr(_rawval(key), _string(key)->_hash & tbl->_numofnodes_minus_one);
+                            node = tbl->_GetStr(_rawval(key), _string(key)->_hash);
                             if (SQ_LIKELY(node)) {
                                 size_t nodeIdx = node - tbl->_nodes;
                                 assert(nodeIdx <= TBL_CLASS_TYPE_MEMBER_MASK);
@@ -1421,8 +1562,10 @@ exception_restore:
             case _OP_DIV: _ARITH_NOZERO(/,TARGET,STK(arg2),STK(arg1)); continue;
             case _OP_MOD: _GUARD(ARITH_OP('%',TARGET,STK(arg2),STK(arg1))); continue;
             case _OP_BITW:  _GUARD(BW_OP( arg3,TARGET,STK(arg2),STK(arg1))); continue;
+            case _OP_CONCATN: SYNC_IP(); _GUARD(StringCatN(&STK(arg1), arg2, TARGET)); continue;
             case _OP_RETURN:
                 SQ_WATCHDOG_CHECK();
+                SQ_MEMLIMIT_CHECK();
                 if((ci)->_generator) {
                     (ci)->_generator->Kill();
                 }
@@ -1454,6 +1597,7 @@ exception_restore:
                 _GUARD(CMP_OP_RES((CmpOP)(uArg3&7),STK(arg2),STK(arg0),r));
                 if(uint8_t(bool(r)) == (uArg3>>3)) {
                     SQ_WATCHDOG_CHECK();
+                    SQ_MEMLIMIT_CHECK();
                     _ip+=(sarg1);
                 }
                 }
@@ -1464,6 +1608,7 @@ exception_restore:
                 _GUARD(CMP_OP_RES((CmpOP)(uArg3&7),STK(arg2),ci->_literals[arg0],r));
                 if(uint8_t(bool(r)) == (uArg3>>3)) {
                     SQ_WATCHDOG_CHECK();
+                    SQ_MEMLIMIT_CHECK();
                     _ip+=(sarg1);
                 }
                 }
@@ -1475,6 +1620,7 @@ exception_restore:
                 _GUARD(CMP_OP_RESI((CmpOP)(uArg3&7),STK(arg2), (SQInteger)sarg1, r));
                 if(uint8_t(bool(r)) == (uArg3>>3)) {
                     SQ_WATCHDOG_CHECK();
+                    SQ_MEMLIMIT_CHECK();
                     _ip+=(sarg0);
                 }
                 }
@@ -1486,12 +1632,14 @@ exception_restore:
                 _GUARD(CMP_OP_RESF((CmpOP)(uArg3&7),STK(arg2), farg1, r));
                 if(uint8_t(bool(r)) == (uArg3>>3)) {
                     SQ_WATCHDOG_CHECK();
+                    SQ_MEMLIMIT_CHECK();
                     _ip+=(sarg0);
                 }
                 }
                 continue;
             case _OP_JZ: {
               SQ_WATCHDOG_CHECK();
+              SQ_MEMLIMIT_CHECK();
               if(uint8_t(IsFalse(STK(arg0))) != arg2) {
                   _ip+=(sarg1);
               }
@@ -1514,8 +1662,9 @@ exception_restore:
                 }
             continue;
             case _OP_NEWOBJ:
+                SYNC_IP();
                 switch(arg3) {
-                    case NEWOBJ_TABLE: TARGET = SQTable::Create(_ss(this), arg1 ? arg1 + 1 : 0); continue;
+                    case NEWOBJ_TABLE: TARGET = arg1 ? SQTable::CreateLiteral(_ss(this), arg1) : SQTable::Create(_ss(this), 0); continue;
                     case NEWOBJ_ARRAY: TARGET = SQArray::Create(_ss(this), 0); _array(TARGET)->Reserve(arg1); continue;
                     case NEWOBJ_CLASS: _GUARD(CLASS_OP(TARGET,arg1)); continue;
                     default: assert(0); continue;
@@ -1630,6 +1779,7 @@ exception_restore:
                 Raise_Error("attempt to perform a bitwise op on a %s", GetTypeName(STK(arg1)));
                 SQ_THROW();
             case _OP_CLOSURE: {
+                SYNC_IP();
                 SQClosure *c = ci->_closure._unVal.pClosure;
                 SQFunctionProto *fp = c->_function;
                 if(!CLOSURE_OP(TARGET,fp->_functions[arg1]._unVal.pFunctionProto)) { SQ_THROW(); }
@@ -1692,7 +1842,30 @@ exception_restore:
                 if (tojump == 1)
                     _ip += jumpToBodyOffset;
                 }continue;
-            case _OP_CLONE: _GUARD(Clone(STK(arg1), TARGET)); continue;
+            case _OP_CLONE: SYNC_IP(); _GUARD(Clone(STK(arg1), TARGET)); continue;
+            case _OP_MERGE: {
+                    SQObjectPtr &self = STK(arg2);
+                    bool plain = sq_type(self) == OT_TABLE && !_table(self)->_delegate
+                        && ((arg3 & MERGE_FLAG_TYPE_METHOD) || !_table(self)->Get(ci->_literals[arg1], temp_reg));
+                    if ((arg3 & MERGE_STEP_MASK) == MERGE_BEGIN) {
+                        if (plain) {
+                            // __merge() copies values through sq_next(), which doesn't keep weak references
+                            TARGET = _table(self)->Clone();
+                            _table(TARGET)->ResolveWeakRefs();
+                        }
+                        else
+                            TARGET = SQTable::Create(_ss(this), 0);
+                    }
+                    else if (!plain) {
+                        if (arg3 & MERGE_FLAG_FREEZE_LITERAL)
+                            TARGET._flags |= SQOBJ_FLAG_IMMUTABLE;
+                        SYNC_IP();
+                        _GUARD(MergeCall(self, ci->_literals[arg1], TARGET, (arg3 & MERGE_FLAG_TYPE_METHOD) != 0, temp_reg));
+                        RELOAD_STK();
+                        TARGET = temp_reg;
+                    }
+                }
+                continue;
             case _OP_TYPEOF: _GUARD(TypeOf(STK(arg1), TARGET)) continue;
             case _OP_PUSHTRAP:{
                 _etraps.push_back(SQExceptionTrap(_top,_stackbase, _ip+arg1, arg0)); traps++;
@@ -2012,6 +2185,9 @@ bool SQVM::CallNative(SQNativeClosure *nclosure, SQInteger nargs, SQInteger newb
     }
     LeaveFrame();
 
+    if (!CheckMemoryLimit())
+        return false;
+
 #if SQ_RUNTIME_TYPE_CHECK
     if (target != -1) {
         if (!check_typemask(sq_type(retval), nclosure->_result_type_mask)) {
@@ -2383,6 +2559,19 @@ cloned_mt:
 }
 
 
+// the generic path of _OP_MERGE, self.__merge(literal)
+bool SQVM::MergeCall(const SQObjectPtr &self, const SQObjectPtr &key, const SQObjectPtr &literal, bool typeMethod, SQObjectPtr &res)
+{
+    SQObjectPtr closure;
+    if (!Get(self, key, closure, typeMethod ? GET_FLAG_TYPE_METHODS_ONLY : 0))
+        return false;
+    Push(self);
+    Push(literal);
+    bool ok = Call(closure, 2, _top - 2, res, SQFalse);
+    Pop(2);
+    return ok;
+}
+
 bool SQVM::NewSlot(const SQObjectPtr &self,const SQObjectPtr &key,const SQObjectPtr &val,bool bstatic)
 {
     if (self._flags & SQOBJ_FLAG_IMMUTABLE) {
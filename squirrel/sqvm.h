@@ -89,8 +89,10 @@ public:
     bool NewSlot(const SQObjectPtr &self, const SQObjectPtr &key, const SQObjectPtr &val,bool bstatic);
     bool DeleteSlot(const SQObjectPtr &self, const SQObjectPtr &key, SQObjectPtr &res);
     bool Clone(const SQObjectPtr &self, SQObjectPtr &target);
+    bool MergeCall(const SQObjectPtr &self, const SQObjectPtr &key, const SQObjectPtr &literal, bool typeMethod, SQObjectPtr &res);
     bool ObjCmp(const SQObjectPtr &o1, const SQObjectPtr &o2,SQInteger &res);
     bool StringCat(const SQObjectPtr &str, const SQObjectPtr &obj, SQObjectPtr &dest);
+    bool StringCatN(SQObjectPtr *args, SQInteger n, SQObjectPtr &dest, const char *sep = NULL, SQInteger sep_len = 0);
     static bool IsEqual(const SQObject &o1,const SQObject &o2);
     static bool IsInstanceOf(const SQObject &obj, const SQClass *cls);
     bool ToString(const SQObjectPtr &o,SQObjectPtr &res);
@@ -171,6 +173,10 @@ public:
     inline void ValidateThreadAccess() {}
     #endif
 
+    bool CheckMemoryLimit();
+    // for allocations whose size is controlled by script, check before allocating
+    bool CheckMemoryLimit(SQUnsignedInteger count, SQUnsignedInteger itemSize);
+
     inline bool CanAccessFromThisThread() {
         #if SQ_CHECK_THREAD >= SQ_CHECK_THREAD_LEVEL_FAST
         if (_nnativecalls && _get_current_thread_id_func)
@@ -0,0 +1,99 @@
+/*
+
+Allocation-heavy workload: lots of short-lived small tables, arrays, strings,
+closures and instances.
+Compare the default build with one configured with -DENABLE_POOL_ALLOCATOR=OFF
+(plain libc malloc) to see the difference made by the size-class pooled allocator.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+class Vec {
+  x = 0
+  y = 0
+  constructor(x_, y_) {
+    this.x = x_
+    this.y = y_
+  }
+}
+
+function tables(iters) {
+  local res
+  for (local i = 0; i < iters; ++i)
+    res = {a = i, b = i + 1, c = "c"}
+  return res
+}
+
+function arrays(iters) {
+  local res
+  for (local i = 0; i < iters; ++i)
+    res = [i, i + 1, i + 2, i + 3]
+  return res
+}
+
+function strings(iters) {
+  local res
+  for (local i = 0; i < iters; ++i)
+    res = $"key_{i}"
+  return res
+}
+
+function closures(iters) {
+  local res
+  for (local i = 0; i < iters; ++i)
+    res = @() i
+  return res
+}
+
+function instances(iters) {
+  local res
+  for (local i = 0; i < iters; ++i)
+    res = Vec(i, i)
+  return res
+}
+
+function growing_tables(iters) {
+  local res
+  for (local i = 0; i < iters / 16; ++i) {
+    res = {}
+    for (local j = 0; j < 16; ++j)
+      res[j] <- j
+  }
+  return res
+}
+
+function mixed_retained(iters) {
+  let keep = []
+  for (local i = 0; i < iters; ++i) {
+    keep.append({id = i, pos = [i, i], name = $"obj{i % 100}"})
+    if (keep.len() > 1000)
+      keep.remove(i % 1000)
+  }
+  return keep.len()
+}
+
+const numTests = 10
+const iters = 200000
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"small tables\"", @() tables(iters))
+profile("\"small arrays\"", @() arrays(iters))
+profile("\"strings\"", @() strings(iters))
+profile("\"closures\"", @() closures(iters))
+profile("\"instances\"", @() instances(iters))
+profile("\"growing tables\"", @() growing_tables(iters))
+profile("\"mixed retained\"", @() mixed_retained(iters))
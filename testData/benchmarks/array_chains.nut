@@ -0,0 +1,72 @@
+/*
+
+map()/filter()/reduce()/each() chains over an array of 1M records, the same
+pipelines as proposed_optimizations/filter_map_folding.nut but with an array
+source, next to the hand written loop. Run with and without -optCF to see
+what fusing the chains into a single loop gives.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let testdata = freeze(array(17*60005).map(@(_, i) {key = i}))
+
+function test_chain() {
+  return testdata
+    .map(@(v) v.key)
+    .filter(@(r) r % 17 == 0)
+    .map(@(r, i) (r * 1000 - i) / 30)
+    .reduce(@(res, v) res + (v % 2 == 0 ? 1 : -1) * v, 0)
+}
+
+function test_loop() {
+  local res = 0
+  local i = 0
+  foreach (v in testdata) {
+    let r = v.key
+    if (r % 17 != 0)
+      continue
+    let x = (r * 1000 - i) / 30
+    i++
+    res += (x % 2 == 0 ? 1 : -1) * x
+  }
+  return res
+}
+
+function test_map_only() {
+  return testdata.map(@(v) v.key * 2)
+}
+
+function test_filter_map() {
+  return testdata.filter(@(v) v.key % 3 == 0).map(@(v) v.key)
+}
+
+function test_each() {
+  local sum = 0
+  testdata.filter(@(v) v.key % 2 == 0).each(@(v) sum += v.key)
+  return sum
+}
+
+assert(test_chain() == test_loop())
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"map.filter.map.reduce\"", test_chain)
+profile("\"hand written loop\"", test_loop)
+profile("\"map\"", test_map_only)
+profile("\"filter.map\"", test_filter_map)
+profile("\"filter.each\"", test_each)
@@ -0,0 +1,91 @@
+/*
+
+array.sort() on 100k elements: plain integers, floats and strings without a
+compare function, a leaderboard of records sorted by score with a compare
+function, with sort_stable() and with sort_by(), and input that is already
+sorted.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+
+local seed = 1
+function rnd() {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff
+  return seed
+}
+
+let ints = array(N).map(@(_) rnd() % 1000000)
+let floats = ints.map(@(x) x * 0.001)
+let strings = ints.map(@(x) $"player{x}")
+let records = ints.map(@(x, i) {score = x % 5000, id = i})
+let sorted = clone ints
+sorted.sort()
+let mixed = ints.map(@(x, i) i % 2 ? x : x + 0.5)
+
+function sort_ints() {
+  let a = clone ints
+  a.sort()
+}
+
+function sort_floats() {
+  let a = clone floats
+  a.sort()
+}
+
+function sort_strings() {
+  let a = clone strings
+  a.sort()
+}
+
+function sort_mixed() {
+  let a = clone mixed
+  a.sort()
+}
+
+function sort_sorted() {
+  let a = clone sorted
+  a.sort()
+}
+
+function sort_records_cmp() {
+  let a = clone records
+  a.sort(@(x, y) y.score <=> x.score)
+}
+
+function sort_records_stable() {
+  let a = clone records
+  a.sort_stable(@(x, y) y.score <=> x.score)
+}
+
+function sort_records_by() {
+  let a = clone records
+  a.sort_by(@(r) -r.score)
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"ints\"", sort_ints)
+profile("\"floats\"", sort_floats)
+profile("\"strings\"", sort_strings)
+profile("\"mixed numbers\"", sort_mixed)
+profile("\"already sorted\"", sort_sorted)
+profile("\"records, compare func\"", sort_records_cmp)
+profile("\"records, sort_stable\"", sort_records_stable)
+profile("\"records, sort_by\"", sort_records_by)
@@ -0,0 +1,81 @@
+/*
+
+json.parse()/json.stringify() over an array of 20000 small records (about 3MB of text),
+next to writing and reading the same data with the binary stream serializer.
+
+*/
+
+let {clock} = require("datetime")
+let {parse, stringify} = require("json")
+let {blob} = require("iostream")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let data = array(20000).map(@(_, i) {
+  id = i
+  name = $"record number {i}"
+  active = i % 3 == 0
+  score = i / 7.0
+  tags = ["alpha", "beta", i % 5 == 0 ? "gamma" : "delta"]
+  pos = {x = i % 100, y = i / 100, label = "line\tbreak\n"}
+})
+let text = stringify(data)
+let serialized = blob()
+serialized.writeobject(data)
+
+function test_parse() {
+  return parse(text)
+}
+
+function test_parse_frozen() {
+  return parse(text, {frozen = true})
+}
+
+function test_stringify() {
+  return stringify(data)
+}
+
+function test_stringify_pretty() {
+  return stringify(data, {pretty = true, sort_keys = true})
+}
+
+function test_stringify_stream() {
+  let out = blob()
+  stringify(data, {stream = out})
+  return out
+}
+
+function test_writeobject() {
+  let out = blob()
+  out.writeobject(data)
+  return out
+}
+
+function test_readobject() {
+  serialized.seek(0)
+  return serialized.readobject()
+}
+
+assert(stringify(test_parse()) == text)
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"json parse\"", test_parse)
+profile("\"json parse frozen\"", test_parse_frozen)
+profile("\"json stringify\"", test_stringify)
+profile("\"json stringify pretty sorted\"", test_stringify_pretty)
+profile("\"json stringify to blob\"", test_stringify_stream)
+profile("\"serializer writeobject\"", test_writeobject)
+profile("\"serializer readobject\"", test_readobject)
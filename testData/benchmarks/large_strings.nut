@@ -0,0 +1,69 @@
+/*
+
+Strings of a few megabytes: joining them, taking halves and whole-string slices,
+splitting into lines and comparing. Strings this long skip the string table, so
+creating one is a single copy without hashing the contents.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let lines = array(40000).map(@(_, i) $"line {i}: some text that makes the line long enough to matter")
+let text = "\n".join(lines)
+
+function test_join() {
+  local n = 0
+  for (local i = 0; i < 20; i++)
+    n += "\n".join(lines).len()
+  return n
+}
+
+function test_slice() {
+  local n = 0
+  let half = text.len() / 2
+  for (local i = 0; i < 50; i++)
+    n += text.slice(i, half + i).len() + text.slice(half - i).len() + text.slice(0).len()
+  return n
+}
+
+function test_concat() {
+  local n = 0
+  for (local i = 0; i < 20; i++)
+    n += (text + i).len()
+  return n
+}
+
+function test_split() {
+  return text.split("\n").len()
+}
+
+function test_compare() {
+  let copy = "".concat(text.slice(0, 100), text.slice(100))
+  local n = 0
+  for (local i = 0; i < 100; i++)
+    if (copy == text)
+      n++
+  return n
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"join\"", test_join)
+profile("\"slice\"", test_slice)
+profile("\"concat\"", test_concat)
+profile("\"split\"", test_split)
+profile("\"compare\"", test_compare)
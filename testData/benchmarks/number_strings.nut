@@ -0,0 +1,75 @@
+/*
+
+Numbers to text and back: telemetry like lines with integers and floats built with
+string interpolation, format() and stringbuilder, and parsed back with tointeger() and
+tofloat(). All of these go through the shared number conversion code.
+
+*/
+
+let {clock} = require("datetime")
+let {format, stringbuilder} = require("string")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+let values = array(N).map(@(_, i) i * 1.37 - 5000.25)
+
+function test_tostring() {
+  local n = 0
+  foreach (i, f in values)
+    n += f.tostring().len() + i.tostring().len()
+  return n
+}
+
+function test_interpolation() {
+  local n = 0
+  foreach (i, f in values)
+    n += $"id={i} value={f} half={f / 2}".len()
+  return n
+}
+
+function test_format() {
+  local n = 0
+  foreach (i, f in values)
+    n += format("%d;%.2f;%g", i, f, f).len()
+  return n
+}
+
+function test_builder() {
+  let sb = stringbuilder()
+  foreach (i, f in values)
+    sb.append(i, ";", f, "\n")
+  return sb.len()
+}
+
+let int_strings = values.map(@(_, i) (i * 7919).tostring())
+let float_strings = values.map(@(f) f.tostring())
+
+function test_parse() {
+  local n = 0.0
+  foreach (s in int_strings)
+    n += s.tointeger()
+  foreach (s in float_strings)
+    n += s.tofloat()
+  return n
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"tostring\"", test_tostring)
+profile("\"interpolation\"", test_interpolation)
+profile("\"format\"", test_format)
+profile("\"stringbuilder\"", test_builder)
+profile("\"parse\"", test_parse)
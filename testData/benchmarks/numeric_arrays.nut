@@ -0,0 +1,76 @@
+/*
+
+Arrays that only hold floats or only integers: building, reading, writing,
+sorting and the memory they take. Such arrays keep raw 8-byte values instead
+of full objects until something else is written into them.
+
+*/
+
+let {clock} = require("datetime")
+let {get_memory_stats} = require("debug")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 200000
+
+let memBefore = get_memory_stats().used
+let floats = array(N).map(@(_, i) (i * 7919 % N) * 0.5)
+println($"\"bytes per element\", {(get_memory_stats().used - memBefore) / N}")
+let ints = floats.map(@(x) x.tointeger())
+
+function build() {
+  let a = []
+  for (local i = 0; i < N; ++i)
+    a.append(i * 0.25)
+  return a
+}
+
+function sum_foreach() {
+  local s = 0.0
+  foreach (x in floats)
+    s += x
+  return s
+}
+
+function sum_index() {
+  local s = 0
+  for (local i = 0; i < N; ++i)
+    s += ints[i]
+  return s
+}
+
+function scale() {
+  for (local i = 0; i < N; ++i)
+    floats[i] = floats[i] * 1.0
+}
+
+function sort_ints() {
+  let a = clone ints
+  a.sort()
+  return a
+}
+
+function reduce_floats() {
+  return floats.reduce(@(acc, x) acc + x, 0.0)
+}
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"build\"", build)
+profile("\"sum foreach\"", sum_foreach)
+profile("\"sum index\"", sum_index)
+profile("\"scale\"", scale)
+profile("\"sort ints\"", sort_ints)
+profile("\"reduce\"", reduce_floats)
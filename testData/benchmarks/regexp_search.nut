@@ -0,0 +1,55 @@
+/*
+
+regexp searches over chat and log lines: filters with a literal prefix, ones starting
+with a char class, ones that rarely match, and a nested quantifier over a long line
+that has no match. Searches only run the matcher where a match can start.
+
+*/
+
+let {clock} = require("datetime")
+let {regexp} = require("string")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let words = ["hello", "team", "push", "mid", "gg", "wp", "need", "heal", "lag", "again", "nice", "shot", "left", "right"]
+let lines = array(20000).map(function(_, i) {
+  let n = 6 + i % 9
+  let msg = " ".join(array(n).map(@(_, k) words[(i * 7 + k * 3) % words.len()]))
+  return $"[{i % 24}:{i % 60}] player{i % 97}: {msg}" + (i % 50 == 0 ? $" error code {i}" : "")
+})
+
+function count(pat) {
+  let r = regexp(pat)
+  local n = 0
+  foreach (l in lines)
+    if (r.search(l) != null)
+      n++
+  return n
+}
+
+let as = "".join(array(3000, "a")) + "c"
+function nested() {
+  let r = regexp("(a*)*b")
+  for (local i = 0; i < 10; i++)
+    r.search(as)
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"literal\"", @() count("error code \\d+"))
+profile("\"word\"", @() count("player\\d+: heal"))
+profile("\"class\"", @() count("\\d+ \\w+ again"))
+profile("\"rare\"", @() count("[xyz]+q"))
+profile("\"nested quantifiers\"", nested)
@@ -0,0 +1,81 @@
+/*
+
+blob.writeobject()/readobject() of a snapshot like state: 20000 records with
+repeated keys and string values, numeric arrays and a large packed array.
+Also reading it with objectreader in 64K steps and lazily, looking at one record.
+Prints the encoded size too.
+
+*/
+
+let {clock} = require("datetime")
+let {blob, objectreader} = require("iostream")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let kinds = ["tank", "plane", "ship", "helicopter"]
+let records = array(20000).map(@(_, i) {
+  id = 1000000 + i
+  kind = kinds[i % kinds.len()]
+  name = $"unit_{i % 500}"
+  alive = i % 7 != 0
+  hp = (i * 37) % 1000
+  pos = [i * 0.5, (i % 100) * 1.25, 0.0]
+  crew = [i % 3, i % 5, i % 11, 123456 + i]
+})
+let snapshot = {
+  records
+  ids = array(100000).map(@(_, i) 5000000 + i * 3)
+  heights = array(100000).map(@(_, i) (i % 1000) / 8.0)
+}
+
+local encoded = blob()
+encoded.writeobject(snapshot)
+
+function test_write() {
+  let b = blob()
+  b.writeobject(snapshot)
+  return b
+}
+
+function test_read() {
+  encoded.seek(0)
+  return encoded.readobject()
+}
+
+function test_read_steps() {
+  encoded.seek(0)
+  let r = objectreader(encoded)
+  while (!r.step(65536)) {}
+  return r.result()
+}
+
+function test_read_lazy() {
+  encoded.seek(0)
+  let r = objectreader(encoded, null, true)
+  while (!r.step(65536)) {}
+  return r.result().records[777].name
+}
+
+let back = test_read()
+assert(back.records.len() == records.len() && back.records[777].name == records[777].name
+  && back.ids[99999] == snapshot.ids[99999] && back.heights[555] == snapshot.heights[555])
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+println($"encoded size {encoded.len()}")
+profile("\"writeobject\"", test_write)
+profile("\"readobject\"", test_read)
+profile("\"objectreader steps\"", test_read_steps)
+profile("\"objectreader lazy\"", test_read_lazy)
@@ -0,0 +1,56 @@
+/*
+
+Building a ~500KB CSV like text from 20000 rows: `s += piece` in a loop creates and
+interns a new string per step, stringbuilder appends to one buffer and creates the
+string once, collecting the pieces into an array for "".join() is the usual workaround.
+
+*/
+
+let {clock} = require("datetime")
+let {stringbuilder} = require("string")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const rows = 20000
+
+function test_plus() {
+  local s = ""
+  for (local i = 0; i < rows; i++)
+    s += "".concat(i, ",", i * 0.5, ",name", i % 7, "\n")
+  return s
+}
+
+function test_join() {
+  let parts = []
+  for (local i = 0; i < rows; i++)
+    parts.append("".concat(i, ",", i * 0.5, ",name", i % 7, "\n"))
+  return "".join(parts)
+}
+
+function test_builder() {
+  let sb = stringbuilder()
+  for (local i = 0; i < rows; i++)
+    sb.append(i, ",", i * 0.5, ",name", i % 7, "\n")
+  return sb.tostring()
+}
+
+assert(test_plus() == test_builder())
+assert(test_join() == test_builder())
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"s += piece\"", test_plus)
+profile("\"array + join\"", test_join)
+profile("\"stringbuilder\"", test_builder)
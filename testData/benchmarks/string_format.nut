@@ -0,0 +1,78 @@
+/*
+
+Log lines built with format(), printf() style: a handful of format strings used over
+and over with a mix of string, integer and float arguments. The format strings are
+parsed once and reused, so the time here is mostly printing the arguments.
+
+*/
+
+let {clock} = require("datetime")
+let {format, stringbuilder} = require("string")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+let levels = ["debug", "info", "warning", "error"]
+let modules = ["net", "render", "physics", "ui", "sound"]
+
+function test_short() {
+  local n = 0
+  for (local i = 0; i < N; i++)
+    n += format("[%s] %s", levels[i % 4], modules[i % 5]).len()
+  return n
+}
+
+function test_log_line() {
+  local n = 0
+  for (local i = 0; i < N; i++)
+    n += format("[%s] %s: frame %d took %.2f ms (%d draw calls)", levels[i % 4], modules[i % 5], i, i * 0.013, i % 977).len()
+  return n
+}
+
+function test_padded() {
+  local n = 0
+  for (local i = 0; i < N; i++)
+    n += format("%-8s|%6d|%08.3f|%x", levels[i % 4], i, i * 0.5, i).len()
+  return n
+}
+
+function test_mixed() {
+  // several format strings in turn, like a few log call sites
+  local n = 0
+  for (local i = 0; i < N; i++) {
+    if (i % 3 == 0)
+      n += format("player %s joined team %d", modules[i % 5], i % 2).len()
+    else if (i % 3 == 1)
+      n += format("packet %d: %d bytes, rtt %.1f ms", i, i % 1500, i * 0.01).len()
+    else
+      n += format("%s: %s", levels[i % 4], "connection lost").len()
+  }
+  return n
+}
+
+function test_appendf() {
+  let sb = stringbuilder()
+  for (local i = 0; i < N; i++)
+    sb.appendf("[%s] %s: frame %d\n", levels[i % 4], modules[i % 5], i)
+  return sb.len()
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"short\"", test_short)
+profile("\"log line\"", test_log_line)
+profile("\"padded\"", test_padded)
+profile("\"mixed\"", test_mixed)
+profile("\"appendf\"", test_appendf)
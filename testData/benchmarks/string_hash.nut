@@ -0,0 +1,90 @@
+/*
+
+String hashing: interning throughput and collisions.
+Run with the default build and with -DENABLE_LEGACY_STRING_HASH=ON.
+The legacy hash samples only every (len/32+1)-th character of long strings, so the
+"adversarial" key sets below (long keys differing in a single character) produce
+lots of identical hashes and degrade table lookups into linear chain scans.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let pad = "x".join(array(40, "abcdefgh"))
+
+function short_keys(n) {
+  return array(n).map(@(_, i) $"k{i}")
+}
+
+function path_keys(n) {
+  return array(n).map(@(_, i) $"/game/content/levels/common/textures/{i}/diffuse_albedo.dds")
+}
+
+function adversarial_keys(n) {
+  // differ only in a single character in the middle of a long string
+  let chars = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  let res = []
+  foreach (c1 in chars)
+    foreach (c2 in chars) {
+      if (res.len() >= n)
+        return res
+      res.append("".concat(pad.slice(0, 101), c1.tochar(), pad.slice(102, 203), c2.tochar(), pad.slice(204)))
+    }
+  return res
+}
+
+function count_collisions(keys) {
+  let hashes = {}
+  foreach (k in keys)
+    hashes[k.hash()] <- true
+  return keys.len() - hashes.len()
+}
+
+function intern(parts) {
+  local res
+  foreach (p in parts)
+    res = "".concat(p, "!")
+  return res
+}
+
+function lookup(keys, iters) {
+  let t = {}
+  foreach (i, k in keys)
+    t[k] <- i
+  local sum = 0
+  for (local j = 0; j < iters; ++j)
+    foreach (k in keys)
+      sum += t[k]
+  return sum
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+
+let short = short_keys(100000)
+let paths = path_keys(100000)
+let adversarial = adversarial_keys(3000)
+
+println("".concat("\"collisions short\", ", count_collisions(short), ", ", short.len()))
+println("".concat("\"collisions paths\", ", count_collisions(paths), ", ", paths.len()))
+println("".concat("\"collisions adversarial\", ", count_collisions(adversarial), ", ", adversarial.len()))
+
+profile("\"intern short\"", @() intern(short))
+profile("\"intern paths\"", @() intern(paths))
+profile("\"intern adversarial\"", @() intern(adversarial))
+profile("\"lookup paths\"", @() lookup(paths.slice(0, 3000), 10))
+profile("\"lookup adversarial\"", @() lookup(adversarial, 10))
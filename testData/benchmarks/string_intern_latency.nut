@@ -0,0 +1,52 @@
+/*
+
+String interning stress test.
+Interns a few million unique strings in small batches and reports the total time
+and the slowest batch. Growing the string table used to rehash all interned strings
+in one go, which showed up as a latency spike proportional to the table size;
+with incremental rehashing the slowest batch should stay close to the average one.
+
+*/
+
+let {clock} = require("datetime")
+
+const numStrings = 2097152
+const batchSize = 256
+
+function intern_batches(keep) {
+  local worst = 0.0
+  let start = clock()
+  for (local i = 0; i < numStrings; i += batchSize) {
+    let batchStart = clock()
+    for (local j = i; j < i + batchSize; ++j)
+      keep[j] = $"interned_string_{j}"
+    let t = clock() - batchStart
+    if (t > worst)
+      worst = t
+  }
+  return { total = clock() - start, worst }
+}
+
+function release_batches(keep) {
+  local worst = 0.0
+  let start = clock()
+  for (local i = 0; i < numStrings; i += batchSize) {
+    let batchStart = clock()
+    for (local j = i; j < i + batchSize; ++j)
+      keep[j] = null
+    let t = clock() - batchStart
+    if (t > worst)
+      worst = t
+  }
+  return { total = clock() - start, worst }
+}
+
+let keep = array(numStrings)
+let add = intern_batches(keep)
+let avgBatches = numStrings / batchSize
+println("".concat("\"intern total\", ", add.total))
+println("".concat("\"intern avg batch\", ", add.total / avgBatches))
+println("".concat("\"intern worst batch\", ", add.worst))
+let rem = release_batches(keep)
+println("".concat("\"release total\", ", rem.total))
+println("".concat("\"release worst batch\", ", rem.worst))
@@ -0,0 +1,92 @@
+/*
+
+Searching and splitting text the way chat filters and localisation code do it: a 1MB
+chat log is searched for words that are rare or not there at all, split into lines and
+words, lowercased and escaped. The scans compare 16 chars at a time where SSE2 is
+available, the long runs between matches are where it shows.
+
+*/
+
+let {clock} = require("datetime")
+let {split_by_chars, escape} = require("string")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let words = ["hello", "Team", "push", "mid", "the", "Objective", "captured", "go", "left", "flank", "nice", "shot", "reload"]
+let lines = []
+local seed = 1
+for (local i = 0; i < 20000; i++) {
+  let line = []
+  for (local j = 0; j < 8; j++) {
+    seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+    line.append(words[(seed >> 8) % words.len()])
+  }
+  lines.append($"[{i % 60}:{i % 24}] Player{i % 97}: {" ".join(line)}")
+}
+let log = "\n".join(lines)
+
+function test_indexof() {
+  local n = 0
+  foreach (w in ["forbidden", "captured!", "Player96: reload", "zzz"])
+    for (local i = log.indexof(w); i != null; i = log.indexof(w, i + 1))
+      n++
+  return n
+}
+
+function test_contains() {
+  local n = 0
+  foreach (line in lines)
+    if (line.contains("Objective captured"))
+      n++
+  return n
+}
+
+function test_replace() {
+  return log.replace("Objective", "Obj").len()
+}
+
+function test_split_lines() {
+  return log.split("\n").len()
+}
+
+function test_split_words() {
+  local n = 0
+  foreach (line in lines)
+    n += line.split().len()
+  return n
+}
+
+function test_split_by_chars() {
+  return split_by_chars(log, " \n:[]", true).len()
+}
+
+function test_case() {
+  return log.tolower().len() + log.toupper().len()
+}
+
+function test_escape() {
+  return escape(log).len()
+}
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"indexof\"", test_indexof)
+profile("\"contains per line\"", test_contains)
+profile("\"replace\"", test_replace)
+profile("\"split lines\"", test_split_lines)
+profile("\"split() words\"", test_split_words)
+profile("\"split_by_chars\"", test_split_by_chars)
+profile("\"tolower + toupper\"", test_case)
+profile("\"escape\"", test_escape)
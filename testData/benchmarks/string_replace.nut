@@ -0,0 +1,91 @@
+/*
+
+Localisation style templating: 2000 strings with a dozen placeholders each get filled
+by a chain of replace() calls, by one replace() with a table of all placeholders, and
+by subst(). Plus replace() over a 100KB text and join()/concat() of numbers, the cases
+where results used to be rebuilt once per occurrence or go through a temporary
+string per item.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+let names = ["player", "team", "score", "kills", "deaths", "map", "mode", "time", "rank", "clan", "vehicle", "reward"]
+let values = {}
+let keyed = {}
+foreach (i, n in names) {
+  values[n] <- $"value{i}"
+  keyed[$"\{{n}\}"] <- $"value{i}"
+}
+let templates = array(2000).map(@(_, i)
+  " ".join(names.map(@(n, j) $"text {i + j} \{{n}\}")))
+let text = "\n".join(array(2000).map(@(_, i) $"line {i}: the quick brown fox jumps over the lazy dog"))
+
+function test_chain() {
+  local total = 0
+  foreach (t in templates) {
+    local s = t
+    foreach (n in names)
+      s = s.replace($"\{{n}\}", values[n])
+    total += s.len()
+  }
+  return total
+}
+
+function test_table() {
+  local total = 0
+  foreach (t in templates)
+    total += t.replace(keyed).len()
+  return total
+}
+
+function test_subst() {
+  local total = 0
+  foreach (t in templates)
+    total += t.subst(values).len()
+  return total
+}
+
+function test_replace_text() {
+  return text.replace("fox", "wolf").len() + text.replace("o", "0").len()
+}
+
+function test_join_numbers() {
+  local total = 0
+  for (local i = 0; i < 2000; i++)
+    total += ",".join([i, i * 0.5, i + 1, i * 2, -i, 7, 8, 9]).len()
+  return total
+}
+
+function test_concat() {
+  local total = 0
+  for (local i = 0; i < 20000; i++)
+    total += " ".concat("item", i, "at", i * 0.25, "x").len()
+  return total
+}
+
+assert(test_chain() == test_table())
+assert(test_chain() == test_subst())
+
+const numTests = 5
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"replace() chain\"", test_chain)
+profile("\"replace(table)\"", test_table)
+profile("\"subst()\"", test_subst)
+profile("\"replace() 100KB\"", test_replace_text)
+profile("\"join() numbers\"", test_join_numbers)
+profile("\"concat()\"", test_concat)
@@ -0,0 +1,99 @@
+/*
+
+Table lookups, inserts, deletes and iteration.
+Compare the default build with one configured with -DENABLE_SWISS_TABLE=ON
+(open addressing with SIMD-probed control bytes instead of chained nodes).
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+let strKeys = array(N).map(@(_, i) $"key_{i}")
+let missKeys = array(N).map(@(_, i) $"miss_{i}")
+
+let strTable = {}
+foreach (i, k in strKeys)
+  strTable[k] <- i
+let intTable = {}
+for (local i = 0; i < N; ++i)
+  intTable[i * 7] <- i
+
+function get_str() {
+  local sum = 0
+  foreach (k in strKeys)
+    sum += strTable[k]
+  return sum
+}
+
+function get_int() {
+  local sum = 0
+  for (local i = 0; i < N; ++i)
+    sum += intTable[i * 7]
+  return sum
+}
+
+function miss_str() {
+  local cnt = 0
+  foreach (k in missKeys)
+    if (k in strTable)
+      ++cnt
+  return cnt
+}
+
+function insert_str() {
+  let t = {}
+  foreach (i, k in strKeys)
+    t[k] <- i
+  return t.len()
+}
+
+function insert_delete() {
+  let t = {}
+  for (local i = 0; i < N; ++i) {
+    t[i] <- i
+    if (i >= 100)
+      t.$rawdelete(i - 100)
+  }
+  return t.len()
+}
+
+function small_tables() {
+  local sum = 0
+  for (local i = 0; i < N; ++i) {
+    let t = {x = i, y = i + 1, z = i + 2}
+    sum += t.x + t.y + t.z
+  }
+  return sum
+}
+
+function iterate() {
+  local sum = 0
+  foreach (k, v in strTable)
+    sum += v
+  return sum
+}
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"get string keys\"", get_str)
+profile("\"get int keys\"", get_int)
+profile("\"miss string keys\"", miss_str)
+profile("\"insert string keys\"", insert_str)
+profile("\"insert/delete\"", insert_delete)
+profile("\"small tables\"", small_tables)
+profile("\"iterate\"", iterate)
@@ -0,0 +1,78 @@
+/*
+
+Tables keyed by consecutive small integers, as in data loaded from configs
+or built with reduce(..., {}). Such keys are kept in the array part of a table.
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+let src = array(N).map(@(_, i) i * 3)
+
+let tbl = src.reduce(function(acc, v, i) { acc[i] <- v; return acc }, {})
+
+function build() {
+  let t = {}
+  for (local i = 0; i < N; ++i)
+    t[i] <- i
+  return t.len()
+}
+
+function build_reduce() {
+  return src.reduce(function(acc, v, i) { acc[i] <- v; return acc }, {}).len()
+}
+
+function get() {
+  local sum = 0
+  for (local i = 0; i < N; ++i)
+    sum += tbl[i]
+  return sum
+}
+
+function set() {
+  for (local i = 0; i < N; ++i)
+    tbl[i] = i
+  return tbl.len()
+}
+
+function increment() {
+  for (local i = 0; i < N; ++i)
+    tbl[i]++
+  return tbl.len()
+}
+
+function iterate() {
+  local sum = 0
+  foreach (k, v in tbl)
+    sum += k + v
+  return sum
+}
+
+function clone_tbl() {
+  return (clone tbl).len()
+}
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"build\"", build)
+profile("\"build with reduce\"", build_reduce)
+profile("\"get\"", get)
+profile("\"set\"", set)
+profile("\"increment\"", increment)
+profile("\"iterate\"", iterate)
+profile("\"clone\"", clone_tbl)
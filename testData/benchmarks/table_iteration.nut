@@ -0,0 +1,77 @@
+/*
+
+foreach over tables, dense ones and ones left sparse by deletions.
+Compare the default build with one configured with -DENABLE_ORDERED_TABLE=ON
+(dense insertion-ordered entries with a separate hash index).
+
+*/
+
+let {clock} = require("datetime")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+
+let dense = {}
+for (local i = 0; i < N; ++i)
+  dense[$"e{i}"] <- i
+
+// like an entity registry after despawns: 70% removed, still not small enough to shrink
+let sparse = clone dense
+for (local i = 0; i < N; ++i)
+  if (i % 10 < 7)
+    sparse.$rawdelete($"e{i}")
+
+let small = {}
+for (local i = 0; i < 32; ++i)
+  small[$"c{i}"] <- i
+
+function iterate(t) {
+  local sum = 0
+  foreach (_, v in t)
+    sum += v
+  return sum
+}
+
+function iterate_small() {
+  local sum = 0
+  for (local i = 0; i < 1000; ++i)
+    foreach (_, v in small)
+      sum += v
+  return sum
+}
+
+function churn() {
+  let t = {}
+  for (local i = 0; i < 1000; ++i)
+    t[i] <- i
+  local sum = 0
+  for (local frame = 0; frame < 100; ++frame) {
+    for (local i = 0; i < 500; ++i)
+      t.$rawdelete(frame * 1000 + i * 2)
+    for (local i = 0; i < 500; ++i)
+      t[(frame + 1) * 1000 + i * 2] <- i
+    foreach (_, v in t)
+      sum += v
+  }
+  return sum
+}
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"iterate dense\"", @() iterate(dense))
+profile("\"iterate sparse\"", @() iterate(sparse))
+profile("\"iterate small\"", iterate_small)
+profile("\"delete/insert/iterate\"", churn)
@@ -0,0 +1,69 @@
+/*
+
+Many small records created from table literals: creation, field reads/writes,
+clone and the memory they take. Literals with the same keys share a shape
+(key layout) and store only their values.
+
+*/
+
+let {clock} = require("datetime")
+let {get_memory_stats} = require("debug")
+
+function profile_it(cnt, f) {//for quirrel version
+  local res = 0
+  for (local i = 0; i < cnt; ++i) {
+    let start = clock()
+    f()
+    let measured = clock() - start
+    if (i == 0 || measured < res)
+      res = measured
+  }
+  return res / 1.0
+}
+
+const N = 100000
+
+function make(i) {
+  return {id = i, x = i * 0.5, y = i * 2.0, name = "item", alive = true}
+}
+
+function create() {
+  let list = array(N)
+  for (local i = 0; i < N; ++i)
+    list[i] = make(i)
+  return list
+}
+
+let memBefore = get_memory_stats().used
+let records = create()
+println($"\"bytes per record\", {(get_memory_stats().used - memBefore) / N}")
+
+function read_fields() {
+  local sum = 0.0
+  foreach (r in records)
+    sum += r.x + r.y + r.id
+  return sum
+}
+
+function write_fields() {
+  foreach (r in records) {
+    r.x += 1.0
+    r.alive = !r.alive
+  }
+}
+
+function clone_records() {
+  local n = 0
+  foreach (r in records)
+    n += (clone r).len()
+  return n
+}
+
+const numTests = 10
+function profile(name, func){
+  println("".concat(name, ", ", profile_it(numTests, func), $", {numTests}"))
+}
+profile("\"create\"", create)
+profile("\"read fields\"", read_fields)
+profile("\"write fields\"", write_fields)
+profile("\"clone\"", clone_records)
@@ -0,0 +1,63 @@
+// map/filter/reduce/each chains on arrays, tests in this directory are compiled with -optCF so they run fused into single loops
+
+let src = [5, 3, 8, 1, 9, 2]
+const LIMIT = 3
+
+function chains(arr: array) {
+  let m = 2
+  return {
+    scaled = arr.map(@(v) v * m).filter(@(x, i) i != 1).map(@(y, j) y + j)
+    sameNames = arr.filter(@(v) v > LIMIT).map(@(v) v * 10)
+    reusedName = arr.filter(@(v) v > LIMIT).map(@(v, i) i).filter(@(v) v > 0)
+    reduceIdx = arr.reduce(@(acc, v, i) acc + v * i)
+    reduceInit = arr.reduce(@(acc, v, i) acc + v * i, 1000)
+    arrays = arr.map(@(v) [v, v]).map(@(p) p[0] + p[1])
+    tables = arr.map(@(v) {x = v}).filter(@(t) t.x > 2).map(@(t) t.x)
+    noParams = arr.filter(@() true).filter(@(v) v).map(@(w, i) w * 100 + i)
+    constant = arr.map(@() 7)
+    emptyReduce = [].map(@(v) v).reduce(@(a, b) a + b, "empty")
+    emptyNoInit = [].filter(@(v) v).reduce(@(a, b) a + b)
+    singleNoInit = [42].map(@(v) v).reduce(@(a, b) a + b)
+    nested = arr.map(@(v) arr.map(@(w) w + v).reduce(@(a, b) a + b))
+  }
+}
+
+let res = chains(src)
+foreach (k in res.keys().sort()) {
+  let r = res[k]
+  println("".concat(k, ": ", type(r) == "array" ? ", ".join(r) : r))
+}
+
+local acc = 10
+println(src.reduce(@(acc, v) acc + v, acc))
+println(src.map(@(v) v).reduce(@(x, y) x + y + acc))
+
+function triple(v) { return v * 3 }
+println(", ".join(src.map(triple)))
+println(", ".join(src.map(@(v) v % 2 ? null : v)))
+
+local sum = 0
+src.filter(@(v) v % 2 == 0).each(@(v) sum += v)
+println(sum)
+
+local indices = []
+src.filter(@(v) v > 2).each(@(v, i) indices.append(i))
+println(", ".join(indices))
+
+println(["b", "a", "c"].map(@(s) s.toupper()).reduce(@(a, b) a + b))
+println(src.map(@(v) v)?.len())
+println(src.filter(@(v) v > 100).len())
+println(src.each(@(v) v))
+
+let holder = { arr = [1, 2] }
+println(holder.arr.map(@(v) v + 1).len())
+
+let frozen = freeze([1, 2, 3])
+let fromFrozen = frozen.map(@(v) v * 2)
+fromFrozen.append(8)
+println(", ".join(fromFrozen))
+
+// fused stages run per element, unfused ones would log all the filter calls first
+let order = []
+src.filter(@(v) order.append($"f{v}") && v > 4).each(@(v) order.append($"e{v}"))
+println(" ".join(order))
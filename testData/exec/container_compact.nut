@@ -0,0 +1,85 @@
+let { get_memory_stats } = require("debug")
+
+function used() {
+  return get_memory_stats().used
+}
+
+// true if less than a tenth of the memory taken since start is still used
+function freed(start, full) {
+  return used() - start < (full - start) / 10
+}
+
+const N = 5000
+
+// deleting most keys shrinks the table, compact() tightens the rest
+local start = used()
+let t = {}
+for (local i = 0; i < N; ++i)
+  t[$"k{i}"] <- i
+let full = used()
+for (local i = 10; i < N; ++i)
+  t.$rawdelete($"k{i}")
+t.compact()
+println($"{t.len()} {t.k0} {t.k9} {"k10" in t} {freed(start, full)}")
+
+// integer keys in the array part
+start = used()
+let ti = {}
+for (local i = 0; i < N; ++i)
+  ti[i] <- i
+let fulli = used()
+for (local i = 5; i < N; ++i)
+  ti.$rawdelete(i)
+println($"{ti.len()} {ti[0]} {ti[4]} {ti?[5]} {freed(start, fulli)}")
+ti[N] <- "big"
+ti.compact()
+println($"{ti.len()} {ti[3]} {ti[N]}")
+
+// clear() gives the memory back
+start = used()
+let tc = {}
+for (local i = 0; i < N; ++i)
+  tc[$"c{i}"] <- i
+let fullc = used()
+tc.clear()
+println($"{tc.len()} {freed(start, fullc)}")
+tc.a <- 1
+println(tc.a)
+
+// arrays
+start = used()
+let a = array(N, 1)
+let fulla = used()
+a.resize(3)
+a.compact()
+println($"{a.len()} {a[2]} {freed(start, fulla)}")
+a.append(5)
+println(a.top())
+
+// recursive compaction goes through nested containers, classes and instances, cycles are fine
+class Holder {
+  items = null
+  constructor() {
+    this.items = []
+  }
+}
+let h = Holder()
+let root = {list = [], inner = {}, holder = h}
+root.self <- root
+for (local i = 0; i < N; ++i) {
+  root.list.append(i)
+  root.inner[$"x{i}"] <- i
+  h.items.append(i)
+}
+root.list.resize(2)
+for (local i = 2; i < N; ++i)
+  root.inner.$rawdelete($"x{i}")
+h.items.resize(2)
+let before = used()
+println(root.compact(true) == root)
+println($"{root.list.len()} {root.inner.len()} {root.inner.x1} {h.items.len()} {root.self == root} {used() < before}")
+
+// frozen containers can be compacted, contents don't change
+let frozen = freeze({p = 1, q = [1, 2, 3]})
+frozen.compact(true)
+println($"{frozen.p} {frozen.q.len()}")
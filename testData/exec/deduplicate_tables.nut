@@ -0,0 +1,59 @@
+// deduplicate_object() makes equal tables share one instance
+
+function count_same(list, item) {
+  local n = 0
+  foreach (t in list)
+    if (t == item)
+      n++
+  return n
+}
+
+let literals = []
+for (local i = 0; i < 18; i++)
+  literals.append({name = "item", count = 3, ratio = 0.5, enabled = true})
+deduplicate_object(literals)
+println(count_same(literals, literals[0]))
+
+// equal tables among different ones
+let mixed = []
+for (local i = 0; i < 30; i++)
+  mixed.append({kind = i % 3, tag = $"t{i % 3}"})
+deduplicate_object(mixed)
+println(count_same(mixed, mixed[0]), count_same(mixed, mixed[1]), count_same(mixed, mixed[2]))
+println(mixed[0] == mixed[1], mixed[3].kind, mixed[4].tag)
+
+// same keys, different values are not merged
+let values = [{a = 1, b = "x"}, {a = 1, b = "y"}, {a = 2, b = "x"}, {a = 1, b = "x"}]
+deduplicate_object(values)
+println(values[0] == values[3], values[0] == values[1], values[0] == values[2])
+
+// nested tables are deduplicated too
+let nested = []
+for (local i = 0; i < 5; i++)
+  nested.append({pos = {x = 1, y = 2}, id = i})
+deduplicate_object(nested)
+println(nested[0] == nested[1], nested[0].pos == nested[4].pos, nested[4].id)
+
+// integer keys, kept in the array part or in the hash part
+let indexed = []
+for (local i = 0; i < 12; i++)
+  indexed.append({[0] = "a", [1] = "b", [2] = i % 2, [1000] = 2.5})
+deduplicate_object(indexed)
+println(count_same(indexed, indexed[0]), count_same(indexed, indexed[1]), indexed[0] == indexed[1])
+println(indexed[3][2], indexed[4][1000], indexed[5].len())
+
+let sparse = [{[0] = 1, [1] = 2}, {[0] = 1, [2] = 2}, {[0] = 1, [1] = 3}, {[0] = 1, [1] = 2}]
+deduplicate_object(sparse)
+println(sparse[0] == sparse[3], sparse[0] == sparse[1], sparse[0] == sparse[2])
+
+let withRemoved = [{[0] = "x", [1] = "y", [2] = "z"}, {[0] = "x", [1] = "y", [2] = "z"}]
+withRemoved[0].$rawdelete(2)
+withRemoved[1].$rawdelete(2)
+deduplicate_object(withRemoved)
+println(withRemoved[0] == withRemoved[1], withRemoved[1].len())
+
+try {
+  literals[0].count = 4
+}
+catch (e)
+  println(e)
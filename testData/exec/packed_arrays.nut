@@ -0,0 +1,90 @@
+let { blob } = require("iostream")
+
+function dump(a) {
+  return ", ".join(a.map(@(x) $"{type(x)}:{x}"))
+}
+
+// integers stay integers, floats stay floats
+let ints = [3, 1, 2]
+let floats = [0.5, 1.5]
+println(dump(ints))
+println(dump(floats))
+
+// writing another type keeps all values
+ints[1] = 1.25
+println(dump(ints))
+floats.append("tail")
+println(dump(floats))
+let mixed = [1, 2.0, true, null]
+println(dump(mixed))
+
+// integers next to floats are not converted
+let a = []
+a.append(1)
+a.append(2.5)
+a.append(3)
+println(dump(a))
+
+// resize, insert, remove, pop, swap, reverse
+let b = array(4, 1.0)
+b.resize(6, 2.0)
+b.insert(0, 0.5)
+b.remove(1)
+println($"{b.pop()} {b.top()} {b.len()}")
+b.swap(0, -1)
+b.reverse()
+println(dump(b))
+b.resize(8)
+println(dump(b))
+
+// sort with and without a compare function
+let c = [5, -3, 9, 0, 2]
+c.sort()
+println(dump(c))
+c.sort(@(x, y) y <=> x)
+println(dump(c))
+let cf = [2.5, -1.0, 0.0, 10.0]
+cf.sort()
+println(dump(cf))
+
+// clone, extend and replace are independent copies
+let d = clone c
+d[0] = 100
+d.extend([1.5, 2])
+println($"{c[0]} {dump(d)}")
+let e = [1, 2]
+e.replace_with(cf)
+e[0] = 42.0
+println($"{cf[0]} {dump(e)}")
+
+// increments, compound assignment and foreach
+let f = [1, 2, 3]
+f[0]++
+f[1] += 10
+f[2] *= 1.5
+local sum = 0
+foreach (i, x in f)
+  sum += i * x
+println($"{dump(f)} {sum}")
+
+// clear and reuse
+f.clear()
+f.append("s")
+f.append(1)
+println(dump(f))
+
+// frozen arrays
+let g = freeze([1, 2, 3])
+try {
+  g[0] = 5
+} catch (err) {
+  println(err)
+}
+println(dump(g))
+
+// serialization round trip and join
+let s = blob()
+s.writeobject([[1, 2, 3], [0.25, 0.5], [1, 0.5]])
+s.seek(0)
+println(s.readobject().map(dump).reduce(@(acc, x) $"{acc} | {x}", ""))
+println(",".join([1, 2, 3]))
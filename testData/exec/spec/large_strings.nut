@@ -0,0 +1,55 @@
+// strings longer than SQ_STRING_INTERN_LIMIT are not interned, equal ones built
+// in different ways are different objects but have to behave like one string
+
+let chunk = "0123456789abcdef"
+let parts = array(512, chunk)
+let a = "".join(parts)
+let b = "".concat(a.slice(0, 4096), a.slice(4096))
+local c = ""
+foreach (p in parts)
+  c += p
+let other = a.slice(0, -1) + "F"
+
+println(a.len(), b.len(), c.len())
+println(a == b, b == c, a != c, a == other, a != other)
+println(a < other, other > a, a <= b, a >= c)
+println(a.hash() == b.hash(), b.hash() == c.hash())
+println([other, c, a].indexof(b), [other, c].contains(a))
+
+// table and class keys
+let t = {}
+t[a] <- 1
+println(t?[b], t?[c], b in t, other in t)
+t[c] = 2
+println(t[a], t.len())
+t[other] <- 3
+local keys = 0
+foreach (k, v in t) {
+  if (k == b)
+    println("key found", v)
+  keys++
+}
+println(keys)
+t.$rawdelete(c)
+println(a in t, t.len())
+
+let lit = {[a] = "lit", x = 1}
+println(lit[b], lit[c])
+
+class Holder {}
+Holder[b] <- "member"
+println(Holder[c], Holder()[a])
+
+// identity of the whole-string slice and pieces of split
+println(a.slice(0) == a, a.slice(0, a.len()).len())
+let lines = "\n".join([a, b, "short", c]).split("\n")
+println(lines.len(), lines[0] == lines[1], lines[1] == lines[3], lines[2])
+let tsplit = {}
+foreach (l in lines)
+  tsplit[l] <- true
+println(tsplit.len())
+
+// sorting and comparing with short strings
+let sorted = [other, "z", a, "0"].sort()
+println(sorted[0], sorted[1] == other, sorted[2] == a, sorted[3])
+println(a.indexof("fff") == null, a.indexof("f0"), a.slice(4090, 4100))
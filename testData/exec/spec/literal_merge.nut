@@ -0,0 +1,65 @@
+// t.__merge({...}) on a table is compiled to a clone of t that gets the literal's slots,
+// tables that would call something else than the type method go through the real call
+
+function show(r) {
+  let keys = r.keys().map(@(k) k.tostring()).sort()
+  return ", ".join(keys.map(@(k) $"{k}={r?[k] ?? r?[k.tointeger()]}"))
+}
+
+let t = { x = 4, z = 5, u = 123 }
+
+let r1 = t.__merge({y = 5, f = 5.3, x = "over"})
+println(show(r1))
+println(show(t))
+println(r1 == t)
+
+let r2 = t.$__merge({})
+println(show(r2))
+println(r2 == t)
+
+function update(state: table, v) {
+  return state.__merge({v, [1] = "one", done = v > 5})
+}
+println(show(update(t, 7)))
+
+function mergeA(s: table) {
+  return s.__merge({a = 1})
+}
+
+let own = { __merge = @(o) $"own __merge got a={o.a}" }
+println(mergeA(own))
+println(own.$__merge({a = 1}).a)
+
+let frozen = freeze({q = 1})
+let r3 = mergeA(frozen)
+println(show(r3))
+println(r3.is_frozen())
+r3.a = 2
+println(r3.a)
+
+// the values are evaluated before the table is copied
+local counter = {n = 1}
+function bump() {
+  counter.n = 100
+  return 2
+}
+function withCall(s: table) {
+  return s.__merge({b = bump()})
+}
+println(show(withCall(counter)))
+
+try {
+  mergeA({__merge = 5})
+} catch (e) {
+  println(e)
+}
+
+// weak references in the source become strong ones in the result, as with the __merge() call
+class Obj {}
+local o = Obj()
+function withWeak(s: table) {
+  return s.__merge({y = 1})
+}
+let wr = withWeak({w = o.weakref(), [0] = o.weakref()})
+o = null
+println(typeof wr.w, typeof wr.rawget("w"), typeof wr[0], wr.y)
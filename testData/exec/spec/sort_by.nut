@@ -0,0 +1,35 @@
+// Sort by a key computed once per element
+let players = [
+  {name = "Charlie", score = 120},
+  {name = "Alice", score = 300},
+  {name = "Dave", score = 120},
+  {name = "Bob", score = 50}
+]
+local calls = 0
+players.sort_by(function(p) {
+  calls++
+  return -p.score
+})
+println("By score, descending:")
+players.each(@(v) println(v.score + " " + v.name))
+println("Key function calls: " + calls)
+
+// String keys
+let words = ["banana", "Apple", "cherry", "apple"]
+words.sort_by(@(w) w.tolower())
+println("\nCase insensitive:")
+words.each(@(v) println(v))
+
+// Array keys are compared with the default order too
+let pts = [[3, "c"], [1, "a"], [2, "b"]]
+pts.sort_by(@(p) p[0])
+println("\nBy first element:")
+pts.each(@(v) println(v[1]))
+
+// Keys that can't be compared
+println("\nBad keys:")
+try {
+  [1, 2, 3].sort_by(@(v) v == 2 ? {} : v)
+} catch (e) {
+  println(e)
+}
@@ -0,0 +1,40 @@
+// Equal elements keep their order
+let a = [
+  {name = "Charlie", team = 2},
+  {name = "Alice", team = 1},
+  {name = "Dave", team = 2},
+  {name = "Bob", team = 1},
+  {name = "Eve", team = 3},
+  {name = "Frank", team = 1}
+]
+a.sort_stable(@(x, y) x.team <=> y.team)
+println("By team:")
+a.each(@(v) println(v.team + " " + v.name))
+
+// Default order without comparator
+let b = [5, 2.5, 1, -3, 2, 0.0]
+b.sort_stable()
+println("\nNumbers:")
+b.each(@(v) println(v))
+
+// Many equal keys
+let c = []
+for (local i = 0; i < 100; i++)
+  c.append([i % 3, i])
+c.sort_stable(@(x, y) x[0] <=> y[0])
+local inOrder = true
+for (local i = 1; i < c.len(); i++)
+  if (c[i - 1][0] == c[i][0] && c[i - 1][1] > c[i][1])
+    inOrder = false
+println("\nStable on 100 elements: " + inOrder)
+
+// Returns the array itself
+println("\nChained: " + [3, 1, 2].sort_stable().top())
+
+// Errors in the comparator are passed up
+println("\nFailing comparator:")
+try {
+  [3, 1, 2].sort_stable(function(x, y) { throw "cmp failed" })
+} catch (e) {
+  println(e)
+}
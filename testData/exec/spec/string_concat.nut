@@ -0,0 +1,45 @@
+// '+' chains with strings and $"..." templates are built with a single _OP_CONCATN,
+// the results have to match concatenating one '+' at a time
+
+class Point {
+  x = 0
+  y = 0
+  constructor(x_, y_) { this.x = x_; this.y = y_ }
+  function _tostring() { return $"({this.x}, {this.y})" }
+}
+
+class Throwing {
+  function _tostring() { throw "no string for you" }
+}
+
+function name() { return "name" }
+
+local i = 42, f = 2.5, s = "str", n = null, b = false
+let p = Point(1, -2)
+
+println(i + f + "|" + i + f)
+println(s + i + f + n + b)
+println("[" + p + "] " + name() + " " + i * 2 + " " + (f + 1))
+println(1 + 2 + "=" + 1 + 2)
+println(("a" + s) + ("b" + i) + s)
+println(s + "" + "" + s)
+println($"{i}/{f}/{s}/{n}/{b}/{p}")
+println($"point {p} at {i + 1}")
+println($"{s}")
+println("{0}-{1}".subst(i, s))
+
+local line = ""
+for (local k = 0; k < 40; k++)
+  line = line + k + (k % 10 == 9 ? "\n" : " ")
+print(line)
+
+let long = s + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i
+  + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + i + s
+println(long)
+println(long.len())
+
+try {
+  println("before " + s + Throwing())
+} catch (e) {
+  println($"caught: {e}")
+}
@@ -0,0 +1,122 @@
+// replace(), subst(), join() and concat() compute the result length first and write the
+// result once, replace() with a table finds all keys in one scan, the results have to match
+// doing it step by step
+
+local seed = 4242
+function rnd(n) {
+  seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+  return (seed >> 8) % n
+}
+
+function rnd_string(alphabet, len) {
+  return "".join(array(len).map(@(_) alphabet.slice(rnd(alphabet.len())).slice(0, 1)))
+}
+
+// leftmost match, the longest key wins among those starting at the same position
+function replace_slow(s, tbl) {
+  local res = ""
+  local i = 0
+  while (i < s.len()) {
+    local best = null
+    foreach (from, _ in tbl)
+      if (from.len() > 0 && s.slice(i).indexof(from) == 0 && (best == null || from.len() > best.len()))
+        best = from
+    if (best == null) {
+      res += s.slice(i, i + 1)
+      i++
+    }
+    else {
+      res += tbl[best]
+      i += best.len()
+    }
+  }
+  return res
+}
+
+function replace_step(s, from, to) {
+  if (from == "")
+    return s
+  local res = ""
+  local pos = 0
+  for (local i = s.indexof(from); i != null; i = s.indexof(from, pos)) {
+    res += s.slice(pos, i) + to
+    pos = i + from.len()
+  }
+  return res + s.slice(pos)
+}
+
+local mismatches = 0
+for (local n = 0; n < 300; n++) {
+  let s = rnd_string("abcab{}", rnd(60))
+  let from = rnd_string("abc", rnd(4))
+  let to = rnd_string("xy", rnd(5))
+  if (s.replace(from, to) != replace_step(s, from, to)) {
+    println($"replace(\"{from}\", \"{to}\") of \"{s}\"")
+    mismatches++
+  }
+
+  // few keys take the first char scan, many the plain one
+  let tbl = {}
+  let nkeys = n % 3 == 0 ? 20 : 1 + rnd(5)
+  for (local k = 0; k < nkeys; k++)
+    tbl[rnd_string(n % 3 == 0 ? "abcdefghijklmnop" : "abc", 1 + rnd(4))] <- rnd_string("XY", rnd(4))
+  let text = rnd_string(n % 3 == 0 ? "abcdefghijklmnopqrstuvwxyz" : "abcab", rnd(80))
+  if (text.replace(tbl) != replace_slow(text, tbl)) {
+    println($"replace() of \"{text}\"")
+    foreach (k, v in tbl) println("  ", k, " -> ", v)
+    println("  ", text.replace(tbl), " vs ", replace_slow(text, tbl))
+    mismatches++
+  }
+}
+println("mismatches: ", mismatches)
+
+println("hello {name}, you have {count} new messages".replace({["{name}"] = "Alice", ["{count}"] = 3}))
+println("abcd".replace({abc = "1", ab = "2", bcd = "3", d = "4"}))
+println("ab".replace({a = "b", b = "c"}))
+println("she sells sea shells".replace({he = "HE", she = "SHE", s = "S", hers = "X", [""] = "empty keys are skipped"}))
+println("unchanged".replace({}), " ", "unchanged".replace({q = "w"}), " ", "".replace({a = "b"}))
+println("x=1".replace({x = 2.5, ["="] = null}))
+try { "a".replace({[1] = "x"}) } catch (e) println(e)
+try { "a".replace({a = "x"}, "y") } catch (e) println(e)
+try { "a".replace("a") } catch (e) println(e)
+
+// a result long enough to skip interning
+let long = "".join(array(1000, "word "))
+println(long.replace("word", "longer word").len(), " ", long.replace({word = "w", [" "] = ""}).len())
+
+println("{{0}} {0} {} {x} {2}".subst(7, {x = "y"}), " ", "{99999999999999999999}".subst(1), " ", "{0".subst(1))
+println("no placeholders".subst(1), " ", "{a}{a}{2}".subst({a = "A"}, {a = "B"}, "zero"))
+println(", ".join([1, 2.5, null, true, "s", -7]), " ", "-".concat(1, "a", 0.1, false), "|", "".join([]), "|", ",".join(["a"]), "|")
+println(", ".join(["a", null, "", "b"], true), " ", "+".join([1, 2, 3, 4], @(v) v % 2 == 0))
+println("".join(array(2000, 0.5)).len(), " ", "".join(array(2000, "ab")).len())
+
+class Point {
+  x = 0
+  y = 0
+  constructor(x_, y_) { this.x = x_; this.y = y_ }
+  function _tostring() { return $"({this.x}, {this.y})" }
+}
+class Throwing {
+  function _tostring() { throw "no string for you" }
+}
+let p = Point(1, -2)
+println(";".join([p, 1, p]), " ", ";".concat(p, "x", 2.0), " ", "at {0} {pt}".subst(p, {pt = p}), " ", "[p]".replace({["p"] = p}))
+try { ",".join([1, Throwing()]) } catch (e) println(e)
+try { ",".concat(1, Throwing()) } catch (e) println(e)
+try { "{0}".subst(Throwing()) } catch (e) println(e)
+try { "a".replace({a = Throwing()}) } catch (e) println(e)
+
+// a _tostring() that removes the keys while they are collected
+let removing = {}
+local conversions = 0
+class Remover {
+  function _tostring() {
+    if (++conversions == 2)
+      removing.clear()
+    return "R"
+  }
+}
+// built at runtime, so only the table holds them
+removing["".concat("key", 0)] <- Remover()
+removing["".concat("key", 1)] <- Remover()
+println("key0 key1 key2 key0".replace(removing), " ", removing.len())
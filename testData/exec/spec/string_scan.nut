@@ -0,0 +1,51 @@
+// string methods scan 16 chars at a time where they can, results have to match a char by
+// char scan for every length and every position of the searched chars in a block
+
+let {split_by_chars, escape, strip, lstrip, rstrip} = require("string")
+
+local seed = 12345
+function rnd(n) {
+  seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+  return (seed >> 8) % n
+}
+
+let alphabet = "abAZ \t\n,;xyz\"\\'\x01\x7f\xe9-."
+function rnd_string(len) {
+  let chars = array(len).map(@(_) alphabet.slice(rnd(alphabet.len())).slice(0, 1))
+  return "".join(chars)
+}
+
+function digest(v) {
+  if (type(v) == "array")
+    return "[" + "|".join(v.map(@(x) escape(x))) + "]"
+  if (type(v) == "string")
+    return escape(v)
+  return v
+}
+
+for (local len = 0; len < 70; len += (len < 40 ? 1 : 7)) {
+  let s = rnd_string(len)
+  let out = []
+  foreach (needle in ["a", "ab", "xyz", "\"\\", ",", "Z ", s.slice(len / 3, len / 3 + 3), s.slice(-2)]) {
+    if (needle == "")
+      continue
+    out.append(s.indexof(needle), s.indexof(needle, len / 2), s.contains(needle))
+    out.append(digest(s.replace(needle, "<>")), digest(s.replace(needle, "")))
+    out.append(digest(s.split(needle)))
+  }
+  out.append(digest(s.split()))
+  out.append(digest(split_by_chars(s, ",")), digest(split_by_chars(s, ",; ", true)), digest(split_by_chars(s, "abcdefghijklmnopqrstuvwxyz")))
+  out.append(digest(s.tolower()), digest(s.toupper()), len > 2 ? digest(s.tolower(1, len / 2)) : "")
+  out.append(escape(s), digest(strip(s)), digest(lstrip(s)), digest(rstrip(s)))
+  println(len, " ".join(out))
+}
+
+// a match across the end of a block
+let long = "".join(array(40, "ab")) + "abc"
+println(long.indexof("abc"), long.indexof("bab", 30), long.replace("bab", "-").len(), long.split("ba").len())
+println("no escapes needed here, even in a long string".len() == escape("no escapes needed here, even in a long string").len())
+
+// searches look at the whole string, not only up to the first zero char
+let zero = require("string").format("%c", 0)
+let withZero = zero.join(["key", "value", "value"])
+println(withZero.indexof("value"), withZero.indexof($"{zero}v", 4), withZero.contains($"e{zero}v"), withZero.split(zero).len())
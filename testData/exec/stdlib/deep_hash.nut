@@ -43,6 +43,14 @@ assert(hash({}) > 100000)
 assert(hash([]) > 100000)
 assert(hash(class {}) > 100000)
 
+// long strings are not interned and get their hash on first use
+let long1 = "".join(array(5000, "a"))
+let long2 = "".concat("".join(array(4999, "a")), "a")
+let long3 = "".concat("".join(array(4999, "a")), "b")
+assert(hash(long1) == hash(long2))
+assert(hash(long1) != hash(long3))
+assert(deep_hash([long1]) != deep_hash([long3]))
+
 local arr = []
 local cnt = 1000
 while (cnt--) {
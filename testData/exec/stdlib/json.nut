@@ -0,0 +1,175 @@
+let json = require("json")
+let {blob} = require("iostream")
+let {format} = require("string")
+
+let {parse, stringify} = json
+
+function show(text) {
+  try
+    println(stringify(parse(text), {sort_keys = true}))
+  catch (e)
+    println(e)
+}
+
+println("-- values")
+show("null")
+show(" true ")
+show("false")
+show("[]")
+show("{}")
+show("\"\"")
+show("[1, -2, 0, -0, 2.5, 1e3, 1E-2, -4.25e+1, 16777216]")
+show("{\"b\": 1, \"a\": {\"y\": [true, null], \"x\": {}}, \"c\": []}")
+show("\n\t [ [ [ ] ] , { } ]\r\n")
+show("9223372036854775807")
+show("-9223372036854775808")
+println(type(parse("9223372036854775808")), " ", type(parse("1.0")), " ", type(parse("100")))
+
+println("-- strings")
+show("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"")
+show("\"\\u0041\\u00e9\\u20ac\\ud83d\\ude00\"")
+println(parse("\"\\u00e9\\u20ac\\ud83d\\ude00\"") == "é€😀")
+println(parse("\"\\u0000x\"").len())
+let controls = "".join(array(32).map(@(_, i) format("%c", i)))
+println(stringify(controls))
+println(parse(stringify(controls)) == controls)
+println(stringify("utf-8 stays as it is: é€😀"))
+
+println("-- errors")
+foreach (bad in ["", "   ", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "{1:2}", "\"abc", "tru", "nul",
+    "01", "-", "1.", "1e", "+1", ".5", "[\"\\q\"]", "\"\\u12\"", "\"\t\"", "[1]x", "[[[]]", "{\"a\":[}"]) {
+  try {
+    parse(bad)
+    println("no error for ", bad)
+  }
+  catch (e)
+    println(e)
+}
+try parse("{\n  \"a\": 1,\n  \"b\": ?\n}") catch (e) println(e)
+try parse(1) catch (e) println(e)
+
+println("-- stringify")
+println(stringify([1.0, 0.1, -0.0, 1e30, 2.5e-5, 16777216.0, 7]))
+println(stringify({[1] = "int key", [2.5] = "float key"}, {sort_keys = true}))
+println(stringify({b = [1, {c = []}], a = {}}, {sort_keys = true, pretty = true}))
+println(stringify([], {pretty = true}), stringify({}, {pretty = true}))
+foreach (bad in [print, blob(), {[true] = 1}, [parse("1e30") * parse("1e30")]]) {
+  try {
+    stringify(bad)
+    println("no error for ", type(bad))
+  }
+  catch (e)
+    println(e)
+}
+let cycle = {}
+cycle.self <- [cycle]
+try stringify(cycle) catch (e) println(e)
+
+println("-- depth")
+println(stringify(parse("".join(array(1000, "[")) + "".join(array(1000, "]")))).len())
+try parse("".join(array(1001, "[")) + "".join(array(1001, "]"))) catch (e) println(e)
+
+println("-- frozen")
+let f = parse("{\"a\": [1, {\"b\": 2}], \"c\": \"s\"}", {frozen = true})
+try f.a.append(3) catch (e) println(e)
+try f.a[1].b = 3 catch (e) println(e)
+try f.d <- 1 catch (e) println(e)
+println(f.is_frozen(), " ", f.a.is_frozen(), " ", parse("[]").is_frozen())
+
+println("-- blob and stream")
+let out = blob()
+println(stringify({x = [1, 2, 3]}, {stream = out}))
+println(out.len(), " ", stringify(parse(out)))
+try stringify(1, {stream = "file"}) catch (e) println(e)
+
+// output larger than a stream chunk has to come out the same way
+let big = array(3000).map(@(_, i) {id = i, name = $"item {i}", tags = ["a", "b\n"], ratio = i / 8.0})
+let text = stringify(big)
+let out2 = blob()
+stringify(big, {stream = out2})
+out2.seek(0)
+println(text.len(), " ", out2.len(), " ", out2.as_string() == text)
+println(stringify(parse(text), {sort_keys = true}) == stringify(big, {sort_keys = true}))
+
+println("-- round trip")
+local seed = 4242
+function rnd(n) {
+  seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+  return (seed >> 8) % n
+}
+
+let alphabet = "ab\"\\/\n\t\x01\x1f é€ xyz"
+function rnd_string(len) {
+  return "".join(array(len).map(@(_) alphabet.slice(rnd(alphabet.len())).slice(0, 1)))
+}
+
+function rnd_value(depth) {
+  let k = rnd(depth > 3 ? 6 : 8)
+  if (k == 0) return null
+  if (k == 1) return rnd(2) == 0
+  if (k == 2) return rnd(2000000) - 1000000
+  if (k == 3) return (rnd(2000000) - 1000000) / 64.0
+  if (k == 4 || k == 5) return rnd_string(rnd(40))
+  if (k == 6) {
+    let a = []
+    for (local i = rnd(6); i > 0; i--)
+      a.append(rnd_value(depth + 1))
+    return a
+  }
+  let t = {}
+  for (local i = rnd(6); i > 0; i--)
+    t[rnd_string(rnd(8))] <- rnd_value(depth + 1)
+  return t
+}
+
+function same(a, b) {
+  if (type(a) != type(b))
+    return false
+  if (type(a) == "array")
+  {
+    if (a.len() != b.len())
+      return false
+    foreach (i, v in a)
+      if (!same(v, b[i]))
+        return false
+    return true
+  }
+  if (type(a) == "table") {
+    if (a.len() != b.len())
+      return false
+    foreach (k, v in a)
+      if (!(k in b) || !same(v, b[k]))
+        return false
+    return true
+  }
+  return a == b
+}
+
+local ok = 0
+for (local i = 0; i < 500; i++) {
+  let v = rnd_value(0)
+  if (same(parse(stringify(v)), v) && same(parse(stringify(v, {pretty = true})), v))
+    ok++
+  else
+    println("round trip failed: ", stringify(v))
+}
+println(ok)
+
+// strings of every length around the 16 char blocks, with the char to escape at every position
+local escaped = 0
+for (local len = 1; len < 40; len++)
+  for (local pos = 0; pos < len; pos++)
+    foreach (c in ["\"", "\\", "\n", "\x01"]) {
+      let s = "".join(array(len, "x").map(@(x, i) i == pos ? c : x))
+      if (parse(stringify(s)) == s && parse(stringify({[s] = s}))[s] == s)
+        escaped++
+    }
+println(escaped)
+
+// keys that differ only in the middle, long keys and long strings
+let keys = {}
+for (local i = 0; i < 200; i++)
+  keys[$"k{i % 10}{i / 10}key"] <- i
+keys["long".join(array(30, "-"))] <- "long".join(array(2000, "."))
+println(same(parse(stringify(keys)), keys))
+println(stringify(parse("[{\"id\":1,\"v\":2},{\"id\":3,\"v\":4},{\"v\":5,\"id\":6}]"), {sort_keys = true}))
@@ -0,0 +1,51 @@
+let { mem_profiler_start, mem_profiler_stop, mem_profiler_report } = require("debug")
+
+function sitesOf(report, type) {
+  return report.filter(@(s) s.source.endswith("mem_profiler.nut") && s.type == type)
+}
+
+mem_profiler_start()
+
+let keep = []
+function makeTables(n) {
+  for (local i = 0; i < n; i++)
+    keep.append({ id = i })
+}
+makeTables(100)
+
+function makeGarbage(n) {
+  for (local i = 0; i < n; i++) {
+    let a = [i, i + 1]
+  }
+}
+makeGarbage(30)
+
+println("exact:")
+let report = mem_profiler_report()
+foreach (s in sitesOf(report, "table"))
+  println($"  line {s.line}: live {s.live_count}, total {s.total_count}, bytes > 0: {s.live_bytes > 0}")
+foreach (s in sitesOf(report, "array"))
+  if (s.line == 18)
+    println($"  line {s.line}: live {s.live_count}, total {s.total_count}")
+
+let top = mem_profiler_report(1)
+println($"top site: {top.len()} {top[0].line} {top[0].type}")
+
+keep.clear()
+println($"after clear: {sitesOf(mem_profiler_report(), "table").filter(@(s) s.line == 12)[0].live_count}")
+
+println("sampled:")
+mem_profiler_start(256)
+let keep2 = []
+for (local i = 0; i < 5000; i++)
+  keep2.append([i])
+let arrSites = sitesOf(mem_profiler_report(), "array").filter(@(s) s.line == 41)
+let est = arrSites.len() > 0 ? arrSites[0].live_count : 0
+println($"  estimate is close: {est > 2500 && est < 10000}")
+
+mem_profiler_stop()
+try {
+  mem_profiler_report()
+}
+catch (e)
+  println($"stopped: {e}")
@@ -0,0 +1,55 @@
+let { set_memory_limit, get_memory_stats } = require("debug")
+
+let stats = get_memory_stats()
+assert(stats.used > 0)
+assert(stats.peak >= stats.used)
+println($"initial limit: {stats.limit}")
+
+let prev = set_memory_limit(stats.used + 2000000)
+println($"previous limit: {prev}")
+
+println("big array:")
+try {
+  array(10000000)
+  println("  not caught")
+}
+catch (e)
+  println($"  caught: {e}")
+
+println("huge sizes:")
+foreach (size in [0x2000000000000001, 0x7FFFFFFFFFFFFFFF]) {
+  try {
+    array(size)
+    println("  not caught")
+  }
+  catch (e)
+    println($"  caught: {e}")
+  try {
+    [1].resize(size)
+    println("  not caught")
+  }
+  catch (e)
+    println($"  caught: {e}")
+}
+
+println("growing array:")
+let keep = []
+try {
+  for (local i = 0; ; ++i)
+    keep.append({ i, s = $"str{i}" })
+}
+catch (e) {
+  // still over the limit here, release memory before doing anything else
+  keep.clear()
+  println($"  caught: {e}")
+}
+
+println("after release:")
+let after = []
+for (local i = 0; i < 100; ++i)
+  after.append({ i })
+println($"  {after.len()}")
+
+println($"peak over used: {get_memory_stats().peak > get_memory_stats().used}")
+set_memory_limit(0)
+println($"limit reset: {get_memory_stats().limit}")
@@ -0,0 +1,33 @@
+// numbers printed by tostring(), concatenation, format() and stringbuilder and parsed by
+// tointeger()/tofloat() have to keep the printf()/strtod() results
+
+let {format, stringbuilder} = require("string")
+
+let floats = [0.0, -0.0, 1.0, -1.5, 0.1, 1.0/3, 2.5e-5, 1e-4, 123456.0, 1234567.0, 1e10, -3.4e38, 1.17549e-38, 100.0, 65536.5]
+let ints = [0, 1, -1, 42, -1234567890, 0x7FFFFFFF, -0x80000000]
+
+foreach (f in floats)
+  println(f, f.tostring(), $"{f}", "" + f + "|" + f, format("%g %f %e %.2f %.0f %.3g %.10e %8.2f %-8g| %+g", f, f, f, f, f, f, f, f, f, f))
+foreach (i in ints)
+  println(i, format("%d %i %5d %-5d| %x %X %o %+d", i, i, i, i, i, i, i, i))
+
+let sb = stringbuilder()
+sb.append(1, " ", 2.5, " ", -7, " ", 1e20, " ", 0.001)
+println(sb)
+
+function try_conv(f) {
+  try
+    return f()
+  catch (e)
+    return "error"
+}
+
+foreach (s in ["12", "-12", " 12", "+12", "12abc", "0012", "99999999999999999999", "-99999999999999999999", "1.9", "1e3", "abc", "", "-"])
+  println($"'{s}'", try_conv(@() s.tointeger()), try_conv(@() s.tofloat()))
+
+foreach (s in ["1F", "0x1F", "-ff"])
+  println(s, s.tointeger(16))
+println("777".tointeger(8), "101".tointeger(2), "z".tointeger(36))
+
+foreach (s in ["1.5", "-2.25e3", " 3.5", "+4", ".5", "5.", "1e", "1e400", "1e-400", "0x10", "inf", "2.5x", "1,5"])
+  println($"'{s}'", try_conv(@() s.tofloat()))
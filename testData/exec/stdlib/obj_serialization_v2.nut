@@ -0,0 +1,172 @@
+// the compact encoding writeobject() uses since format version 2, and reading version 1 data
+let { blob } = require("iostream")
+let { file } = require("io")
+let { remove } = require("system")
+let { format } = require("string")
+
+function same(a, b) {
+  if (type(a) != type(b))
+    return false
+  if (type(a) == "array") {
+    if (a.len() != b.len())
+      return false
+    foreach (i, v in a)
+      if (!same(v, b[i]))
+        return false
+    return true
+  }
+  if (type(a) == "table") {
+    if (a.len() != b.len())
+      return false
+    foreach (k, v in a)
+      if (!(k in b) || !same(v, b[k]))
+        return false
+    return true
+  }
+  if (type(a) == "float" && a == 0.0 && b == 0.0)
+    return format("%g", a) == format("%g", b) // keeps the sign of zero
+  return a == b
+}
+
+function round_trip(obj) {
+  let b = blob()
+  b.writeobject(obj)
+  b.seek(0)
+  let res = b.readobject()
+  assert(b.eos())
+  return [res, b.len()]
+}
+
+// the size of floats depends on the SQFloat type of the build
+function check(name, obj, print_size = true) {
+  let [res, size] = round_trip(obj)
+  println(print_size ? $"{name}: {same(obj, res)} {size}" : $"{name}: {same(obj, res)}")
+}
+
+println("-- scalars")
+check("null", null)
+check("true", true)
+check("small ints", [-1, 0, 1, 13, "x"])
+check("ints", [14, -2, 127, 128, -129, 65535, 1 << 31, -(1 << 31), 1 << 40])
+check("int limits", [0x7FFFFFFFFFFFFFFF, -0x7FFFFFFFFFFFFFFF - 1, "x"])
+check("floats", [-1.0, -0.5, 0.0, 0.5, 1.0, 2.0, 0.1, -3.75, 1e30, "x"], false)
+check("negative zero", [-0.0, "x"], false)
+
+println("-- strings")
+check("empty", "")
+check("short", "abc")
+check("length 14", "abcdefghijklmn")
+check("length 15", "abcdefghijklmno")
+check("long", "x".join(array(1000, "yz")))
+let words = array(40).map(@(_, i) $"word{i}")
+check("repeated", array(400).map(@(_, i) words[(i * 7) % words.len()]))
+
+println("-- arrays")
+check("empty array", [])
+check("one int", [5])
+check("packed ints", array(100).map(@(_, i) i * i - 500))
+check("packed sequence", array(1000).map(@(_, i) 1000000 + i))
+check("packed floats", array(100).map(@(_, i) i / 3.0), false)
+check("mixed numbers", array(100).map(@(_, i) i % 2 ? i : i + 0.5), false)
+check("numbers and null", [1, 2, null, 3])
+check("nested", [[1, 2], [0.5, 1.5], [[]], [[1], ["a"]]])
+let unpacked = array(100).map(@(_, i) i % 2 ? i : "s")
+unpacked.apply(@(_, i) i * 10)
+check("ints unpacked before", unpacked)
+
+println("-- tables")
+check("empty table", {})
+check("table", {a = 1, b = "two", c = [3], d = {e = null}})
+check("int keys", {[0] = "zero", [1] = "one", [100] = 100, [-5] = -5, [0.5] = "half"}, false)
+let big = {}
+for (local i = 0; i < 300; i++)
+  big[$"key{i}"] <- i % 3 ? i : $"value{i % 17}"
+check("big table", big, false)
+check("records", array(50).map(@(_, i) {id = i, name = $"n{i % 4}", pos = [i * 0.5, 1.0], tags = ["a", "b"]}), false)
+
+println("-- instances")
+let classes = {}
+for (local i = 0; i < 20; i++) {
+  let idx = i
+  classes[$"Class{i}"] <- class {
+    value = null
+    function __getstate() { return {idx, value = this.value} }
+    function __setstate(state) { this.value = state.value }
+  }
+}
+let instances = array(60).map(@(_, i) classes[$"Class{i % 20}"]())
+instances.each(@(obj, i) obj.value = [i, $"v{i}"])
+let ib = blob()
+ib.writeobject(instances, classes)
+ib.seek(0)
+let ires = ib.readobject(classes)
+println(ires.len(), " ", ires.map(@(obj) obj.value[0]).reduce(@(a, b) a + b), " ", ires[59].value[1],
+  " ", ires[45] instanceof classes.Class5)
+
+// strings __getstate() makes are freed while writing goes on, a later one may get the same address
+class Tagged {
+  n = 0
+  constructor(n_ = 0) { this.n = n_ }
+  function __getstate() { return format("%03d", this.n) }
+  function __setstate(state) { this.n = state.tointeger() }
+}
+let tagged = array(200).map(@(_, i) Tagged(i))
+let tb = blob()
+tb.writeobject(tagged, {Tagged})
+tb.seek(0)
+let tres = tb.readobject({Tagged})
+println(tres.filter(@(obj, i) obj.n != i).len(), " ", tres[199].n)
+
+println("-- several objects in one stream")
+let multi = blob()
+multi.writeobject({first = 1})
+multi.writeobject([2, 3])
+multi.writeobject("third")
+multi.seek(0)
+println(multi.readobject().first, " ", multi.readobject()[1], " ", multi.readobject(), " ", multi.eos())
+
+let path = "qtest_obj_serialization_v2.bin"
+let f = file(path, "wb")
+f.writeobject({name = "file", data = array(1000).map(@(_, i) i)})
+f.writeobject(42)
+f.close()
+let f2 = file(path, "rb")
+let fres = f2.readobject()
+println(fres.name, " ", fres.data[999], " ", f2.readobject(), " ", f2.eos() != null)
+f2.close()
+remove(path)
+
+println("-- version 1 data")
+// {a = [1, 2], b = "a", c = "a"} in the first format, "a" the second time by its index
+let v1 = blob()
+foreach (byte in [0xEA, 0x61, 3, 0x41, 1, 'a', 0x51, 2, 0x22, 0x23, 0x41, 1, 'b', 0x44, 0,
+    0x41, 1, 'c', 0x44, 0, 0xFA])
+  v1.writen(byte, 'b')
+v1.seek(0)
+let old = v1.readobject()
+println(old.a[0] + old.a[1], " ", old.b, " ", old.c)
+
+println("-- broken data")
+let good = blob()
+good.writeobject({a = [1, 2, 3], b = "text", c = "text"})
+function broken(name, fix, data = good) {
+  let b = blob()
+  b.writeblob(data)
+  fix(b)
+  b.seek(0)
+  try {
+    b.readobject()
+    println($"{name}: no error")
+  }
+  catch (e)
+    println($"{name}: {e}")
+}
+broken("truncated", @(b) b.resize(b.len() - 3))
+broken("no end marker", @(b) b.resize(b.len() - 1))
+broken("bad end marker", function(b) { b.seek(-1, 'e'); b.writen(0, 'b') })
+broken("size too large", function(b) { b.seek(1); b.writen(0x7F, 'b') })
+broken("size too small", function(b) { b.seek(1); b.writen(b[1] - 1, 'b') })
+broken("bad type", function(b) { b.seek(2); b.writen(0xF0, 'b') })
+let refs = blob()
+refs.writeobject(["ab", "ab"]) // the second "ab" is a reference to the first one right before the end marker
+broken("bad string index", function(b) { b.seek(-2, 'e'); b.writen(0x85, 'b') }, refs)
@@ -0,0 +1,250 @@
+// objectreader: reading writeobject() data in steps and decoding tables on first access
+let { blob, objectreader } = require("iostream")
+let { file } = require("io")
+let { remove } = require("system")
+let { collectgarbage } = require("debug")
+
+function same(a, b) {
+  if (type(a) == "instance" && typeof a == "lazytable")
+    a = a.totable()
+  if (type(b) == "instance" && typeof b == "lazytable")
+    b = b.totable()
+  if (type(a) != type(b))
+    return false
+  if (type(a) == "instance")
+    return a.x == b.x && a.y == b.y
+  if (type(a) == "array") {
+    if (a.len() != b.len())
+      return false
+    foreach (i, v in a)
+      if (!same(v, b[i]))
+        return false
+    return true
+  }
+  if (type(a) == "table") {
+    if (a.len() != b.len())
+      return false
+    foreach (k, v in a)
+      if (!(k in b) || !same(v, b[k]))
+        return false
+    return true
+  }
+  return a == b
+}
+
+class Point {
+  x = 0
+  y = 0
+  constructor(x_ = 0, y_ = 0) {
+    this.x = x_
+    this.y = y_
+  }
+  function __getstate() {
+    return {x = this.x, y = this.y}
+  }
+  function __setstate(state) {
+    this.x = state.x
+    this.y = state.y
+  }
+}
+
+let classes = {Point}
+
+function make_data() {
+  let items = []
+  for (local i = 0; i < 200; i++)
+    items.append({id = i, name = $"item{i}", tags = ["a", "b", $"t{i % 7}"], pos = Point(i, -i), ratio = i / 4.0})
+  return {
+    title = "inventory"
+    items
+    bytes = array(300, 7)
+    nested = {a = {b = {c = {d = "deep"}}}}
+    empty = {}
+    flags = [true, false, null]
+  }
+}
+
+let data = make_data()
+let b = blob()
+b.writeobject(data, classes)
+
+function read_in_steps(stream, size, lazy = false) {
+  let r = objectreader(stream, classes, lazy)
+  local steps = 1
+  while (!r.step(size))
+    if (steps++ % 50 == 0)
+      collectgarbage()
+  return [r.result(), steps]
+}
+
+println("-- steps")
+foreach (size in [1, 16, 1000, 20000]) {
+  b.seek(0)
+  let [res, steps] = read_in_steps(b, size)
+  println(size, same(res, data), steps > 1, b.eos() != null, res.items[123].pos.x)
+}
+
+println("-- next object in the stream")
+let two = blob()
+two.writeobject([1, 2, 3])
+two.writeobject("second")
+two.seek(0)
+let r1 = objectreader(two)
+println(r1.done(), r1.step(100), r1.done(), r1.result().len())
+let r2 = objectreader(two)
+println(r2.step(100), r2.result(), two.eos() != null)
+
+println("-- lazy tables")
+b.seek(0)
+let [lt, lsteps] = read_in_steps(b, 64, true)
+println(typeof lt, lsteps > 1, lt.len(), lt.title, typeof lt.nested, typeof lt.nested.a.b)
+println(lt.nested.a.b.c.d, lt?.nested.a.b.c.d, lt?.missing, "title" in lt, "missing" in lt)
+println(typeof lt.items, lt.items.len(), typeof lt.items[5], lt.items[5].name, lt.items[5].pos.y)
+println(lt.items[5] == lt.items[5], lt.nested == lt.nested) // decoded once
+let keys = []
+foreach (k, v in lt)
+  keys.append($"{k}:{typeof v}")
+keys.sort()
+println(" ".join(keys))
+let t = lt.totable()
+println(type(t), t.len(), typeof t.nested, same(lt, data))
+try {
+  println(lt.missing)
+}
+catch (e)
+  println(e)
+try {
+  lt.title = "x"
+}
+catch (e)
+  println("read only")
+try {
+  clone lt
+}
+catch (e)
+  println(e)
+collectgarbage()
+println(lt.items[199].tags[2], lt.empty.len())
+
+println("-- unusual keys")
+let ukeys = {[1] = "int", [2.5] = "float", [true] = "bool", [[1, 2]] = "array", [Point(1, 2)] = "instance"}
+let ub = blob()
+ub.writeobject(ukeys, classes)
+ub.seek(0)
+let ur = objectreader(ub, classes, true)
+ur.step(1000)
+let ulazy = ur.result()
+println(ulazy[1], ulazy[2.5], ulazy[true], ulazy.len())
+let found = []
+foreach (k, v in ulazy)
+  if (type(k) == "instance")
+    found.append($"{k.x + k.y} {v}")
+  else if (type(k) == "array")
+    found.append($"{k.len()} {v}")
+found.sort()
+println(", ".join(found))
+
+println("-- file stream")
+let path = "objectreader.tmp"
+let f = file(path, "wb+")
+f.writeobject(data, classes)
+f.writeobject(["tail"], classes)
+f.close()
+let f2 = file(path, "rb")
+let [fres, fsteps] = read_in_steps(f2, 100, true)
+println(fsteps > 1, fres.items[42].name, same(fres, data))
+let [ftail, _] = read_in_steps(f2, 100)
+println(ftail[0])
+f2.close()
+remove(path)
+
+println("-- source blob growing while it is read")
+let growing = blob()
+class Grower {
+  v = null
+  function __getstate() { return this.v }
+  function __setstate(state) {
+    this.v = state
+    let pos = growing.tell()
+    growing.seek(0, 'e')
+    for (local i = 0; i < 5000; i++)
+      growing.writen(i, 'i')
+    growing.seek(pos)
+  }
+}
+let grown = []
+for (local i = 0; i < 10; i++) {
+  let g = Grower()
+  g.v = [i, i + 1, i * 1000] // packed
+  grown.append(g)
+}
+growing.writeobject(grown, {Grower})
+let grownSize = growing.len()
+growing.seek(0)
+let gback = growing.readobject({Grower})
+println(gback.len(), gback[7].v[2], gback[9].v[1], growing.tell() == grownSize)
+growing.resize(grownSize)
+growing.seek(0)
+let gr = objectreader(growing, {Grower})
+local gsteps = 1
+while (!gr.step(7))
+  gsteps++
+println(gsteps > 1, gr.result()[5].v[2], growing.tell() == grownSize)
+
+println("-- version 1 data")
+let v1 = blob()
+foreach (byte in [0xEA, 0x61, 3, 0x41, 1, 'a', 0x51, 2, 0x22, 0x23, 0x41, 1, 'b', 0x44, 0,
+    0x41, 1, 'c', 0x44, 0, 0xFA])
+  v1.writen(byte, 'b')
+v1.seek(0)
+let ov1 = objectreader(v1, null, true)
+println(ov1.step(1), type(ov1.result()), ov1.result().b)
+
+println("-- errors")
+function broken(name, fix, lazy) {
+  let bb = blob()
+  bb.writeblob(b)
+  fix(bb)
+  bb.seek(0)
+  let r = objectreader(bb, classes, lazy)
+  try {
+    while (!r.step(50)) {}
+    println($"{name}: no error")
+  }
+  catch (e)
+    println($"{name}: {e}")
+  try {
+    r.step(50)
+  }
+  catch (e)
+    println($"{name} again: {e}")
+}
+foreach (lazy in [false, true]) {
+  broken("truncated", @(bb) bb.resize(bb.len() - 3), lazy)
+  broken("bad end marker", function(bb) { bb.seek(-1, 'e'); bb.writen(0, 'b') }, lazy)
+  broken("bad type", function(bb) { bb.seek(3); bb.writen(0xF0, 'b') }, lazy) // the size takes two bytes
+}
+let empty = objectreader(blob())
+try {
+  empty.step(10)
+}
+catch (e)
+  println(e)
+try {
+  empty.result()
+}
+catch (e)
+  println(e)
+try {
+  objectreader(b).step(0)
+}
+catch (e)
+  println(e)
+try {
+  objectreader(b, {})
+  b.seek(0)
+  let r = objectreader(b, {})
+  while (!r.step(1000)) {}
+}
+catch (e)
+  println(e)
@@ -0,0 +1,47 @@
+// searches skip the start positions no match can begin at, the results and captures
+// have to stay the ones the matcher finds when it is tried everywhere
+
+let {regexp} = require("string")
+
+function show(pat, s, start = 0) {
+  let r = regexp(pat)
+  let m = r.search(s, start)
+  let c = r.capture(s, start)
+  println(pat, "|", s.len() > 40 ? $"<{s.len()} chars>" : s, "|",
+    m == null ? "null" : $"{m.begin}-{m.end}",
+    c == null ? "null" : " ".join(c.map(@(x) $"{x.begin}-{x.end}")))
+}
+
+// the matcher doesn't backtrack, these differ from other regexp engines
+show(".*b", "abcb")
+show("(a|ab)c", "abc")
+show("(ab|a)c", "abc")
+show("a*ab", "xaab")
+show("x(a*)(a)", "xaaa")
+show("(a?){3}a{3}", "aaa")
+show("(.*)(\\d+)", "abc123")
+
+// literal prefixes and first chars
+show("error: (\\d+)", "warning: 1, error: 42, error: 7")
+show("error: (\\d+)", "warning: 1, error: 42, error: 7", 20)
+show("error", "erro")
+show("[xyz]+", "abc zzy")
+show("\\d+\\.\\d*", "v 12.5x")
+show("^abc", "xabc")
+show("^abc", "abcabc")
+show("^abc", "abcabc", 3)
+show("a*", "bbb")
+show("\\bfoo", "a foo")
+show("\\m()", "x(a(b)c)d")
+show("(\\d+)-(\\d+)?|(x)", "12-")
+show("[^a-z]+", "abééc")
+
+// no match anywhere, each would take the matcher quadratic time on long texts
+let as = "".join(array(20000, "a"))
+foreach (pat in ["(a*)*b", "(a|a)*b", "(a+)+b", "(.*)*x", "a*a*a*a*a*b", ".*.*=.*", "((a*)*)*b", "(a*b?)*c"])
+  show(pat, as + "c")
+
+// a match at the very end of a long text
+show("(a+)+b", as + "b")
+show("a{3}(b)", as + "b")
+show("(\\w+)=(\\w+)", as.slice(0, 5000) + " key=value")
@@ -0,0 +1,68 @@
+// format(), printf() and stringbuilder.appendf() reuse the parsed format string,
+// the results and errors have to stay the same on every call
+
+let {format, printf, stringbuilder} = require("string")
+
+function try_format(...) {
+  try
+    return format.acall([null].extend(vargv))
+  catch (e)
+    return $"error: {e}"
+}
+
+let fmts = [
+  "[%s] %s: %d items in %.3f ms",
+  "%%d %d %% %s %%",
+  "no conversions at all",
+  "",
+  "%5s|%-5s|%.2s|",
+  "%08.3f %x %c",
+  "trailing %",
+  "%d %d",
+  "%s %q",
+  "%123456789012345678901234567890d",
+  "%.123456789012345678901234567890d",
+]
+
+for (local pass = 0; pass < 3; pass++) {
+  println("pass", pass)
+  println(try_format(fmts[0], "info", "loader", 12, 3.14159))
+  println(try_format(fmts[1], 1, "x"))
+  println(try_format(fmts[2]))
+  println($"'{try_format(fmts[3])}'")
+  println(try_format(fmts[4], "ab", "cd", "efgh"))
+  println(try_format(fmts[5], 2.5, 255, 66))
+  println(try_format(fmts[6]))
+  println(try_format(fmts[6], 1))
+  println(try_format(fmts[7], 1))
+  println(try_format(fmts[7], 1, "2"))
+  println(try_format(fmts[7], 1, 2.9))
+  println(try_format(fmts[8], "a", "b"))
+  println(try_format(fmts[9], 1))
+  println(try_format(fmts[10], 1))
+  println(try_format(fmts[0], 1, "loader", 12, 3.14159))
+}
+
+// the same text built at runtime
+let parts = ["value ", "%d", " of ", "%s"]
+foreach (i, name in ["a", "b", "c"])
+  println(format("".join(parts), i, name))
+
+// many different format strings in a row, more than the cache holds
+local sum = 0
+for (local i = 0; i < 200; i++)
+  sum += format($"{i}:%d", i).len()
+println(sum)
+
+// format strings too long to be cached
+let long = "%d " + "x".join(array(2000, ""))
+println(format(long, 7).len(), format(long, 123).slice(0, 4))
+println(try_format("".join(array(600, "%d ")), 1))
+
+let sb = stringbuilder()
+for (local i = 0; i < 3; i++)
+  sb.appendf("%d:%s;", i, "v")
+println(sb)
+
+printf("%s %d\n", "printf", 1)
+printf("%s %d\n", "printf", 2)
@@ -0,0 +1,48 @@
+let {stringbuilder} = require("string")
+
+let sb = stringbuilder()
+println(typeof sb)
+println(sb.len())
+println($"[{sb.tostring()}]")
+
+sb.append("a", 1, 2.5, null, true, "z").append(-0.0).appendf("|%05d|%s|", 42, "x")
+println(sb.tostring())
+println(sb.len())
+
+class P {
+  function _tostring() { return "P!" }
+}
+
+sb.clear()
+println(sb.len())
+sb.append(P(), " ", 1e30, " ", -9223372036854775807 - 1, " ", 0.1)
+println(sb)
+
+let copy = clone sb
+copy.append("+")
+println(sb)
+println(copy)
+println("concat: " + copy)
+
+let big = stringbuilder(4)
+for (local i = 0; i < 10000; i++)
+  big.append(i, ",")
+println(big.len())
+println(big.tostring().slice(0, 20))
+println(big.capacity() >= big.len())
+big.reserve(100000)
+println(big.capacity())
+big.clear()
+println(big.capacity())
+
+try {
+  stringbuilder(-1)
+} catch (e) {
+  println(e)
+}
+
+try {
+  sb.appendf("%d", "x")
+} catch (e) {
+  println(e)
+}
@@ -0,0 +1,81 @@
+let { blob } = require("iostream")
+
+function keys_str(t) {
+  let keys = t.keys().map(@(k) $"{type(k)}:{k}")
+  keys.sort()
+  return ", ".join(keys)
+}
+
+// consecutive integer keys
+let t = {}
+for (local i = 0; i < 20; ++i)
+  t[i] <- i * 10
+println($"{t.len()} {t[0]} {t[19]} {t?[20]}")
+
+// integer, float and bool keys are distinct
+t[1.0] <- "float"
+t[true] <- "bool"
+println($"{t[1]} {t[1.0]} {t[true]} {t.len()}")
+
+// delete, re-add, missing keys
+t.$rawdelete(5)
+println($"{5 in t} {t?[5]} {t.len()}")
+t[5] <- null
+println($"{5 in t} {t[5]} {t.len()}")
+t.$rawdelete(5)
+t.$rawdelete(5)
+println(t.len())
+
+// increments and assignment to existing/missing keys
+t[0]++
+t[1] += 100
+println($"{t[0]} {t[1]}")
+try {
+  t[100] = 1
+} catch (e) {
+  println($"set missing: {e}")
+}
+
+// negative and big keys next to small ones
+t[-1] <- "neg"
+t[1000000] <- "big"
+println($"{t[-1]} {t[1000000]} {t.len()}")
+
+// iteration sees every key once
+local sum = 0
+local count = 0
+foreach (k, v in t) {
+  if (type(k) == "integer" && k >= 0 && k < 20)
+    sum += k
+  count++
+}
+println($"{sum} {count}")
+
+// clone and equality of contents
+let c = clone t
+println($"{c.len()} {keys_str(c) == keys_str(t)}")
+c[2] = "changed"
+println($"{t[2]} {c[2]}")
+
+// sparse keys
+let s = {}
+foreach (k in [0, 2, 3, 7, 8, 64, 65, 66, 67])
+  s[k] <- k
+println(keys_str(s))
+
+// clear and reuse
+t.clear()
+println($"{t.len()} {keys_str(t)}")
+t[3] <- 3
+println(keys_str(t))
+
+// serialization round trip
+let b = blob()
+let orig = {}
+for (local i = 0; i < 10; ++i)
+  orig[i] <- $"v{i}"
+orig.x <- "str"
+b.writeobject(orig)
+b.seek(0)
+let res = b.readobject({})
+println($"{res.len()} {keys_str(res) == keys_str(orig)} {res[7]} {res.x}")
@@ -0,0 +1,75 @@
+let { blob } = require("iostream")
+
+function make(i) {
+  return {x = i, y = i * 2, name = $"p{i}"}
+}
+
+// literals with the same keys share a layout, values stay per table
+let a = make(1)
+let b = make(2)
+a.x = 10
+println($"{a.x} {a.y} {a.name} {b.x} {b.y} {b.name}")
+
+// declaration order is kept while iterating
+println(", ".join(a.keys()))
+
+// adding and replacing keys
+a.z <- 3
+a.x <- 11
+println($"{a.len()} {a.x} {a.z} {b?.z}")
+try {
+  b.z = 1
+} catch (e) {
+  println($"set missing: {e}")
+}
+
+// deleting a key keeps the rest intact
+a.$rawdelete("y")
+println($"{a.len()} {"y" in a} {a.x} {a.name} {a.z}")
+a.y <- 5
+println($"{a.y} {a.len()}")
+
+// non-string keys next to literal ones
+let c = make(3)
+c[0] <- "zero"
+c[1.5] <- "float"
+c[false] <- "bool"
+println($"{c.len()} {c[0]} {c[1.5]} {c[false]} {c.x}")
+
+// clone and clear
+let d = clone b
+d.x = 100
+println($"{b.x} {d.x} {d.name} {d.len()}")
+d.clear()
+println($"{d.len()} {d?.x}")
+d.x <- 1
+println($"{d.x} {d.len()}")
+
+// field access from a shared code site over tables that diverged
+local sum = 0
+for (local i = 0; i < 100; ++i) {
+  let t = make(i)
+  if (i % 3 == 0)
+    t.extra <- 1
+  if (i % 5 == 0)
+    t.$rawdelete("y")
+  t.x += 1
+  sum += t.x + (t?.y ?? 0) + (t?.extra ?? 0)
+}
+println(sum)
+
+// many keys
+let big = {k0 = 0, k1 = 1, k2 = 2, k3 = 3}
+for (local i = 4; i < 50; ++i)
+  big[$"k{i}"] <- i
+local bsum = 0
+foreach (k, v in big)
+  bsum += v
+println($"{big.len()} {bsum} {big.k0} {big.k49}")
+
+// serialization round trip
+let s = blob()
+s.writeobject({p = make(7), q = [make(8), make(9)]})
+s.seek(0)
+let r = s.readobject()
+println($"{r.p.x} {r.p.name} {r.q[1].y} {r.q.len()}")
@@ -168,6 +168,9 @@ def runSATest(compiler, workingDir, dirname, name):
 def runExecuteTest(compiler, workingDir, dirname, name):
     runTestGeneric(compiler, workingDir, dirname, name, "Exec", '.out', ["--check-stack"], True)
 
+def runChainFusionTest(compiler, workingDir, dirname, name):
+    runTestGeneric(compiler, workingDir, dirname, name, "Chain Fusion", '.out', ["--check-stack", "-optCF"], True)
+
 def runParseTypesTest(compiler, workingDir, dirname, name):
     runTestGeneric(compiler, workingDir, dirname, name, "Parse Types", '.out', ["--parse-types"], True)
 
@@ -194,6 +197,8 @@ def runTestForData(filePath, compiler, workingDir, testMode):
             runDiagTest(compiler, workingDir, dirname, name)
         elif testMode == 'exec':
             runExecuteTest(compiler, workingDir, dirname, name)
+        elif testMode == 'chain_fusion':
+            runChainFusionTest(compiler, workingDir, dirname, name)
         elif testMode == 'types':
             runParseTypesTest(compiler, workingDir, dirname, name)
         elif testMode == 'sa':
@@ -249,6 +254,7 @@ def main():
 
     allTests = []
     allTests += collectTests('exec', 'exec')
+    allTests += collectTests('chain_fusion', 'chain_fusion')
     allTests += collectTests('diagnostics', 'diag')
     allTests += collectTests('ast', 'ast')
     allTests += collectTests('static_analyzer', 'sa')